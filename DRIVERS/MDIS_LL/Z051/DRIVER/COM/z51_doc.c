@@ -74,7 +74,8 @@
     - Channel 1: DAC channel B
     - Channel 2: DAC channels A and B
 
-    Note: M_setstat() and M_getstat() can only be used for channel 0 or 1.
+    Note: M_setstat() and M_getstat() codes which refer to a single DAC
+    channel (e.g. Z51_OFFSET) can only be used for channel 0 or 1.
 
     Using M_write() a 16-bit value can be written on channels 0 and 1 which
     determines the voltage/current on DAC channel A or B respectively.
@@ -88,6 +89,498 @@
     Writing on channel 2 causes both DAC channels to be updated simultaneously.
 
 
+    \n \subsection multiunit Multiple DAC Units
+
+    An FPGA design may place several 16Z051 units in the address space of
+    one device. Descriptor key Z51_UNITS sets their number (up to
+    Z51_UNITS_MAX), Z51_UNIT_OFFSET_n the offset of unit n's registers
+    (default n * 0x10). Each unit has the three logical channels above,
+    numbered 3 * unit + 0..2 (see Z51_CH()). With more than one unit an
+    additional group channel Z51_CH_GROUP(units) follows the last unit's
+    channels.
+
+    M_write() on the group channel writes its 32-bit argument to both
+    outputs of all units. A block write frame on the group channel holds
+    one 32-bit value ((B << 16) | A) per unit, unit 0 first. Output A of
+    all units is buffered first, then all units load both outputs, so a
+    whole bank is updated with one call and one lock per frame. The group
+    channel uses the block write settings of channel 0.
+
+    The calibration of the outputs is set by descriptor keys
+    Z51_OFFSET_n/Z51_GAIN_n, where n = 2 * unit for output A and
+    2 * unit + 1 for output B. Waveform playback, asynchronous block writes,
+    synchronized start and the sequencer are available on the channels of
+    unit 0 only; block GetStat/SetStat Z51_BLK_STATUS address the unit of
+    the current channel (unit 0 for the group channel). Raw command words
+    are written to the unit of the current channel.
+
+
+    \n \subsection combining Write Combining
+
+    Applications updating output A and B of a unit on separate paths
+    cause one load frame per M_write() and a skew between the outputs.
+    With SetStat Z51_COMBINE_WINDOW (descriptor key Z51_COMBINE_WINDOW)
+    set to a window of 1..Z51_COMBINE_MAX us, M_write() on output A or B
+    only buffers the value and waits up to the window for a write of the
+    other output of the same unit. That write buffers its value and loads
+    both outputs with one frame (DAC_CMD_LOAD_AB), and both calls return.
+    Either output may come first. The waiting call doesn't lock the
+    device, but it occupies its CPU for up to the window.
+
+    If the window passes without a write of the other output, the waiting
+    call loads its output itself: the value is output one window late and
+    costs two frames. So with combining on, every write that finds no
+    partner is delayed by the full window, both its output and the return
+    of M_write(); only enable it if the outputs are mostly written in
+    pairs. The window is measured from the call with the driver's clock. A second write of the same output while one is
+    waiting, or other output on the unit (pair or group channel, block
+    writes, playback), loads the buffered value first. Each buffered
+    value is counted once: GetStat Z51_COMBINE_HITS returns the number
+    loaded together with the other output (one frame saved each),
+    Z51_COMBINE_MISSES the number loaded alone, so the hit rate is
+    HITS / (HITS + MISSES). SetStat Z51_COMBINE_HITS resets both. The
+    window is off (0) by default. A value still buffered when the safe
+    state is entered is dropped, and the waiting call returns
+    ERR_LL_DEV_NOTRDY.
+
+
+    \n \subsection priority Priority Classes
+
+    Calls on a device are serialized (see \ref locking), so an M_write()
+    of a control loop would wait until a synchronous block write on
+    another path has output all its values. SetStat Z51_WRITE_PRIO sets
+    the priority class of M_write() on the current channel:
+    - Z51_PRIO_NORMAL: wait for calls in progress (default)
+    - Z51_PRIO_HIGH: don't wait for calls in progress, output the value
+      between two of their frames
+
+    Block writes, waveform playback and the timer hold the driver's
+    scheduler lock for one frame at a time (Z51_FMT_RAW without sample
+    period: 64 command words), so a high priority write is delayed by at
+    most one frame and the stream continues right after it, delayed by
+    the write. A high priority write doesn't wait for write combining;
+    the first write after open or after a malfunction initializes the DAC
+    as a normal write. The class applies to M_write() only; block writes
+    on the channel are not affected.
+
+    Block GetStat Z51_BLK_PRIO_STATS returns one Z51_PRIO_STATS per class
+    with the number of writes and the maximum and summed latency from the
+    call until the value was written [us]; SetStat Z51_PRIO_CLR resets
+    them. The latency has a resolution of 1us on Linux and of the system
+    tick elsewhere.
+
+
+    \n \subsection blockwrite Block Write and Interpolation
+
+    Using M_setblock() a sequence of values can be written in one call. On
+    channels 0 and 1 the buffer holds 16-bit values, on channel 2 32-bit
+    values composed like the M_write() argument. The values are output one
+    after another, spaced by Z51_SAMPLE_PERIOD microseconds (0..1000000,
+    0 = as fast as possible). Each value is due at the block start plus a
+    multiple of the period, so processing time doesn't add up over a
+    block; a value late by more than a period restarts the spacing. While
+    waiting for the next value the device is unlocked, so calls on other
+    paths are served in between.
+
+    The driver can upsample the data: every input value is expanded into
+    Z51_INTERP_FACTOR (1..256) output values which are interpolated between
+    the previous and the current input value according to Z51_INTERP_MODE:
+    - 0: zero-order hold (the input value is repeated)
+    - 1: linear interpolation
+    - 2: cubic interpolation (Catmull-Rom spline)
+
+    Interpolation is done in fixed-point arithmetic on the uncalibrated
+    values, the results are calibrated as described below. The interpolation
+    continues seamlessly over consecutive blocks; M_write() or changing mode
+    or factor restarts it from the next input value. Channel 2 uses the
+    settings of channel 0 for both outputs.
+
+    \n \subsection blkformat Encoded Block Format
+
+    Waveforms consisting mostly of plateaus and slow ramps can be written in
+    a compact encoded format. After SetStat Z51_BLK_FORMAT is set to
+    Z51_FMT_RLE on channel 0 or 1, M_setblock() expects a byte stream of
+    run-length holds, 7-bit signed deltas and raw 16-bit escapes (see
+    z51_drv.h). The driver expands it on the fly into input values, which
+    are then interpolated and calibrated as usual. Tokens may be split
+    across consecutive M_setblock() calls. A reserved tag fails the call
+    with ERR_LL_ILL_PARAM after the values before it were output; the
+    decoder starts over with the next M_setblock().
+
+    The user library z51_api provides Z51_RleEncode() to encode values and
+    Z51_RleDecode() to check encoded data. The program z51_bench measures
+    compression ratio and throughput for typical profiles.
+
+    \n \subsection rawformat Raw Command Words
+
+    For waveforms calibrated offline, Z51_BLK_FORMAT Z51_FMT_RAW makes
+    M_setblock() take complete 32-bit DAC command words: load bits, buffer
+    select, powerdown bits and the calibrated 16-bit value (Z51_RAW_xxx in
+    z51_drv.h). The driver checks all words of a block at once and rejects
+    the whole block with ERR_LL_ILL_PARAM if any word has other bits set.
+    The words are then written unchanged, spaced by Z51_SAMPLE_PERIOD or
+    back to back if the period is 0. Interpolation, calibration and the
+    driver's powerdown state and output values (Z51_BLK_STATUS) are not
+    involved. Raw blocks cannot be queued asynchronously.
+
+    \n \subsection units Signed Values and Engineering Units
+
+    With Z51_BLK_FORMAT set to Z51_FMT_S16, block writes (also asynchronous
+    ones, and on channel 2 for both halves of each frame) expect signed
+    16-bit values: -0x8000 selects the lowest and 0x7fff the highest output
+    value. The driver converts them to input values while reading the block.
+
+    Floating point values in engineering units (e.g. volts or milliamps) are
+    converted in user space by Z51_UnitsToCode() of the z51_api library. The
+    channel's unit range is given as the values corresponding to input value
+    0x0000 and 0xffff; results are rounded, saturated and then written in
+    format Z51_FMT_NATIVE, so the driver calibrates them like any other
+    value. On SSE2 capable CPUs the conversion is vectorized. The scalar
+    Z51_UnitsToCodeRef() is the reference; "z51_bench units" checks that
+    both give bit-exact results and compares their throughput.
+
+    \n \subsection wavecache Waveform Cache and Playback
+
+    Waveforms which are output repeatedly can be uploaded once into a
+    driver-side cache and then be played back by a single SetStat call
+    without copying data again.
+
+    A waveform is uploaded with block SetStat Z51_BLK_WAVE_LOAD. The block
+    starts with a Z51_WAVE_HDR containing the waveform ID (0..0xffff, other
+    IDs are rejected with ERR_LL_ILL_PARAM), followed by the values: 16-bit values if uploaded on channel 0 or 1,
+    32-bit values ((B << 16) | A) if uploaded on channel 2. Uploading an ID
+    again replaces the cached waveform. Z51_WAVE_DELETE removes it.
+
+    The total size of all cached waveforms is limited by descriptor key
+    Z51_WAVE_MEM, at most Z51_WAVE_MAX waveforms are cached. If an upload
+    exceeds the limits, the least recently used waveforms are evicted; the
+    playing waveform is never evicted.
+
+    The cache memory, the waveform table and the asynchronous queues are
+    reserved as one block at Z51_Init() and released at M_close(); the
+    driver does not allocate memory while the device is in use. Waveforms
+    are stored in a pool of blocks of Z51_POOL_BLOCK bytes, which are taken
+    and returned in constant time, so uploads and evictions never fragment
+    memory. Each waveform occupies whole blocks. GetStat Z51_POOL_FREE
+    returns the number of free blocks, Z51_POOL_HWM the maximum number of
+    used blocks and Z51_ASYNC_HWM the maximum fill level of a channel's
+    asynchronous queue; SetStat on the high-water marks resets them to the
+    current level.
+
+    SetStat Z51_WAVE_START starts playback on the current channel. Its
+    argument contains the ID and the number of passes (0 = endless), see
+    Z51_WAVE_START_ARG(). A 16-bit waveform can be played on channel 0 or 1,
+    a 32-bit waveform on channel 2. The values are calibrated and output
+    every Z51_SAMPLE_PERIOD microseconds (channel 2: period of channel 0;
+    0 = one value per timer tick). Starting a waveform replaces a running
+    playback of the channel. Z51_WAVE_STOP stops it (on channel 2: both
+    channels), the output keeps its last value.
+
+    Channel 0 and 1 have independent players: each can play its own
+    waveform or asynchronous stream with its own sample period, e.g. a slow
+    bias on one channel and a fast stimulus on the other. Channel 2 drives
+    both outputs in lockstep and therefore can only be started while
+    channel 1 is idle (and vice versa), otherwise ERR_LL_DEV_BUSY is
+    returned.
+
+    Playback runs from a single driver timer with a period of Z51_TICK_MS
+    milliseconds, which serves both players in the order of their
+    deadlines. When the deadlines of channel 0 and 1 coincide, both values
+    are output with one combined load command. The timer doesn't wait
+    within a tick: values due within the same tick are output back to back
+    at its start, so sample periods below Z51_TICK_MS give bursts of values
+    per tick. M_setblock() paces each value in the caller's context instead.
+
+    GetStat Z51_WAVE_STATE returns the ID of the playing waveform (-1 if
+    idle), Z51_WAVE_MEM_USED the used cache memory and block GetStat
+    Z51_BLK_WAVE_INFO a Z51_WAVE_INFO entry for each cached waveform.
+
+    \n \subsection syncstart Synchronized Start
+
+    Playback on several Z51 devices can be started simultaneously. On each
+    device the waveform is armed with SetStat Z51_SYNC_ARM, which takes the
+    same argument as Z51_WAVE_START. Arming writes the first frame into the
+    DAC's input buffers (DAC_CMD_BUF_A/B) without loading the outputs.
+
+    A single SetStat Z51_SYNC_TRIGGER on any Z51 path then releases all
+    armed devices of this driver at the deadline given as argument (delay
+    in microseconds, max. 100000), and returns without waiting. The
+    playback timer of an armed device keeps running; each timer loads its
+    device's staged frames at its first tick at or after the deadline and
+    plays the waveform from there. The timers of different devices are not
+    in phase, so the devices are released up to one Z51_TICK_MS apart.
+
+    GetStat Z51_SYNC_LATE returns the device's release time relative to
+    the deadline in microseconds (ERR_LL_DEV_BUSY while the release is
+    pending). GetStat Z51_SYNC_SKEW returns the spread of the release times
+    of all devices released by the last trigger, i.e. the latest minus the
+    earliest release. It fails with ERR_LL_DEV_BUSY while one of them is
+    pending and with ERR_LL_DEV_NOTRDY on a device that the last trigger
+    did not release. The timestamps are taken from the kernel's monotonic
+    clock on Linux, on other systems the resolution is one OSS tick.
+    Z51_WAVE_STOP disarms a device; z51_bench sync measures the lateness
+    and the spread of several devices.
+
+    \n \subsection asyncwrite Asynchronous Block Write
+
+    With SetStat Z51_BLK_ASYNC set to 1, M_setblock() does not wait until
+    the values have been output. The block (Z51_FMT_NATIVE only) is copied
+    into the channel's queue of Z51_ASYNC_FRAMES values and the call
+    returns at once. The playback timer outputs the queued values with the
+    sample period and interpolation settings of the channel. If the block
+    does not fit into the queue, or a waveform is playing on the channel,
+    M_setblock() fails with ERR_LL_DEV_BUSY and nothing is queued.
+
+    Channel 0 and 1 have separate queues, channel 2 uses the queue of
+    channel 0 while it is empty. The ticket and queue codes below refer to
+    the current channel.
+
+    Z51_BLK_ASYNC is a mode of the device, not of the path: it applies to
+    M_setblock() on all paths opened on the device until it is cleared.
+
+    Every queued block gets a ticket, a counter which GetStat
+    Z51_ASYNC_TICKET returns right after M_setblock(). If several threads
+    queue blocks on the same channel, another block may be queued in
+    between; block GetStat Z51_BLK_ASYNC_SUBMIT queues the frames following
+    a Z51_ASYNC_HDR (independent of Z51_BLK_ASYNC) and returns the block's
+    ticket in the header with the same call. GetStat
+    Z51_ASYNC_DONE returns the ticket of the last completely output block,
+    Z51_ASYNC_COMPLETED() compares both. Z51_ASYNC_FREE returns the free
+    queue space in values. Optionally a signal installed with
+    Z51_ASYNC_SIG_SET is sent whenever a block is completed.
+
+    Z51_WAVE_STOP discards all queued blocks; they are reported as
+    completed. If the queue runs empty, the underrun policy applies (see
+    below).
+
+    The header z51_coro.hpp contains a C++20 wrapper which exposes the
+    submission (Z51_BLK_ASYNC_SUBMIT) and completion of blocks as awaitable
+    objects, so a single thread can feed several devices from coroutines.
+    It leaves the Z51_BLK_ASYNC mode of the device unchanged.
+
+    \n \subsection underrun Underrun Handling
+
+    If the asynchronous queue runs empty, this is counted as an underrun
+    unless SetStat Z51_ASYNC_EOS announced the end of the stream before.
+    The reaction is selected per channel with SetStat Z51_UNDERRUN_MODE
+    (channel 2: setting of channel 0):
+    - 0: hold the last value (default)
+    - 1: repeat the last block until new data is queued; the queue space
+         of the last completed block stays reserved for this
+    - 2: ramp linearly within Z51_RAMP_LEN values to Z51_SAFE_VALUE
+    - 3: power down the output with the channel's Z51_SAFE_PD mode (mode 1,
+         1 kOhm to GND, if Z51_SAFE_PD is 0) like Z51_POWERDOWN, which
+         GetStat Z51_POWERDOWN then returns; the next output value powers
+         it up again
+
+    Each time the queue runs dry only one underrun is counted until new
+    data is queued. Additionally the driver counts values of playback and
+    asynchronous output which are output more than one sample period (one
+    timer tick if the period is 0) after their deadline, and records the
+    maximum lateness. GetStat Z51_UNDERRUNS, Z51_LATE_COUNT and Z51_LATE_MAX
+    return the counters, SetStat Z51_UNDERRUNS resets them. A signal
+    installed with Z51_UNDERRUN_SIG_SET is sent on every underrun; it is
+    separate from the hardware malfunction signal (Z51_SET_SIGNAL).
+
+    \n \subsection safestate Safe State
+
+    SetStat Z51_SAFE_STATE 1 puts the whole device into a preconfigured
+    safe state within one call: the command sequencer and waveform
+    playback are stopped, queued asynchronous blocks are discarded (their
+    tickets complete, Z51_ASYNC_SIG_SET is sent) and each output is set to
+    its Z51_SAFE_VALUE, or powered down if its Z51_SAFE_PD mode (1..3, see
+    \ref powerdown) is not 0. All units are loaded together with one
+    register write per unit. The call doesn't wait for other calls on the
+    path, e.g. a synchronous block write in progress; that call stops at
+    its next value and returns ERR_LL_DEV_NOTRDY. So the time to safe is
+    bounded by the register writes, independent of the output queued.
+
+    In the safe state M_write(), M_setblock() and the SetStat codes
+    starting output (Z51_POWERDOWN, Z51_WAVE_START, Z51_SYNC_ARM,
+    Z51_SEQ_START, block Z51_BLK_STATUS) fail with ERR_LL_DEV_NOTRDY;
+    configuration is still possible. SetStat Z51_SAFE_STATE 0 leaves it,
+    the outputs keep the safe values until written again. Block GetStat
+    Z51_BLK_STATUS reports the state with Z51_STATUS_SAFE.
+
+    With Z51_SAFE_ON_FAULT set to 1 the interrupt routine enters the safe
+    state on a hardware malfunction (see \ref interrupt), reinitializing
+    the faulty unit first. GetStat Z51_SAFE_TIME returns the longest time
+    to safe measured by the driver [us], SetStat Z51_SAFE_TIME resets it.
+
+    A Z51_SAFE of the z51_api library fires the safe state of several
+    devices in parallel: Z51_SafeCreate() starts one waiting helper thread
+    per device, Z51_SafeFire() wakes them, sets the first device itself
+    and returns the time until all were safe. "z51_bench safe" compares
+    this with setting the devices one after the other while they play a
+    waveform, and reports the driver's worst case per device.
+
+    \n \subsection markers Marker Events
+
+    Markers tag single frames of the output so the application learns when
+    exactly a frame reached the DAC. SetStat Z51_BLK_MARKER_SET adds up to
+    Z51_MARKER_MAX markers (Z51_MARKER entries), either all or none:
+    - Z51_MARK_WAVE: frame of a cached waveform (target = waveform ID);
+      fires each time the frame is played, on every loop
+    - Z51_MARK_BLOCK: frame of a block queued on the current channel
+      (target = ticket from Z51_ASYNC_TICKET); fires once and is removed,
+      or is discarded with the queue by Z51_WAVE_STOP
+
+    When a marked frame is written, the playback timer records a
+    Z51_MARK_EVENT with the marker ID and the Z51_MARKER_TIME timestamp
+    [us] taken right after the write. With interpolation, a queued frame is
+    written with the last interpolation step. Up to Z51_MARK_EVENTS events
+    are buffered; GetStat Z51_BLK_MARKER_EVENTS takes the oldest ones,
+    Z51_MARKER_COUNT returns the number buffered and Z51_MARKER_LOST the
+    number lost because the buffer was full. A signal installed with
+    Z51_MARKER_SIG_SET is sent after each frame with markers. SetStat
+    Z51_MARKER_CLR removes all markers.
+
+    \n \subsection sequencer Command Sequencer
+
+    For output patterns with exact timing between single DAC commands, a
+    program of up to Z51_SEQ_MAX steps (Z51_SEQ_STEP, see \ref seq_ops) is
+    loaded with block SetStat Z51_BLK_SEQ_LOAD. The driver validates the
+    whole program once: unknown operations, illegal channels or values,
+    loops without a wait step and load steps without a preceding stage step
+    are rejected with ERR_LL_ILL_PARAM, and a running program cannot be
+    replaced. The sequencer codes are only available on the channels of
+    unit 0 (ERR_LL_ILL_CHAN otherwise).
+
+    SetStat Z51_SEQ_START runs the program from its first step within the
+    playback timer. Steps are executed back to back until a Z51_SEQ_WAIT
+    step; the following steps are due after the given time, which is kept
+    with microsecond spacing like the samples of waveform playback. Steps
+    due at the same time as a playback frame are executed first.
+    Z51_SEQ_STAGE and Z51_SEQ_LOAD use the DAC's buffer and load commands,
+    so both outputs can be updated at the same instant. Values are
+    calibrated like M_write() values. A load step rewrites the last buffer
+    it loads (A for arg 1, else B) with the value staged for it, so on
+    every path to the load step a Z51_SEQ_STAGE of that channel must come
+    after the previous load step or Z51_SEQ_WRITE of the channel; a loop
+    jumping back over the load step must contain the stage step.
+
+    GetStat Z51_SEQ_STATE returns the index of the next step or -1 when the
+    program has ended or was stopped with SetStat Z51_SEQ_STOP. Block
+    GetStat Z51_BLK_SEQ_TIMING returns a Z51_SEQ_TIMING per step with the
+    number of executions, the time of the last execution since the start,
+    and how late it was executed. A signal installed with Z51_SEQ_SIG_SET
+    is sent by Z51_SEQ_SIGNAL steps.
+
+    \n \subsection status Status Snapshot
+
+    Block GetStat Z51_BLK_STATUS returns a Z51_STATUS structure with the
+    calibration and calibration profile, powerdown mode, safe state settings
+    and last output value of both DAC channels, the debug level, installed
+    signals, safe and malfunction state, the interrupt, underrun and
+    deadline counters, and the size and usage of the waveform cache. All members are sampled together with
+    playback locked, so a monitor gets a consistent view with one call. The
+    output value is the uncalibrated value last loaded to the output.
+
+    Block SetStat Z51_BLK_STATUS applies calibration, calibration profiles,
+    powerdown modes, safe state settings and debug level from such a
+    structure at once; read-only members are ignored, so a snapshot can be
+    modified and written back. The structure starts with
+    Z51_STATUS_VERSION; a block with another version, a value out of range
+    or a profile which is not loaded is rejected with ERR_LL_ILL_PARAM.
+    A block smaller than Z51_STATUS is rejected with ERR_LL_USERBUF
+    (GetStat) or ERR_LL_ILL_PARAM (SetStat).
+
+    \n \subsection cpp C++ Interface
+
+    The header-only z51.hpp wraps the MDIS calls for C++17 applications.
+    z51::Path owns an MDIS path and closes it on destruction; it is
+    movable, but not copyable. z51::Channel<ch> opens its own path with
+    channel ch selected once, so each write is a single MDIS call. Its
+    value type (u_int16, or u_int32 for channels driving both outputs) and
+    the packing of z51::Channel<2>::write(a, b) are fixed at compile time;
+    settings which only exist for single outputs do not compile on channels
+    driving both. Block writes take a z51::Span of values, e.g. a
+    std::vector, which is passed to M_setblock() without copy.
+    z51::Group<units> addresses the group channel. z51::calibrate() is a
+    constexpr version of the driver's calibration. Errors are thrown as
+    z51::Error.
+
+    \n \subsection mpsc Submission Queue
+
+    MDIS paths are not meant to be shared by threads: the current channel
+    is part of the path. When many threads update outputs of one device,
+    they can submit the updates to a Z51_MPSC queue of the z51_api library
+    instead, and a single dispatcher thread owns the path.
+
+    Z51_MpscPut() and Z51_MpscPutAt() take a channel and a value as for
+    M_write() and never block: the queue is a bounded lock-free ring, a
+    full queue is reported to the producer (-1) and counted. An update
+    with a deadline (UOS_MsecTimerGet() time) is dropped when the
+    dispatcher takes it too late.
+
+    Z51_MpscDispatch() takes all queued updates and keeps only the newest
+    one per channel. Both outputs of a unit changed are written at once
+    over the unit's channel driving both, several changed units by one
+    frame on the group channel (using the block settings of channel 0,
+    which must be the defaults). Z51_MpscDrain() returns the coalesced
+    updates instead, for dispatchers writing them differently.
+    Z51_MpscStats() returns the counters; "z51_bench mpsc" compares the
+    queue with threads sharing a path under a mutex.
+
+    \n \subsection mixer Waveform Mixer
+
+    A Z51_MIXER of the z51_api library sums up to Z51_MIX_LAYERS_MAX
+    layers into one stream, e.g. a bias ramp, a stimulus and a dither for
+    one output. Layers are buffers of values (once or looped), sine
+    generators (DDS with a 32-bit phase step), linear ramps holding their
+    end value, or noise; each has its own gain (Z51_MIX_GAIN_ONE = 1.0).
+    Values are signed, so Z51_MixerRender() output is written with block
+    format Z51_FMT_S16 (or as 0x8000 ^ value with M_write()); the driver
+    calibrates the sum as any other value.
+
+    Rendering generates one layer at a time in chunks that stay in the
+    cache and adds it with saturation, eight values per SSE2 instruction,
+    so each layer adds about the same cost. Other threads may add and
+    remove layers or change gains while a thread renders; changes apply
+    from the next chunk. "z51_bench mix" shows the cost per layer.
+
+    \n \subsection pacing Output Pacing
+
+    Loops writing one value per period with UOS_Delay() drift by the loop
+    body and the wake-up latency of each sleep, and can't go below 1ms. A
+    Z51_PACE of the z51_api library waits for absolute deadlines on a
+    monotonic nanosecond clock (Z51_NsecTimerGet()): Z51_PaceWait() sleeps
+    until shortly before the deadline and spins the rest
+    (Z51_PACE_SPIN_DEFAULT), so the rate holds over any run time. A loop
+    that overran its deadline continues at once; whole periods missed are
+    skipped and returned, so the caller can keep the waveform in time
+    instead of catching up with a burst. Z51_PaceStats() counts overruns,
+    skipped periods and the delay after the deadlines. At 10..100kHz the
+    period is within the spin tail, so the loop occupies one CPU.
+    z51_simp uses a pacer for its sawtooth; "z51_bench pace" shows drift
+    and delays against UOS_Delay() loops.
+
+    \n \subsection z51d Output Server
+
+    Opening a path initializes the device, and paths of different
+    processes contend for the device. Hosts running many short-lived
+    processes can start the server z51d instead, which keeps the devices
+    open. Processes use the z51d_api library (POSIX only): Z51D_Open()
+    connects to the server's Unix socket (Z51D_SOCKET or $Z51D_SOCKET) and
+    opens a session for one channel. The server reserves the outputs the
+    channel drives, so overlapping channels of other sessions, including
+    the group channel, are rejected with ERR_LL_DEV_BUSY until the session
+    is closed.
+
+    Z51D_Write() and Z51D_WriteAt() put values into a ring in shared memory
+    without a system call while the server is busy; the sleeping server is
+    woken by its doorbell pipe. The server moves the values of all sessions
+    of a device into a submission queue and writes them as
+    Z51_MpscDispatch() does: only the newest value per channel, several
+    outputs by one pair or group channel write. The server takes at most
+    a few hundred values of a ring per pass, so one busy session doesn't
+    hold up the others, and it closes a session whose ring head is more
+    than one ring ahead. Z51D_Flush() waits until the values are output
+    and returns write errors as MDIS error codes. Z51D_SetStat() and
+    Z51D_GetStat() are limited to Z51_OFFSET, Z51_GAIN and Z51_POWERDOWN of
+    the session's single output. "z51_bench z51d" compares open and write
+    times with direct access.
+
     \n \subsection calibration Calibration
     Calibration of the DACs is done by default values for gain and offset
     which are compiled into the driver. If necessary these can be overwritten
@@ -107,6 +600,42 @@
     \n If Z51_GAIN is zero, then no calibration is done. In this case the
     values given by M_write() are written to the DAC without change.
 
+    \n \subsection calprofiles Calibration Profiles
+    Besides this linear correction (profile 0), each output can hold up
+    to Z51_CAL_PROFILES further profiles, e.g. one per output range or
+    load, which also correct the nonlinearity of the DAC. A profile is a
+    list of 2..Z51_CAL_POINTS_MAX points (Z51_CAL_POINT): for the value
+    \a in given by M_write() the DAC is loaded with \a out. Between the
+    points the driver interpolates linearly, below the first and above
+    the last point it holds their \a out. The \a in values must ascend by
+    at least Z51_CAL_SPACING (see \ref cal_profiles).
+
+    Profiles are loaded from the descriptor keys Z51_CAL_n_p_k or with the
+    block SetStat Z51_BLK_CAL_LOAD (a Z51_CAL_HDR followed by the points,
+    0 points delete the profile), which also reads them back as a block
+    GetStat. Z51_CAL_PROFILE selects the profile of a channel; descriptor
+    key Z51_CAL_n selects it at init. The selected profile cannot be
+    reloaded (ERR_LL_DEV_BUSY): load the new points into another profile
+    and select that one, which switches atomically. Deleting the selected
+    profile falls back to profile 0.
+
+    \code
+    struct { Z51_CAL_HDR hdr; Z51_CAL_POINT pt[3]; } cal =
+        { { 1, 3 }, { { 0, 0x1985 }, { 0x8000, 0x7420 }, { 0xffff, 0xe7c2 } } };
+    M_SG_BLOCK blk = { sizeof(cal), &cal };
+
+    M_setstat( path, M_MK_CH_CURRENT, 0 );
+    M_setstat( path, Z51_BLK_CAL_LOAD, (INT32_OR_64)&blk );
+    M_setstat( path, Z51_CAL_PROFILE, 1 );      // 0: offset/gain
+    \endcode
+
+    Loading compiles the points into a table of segments, indexed by the
+    high byte of the value, held in the memory reserved at init. Per value
+    a lookup costs one index, one compare and one multiply, whatever the
+    number of points, and switching profiles only changes the pointer the
+    output paths use. The output is exact at the points and within 1 LSB
+    of the straight line between them.
+
 
     \n \subsection interrupt Interrupt handling
 
@@ -160,8 +689,42 @@
     malfunction, a signal is optionally sended to the application and the
     interrupt is disabled until the next M_write() call.
 
+    \n Since that M_write() waits for the watchdog again, each fault costs
+    about 1000ms of output. The soak test z51_soak measures this without
+    hardware: it runs the driver (built with switch Z51_SIM) on a simulated
+    register window, injects single, burst, periodic or scripted faults
+    while writing at a fixed period and reports per pattern the time to
+    recover, lost and blocked writes and the throughput against a run
+    without faults. Time is virtual, so the runs are fast and reproducible,
+    and changes to the fault handling can be compared by their numbers.
+
+    \n \subsection replay Trace Replay
+    The program z51_replay replays a trace of M_write(), M_setblock() and
+    M_setstat() calls against the driver on the simulated register window
+    of z51_soak. A trace is a text file with one call per line: the time
+    [us], the call, the channel and the value, setstat code or block data
+    (hex bytes). Calls are issued at their recorded time, divided by a
+    speed-up factor (-s), or back to back (-s=0); a call that starts late
+    because the previous one blocked is counted as lag. The program reports
+    the latency of each call type (each call with -v) in virtual time.
+
+    With -o it saves the resulting DAC_CTRL_REG writes, each with its time,
+    unit and the trace line of the call. Replaying the same trace with two
+    driver builds and comparing the saved streams (-c) shows the first
+    differing write, the number of differences and how far equal writes
+    moved in time, so a driver change can be checked for changed output or
+    timing before it runs on hardware.
+
+    A call can be followed by '= <error>', the error it must return.
+    TOOLS/Z51_REPLAY/TEST holds regression traces (*.trc) with the stream
+    they must produce (*.str); each trace names its check command.
+
     \n \subsection locking Locking Mode
-    This driver uses call-locking.
+    This driver uses no MDIS locking (LL_LOCK_NONE) but locks each call
+    itself with the device semaphore, so calls are serialized as with
+    call-locking. Only SetStat Z51_SAFE_STATE 1 (see \ref safestate) and
+    M_write() of priority class Z51_PRIO_HIGH (see \ref priority) bypass
+    this lock.
 
     \n \section api_functions Supported API Functions
 
@@ -222,16 +785,84 @@
         <td>Gain value for calibration</td>
         <td>0..0xffff, default: 0xCDD3</td>
     </tr>
+    <tr><td>Z51_OFFSET_n, Z51_GAIN_n</td>
+        <td>Calibration of further units' outputs (n = 2..2*Z51_UNITS-1)</td>
+        <td>0..0xffff, default: as for n = 0 (even) or 1 (odd)</td>
+    </tr>
+    <tr><td>Z51_CAL_n_p_k</td>
+        <td>Point k (0..Z51_CAL_POINTS_MAX-1, up to the first missing) of
+            calibration profile p (1..Z51_CAL_PROFILES) of output n,
+            Z51_CAL_KEY(in,out)</td>
+        <td>(in << 16) | out, default: profile empty</td>
+    </tr>
+    <tr><td>Z51_CAL_n</td>
+        <td>Calibration profile of output n at init</td>
+        <td>0..Z51_CAL_PROFILES (loaded), default: 0 (offset/gain)</td>
+    </tr>
+    <tr><td>Z51_SAFE_VALUE_n</td>
+        <td>Safe value of output n (see \ref safestate)</td>
+        <td>0..0xffff, default: 0</td>
+    </tr>
+    <tr><td>Z51_SAFE_PD_n</td>
+        <td>Powerdown mode of output n in the safe state</td>
+        <td>0..3, default: 0 (Z51_SAFE_VALUE_n)</td>
+    </tr>
+    <tr><td>Z51_SAFE_ON_FAULT</td>
+        <td>Enter the safe state on hardware malfunction</td>
+        <td>0..1, default: 0</td>
+    </tr>
+    <tr><td>Z51_COMBINE_WINDOW</td>
+        <td>Write combining window [us] (see \ref combining)</td>
+        <td>0..Z51_COMBINE_MAX, default: 0 (off)</td>
+    </tr>
+    <tr><td>Z51_UNITS</td>
+        <td>Number of 16Z051 units in the address space</td>
+        <td>1..Z51_UNITS_MAX, default: 1</td>
+    </tr>
+    <tr><td>Z51_UNIT_OFFSET_n</td>
+        <td>Register offset of unit n</td>
+        <td>0..0xf0 (multiple of 4), default: n * 0x10</td>
+    </tr>
+    <tr><td>Z51_WAVE_MEM</td>
+        <td>Waveform cache size [bytes]</td>
+        <td>0..0x4000000, default: 0x10000</td>
+    </tr>
+    <tr><td>Z51_POOL_BLOCK</td>
+        <td>Waveform cache block size [bytes], rounded down to a power
+            of 2</td>
+        <td>64..0x10000, default: 0x400</td>
+    </tr>
+    <tr><td>Z51_TICK_MS</td>
+        <td>Playback timer period [ms]</td>
+        <td>1..n, default: 1</td>
+    </tr>
+    <tr><td>Z51_ASYNC_FRAMES</td>
+        <td>Asynchronous queue size [values], rounded down to a power of 2</td>
+        <td>2..0x100000, default: 0x4000</td>
+    </tr>
     </table>
 
 
     \n \section codes Z51 specific Getstat/Setstat codes
     see \ref getstat_setstat_codes "section about Getstat/Setstat codes"
+    and \ref getstat_setstat_blk_codes "section about block codes"
 
     \n \section Documents Overview of all Documents
 
     \subsection z51_simp  Simple example for using the driver
     z51_simp.c (see example section)
+
+    \subsection z51_bench  Benchmarks for driver and library
+    z51_bench.c
+
+    \subsection z51d_server  Output server
+    z51d.c
+
+    \subsection z51_soak  Fault-injection soak test
+    z51_soak.c, z51_sim.c
+
+    \subsection z51_replay  Trace replay
+    z51_replay.c
 */
 
 /** \example tmpl_simp.c
@@ -9,7 +9,7 @@
  *
  *     Required: OSS, DESC, DBG, ID libraries
  *
- *     \switches _ONE_NAMESPACE_PER_DRIVER_
+ *     \switches _ONE_NAMESPACE_PER_DRIVER_, Z51_SIM
  */
  /*
  *---------------------------------------------------------------------------
@@ -42,11 +42,28 @@
 #include <MEN/mdis_err.h>   /* MDIS error codes               */
 #include <MEN/ll_defs.h>    /* low-level driver definitions   */
 
+#if defined(LINUX) && defined(__KERNEL__)
+# include <linux/ktime.h>   /* fine grained timestamps        */
+#endif
+
+#ifdef Z51_SIM
+/* register accesses go to the simulated hardware of the soak test */
+# undef  MREAD_D32
+# undef  MWRITE_D32
+# define MREAD_D32(ma,offs)       Z51_SimRead( (ma), (offs) )
+# define MWRITE_D32(ma,offs,val)  Z51_SimWrite( (ma), (offs), (val) )
+extern u_int32 Z51_SimRead( MACCESS ma, u_int32 offs );
+extern void Z51_SimWrite( MACCESS ma, u_int32 offs, u_int32 val );
+#endif
+
 /*-----------------------------------------+
 |  DEFINES                                 |
 +-----------------------------------------*/
 /* general defines */
-#define CH_NUMBER           3           /**< number of device channels */
+#define UNIT_CHANNELS       3           /**< channels per DAC unit */
+#define UNITS_MAX           8           /**< max. DAC units (Z51_UNITS_MAX) */
+#define UNIT_REG_SIZE       0x10        /**< size of a unit's registers */
+#define CH_GROUP(h)         ((int32)(h)->units * UNIT_CHANNELS) /**< all units */
 #define USE_IRQ             TRUE        /**< interrupt required  */
 #define ADDRSPACE_COUNT     1           /**< nbr of required address spaces */
 #define ADDRSPACE_SIZE      256         /**< size of address space */
@@ -87,11 +104,261 @@
 #define DAC_CMD_PD_1K       0x010000    /* powerdown with out impedance 1kOhm */
 #define DAC_CMD_PD_100K     0x020000    /* powerdown 100kOhm */
 #define DAC_CMD_PD_HIGHZ    0x030000    /* powerdown high impedance */
+#define DAC_CMD_VALID       0x37ffff    /* load, buffer, powerdown and data */
+
+/* interpolation */
+#define INTERP_FRAC_BITS    10          /* fraction bits of spline parameter */
+
+/* encoded block format (see z51_drv.h) */
+#define RLE_CHUNK           64          /* decoded samples per output chunk */
+
+/* raw command words */
+#define RAW_CHUNK           64          /* words written per lock (period 0) */
+#define PERIOD_MAX          1000000     /* max. sample period [us] */
+
+/* lane records */
+#define CHAN_ALIGN          64          /* cache line size [bytes] */
+
+/* calibration profiles */
+#define CAL_POINTS_MAX      32          /* max. points (Z51_CAL_POINTS_MAX) */
+#define CAL_SEGS            (CAL_POINTS_MAX + 2) /* segments + end mark */
+#define CAL_BINS            256         /* lookup bins (high byte of value) */
+#define CAL_END             0x10000     /* start of end mark segment */
+#define CAL_IN(pt)          ((pt) >> 16)        /* in of a point */
+#define CAL_OUT(pt)         ((pt) & 0xffff)     /* out of a point */
+
+/* waveform playback */
+#define WAVE_MEM_DEFAULT    0x10000     /* default waveform memory [bytes] */
+#define WAVE_MEM_MAX        0x4000000   /* max. waveform memory [bytes] */
+#define POOL_BLOCK_DEFAULT  0x400       /* default pool block size [bytes] */
+#define POOL_BLOCK_MIN      64          /* min. pool block size [bytes] */
+#define POOL_BLOCK_MAX      0x10000     /* max. pool block size [bytes] */
+#define POOL_NIL            0xffffffff  /* end of block chain */
+#define TICK_MS_DEFAULT     1           /* default timer period [ms] */
+
+/* asynchronous block writes */
+#define ASYNC_FRAMES_DEFAULT 0x4000     /* default queue size [frames] */
+#define ASYNC_FRAMES_MAX    0x100000    /* max. queue size [frames] */
+#define ASYNC_BLOCKS        16          /* max. queued blocks (power of 2) */
+
+/* underrun handling */
+#define RAMP_LEN_DEFAULT    64          /* default ramp length [values] */
+
+/* priority classes of M_write() */
+#define PRIO_CLASSES        2           /* (Z51_PRIO_CLASSES) */
+#define CH_MAX              (UNITS_MAX * UNIT_CHANNELS + 1) /* incl. group */
+
+/* write combining */
+#define COMB_MAX            1000        /* max. window [us] (Z51_COMBINE_MAX) */
+#define COMB_LANE(pend)     (((pend) & 3) - 1)  /* lane of a pending write */
+
+/* lock state shared with the timer callback */
+#define LOCK_SCHED(state)   (state) = OSS_IrqMaskR( OSH, llHdl->irqHdl )
+#define UNLOCK_SCHED(state) OSS_IrqRestore( OSH, llHdl->irqHdl, (state) )
+
+/* device lock of the entry points (LL_LOCK_NONE) */
+#define LOCK_DEV()          OSS_SemWait( OSH, llHdl->devSem, OSS_SEM_WAITFOREVER )
+#define UNLOCK_DEV()        OSS_SemSignal( OSH, llHdl->devSem )
+
+/* synchronized start */
+#define SYNC_DELAY_MAX      100000      /* max. trigger delay [us] */
+
+/* command sequencer */
+#define SEQ_STEPS_MAX       64          /* max. program steps (Z51_SEQ_MAX) */
+
+/* marker events */
+#define MARK_MAX            32          /* max. markers (Z51_MARKER_MAX) */
+#define MARK_EVENTS         64          /* event queue (Z51_MARK_EVENTS) */
+#define MARK_WAVE           0           /* see Z51_MARK_WAVE */
+#define MARK_BLOCK          1           /* see Z51_MARK_BLOCK */
+#define SEQ_WAIT_MAX        1000000     /* max. wait step [us] */
+
+/* player states */
+#define PLAY_ACTIVE(p)      (((p)->wave || (p)->stream) && !(p)->armed)
+#define PLAY_BUSY(p)        ((p)->wave || (p)->stream || (p)->armed)
+
+/* powerdown mode of a lane on underrun: Z51_SAFE_PD, 1 if that is 0 */
+#define UNDER_PD(c)         ((c)->safePd ? (c)->safePd : 1)
+
+/* wrap-around safe comparison of microsecond timestamps */
+#define US_BEFORE(a,b)      ((int32)((a) - (b)) < 0)
 
 
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +-----------------------------------------*/
+/** state of the streaming decoder for Z51_FMT_RLE blocks */
+typedef struct {
+    u_int16         prev;           /**< last decoded value */
+    u_int32         holdLeft;       /**< repetitions left of current hold */
+    u_int8          tok[3];         /**< bytes of incomplete token */
+    u_int32         tokLen;         /**< number of bytes in tok[] */
+} RLE_DEC;
+
+/** segment of a compiled calibration profile */
+typedef struct {
+    u_int32         x;              /**< first input value */
+    u_int16         y;              /**< output at x */
+    u_int16         neg;            /**< output decreases */
+    u_int32         slope;          /**< |dy/dx| << 16 */
+} CAL_SEG;
+
+/**
+ * compiled calibration profile
+ *
+ * first[] holds the last segment starting at or below each multiple of
+ * CAL_BINS, so a lookup is one index, one compare and one multiply.
+ */
+typedef struct {
+    u_int8          first[CAL_BINS];    /**< segment of value & 0xff00 */
+    CAL_SEG         seg[CAL_SEGS];      /**< segments, end mark */
+    u_int32         points;             /**< number of points, 0 = unused */
+    u_int32         point[CAL_POINTS_MAX]; /**< points as loaded */
+} CAL_PROFILE;
+
+/** cached waveform */
+typedef struct {
+    int             used;           /**< entry in use */
+    u_int32         id;             /**< waveform ID */
+    u_int32         width;          /**< bytes per frame (2: ch 0/1, 4: ch 2) */
+    u_int32         frames;         /**< number of frames */
+    u_int32         first;          /**< first pool block of frame data */
+    u_int32         last;           /**< last pool block of frame data */
+    u_int32         blocks;         /**< number of pool blocks */
+    u_int32         lastUse;        /**< LRU stamp of last upload/start */
+    u_int32         starts;         /**< number of playback starts */
+} WAVE;
+
+
+/** pool of fixed-size blocks for waveform data */
+typedef struct {
+    u_int8          *mem;           /**< block memory */
+    u_int32         *link;          /**< next block of a chain or free list */
+    u_int32         blkSize;        /**< block size [bytes] (power of 2) */
+    u_int32         blkShift;       /**< log2(blkSize) */
+    u_int32         blocks;         /**< number of blocks */
+    u_int32         freeHead;       /**< first free block or POOL_NIL */
+    u_int32         freeCnt;        /**< number of free blocks */
+    u_int32         hwm;            /**< max. number of used blocks */
+} POOL;
+
+/** queue of asynchronous block writes */
+typedef struct {
+    u_int32         *ring;          /**< queued frames */
+    u_int32         hwm;            /**< max. number of queued frames */
+    u_int32         mask;           /**< queue size - 1 (power of 2) */
+    u_int32         in;             /**< frames queued (free running) */
+    u_int32         out;            /**< frames output (free running) */
+    u_int32         begin[ASYNC_BLOCKS]; /**< value of in at start of block */
+    u_int32         end[ASYNC_BLOCKS]; /**< value of in at end of block */
+    u_int32         ticket;         /**< blocks submitted */
+    u_int32         done;           /**< blocks completed */
+    u_int32         k;              /**< interpolation step of current frame */
+    u_int32         last;           /**< start of last completed block */
+    int             eos;            /**< queue may run empty (end of stream) */
+    int             starving;       /**< underrun counted, no data since */
+    u_int32         rampLeft;       /**< values left of underrun ramp */
+    u_int32         rampFrom[2];    /**< ramp start values */
+    int             pdPending;      /**< powerdown at next deadline */
+    int             pdDone;         /**< underrun powered the outputs down */
+} STREAM;
+
+/** waveform player, one per DAC channel (channel 2 uses player 0) */
+typedef struct {
+    WAVE            *wave;          /**< playing waveform or NULL */
+    int32           ch;             /**< output channel */
+    u_int32         pos;            /**< next frame */
+    u_int32         blk;            /**< pool block of next frame */
+    u_int32         ofs;            /**< offset of next frame in blk */
+    u_int32         repeat;         /**< passes left (0 = endless) */
+    u_int32         period;         /**< frame period [us] */
+    u_int32         next;           /**< deadline of next frame [us] */
+    int             armed;          /**< waiting for Z51_SYNC_TRIGGER */
+    int             stream;         /**< outputs the asynchronous queue */
+    STREAM          strm;           /**< queue of asynchronous blocks */
+    u_int32         markHit;        /**< markers of the frame being output */
+} PLAYER;
+
+/**
+ * state of one DAC output (lane), padded to whole cache lines
+ *
+ * Lane 2*u is output A, lane 2*u+1 output B of unit u. The settings of a
+ * channel driving both outputs of a unit are held by its A lane.
+ */
+typedef struct {
+    /* calibration (pointer first: the padding does not depend on its size) */
+    const CAL_PROFILE *cal;         /**< active profile, NULL = offset/gain */
+    u_int32         calSel;         /**< active profile number */
+    /* output */
+    u_int32         offset;         /**< offset parameter */
+    u_int32         gain;           /**< gain parameter */
+    u_int32         powerdown;      /**< powerdown mode */
+    u_int32         bufVal;         /**< uncalibrated value in DAC buffer */
+    u_int32         outVal;         /**< uncalibrated value at DAC output */
+    u_int32         syncVal;        /**< staged calibrated value */
+    u_int32         seqStaged;      /**< calibrated value of Z51_SEQ_STAGE */
+    /* block write */
+    u_int32         period;         /**< sample period [us] */
+    u_int32         interpMode;     /**< interpolation mode (Z51_INTERP_xxx) */
+    u_int32         interpFactor;   /**< interpolation factor */
+    int32           hist[2];        /**< last two input samples */
+    int             histValid;      /**< interpolation history valid */
+    u_int32         format;         /**< block format (Z51_FMT_xxx) */
+    /* underrun policy */
+    u_int32         underMode;      /**< underrun policy (Z51_UNDERRUN_xxx) */
+    u_int32         safeValue;      /**< value to ramp to on underrun */
+    u_int32         safePd;         /**< powerdown mode in safe state */
+    u_int32         rampLen;        /**< underrun ramp length [values] */
+    RLE_DEC         rle;            /**< decoder state for Z51_FMT_RLE */
+    u_int8          pad[36 - sizeof(void*)]; /**< fill to CHAN_ALIGN */
+} CHAN;
+
+/* fails to compile if CHAN is not a multiple of CHAN_ALIGN */
+typedef char CHAN_SIZE_CHECK[(sizeof(CHAN) % CHAN_ALIGN) ? -1 : 1];
+
+/** marker of a waveform frame or a queued frame */
+typedef struct {
+    u_int32         id;             /**< event ID */
+    u_int32         target;         /**< waveform ID or block ticket */
+    u_int32         frame;          /**< frame index in waveform or block */
+    u_int32         type;           /**< MARK_WAVE or MARK_BLOCK */
+    u_int32         pos;            /**< MARK_BLOCK: queue position */
+    u_int32         play;           /**< MARK_BLOCK: player */
+} MARK;
+
+/** recorded marker event (layout of Z51_MARK_EVENT) */
+typedef struct {
+    u_int32         id;             /**< event ID */
+    u_int32         time;           /**< output time [us] */
+    u_int32         target;         /**< waveform ID or block ticket */
+    u_int32         frame;          /**< frame index */
+} MARK_EVENT;
+
+/** pacing of a block write (see paceWait()) */
+typedef struct {
+    u_int32         period;         /**< sample period [us], 0 = none */
+    u_int32         due;            /**< deadline of the next output [us] */
+    int32           error;          /**< device lock failed after a wait */
+} PACE;
+
+/** latency of a priority class (layout of Z51_PRIO_STATS) */
+typedef struct {
+    u_int32         writes;         /**< M_write() calls */
+    u_int32         latMax;         /**< max. latency [us] */
+    u_int32         latSum;         /**< sum of latencies [us] */
+} PRIO_STAT;
+
+/** validated sequencer step */
+typedef struct {
+    u_int16         op;             /**< operation (Z51_SEQ_xxx) */
+    u_int16         par;            /**< channel or loop passes */
+    u_int32         arg;            /**< operand */
+    u_int32         loopLeft;       /**< passes left (Z51_SEQ_LOOP) */
+    u_int32         count;          /**< number of executions */
+    u_int32         time;           /**< last execution since start [us] */
+    int32           late;           /**< lateness of last execution [us] */
+} SEQ_STEP;
+
 /** low-level handle */
 typedef struct {
     /* general */
@@ -100,6 +367,7 @@ typedef struct {
     OSS_IRQ_HANDLE  *irqHdl;        /**< irq handle */
     DESC_HANDLE     *descHdl;       /**< desc handle */
     MACCESS         ma;             /**< hw access handle */
+    OSS_SEM_HANDLE  *devSem;        /**< device semaphore */
     MDIS_IDENT_FUNCT_TBL idFuncTbl; /**< id function table */
     /* debug */
     u_int32         dbgLevel;       /**< debug level */
@@ -108,9 +376,73 @@ typedef struct {
     u_int32         irqCount;       /**< interrupt counter */
     /* device specific */
     u_int32         irqEnable;      /**< enable irq on driver init */
-    u_int32         offset[2];      /**< offset parameter */
-    u_int32         gain[2];        /**< gain parameter */
-    u_int32         powerdown[2];   /**< powerdown mode */
+    u_int32         units;          /**< number of DAC units */
+    u_int32         chNumber;       /**< number of channels */
+    MACCESS         unitMa[UNITS_MAX]; /**< register window per unit */
+    CHAN            *chan;          /**< lanes (2 per unit, in arena) */
+    CAL_PROFILE     *calProf;       /**< Z51_CAL_PROFILES per lane (arena) */
+    /* waveform cache and playback */
+    u_int8          *arena;         /**< memory reserved at init */
+    u_int32         arenaAlloc;     /**< size allocated for arena */
+    POOL            pool;           /**< waveform data blocks (in arena) */
+    WAVE            *wave;          /**< waveform cache (Z51_WAVE_MAX) */
+    u_int32         waveMemUsed;    /**< used waveform memory [bytes] */
+    u_int32         waveStamp;      /**< LRU clock */
+    PLAYER          play[2];        /**< players for channel 0/2 and 1 */
+    OSS_TIMER_HANDLE *timer;        /**< playback timer */
+    u_int32         tickMs;         /**< timer period [ms] */
+    int             timerRun;       /**< timer started */
+    u_int32         schedNow;       /**< scheduler time [us] */
+    /* asynchronous block writes */
+    int             async;          /**< block writes are queued */
+    OSS_SIG_HANDLE  *asyncSig;      /**< completion signal */
+    /* underrun and deadline accounting */
+    u_int32         schedOfs;       /**< real time - scheduler time [us] */
+    u_int32         underruns;      /**< number of underruns */
+    u_int32         lateCount;      /**< number of late values */
+    u_int32         lateMax;        /**< max. lateness [us] */
+    OSS_SIG_HANDLE  *underSig;      /**< underrun signal */
+    /* command sequencer */
+    SEQ_STEP        seq[SEQ_STEPS_MAX]; /**< validated program */
+    u_int32         seqLen;         /**< number of steps (0 = none) */
+    u_int32         seqPc;          /**< next step */
+    int             seqRun;         /**< sequencer running */
+    u_int32         seqNext;        /**< deadline of next step [us] */
+    u_int32         seqStart;       /**< real time of start [us] */
+    OSS_SIG_HANDLE  *seqSig;        /**< signal for Z51_SEQ_SIGNAL */
+    /* marker events */
+    MARK            mark[MARK_MAX]; /**< markers */
+    u_int32         markCnt;        /**< number of markers */
+    MARK_EVENT      markEv[MARK_EVENTS]; /**< recorded events */
+    u_int32         markIn;         /**< events recorded (free running) */
+    u_int32         markOut;        /**< events taken (free running) */
+    u_int32         markLost;       /**< events lost, queue full */
+    OSS_SIG_HANDLE  *markSig;       /**< signal on recorded events */
+    /* safe state */
+    int             safe;           /**< safe state entered */
+    u_int32         safeOnFault;    /**< enter safe state on malfunction */
+    u_int32         safeTime;       /**< max. time to safe state [us] */
+    /* priority classes (see Z51_Write()) */
+    u_int8          chPrio[CH_MAX]; /**< class of M_write() per channel */
+    PRIO_STAT       prio[PRIO_CLASSES]; /**< latency per class */
+    /* write combining (see combineWrite()) */
+    u_int32         combWindow;     /**< window [us], 0 = off */
+    volatile u_int32 combPend[UNITS_MAX]; /**< (gen << 2) | (lane + 1) of
+                                         the buffered write or 0 */
+    u_int32         combCmd[UNITS_MAX]; /**< DAC command of that write */
+    u_int32         combGen;        /**< pending writes (free running) */
+    u_int32         combHits;       /**< pending writes loaded with the
+                                         other lane */
+    u_int32         combMisses;     /**< pending writes loaded alone */
+    /* synchronized start */
+    void            *syncNext;      /**< next armed device (LL_HANDLE) */
+    int             syncLinked;     /**< device is in G_syncList */
+    int             syncPend;       /**< triggered, released by the timer */
+    u_int32         syncAt;         /**< release deadline [us] */
+    int32           syncLate;       /**< release time - deadline [us] */
+    void            *syncGrpNext;   /**< next device of G_syncGroup */
+    int             syncGrouped;    /**< device is in G_syncGroup */
+    int             syncRef;        /**< counted in G_syncRef */
     int             initDac;        /**< init data communication and IRQ */
     int             hwInit;         /**< hardware initialized */
     OSS_SIG_HANDLE  *hwSig;         /**< signal for hardware malfunction */
@@ -126,6 +458,18 @@ typedef struct {
     static const char IdentString[]=MENT_XSTR_SFX(MAK_REVISION,Z51 (non swapped));
 #endif
 
+/*-----------------------------------------+
+|  GLOBALS                                 |
++-----------------------------------------*/
+/*
+ * Armed devices of all instances of this driver. Z51_Init()/Z51_Exit()
+ * are serialized by the MDIS kernel, so G_syncRef needs no lock.
+ */
+static LL_HANDLE      *G_syncList;  /**< armed devices */
+static LL_HANDLE      *G_syncGroup; /**< devices of the last trigger */
+static OSS_SEM_HANDLE *G_syncSem;   /**< protects both lists */
+static u_int32        G_syncRef;    /**< number of driver instances */
+
 /*-----------------------------------------+
 |  PROTOTYPES                              |
 +-----------------------------------------*/
@@ -141,13 +485,111 @@ static int32 Z51_BlockRead(LL_HANDLE *llHdl, int32 ch, void *buf, int32 size,
                             int32 *nbrRdBytesP);
 static int32 Z51_BlockWrite(LL_HANDLE *llHdl, int32 ch, void *buf, int32 size,
                              int32 *nbrWrBytesP);
+static int32 setStat( LL_HANDLE *llHdl, int32 code, int32 ch,
+                      INT32_OR_64 value32_or_64 );
+static int32 getStat( LL_HANDLE *llHdl, int32 code, int32 ch,
+                      INT32_OR_64 *value32_or_64P );
+static int32 blockWrite( LL_HANDLE *llHdl, int32 ch, void *buf, int32 size,
+                         int32 *nbrWrBytesP, PACE *pace );
 static int32 Z51_Irq(LL_HANDLE *llHdl );
 static int32 Z51_Info(int32 infoType, ... );
 
 static char* Ident( void );
 static int32 Cleanup(LL_HANDLE *llHdl, int32 retCode);
-static u_int16 calibrate( LL_HANDLE *llHdl, u_int16 value, 
-                          int offset, int gain );
+static u_int16 calibrate( LL_HANDLE *llHdl, u_int16 value, const CHAN *c );
+static u_int16 calLookup( const CAL_PROFILE *prof, u_int16 value );
+static void calCompile( CAL_PROFILE *prof, const u_int32 *pt, u_int32 n );
+static int32 calLoad( LL_HANDLE *llHdl, u_int32 lane, u_int32 profile,
+                      const u_int32 *pt, u_int32 n );
+static int32 calSelect( LL_HANDLE *llHdl, u_int32 lane, u_int32 profile );
+static int32 calSet( LL_HANDLE *llHdl, u_int32 lane, M_SG_BLOCK *blk );
+static int32 calGet( LL_HANDLE *llHdl, u_int32 lane, M_SG_BLOCK *blk );
+static void dacInit( LL_HANDLE *llHdl );
+static void outputFrame( LL_HANDLE *llHdl, int32 ch,
+                         u_int16 valA, u_int16 valB );
+static u_int16 interpolate( u_int32 mode, u_int32 factor, u_int32 k,
+                            int32 p0, int32 p1, int32 p2, int32 p3 );
+static void interpSample( LL_HANDLE *llHdl, int lane, int32 *histP,
+                          int32 sample );
+static void writeSamples( LL_HANDLE *llHdl, int32 ch, const u_int16 *data,
+                          u_int32 n, const u_int16 *nextP, u_int16 flip,
+                          PACE *pace );
+static int paceWait( LL_HANDLE *llHdl, PACE *pace );
+static int32 rleDecode( RLE_DEC *dec, const u_int8 **srcP,
+                        const u_int8 *end, u_int16 *dst, u_int32 max,
+                        u_int32 *nP );
+static int chanCode( int32 code );
+static int sizeAdd( u_int32 *sizeP, u_int32 n, u_int32 elemSize );
+static int rawCheck( const u_int32 *data, u_int32 n );
+static void rawWrite( LL_HANDLE *llHdl, u_int32 unit, const u_int32 *data,
+                      u_int32 n, PACE *pace );
+static void schedTimer( void *arg );
+static WAVE* waveFind( LL_HANDLE *llHdl, u_int32 id );
+static void waveFree( LL_HANDLE *llHdl, WAVE *wave );
+static u_int32 poolAlloc( POOL *pool, u_int32 n, u_int32 *lastP );
+static void poolFree( POOL *pool, u_int32 first, u_int32 last, u_int32 n );
+static int32 waveLoad( LL_HANDLE *llHdl, int32 ch, M_SG_BLOCK *blk );
+static int32 waveStart( LL_HANDLE *llHdl, int32 ch, u_int32 arg, int arm );
+static void waveStop( LL_HANDLE *llHdl, int32 ch );
+static void playAdvance( LL_HANDLE *llHdl, PLAYER *play );
+static u_int32 usecNow( LL_HANDLE *llHdl );
+static void syncUpdate( LL_HANDLE *llHdl );
+static void syncLeave( LL_HANDLE *llHdl );
+static int32 syncTrigger( LL_HANDLE *llHdl, u_int32 delay );
+static void syncSchedule( LL_HANDLE *llHdl, u_int32 deadline );
+static void syncRelease( LL_HANDLE *llHdl );
+static int syncLate( LL_HANDLE *llHdl, int32 *lateP );
+static int32 syncSpread( LL_HANDLE *llHdl, int32 *valueP );
+static int32 waveInfo( LL_HANDLE *llHdl, M_SG_BLOCK *blk );
+static int32 asyncSubmit( LL_HANDLE *llHdl, int32 ch, void *buf, int32 size,
+                         u_int32 flip, u_int32 *ticketP );
+static int32 asyncBlock( LL_HANDLE *llHdl, int32 ch, M_SG_BLOCK *blk );
+static u_int32 streamUsed( LL_HANDLE *llHdl, STREAM *strm, int32 setCh );
+static void asyncCancel( LL_HANDLE *llHdl, PLAYER *play );
+static int streamFrame( LL_HANDLE *llHdl, PLAYER *play, u_int32 *valP );
+static void streamEmpty( LL_HANDLE *llHdl, PLAYER *play );
+static void streamRamp( LL_HANDLE *llHdl, PLAYER *play, u_int32 *valP );
+static void setPowerdown( LL_HANDLE *llHdl, int32 ch, u_int32 mode );
+static int32 timerStart( LL_HANDLE *llHdl );
+static PLAYER* chanPlayer( LL_HANDLE *llHdl, int32 ch );
+static int chanConflict( LL_HANDLE *llHdl, int32 ch );
+static PLAYER* schedNext( LL_HANDLE *llHdl );
+static int playFrame( LL_HANDLE *llHdl, PLAYER *play, u_int32 *valP );
+static void lateCheck( LL_HANDLE *llHdl, PLAYER *play );
+static void timerStopIdle( LL_HANDLE *llHdl );
+static int32 seqLoad( LL_HANDLE *llHdl, M_SG_BLOCK *blk );
+static int seqStageCheck( const Z51_SEQ_STEP *prog, u_int32 n, u_int32 i );
+static int32 seqStart( LL_HANDLE *llHdl );
+static void seqExec( LL_HANDLE *llHdl );
+static int32 seqTiming( LL_HANDLE *llHdl, M_SG_BLOCK *blk );
+static int32 statusGet( LL_HANDLE *llHdl, u_int32 unit, M_SG_BLOCK *blk );
+static int32 statusSet( LL_HANDLE *llHdl, u_int32 unit, M_SG_BLOCK *blk );
+static u_int32 chanLanes( LL_HANDLE *llHdl, int32 ch, u_int32 *firstP );
+static int playCode( int32 code );
+static int outputCode( int32 code );
+static int safeEnter( LL_HANDLE *llHdl, int fault );
+static void safeLeave( LL_HANDLE *llHdl );
+static u_int32 safeCmd( LL_HANDLE *llHdl, CHAN *c );
+static u_int32 pdBits( u_int32 mode );
+static int asyncDiscard( LL_HANDLE *llHdl, PLAYER *play );
+static void outputBank( LL_HANDLE *llHdl, u_int32 unit, u_int32 n,
+                        const u_int32 *frame );
+static void writeFrames( LL_HANDLE *llHdl, int32 ch, const u_int32 *data,
+                         u_int32 n, u_int32 flip, PACE *pace );
+static int32 markSet( LL_HANDLE *llHdl, int32 ch, M_SG_BLOCK *blk );
+static void markCheck( LL_HANDLE *llHdl, PLAYER *play, u_int32 type,
+                       u_int32 target, u_int32 pos );
+static void markRecord( LL_HANDLE *llHdl, PLAYER *play );
+static void markDrop( LL_HANDLE *llHdl, PLAYER *play );
+static void markRemove( LL_HANDLE *llHdl, u_int32 i );
+static int32 markEvents( LL_HANDLE *llHdl, M_SG_BLOCK *blk );
+static int32 combineWrite( LL_HANDLE *llHdl, int32 ch, u_int16 value,
+                           u_int32 start );
+static int32 writeValue( LL_HANDLE *llHdl, int32 ch, int32 value,
+                         u_int32 start );
+static void prioCount( LL_HANDLE *llHdl, int32 ch, u_int32 start );
+static int32 prioStats( LL_HANDLE *llHdl, M_SG_BLOCK *blk );
+static int32 combineFlush( LL_HANDLE *llHdl, u_int32 unit );
 
 
 /****************************** Z51_GetEntry ********************************/
@@ -187,8 +629,29 @@ static u_int16 calibrate( LL_HANDLE *llHdl, u_int16 value,
  * DEBUG_LEVEL_DESC      OSS_DBG_DEFAULT  see dbg.h
  * DEBUG_LEVEL           OSS_DBG_DEFAULT  see dbg.h
  * ID_CHECK              1                0..1
+ * Z51_UNITS             1                1..Z51_UNITS_MAX
+ * Z51_UNIT_OFFSET_n     n*0x10           register offset of unit n
+ * Z51_OFFSET_n          see z51_doc.c    offset of lane n (0..2*units-1)
+ * Z51_GAIN_n            see z51_doc.c    gain of lane n (0..2*units-1)
+ * Z51_CAL_n_p_k         -                point k of profile p of lane n
+ *                                        Z51_CAL_KEY(in,out), p=1..4
+ * Z51_CAL_n             0                active profile of lane n
+ * Z51_SAFE_VALUE_n      0                safe value of lane n
+ * Z51_SAFE_PD_n         0                safe powerdown mode of lane n
+ * Z51_SAFE_ON_FAULT     0                safe state on malfunction
+ * Z51_COMBINE_WINDOW    0                write combining window [us]
+ * Z51_WAVE_MEM          0x10000          waveform cache size [bytes]
+ *                                        0..0x4000000
+ * Z51_POOL_BLOCK        0x400            waveform cache block size [bytes]
+ *                                        64..0x10000
+ * Z51_TICK_MS           1                playback timer period [ms]
+ * Z51_ASYNC_FRAMES      0x4000           asynchronous queue size [frames]
+ *                                        2..0x100000
  * \endcode
  *
+ * Values out of range fail with ERR_LL_ILL_PARAM, as does a buffer size
+ * which does not fit into 32 bits.
+ *
  *  \param descP      \IN  pointer to descriptor data
  *  \param osHdl      \IN  oss handle
  *  \param ma         \IN  hw access handle
@@ -210,7 +673,10 @@ static int32 Z51_Init(
     LL_HANDLE *llHdl = NULL;
     u_int32 gotsize;
     int32 error;
-    u_int32 value;
+    u_int32 value, waveMem, ringSize, size, i, p, k;
+    u_int32 pt[Z51_CAL_POINTS_MAX];
+    u_int8  *mem;
+    CHAN    *c;
 
     /*------------------------------+
     |  prepare the handle           |
@@ -228,6 +694,7 @@ static int32 Z51_Init(
     /* init */
     llHdl->memAlloc   = gotsize;
     llHdl->osHdl      = osHdl;
+    llHdl->devSem     = devSemHdl;
     llHdl->irqHdl     = irqHdl;
     llHdl->ma         = *ma;
 
@@ -277,38 +744,237 @@ static int32 Z51_Init(
         error != ERR_DESC_KEY_NOTFOUND)
         return( Cleanup(llHdl,error) );
 
-    /* Z51_OFFSET_0 */
-    if ((error = DESC_GetUInt32(llHdl->descHdl, DAC_OFFSET_DEFAULT_0,
-                                &llHdl->offset[0], "Z51_OFFSET_0")) &&
+    /* Z51_UNITS */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 1,
+                                &llHdl->units, "Z51_UNITS")) &&
+        error != ERR_DESC_KEY_NOTFOUND)
+        return( Cleanup(llHdl,error) );
+
+    if( !IN_RANGE( llHdl->units, 1, UNITS_MAX ) )
+        return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+    /* three channels per unit, plus the group channel for several units */
+    llHdl->chNumber = llHdl->units * UNIT_CHANNELS + (llHdl->units > 1);
+
+    /* Z51_UNIT_OFFSET_n: register window of each unit */
+    for( i=0; i<llHdl->units; i++ ) {
+        if ((error = DESC_GetUInt32(llHdl->descHdl, i * UNIT_REG_SIZE,
+                                    &value, "Z51_UNIT_OFFSET_%d", i)) &&
+            error != ERR_DESC_KEY_NOTFOUND)
+            return( Cleanup(llHdl,error) );
+
+        if( (value & 3) || value > ADDRSPACE_SIZE - UNIT_REG_SIZE )
+            return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+        MACCESS_CLONE( *ma, llHdl->unitMa[i], value );
+    }
+    llHdl->ma = llHdl->unitMa[0];
+
+    /* Z51_WAVE_MEM */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, WAVE_MEM_DEFAULT,
+                                &waveMem, "Z51_WAVE_MEM")) &&
+        error != ERR_DESC_KEY_NOTFOUND)
+        return( Cleanup(llHdl,error) );
+
+    if( waveMem > WAVE_MEM_MAX )
+        return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+    /* Z51_POOL_BLOCK */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, POOL_BLOCK_DEFAULT,
+                                &value, "Z51_POOL_BLOCK")) &&
+        error != ERR_DESC_KEY_NOTFOUND)
+        return( Cleanup(llHdl,error) );
+
+    if( !IN_RANGE( value, POOL_BLOCK_MIN, POOL_BLOCK_MAX ) )
+        return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+    /* round down to a power of 2 */
+    while( value & (value - 1) )
+        value &= value - 1;
+    llHdl->pool.blkSize = value;
+    while( (1UL << llHdl->pool.blkShift) < value )
+        llHdl->pool.blkShift++;
+    llHdl->pool.blocks = waveMem >> llHdl->pool.blkShift;
+
+    /* Z51_TICK_MS */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, TICK_MS_DEFAULT,
+                                &llHdl->tickMs, "Z51_TICK_MS")) &&
         error != ERR_DESC_KEY_NOTFOUND)
         return( Cleanup(llHdl,error) );
 
-    /* Z51_GAIN_0 */
-    if ((error = DESC_GetUInt32(llHdl->descHdl, DAC_GAIN_DEFAULT_0,
-                                &llHdl->gain[0], "Z51_GAIN_0")) &&
+    if( llHdl->tickMs == 0 )
+        return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+    /* Z51_SAFE_ON_FAULT */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0,
+                                &llHdl->safeOnFault, "Z51_SAFE_ON_FAULT")) &&
         error != ERR_DESC_KEY_NOTFOUND)
         return( Cleanup(llHdl,error) );
 
-    /* Z51_OFFSET_1 */
-    if ((error = DESC_GetUInt32(llHdl->descHdl, DAC_OFFSET_DEFAULT_1,
-                                &llHdl->offset[1], "Z51_OFFSET_1")) &&
+    /* Z51_COMBINE_WINDOW */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0,
+                                &llHdl->combWindow, "Z51_COMBINE_WINDOW")) &&
         error != ERR_DESC_KEY_NOTFOUND)
         return( Cleanup(llHdl,error) );
 
-    /* Z51_GAIN_1 */
-    if ((error = DESC_GetUInt32(llHdl->descHdl, DAC_GAIN_DEFAULT_1,
-                                &llHdl->gain[1], "Z51_GAIN_1")) &&
+    if( llHdl->combWindow > COMB_MAX )
+        return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+    /* Z51_ASYNC_FRAMES */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, ASYNC_FRAMES_DEFAULT,
+                                &value, "Z51_ASYNC_FRAMES")) &&
         error != ERR_DESC_KEY_NOTFOUND)
         return( Cleanup(llHdl,error) );
 
+    if( !IN_RANGE( value, 2, ASYNC_FRAMES_MAX ) )
+        return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+    /* round down to a power of 2 */
+    while( value & (value - 1) )
+        value &= value - 1;
+    llHdl->play[0].strm.mask = llHdl->play[1].strm.mask = value - 1;
+
+    /*
+     * Reserve all buffers at once: waveform table, asynchronous block
+     * queues, pool links and pool blocks. Nothing is allocated later.
+     */
+    ringSize = (llHdl->play[0].strm.mask + 1) * sizeof(u_int32);
+    size = CHAN_ALIGN;
+    if( !sizeAdd( &size, 2 * llHdl->units, sizeof(CHAN) ) ||
+        !sizeAdd( &size, Z51_WAVE_MAX, sizeof(WAVE) ) ||
+        !sizeAdd( &size, 2, ringSize ) ||
+        !sizeAdd( &size, 2 * llHdl->units * Z51_CAL_PROFILES,
+                  sizeof(CAL_PROFILE) ) ||
+        !sizeAdd( &size, llHdl->pool.blocks,
+                  sizeof(u_int32) + llHdl->pool.blkSize ) )
+        return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+    if ((llHdl->arena = (u_int8*)OSS_MemGet(osHdl, size,
+                                            &llHdl->arenaAlloc)) == NULL)
+        return( Cleanup(llHdl,ERR_OSS_MEM_ALLOC) );
+
+    /* lanes first, on a cache line boundary */
+    mem = llHdl->arena + ((CHAN_ALIGN -
+                           ((U_INT32_OR_64)llHdl->arena & (CHAN_ALIGN-1))) &
+                          (CHAN_ALIGN-1));
+    OSS_MemFill(osHdl, 2 * llHdl->units * sizeof(CHAN), (char*)mem, 0x00);
+    llHdl->chan = (CHAN*)mem;
+    mem += 2 * llHdl->units * sizeof(CHAN);
+
+    OSS_MemFill(osHdl, Z51_WAVE_MAX * sizeof(WAVE), (char*)mem, 0x00);
+    llHdl->wave = (WAVE*)mem;
+    mem += Z51_WAVE_MAX * sizeof(WAVE);
+
+    llHdl->play[0].strm.ring = (u_int32*)mem;
+    mem += ringSize;
+    llHdl->play[1].strm.ring = (u_int32*)mem;
+    mem += ringSize;
+
+    size = 2 * llHdl->units * Z51_CAL_PROFILES * sizeof(CAL_PROFILE);
+    OSS_MemFill(osHdl, size, (char*)mem, 0x00);
+    llHdl->calProf = (CAL_PROFILE*)mem;
+    mem += size;
+
+    llHdl->pool.link = (u_int32*)mem;
+    mem += llHdl->pool.blocks * sizeof(u_int32);
+    llHdl->pool.mem = mem;
+
+    /* chain all blocks into the free list */
+    for( value=0; value<llHdl->pool.blocks; value++ )
+        llHdl->pool.link[value] = value + 1;
+    if( llHdl->pool.blocks ) {
+        llHdl->pool.link[llHdl->pool.blocks - 1] = POOL_NIL;
+        llHdl->pool.freeHead = 0;
+    }
+    else
+        llHdl->pool.freeHead = POOL_NIL;
+    llHdl->pool.freeCnt = llHdl->pool.blocks;
+
+    /* playback timer */
+    if ((error = OSS_TimerCreate(osHdl, schedTimer, llHdl, &llHdl->timer)))
+        return( Cleanup(llHdl,error) );
+
+    /* lock for synchronized start, shared by all instances */
+    if (G_syncRef == 0 &&
+        (error = OSS_SemCreate(osHdl, OSS_SEM_BIN, 1, &G_syncSem)))
+        return( Cleanup(llHdl,error) );
+
+    G_syncRef++;
+    llHdl->syncRef = 1;
+
     /* tell write routine to init DAC communication and IRQ */
     llHdl->initDac = 1;
     llHdl->hwInit = 0;
-    llHdl->powerdown[0] = llHdl->powerdown[1] = 0;
 
-    DBGWRT_3((DBH, "Z51_Init: offset=%d,%d  gain=%d,%d\n", 
-              llHdl->offset[0],llHdl->offset[1],
-              llHdl->gain[0], llHdl->gain[1] ));
+    for( i=0; i<2*llHdl->units; i++ ) {
+        c = &llHdl->chan[i];
+
+        /* Z51_OFFSET_n, Z51_GAIN_n (n = lane: 2*unit for A, 2*unit+1 for B) */
+        if ((error = DESC_GetUInt32(llHdl->descHdl,
+                                    (i & 1) ? DAC_OFFSET_DEFAULT_1 :
+                                              DAC_OFFSET_DEFAULT_0,
+                                    &c->offset, "Z51_OFFSET_%d", i)) &&
+            error != ERR_DESC_KEY_NOTFOUND)
+            return( Cleanup(llHdl,error) );
+
+        if ((error = DESC_GetUInt32(llHdl->descHdl,
+                                    (i & 1) ? DAC_GAIN_DEFAULT_1 :
+                                              DAC_GAIN_DEFAULT_0,
+                                    &c->gain, "Z51_GAIN_%d", i)) &&
+            error != ERR_DESC_KEY_NOTFOUND)
+            return( Cleanup(llHdl,error) );
+
+        /* block writes: as fast as possible, no interpolation */
+        c->powerdown    = 0;
+        c->period       = 0;
+        c->interpMode   = Z51_INTERP_ZOH;
+        c->interpFactor = 1;
+        c->histValid    = 0;
+        c->format       = Z51_FMT_NATIVE;
+        c->underMode    = Z51_UNDERRUN_HOLD;
+        c->rampLen      = RAMP_LEN_DEFAULT;
+
+        /* Z51_SAFE_VALUE_n, Z51_SAFE_PD_n */
+        if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &c->safeValue,
+                                    "Z51_SAFE_VALUE_%d", i)) &&
+            error != ERR_DESC_KEY_NOTFOUND)
+            return( Cleanup(llHdl,error) );
+
+        if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &c->safePd,
+                                    "Z51_SAFE_PD_%d", i)) &&
+            error != ERR_DESC_KEY_NOTFOUND)
+            return( Cleanup(llHdl,error) );
+
+        if( c->safeValue > 0xffff || c->safePd > 3 )
+            return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+        /* Z51_CAL_n_p_k: point k of profile p, up to the first missing */
+        for( p=1; p<=Z51_CAL_PROFILES; p++ ) {
+            for( k=0; k<Z51_CAL_POINTS_MAX; k++ ) {
+                if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &pt[k],
+                                            "Z51_CAL_%d_%d_%d", i, p, k))) {
+                    if( error != ERR_DESC_KEY_NOTFOUND )
+                        return( Cleanup(llHdl,error) );
+                    break;
+                }
+            }
+
+            if( k && (error = calLoad( llHdl, i, p, pt, k )) )
+                return( Cleanup(llHdl,error) );
+        }
+
+        /* Z51_CAL_n: active profile */
+        if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+                                    "Z51_CAL_%d", i)) &&
+            error != ERR_DESC_KEY_NOTFOUND)
+            return( Cleanup(llHdl,error) );
+
+        if( (error = calSelect( llHdl, i, value )) )
+            return( Cleanup(llHdl,error) );
+
+        DBGWRT_3((DBH, "Z51_Init: lane %d offset=%d gain=%d profile=%d\n",
+                  i, c->offset, c->gain, c->calSel ));
+    }
 
     /*------------------------------+
     |  hardware init in Z51_Write() |
@@ -334,26 +1000,41 @@ static int32 Z51_Exit(
 )
 {
     LL_HANDLE *llHdl = *llHdlP;
-    MACCESS   ma = llHdl->ma;
+    MACCESS   ma;
     int32     error = 0;
+    u_int32   u;
 
     DBGWRT_1((DBH, "LL - Z51_Exit\n"));
 
+    /* a trigger on another device must not release this one anymore */
+    syncLeave( llHdl );
+
+    /* stop playback */
+    if( llHdl->timerRun ) {
+        OSS_TimerStop( OSH, llHdl->timer );
+        llHdl->timerRun = 0;
+    }
+
     /*------------------------------+
     |  de-init hardware             |
     +------------------------------*/
 
     /* set DAC outputs to zero */
     if (llHdl->hwInit) {
-        MWRITE_D32( ma, DAC_CTRL_REG,
-                    DAC_CMD_LOAD_AB | DAC_CMD_BUF_B | 0 );
+        for( u=0; u<llHdl->units; u++ )
+            MWRITE_D32( llHdl->unitMa[u], DAC_CTRL_REG,
+                        DAC_CMD_LOAD_AB | DAC_CMD_BUF_B | 0 );
         OSS_Delay( OSH, 100 );
 
-        /* disable interrupt */
-        MWRITE_D32( ma, DAC_IER_REG, 0 );
+        for( u=0; u<llHdl->units; u++ ) {
+            ma = llHdl->unitMa[u];
+
+            /* disable interrupt */
+            MWRITE_D32( ma, DAC_IER_REG, 0 );
 
-        /* turn off outputs using F401 watchdog mechanism */
-        MWRITE_D32( ma, DAC_SCLK_REG, 0 );
+            /* turn off outputs using F401 watchdog mechanism */
+            MWRITE_D32( ma, DAC_SCLK_REG, 0 );
+        }
 
         llHdl->hwInit = 0;
     }
@@ -394,6 +1075,13 @@ static int32 Z51_Read(
  *
  *  The function writes a value to the current channel.
  *
+ *  A channel of priority class Z51_PRIO_HIGH (see Z51_WRITE_PRIO) doesn't
+ *  wait for the device lock held by other calls, e.g. a block write in
+ *  progress, but only for the scheduler lock, which is held for one
+ *  frame at a time. So its value is output between two frames of the
+ *  other call. Before the first access or after a malfunction the write
+ *  takes the normal path to initialize the DAC.
+ *
  *  \param llHdl      \IN  low-level handle
  *  \param ch         \IN  current channel
  *  \param value      \IN read value
@@ -406,67 +1094,45 @@ static int32 Z51_Write(
     int32 value
 )
 {
-    MACCESS   ma = llHdl->ma;
+    u_int32 start = usecNow( llHdl );
+    int32   error;
+    OSS_IRQ_STATE state;
 
     DBGWRT_1((DBH, "LL - Z51_Write: ch=%d val=0x%x\n",ch, value));
 
-    if( !IN_RANGE( ch, 0, CH_NUMBER-1 ) )
+    if( !IN_RANGE( ch, 0, (int32)llHdl->chNumber-1 ) )
         return( ERR_LL_ILL_CHAN );
 
-    /*
-     * If this is the first write we have to initialize the communication
-     * between the FPGA and the DAC. This also connects the DAC's outputs to
-     * the output drivers of the module.
-     * So before the first access we have always 0mA output current (on F401).
-     */
-    if( llHdl->initDac ) {
-        MWRITE_D32( ma, DAC_SCLK_REG, DAC_SCLK_DEFAULT );
-
-        /*
-         * In order to avoid an unwanted interrupt we have to wait for the
-         * watchdog circuit to release the IRQ input before we can enable
-         * the interrupt.
-         */
-        if( llHdl->irqEnable ) {
-            DBGWRT_3((DBH, "delay for watchdog to come up...\n"));
-            OSS_Delay( OSH, 1010 );  /* worst case = 1000ms */
-            MWRITE_D32( ma, DAC_IER_REG, DAC_IRQ_MASK );
-        }
-        llHdl->initDac = 0;
-        llHdl->hwInit = 1;
+    /* high priority: between the frames of other calls */
+    if( llHdl->chPrio[ch] == Z51_PRIO_HIGH && !llHdl->initDac ) {
+        LOCK_SCHED( state );
+        error = writeValue( llHdl, ch, value, start );
+        UNLOCK_SCHED( state );
+        return( error );
     }
 
-    /* dependant on channel set output A, B or both */
-    switch( ch ) {
-        case 0:
-            MWRITE_D32( ma, DAC_CTRL_REG,
-                        DAC_CMD_LOAD_A | DAC_CMD_BUF_A |
-                        calibrate( llHdl, (u_int16)value, 
-                                   llHdl->offset[0], llHdl->gain[0] ));
-            break;
+    if( (error = LOCK_DEV()) )
+        return( error );
 
-        case 1:
-            MWRITE_D32( ma, DAC_CTRL_REG, 
-                        DAC_CMD_LOAD_B | DAC_CMD_BUF_B |
-                        calibrate( llHdl, (u_int16)value, 
-                                   llHdl->offset[1], llHdl->gain[1] ));
-            break;
+    if( llHdl->safe ) {
+        UNLOCK_DEV();
+        return( ERR_LL_DEV_NOTRDY );
+    }
 
-        default:
-            MWRITE_D32( ma, DAC_CTRL_REG,
-                        DAC_CMD_BUF_A |
-                        calibrate( llHdl, (u_int16)value, 
-                                   llHdl->offset[0], llHdl->gain[0] ) );
-                        
-			OSS_MikroDelay(OSH, 1);
+    dacInit( llHdl );
 
-            MWRITE_D32( ma, DAC_CTRL_REG,
-                        DAC_CMD_LOAD_AB | DAC_CMD_BUF_B | 
-                        calibrate( llHdl, (u_int16)((u_int32)value >> 16),
-                                   llHdl->offset[1], llHdl->gain[1] ) );
+    /* output A or B: wait for the other lane (returns unlocked) */
+    if( llHdl->combWindow && ch != CH_GROUP( llHdl ) &&
+        ch % UNIT_CHANNELS < 2 ) {
+        return( combineWrite( llHdl, ch, (u_int16)value, start ) );
     }
 
-    return(ERR_SUCCESS);
+    LOCK_SCHED( state );
+    error = writeValue( llHdl, ch, value, start );
+    UNLOCK_SCHED( state );
+
+    UNLOCK_DEV();
+    return( error );
 }
 
 /****************************** Z51_SetStat *********************************/
@@ -490,17 +1156,69 @@ static int32 Z51_SetStat(
     INT32_OR_64 value32_or_64
 )
 {
-    MACCESS   ma = llHdl->ma;
+    int32 error;
+    int   pending;
+    OSS_IRQ_STATE state;
+
+    /* entering the safe state does not wait for calls in progress */
+    if( code == Z51_SAFE_STATE && (int32)value32_or_64 ) {
+        DBGWRT_1((DBH, "LL - Z51_SetStat: enter safe state\n"));
+
+        LOCK_SCHED( state );
+        pending = safeEnter( llHdl, FALSE );
+        UNLOCK_SCHED( state );
+
+        if( pending && llHdl->asyncSig )
+            OSS_SigSend( OSH, llHdl->asyncSig );
+        return( ERR_SUCCESS );
+    }
+
+    if( (error = LOCK_DEV()) )
+        return( error );
+
+    error = setStat( llHdl, code, ch, value32_or_64 );
+
+    UNLOCK_DEV();
+    return( error );
+}
+
+/**********************************************************************/
+/** Set the driver status with the device locked (see Z51_SetStat())
+ *
+ *  \param llHdl         \IN  low-level handle
+ *  \param code          \IN  status code
+ *  \param ch            \IN  current channel
+ *  \param value32_or_64 \IN  data or pointer to block data structure
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 setStat(
+    LL_HANDLE *llHdl,
+    int32  code,
+    int32  ch,
+    INT32_OR_64 value32_or_64
+)
+{
     int32     error = ERR_SUCCESS;
     int32     value  = (int32)value32_or_64; /* 32bit value     */  
+    u_int32   lane, u;
 
     DBGWRT_1((DBH, "LL - Z51_SetStat: ch=%d code=0x%04x value=0x%x\n",
               ch,code,value));
 
-    /* SetStat is only allowed on channels 0 and 1 */
-    if( !IN_RANGE( ch, 0, 1 ) )
+    /*
+     * per DAC channel codes are only allowed on single output channels,
+     * playback codes only on the channels of unit 0
+     */
+    if( !IN_RANGE( ch, 0, (int32)llHdl->chNumber-1 ) ||
+        (chanLanes( llHdl, ch, &lane ) > 1 && chanCode( code )) ||
+        (ch >= UNIT_CHANNELS && playCode( code )) )
         return( ERR_LL_ILL_CHAN );
 
+    /* no new output until the safe state is left */
+    if( llHdl->safe && outputCode( code ) )
+        return( ERR_LL_DEV_NOTRDY );
+
     switch(code) {
         /*--------------------------+
         |  debug level              |
@@ -516,7 +1234,8 @@ static int32 Z51_SetStat(
             DBGWRT_2((DBH, " %sable irq\n", value ? "en":"dis"));
 
             if( value == 0 ) {
-                MWRITE_D32( ma, DAC_IER_REG, 0 );
+                for( u=0; u<llHdl->units; u++ )
+                    MWRITE_D32( llHdl->unitMa[u], DAC_IER_REG, 0 );
             }
             else {
                 /* enable IRQ on next write access */
@@ -545,14 +1264,25 @@ static int32 Z51_SetStat(
         |  DAC offset parameter     |
         +--------------------------*/
         case Z51_OFFSET:
-            llHdl->offset[ch] = value;
+            llHdl->chan[lane].offset = value;
             break;
 
         /*--------------------------+
         |  DAC gain parameter       |
         +--------------------------*/
         case Z51_GAIN:
-            llHdl->gain[ch] = value;
+            llHdl->chan[lane].gain = value;
+            break;
+
+        /*--------------------------+
+        |  calibration profiles     |
+        +--------------------------*/
+        case Z51_CAL_PROFILE:
+            error = calSelect( llHdl, lane, (u_int32)value );
+            break;
+
+        case Z51_BLK_CAL_LOAD:
+            error = calSet( llHdl, lane, (M_SG_BLOCK*)value32_or_64 );
             break;
 
         /*--------------------------+
@@ -560,176 +1290,404 @@ static int32 Z51_SetStat(
         +--------------------------*/
         case Z51_POWERDOWN:
         {
-            u_int32 pdMode;
-
-            /* select powerdown mode */
-            switch( value ) {
-                case 1:  pdMode = DAC_CMD_PD_1K; break;
-                case 2:  pdMode = DAC_CMD_PD_100K; break;
-                case 3:  pdMode = DAC_CMD_PD_HIGHZ; break;
-                default: pdMode = DAC_CMD_PD_NONE;
-            }
+            OSS_IRQ_STATE state;
 
-            /* dependant on channel turn off output A or B */
-            switch( ch ) {
-                case 0:
-                    MWRITE_D32( ma, DAC_CTRL_REG,
-                                DAC_CMD_LOAD_A | DAC_CMD_BUF_A | pdMode );
-                    break;
-
-                case 1:
-                    MWRITE_D32( ma, DAC_CTRL_REG,
-                                DAC_CMD_LOAD_B | DAC_CMD_BUF_B | pdMode );
-                    break;
-            }
+            LOCK_SCHED( state );
+            setPowerdown( llHdl, ch, value );
+            UNLOCK_SCHED( state );
 
-            llHdl->powerdown[ch] = value;
+            llHdl->chan[lane].powerdown = value;
         }
         break;
 
         /*--------------------------+
-        |  register signal          |
+        |  block write sample period|
         +--------------------------*/
-        case Z51_SET_SIGNAL:
-
-            /* signal already installed ? */
-            if( llHdl->hwSig ) {
-                error = ERR_OSS_SIG_SET;
+        case Z51_SAMPLE_PERIOD:
+            if( !IN_RANGE( value, 0, PERIOD_MAX ) ) {
+                error = ERR_LL_ILL_PARAM;
                 break;
             }
-
-            error = OSS_SigCreate( OSH, value, &llHdl->hwSig );
+            llHdl->chan[lane].period = value;
             break;
 
         /*--------------------------+
-        |  unregister signal        |
+        |  interpolation mode       |
         +--------------------------*/
-        case Z51_CLR_SIGNAL:
-
-            /* signal already installed ? */
-            if( llHdl->hwSig == NULL ) {
-                error = ERR_OSS_SIG_CLR;
+        case Z51_INTERP_MODE:
+            if( !IN_RANGE( value, Z51_INTERP_ZOH, Z51_INTERP_CUBIC ) ) {
+                error = ERR_LL_ILL_PARAM;
                 break;
             }
-
-            error = OSS_SigRemove( OSH, &llHdl->hwSig );
+            llHdl->chan[lane].interpMode = value;
+            llHdl->chan[lane].histValid = 0;
             break;
 
         /*--------------------------+
-        |  (unknown)                |
-        +--------------------------*/
-        default:
-            error = ERR_LL_UNK_CODE;
-    }
-
-    return(error);
-}
-
-/****************************** Z51_GetStat *********************************/
-/** Get the driver status
- *
- *  The driver supports \ref getstat_setstat_codes "these status codes"
- *  in addition to the standard codes (see mdis_api.h).
- *
- *  \param llHdl          \IN  low-level handle
- *  \param code           \IN  \ref getstat_setstat_codes "status code"
- *  \param ch             \IN  current channel
- *  \param value32_or_64P \IN  pointer to block data structure (M_SG_BLOCK) for
- *                             block status codes
- *  \param value32_or_64P \OUT data pointer or pointer to block data structure
- *                             (M_SG_BLOCK) for block status codes
- *
- *  \return           \c 0 on success or error code
- */
-static int32 Z51_GetStat(
-    LL_HANDLE *llHdl,
-    int32  code,
-    int32  ch,
-    INT32_OR_64 *value32_or_64P
-)
-{
-    int32      error = ERR_SUCCESS;
-    int32       *valueP = (int32*)value32_or_64P; /* pointer to 32bit value  */
-    INT32_OR_64 *value64P = value32_or_64P;       /* stores 32/64bit pointer  */
-
-    DBGWRT_1((DBH, "LL - Z51_GetStat: ch=%d code=0x%04x\n",
-              ch,code));
-
-    /* GetStat is only allowed on channels 0 and 1 */
-    if( !IN_RANGE( ch, 0, 1 ) )
-        return( ERR_LL_ILL_CHAN );
-
-    switch(code)
-    {
-        /*--------------------------+
-        |  debug level              |
+        |  interpolation factor     |
         +--------------------------*/
-        case M_LL_DEBUG_LEVEL:
-            *valueP = llHdl->dbgLevel;
+        case Z51_INTERP_FACTOR:
+            if( !IN_RANGE( value, 1, Z51_INTERP_FACTOR_MAX ) ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->chan[lane].interpFactor = value;
+            llHdl->chan[lane].histValid = 0;
             break;
+
         /*--------------------------+
-        |  number of channels       |
+        |  block write format       |
         +--------------------------*/
-        case M_LL_CH_NUMBER:
-            *valueP = CH_NUMBER;
+        case Z51_BLK_FORMAT:
+            if( !IN_RANGE( value, Z51_FMT_NATIVE, Z51_FMT_RAW ) ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->chan[lane].format = value;
+            OSS_MemFill( OSH, sizeof(RLE_DEC), (char*)&llHdl->chan[lane].rle, 0 );
             break;
+
         /*--------------------------+
-        |  channel direction        |
+        |  waveform playback        |
         +--------------------------*/
-        case M_LL_CH_DIR:
-            *valueP = M_CH_OUT;
+        case Z51_WAVE_START:
+            error = waveStart( llHdl, ch, value, FALSE );
             break;
+
         /*--------------------------+
-        |  channel length [bits]    |
+        |  synchronized start       |
         +--------------------------*/
-        case M_LL_CH_LEN:
-            *valueP = 32;
+        case Z51_SYNC_ARM:
+            error = waveStart( llHdl, ch, value, TRUE );
             break;
-        /*--------------------------+
-        |  channel type info        |
-        +--------------------------*/
-        case M_LL_CH_TYP:
-            *valueP = M_CH_ANALOG;
+
+        case Z51_SYNC_TRIGGER:
+            error = syncTrigger( llHdl, value );
             break;
-        /*--------------------------+
-        |  irq counter              |
-        +--------------------------*/
-        case M_LL_IRQ_COUNT:
-            *valueP = llHdl->irqCount;
+
+        case Z51_WAVE_STOP:
+            waveStop( llHdl, ch );
             break;
+
         /*--------------------------+
-        |  ID PROM check enabled    |
+        |  asynchronous block write |
         +--------------------------*/
-        case M_LL_ID_CHECK:
-            *valueP = 0;
+        case Z51_BLK_ASYNC:
+            llHdl->async = value ? 1 : 0;
             break;
-        /*--------------------------+
-        |   ident table pointer     |
-        |   (treat as non-block!)   |
+
+        case Z51_ASYNC_SIG_SET:
+            if( llHdl->asyncSig ) {
+                error = ERR_OSS_SIG_SET;
+                break;
+            }
+
+            error = OSS_SigCreate( OSH, value, &llHdl->asyncSig );
+            break;
+
+        case Z51_ASYNC_SIG_CLR:
+            if( llHdl->asyncSig == NULL ) {
+                error = ERR_OSS_SIG_CLR;
+                break;
+            }
+
+            error = OSS_SigRemove( OSH, &llHdl->asyncSig );
+            break;
+
+        case Z51_ASYNC_EOS:
+        {
+            OSS_IRQ_STATE state;
+
+            LOCK_SCHED( state );
+            chanPlayer( llHdl, ch )->strm.eos = 1;
+            UNLOCK_SCHED( state );
+            break;
+        }
+
+        /*--------------------------+
+        |  underrun handling        |
         +--------------------------*/
-        case M_MK_BLK_REV_ID:
-           *value64P = (INT32_OR_64)&llHdl->idFuncTbl;
-           break;
+        case Z51_UNDERRUN_MODE:
+            if( !IN_RANGE( value, Z51_UNDERRUN_HOLD, Z51_UNDERRUN_POWERDOWN ) ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->chan[lane].underMode = value;
+            break;
+
+        case Z51_SAFE_VALUE:
+            if( !IN_RANGE( value, 0, 0xffff ) ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->chan[lane].safeValue = value;
+            break;
 
         /*--------------------------+
-        |  DAC offset parameter     |
+        |  safe state               |
         +--------------------------*/
-        case Z51_OFFSET:
-            *valueP = llHdl->offset[ch];
+        case Z51_SAFE_STATE:
+            /* entered by Z51_SetStat() */
+            safeLeave( llHdl );
+            break;
+
+        case Z51_SAFE_PD:
+            if( !IN_RANGE( value, 0, 3 ) ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->chan[lane].safePd = value;
+            break;
+
+        case Z51_SAFE_ON_FAULT:
+            llHdl->safeOnFault = value ? 1 : 0;
+            break;
+
+        case Z51_SAFE_TIME:
+            llHdl->safeTime = 0;
             break;
 
         /*--------------------------+
-        |  DAC gain parameter       |
+        |  priority classes         |
         +--------------------------*/
-        case Z51_GAIN:
-            *valueP = llHdl->gain[ch];
+        case Z51_WRITE_PRIO:
+            if( !IN_RANGE( value, 0, PRIO_CLASSES-1 ) ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->chPrio[ch] = (u_int8)value;
             break;
 
+        case Z51_PRIO_CLR:
+        {
+            OSS_IRQ_STATE state;
+
+            LOCK_SCHED( state );
+            OSS_MemFill( OSH, sizeof(llHdl->prio), (char*)llHdl->prio, 0 );
+            UNLOCK_SCHED( state );
+            break;
+        }
+
         /*--------------------------+
-        |  current powerdown mode   |
+        |  write combining          |
         +--------------------------*/
-        case Z51_POWERDOWN:
-            *valueP = llHdl->powerdown[ch];
+        case Z51_COMBINE_WINDOW:
+            if( !IN_RANGE( value, 0, COMB_MAX ) ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->combWindow = value;
+            break;
+
+        case Z51_COMBINE_HITS:
+        {
+            OSS_IRQ_STATE state;
+
+            /* reset both counters */
+            LOCK_SCHED( state );
+            llHdl->combHits   = 0;
+            llHdl->combMisses = 0;
+            UNLOCK_SCHED( state );
+            break;
+        }
+
+        case Z51_RAMP_LEN:
+            if( value < 1 ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            llHdl->chan[lane].rampLen = value;
+            break;
+
+        case Z51_UNDERRUNS:
+        {
+            OSS_IRQ_STATE state;
+
+            /* reset all counters */
+            LOCK_SCHED( state );
+            llHdl->underruns = 0;
+            llHdl->lateCount = 0;
+            llHdl->lateMax   = 0;
+            UNLOCK_SCHED( state );
+            break;
+        }
+
+        case Z51_UNDERRUN_SIG_SET:
+            if( llHdl->underSig ) {
+                error = ERR_OSS_SIG_SET;
+                break;
+            }
+
+            error = OSS_SigCreate( OSH, value, &llHdl->underSig );
+            break;
+
+        case Z51_UNDERRUN_SIG_CLR:
+            if( llHdl->underSig == NULL ) {
+                error = ERR_OSS_SIG_CLR;
+                break;
+            }
+
+            error = OSS_SigRemove( OSH, &llHdl->underSig );
+            break;
+
+        /*--------------------------+
+        |  delete cached waveform   |
+        +--------------------------*/
+        case Z51_WAVE_DELETE:
+        {
+            WAVE *wave = waveFind( llHdl, value );
+
+            if( wave == NULL )
+                error = ERR_LL_ILL_PARAM;
+            else if( wave == llHdl->play[0].wave ||
+                     wave == llHdl->play[1].wave )
+                error = ERR_LL_DEV_BUSY;
+            else
+                waveFree( llHdl, wave );
+            break;
+        }
+
+        /*--------------------------+
+        |  upload waveform          |
+        +--------------------------*/
+        case Z51_BLK_WAVE_LOAD:
+            error = waveLoad( llHdl, ch, (M_SG_BLOCK*)value32_or_64 );
+            break;
+
+        /*--------------------------+
+        |  high-water marks         |
+        +--------------------------*/
+        case Z51_ASYNC_HWM:
+        {
+            STREAM *strm;
+            OSS_IRQ_STATE state;
+
+            LOCK_SCHED( state );
+            strm = &chanPlayer( llHdl, ch )->strm;
+            strm->hwm = strm->in - strm->out;
+            UNLOCK_SCHED( state );
+            break;
+        }
+
+        case Z51_POOL_HWM:
+            llHdl->pool.hwm = llHdl->pool.blocks - llHdl->pool.freeCnt;
+            break;
+
+        /*--------------------------+
+        |  command sequencer        |
+        +--------------------------*/
+        case Z51_BLK_SEQ_LOAD:
+            error = seqLoad( llHdl, (M_SG_BLOCK*)value32_or_64 );
+            break;
+
+        /*--------------------------+
+        |  apply configuration      |
+        +--------------------------*/
+        case Z51_BLK_STATUS:
+            error = statusSet( llHdl, lane / 2, (M_SG_BLOCK*)value32_or_64 );
+            break;
+
+        case Z51_SEQ_START:
+            error = seqStart( llHdl );
+            break;
+
+        case Z51_SEQ_STOP:
+        {
+            OSS_IRQ_STATE state;
+
+            LOCK_SCHED( state );
+            llHdl->seqRun = 0;
+            UNLOCK_SCHED( state );
+
+            timerStopIdle( llHdl );
+            break;
+        }
+
+        case Z51_SEQ_SIG_SET:
+            if( llHdl->seqSig ) {
+                error = ERR_OSS_SIG_SET;
+                break;
+            }
+
+            error = OSS_SigCreate( OSH, value, &llHdl->seqSig );
+            break;
+
+        case Z51_SEQ_SIG_CLR:
+            if( llHdl->seqSig == NULL ) {
+                error = ERR_OSS_SIG_CLR;
+                break;
+            }
+
+            error = OSS_SigRemove( OSH, &llHdl->seqSig );
+            break;
+
+        /*--------------------------+
+        |  marker events            |
+        +--------------------------*/
+        case Z51_BLK_MARKER_SET:
+            error = markSet( llHdl, ch, (M_SG_BLOCK*)value32_or_64 );
+            break;
+
+        case Z51_MARKER_CLR:
+        {
+            OSS_IRQ_STATE state;
+
+            LOCK_SCHED( state );
+            llHdl->markCnt = 0;
+            llHdl->play[0].markHit = 0;
+            llHdl->play[1].markHit = 0;
+            UNLOCK_SCHED( state );
+            break;
+        }
+
+        case Z51_MARKER_LOST:
+            llHdl->markLost = 0;
+            break;
+
+        case Z51_MARKER_SIG_SET:
+            if( llHdl->markSig ) {
+                error = ERR_OSS_SIG_SET;
+                break;
+            }
+
+            error = OSS_SigCreate( OSH, value, &llHdl->markSig );
+            break;
+
+        case Z51_MARKER_SIG_CLR:
+            if( llHdl->markSig == NULL ) {
+                error = ERR_OSS_SIG_CLR;
+                break;
+            }
+
+            error = OSS_SigRemove( OSH, &llHdl->markSig );
+            break;
+
+        /*--------------------------+
+        |  register signal          |
+        +--------------------------*/
+        case Z51_SET_SIGNAL:
+
+            /* signal already installed ? */
+            if( llHdl->hwSig ) {
+                error = ERR_OSS_SIG_SET;
+                break;
+            }
+
+            error = OSS_SigCreate( OSH, value, &llHdl->hwSig );
+            break;
+
+        /*--------------------------+
+        |  unregister signal        |
+        +--------------------------*/
+        case Z51_CLR_SIGNAL:
+
+            /* signal already installed ? */
+            if( llHdl->hwSig == NULL ) {
+                error = ERR_OSS_SIG_CLR;
+                break;
+            }
+
+            error = OSS_SigRemove( OSH, &llHdl->hwSig );
             break;
 
         /*--------------------------+
@@ -742,312 +1700,4182 @@ static int32 Z51_GetStat(
     return(error);
 }
 
-/******************************* Z51_BlockRead ******************************/
-/** Read a data block from the device
+/****************************** Z51_GetStat *********************************/
+/** Get the driver status
  *
- *  \param llHdl       \IN  low-level handle
- *  \param ch          \IN  current channel
- *  \param buf         \IN  data buffer
- *  \param size        \IN  data buffer size
- *  \param nbrRdBytesP \OUT number of read bytes
+ *  The driver supports \ref getstat_setstat_codes "these status codes"
+ *  in addition to the standard codes (see mdis_api.h).
  *
- *  \return            \c 0 on success or error code
+ *  \param llHdl          \IN  low-level handle
+ *  \param code           \IN  \ref getstat_setstat_codes "status code"
+ *  \param ch             \IN  current channel
+ *  \param value32_or_64P \IN  pointer to block data structure (M_SG_BLOCK) for
+ *                             block status codes
+ *  \param value32_or_64P \OUT data pointer or pointer to block data structure
+ *                             (M_SG_BLOCK) for block status codes
+ *
+ *  \return           \c 0 on success or error code
  */
-static int32 Z51_BlockRead(
-     LL_HANDLE *llHdl,
-     int32     ch,
-     void      *buf,
-     int32     size,
-     int32     *nbrRdBytesP
+static int32 Z51_GetStat(
+    LL_HANDLE *llHdl,
+    int32  code,
+    int32  ch,
+    INT32_OR_64 *value32_or_64P
 )
 {
-    DBGWRT_1((DBH, "LL - Z51_BlockRead: ch=%d, size=%d\n",ch,size));
+    int32 error;
+
+    if( (error = LOCK_DEV()) )
+        return( error );
+
+    error = getStat( llHdl, code, ch, value32_or_64P );
+
+    UNLOCK_DEV();
+    return( error );
+}
+
+/**********************************************************************/
+/** Get the driver status with the device locked (see Z51_GetStat())
+ *
+ *  \param llHdl          \IN  low-level handle
+ *  \param code           \IN  status code
+ *  \param ch             \IN  current channel
+ *  \param value32_or_64P \IN  pointer to block data structure
+ *  \param value32_or_64P \OUT data or block data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 getStat(
+    LL_HANDLE *llHdl,
+    int32  code,
+    int32  ch,
+    INT32_OR_64 *value32_or_64P
+)
+{
+    int32      error = ERR_SUCCESS;
+    int32       *valueP = (int32*)value32_or_64P; /* pointer to 32bit value  */
+    INT32_OR_64 *value64P = value32_or_64P;       /* stores 32/64bit pointer  */
+    u_int32     lane;
+
+    DBGWRT_1((DBH, "LL - Z51_GetStat: ch=%d code=0x%04x\n",
+              ch,code));
+
+    /*
+     * per DAC channel codes are only allowed on single output channels,
+     * playback codes only on the channels of unit 0
+     */
+    if( !IN_RANGE( ch, 0, (int32)llHdl->chNumber-1 ) ||
+        (chanLanes( llHdl, ch, &lane ) > 1 && chanCode( code )) ||
+        (ch >= UNIT_CHANNELS && playCode( code )) )
+        return( ERR_LL_ILL_CHAN );
+
+    switch(code)
+    {
+        /*--------------------------+
+        |  debug level              |
+        +--------------------------*/
+        case M_LL_DEBUG_LEVEL:
+            *valueP = llHdl->dbgLevel;
+            break;
+        /*--------------------------+
+        |  number of channels       |
+        +--------------------------*/
+        case M_LL_CH_NUMBER:
+            *valueP = llHdl->chNumber;
+            break;
+        /*--------------------------+
+        |  channel direction        |
+        +--------------------------*/
+        case M_LL_CH_DIR:
+            *valueP = M_CH_OUT;
+            break;
+        /*--------------------------+
+        |  channel length [bits]    |
+        +--------------------------*/
+        case M_LL_CH_LEN:
+            *valueP = 32;
+            break;
+        /*--------------------------+
+        |  channel type info        |
+        +--------------------------*/
+        case M_LL_CH_TYP:
+            *valueP = M_CH_ANALOG;
+            break;
+        /*--------------------------+
+        |  irq counter              |
+        +--------------------------*/
+        case M_LL_IRQ_COUNT:
+            *valueP = llHdl->irqCount;
+            break;
+        /*--------------------------+
+        |  ID PROM check enabled    |
+        +--------------------------*/
+        case M_LL_ID_CHECK:
+            *valueP = 0;
+            break;
+        /*--------------------------+
+        |   ident table pointer     |
+        |   (treat as non-block!)   |
+        +--------------------------*/
+        case M_MK_BLK_REV_ID:
+           *value64P = (INT32_OR_64)&llHdl->idFuncTbl;
+           break;
+
+        /*--------------------------+
+        |  DAC offset parameter     |
+        +--------------------------*/
+        case Z51_OFFSET:
+            *valueP = llHdl->chan[lane].offset;
+            break;
+
+        /*--------------------------+
+        |  DAC gain parameter       |
+        +--------------------------*/
+        case Z51_GAIN:
+            *valueP = llHdl->chan[lane].gain;
+            break;
+
+        /*--------------------------+
+        |  calibration profiles     |
+        +--------------------------*/
+        case Z51_CAL_PROFILE:
+            *valueP = llHdl->chan[lane].calSel;
+            break;
+
+        case Z51_BLK_CAL_LOAD:
+            error = calGet( llHdl, lane, (M_SG_BLOCK*)value32_or_64P );
+            break;
+
+        /*--------------------------+
+        |  current powerdown mode   |
+        +--------------------------*/
+        case Z51_POWERDOWN:
+            *valueP = llHdl->chan[lane].powerdown;
+            break;
+
+        /*--------------------------+
+        |  block write sample period|
+        +--------------------------*/
+        case Z51_SAMPLE_PERIOD:
+            *valueP = llHdl->chan[lane].period;
+            break;
+
+        /*--------------------------+
+        |  interpolation mode       |
+        +--------------------------*/
+        case Z51_INTERP_MODE:
+            *valueP = llHdl->chan[lane].interpMode;
+            break;
+
+        /*--------------------------+
+        |  interpolation factor     |
+        +--------------------------*/
+        case Z51_INTERP_FACTOR:
+            *valueP = llHdl->chan[lane].interpFactor;
+            break;
+
+        /*--------------------------+
+        |  block write format       |
+        +--------------------------*/
+        case Z51_BLK_FORMAT:
+            *valueP = llHdl->chan[lane].format;
+            break;
+
+        /*--------------------------+
+        |  playing waveform         |
+        +--------------------------*/
+        case Z51_WAVE_STATE:
+        {
+            OSS_IRQ_STATE state;
+
+            PLAYER *play;
+
+            LOCK_SCHED( state );
+            play = chanPlayer( llHdl, ch );
+            *valueP = play->wave ? (int32)play->wave->id : -1;
+            UNLOCK_SCHED( state );
+            break;
+        }
+
+        /*--------------------------+
+        |  synchronized start       |
+        +--------------------------*/
+        case Z51_SYNC_ARM:
+            *valueP = chanPlayer( llHdl, ch )->armed;
+            break;
+
+        case Z51_SYNC_SKEW:
+            error = syncSpread( llHdl, valueP );
+            break;
+
+        case Z51_SYNC_LATE:
+            if( !syncLate( llHdl, valueP ) )
+                error = ERR_LL_DEV_BUSY;
+            break;
+
+        /*--------------------------+
+        |  asynchronous block write |
+        +--------------------------*/
+        case Z51_BLK_ASYNC:
+            *valueP = llHdl->async;
+            break;
+
+        case Z51_ASYNC_TICKET:
+            *valueP = chanPlayer( llHdl, ch )->strm.ticket;
+            break;
+
+        case Z51_BLK_ASYNC_SUBMIT:
+            error = asyncBlock( llHdl, ch, (M_SG_BLOCK*)value32_or_64P );
+            break;
+
+        case Z51_ASYNC_DONE:
+            *valueP = chanPlayer( llHdl, ch )->strm.done;
+            break;
+
+        case Z51_ASYNC_FREE:
+        {
+            STREAM *strm;
+            OSS_IRQ_STATE state;
+
+            LOCK_SCHED( state );
+            strm = &chanPlayer( llHdl, ch )->strm;
+            if( strm->ticket - strm->done == ASYNC_BLOCKS )
+                *valueP = 0;
+            else
+                *valueP = strm->mask + 1 -
+                          streamUsed( llHdl, strm, (ch == 2) ? 0 : ch );
+            UNLOCK_SCHED( state );
+            break;
+        }
+
+        case Z51_ASYNC_HWM:
+            *valueP = chanPlayer( llHdl, ch )->strm.hwm;
+            break;
+
+        /*--------------------------+
+        |  memory pool              |
+        +--------------------------*/
+        case Z51_POOL_FREE:
+            *valueP = llHdl->pool.freeCnt;
+            break;
+
+        case Z51_POOL_HWM:
+            *valueP = llHdl->pool.hwm;
+            break;
+
+        /*--------------------------+
+        |  underrun handling        |
+        +--------------------------*/
+        case Z51_UNDERRUN_MODE:
+            *valueP = llHdl->chan[lane].underMode;
+            break;
+
+        case Z51_SAFE_VALUE:
+            *valueP = llHdl->chan[lane].safeValue;
+            break;
+
+        /*--------------------------+
+        |  safe state               |
+        +--------------------------*/
+        case Z51_SAFE_STATE:
+            *valueP = llHdl->safe;
+            break;
+
+        case Z51_SAFE_PD:
+            *valueP = llHdl->chan[lane].safePd;
+            break;
+
+        case Z51_SAFE_ON_FAULT:
+            *valueP = llHdl->safeOnFault;
+            break;
+
+        case Z51_SAFE_TIME:
+            *valueP = llHdl->safeTime;
+            break;
+
+        /*--------------------------+
+        |  priority classes         |
+        +--------------------------*/
+        case Z51_WRITE_PRIO:
+            *valueP = llHdl->chPrio[ch];
+            break;
+
+        case Z51_BLK_PRIO_STATS:
+            error = prioStats( llHdl, (M_SG_BLOCK*)value32_or_64P );
+            break;
+
+        /*--------------------------+
+        |  write combining          |
+        +--------------------------*/
+        case Z51_COMBINE_WINDOW:
+            *valueP = llHdl->combWindow;
+            break;
+
+        case Z51_COMBINE_HITS:
+            *valueP = llHdl->combHits;
+            break;
+
+        case Z51_COMBINE_MISSES:
+            *valueP = llHdl->combMisses;
+            break;
+
+        case Z51_RAMP_LEN:
+            *valueP = llHdl->chan[lane].rampLen;
+            break;
+
+        case Z51_UNDERRUNS:
+            *valueP = llHdl->underruns;
+            break;
+
+        case Z51_LATE_COUNT:
+            *valueP = llHdl->lateCount;
+            break;
+
+        case Z51_LATE_MAX:
+            *valueP = llHdl->lateMax;
+            break;
+
+        /*--------------------------+
+        |  used waveform memory     |
+        +--------------------------*/
+        case Z51_WAVE_MEM_USED:
+            *valueP = llHdl->waveMemUsed;
+            break;
+
+        /*--------------------------+
+        |  cached waveforms         |
+        +--------------------------*/
+        case Z51_BLK_WAVE_INFO:
+            error = waveInfo( llHdl, (M_SG_BLOCK*)value32_or_64P );
+            break;
+
+        /*--------------------------+
+        |  command sequencer        |
+        +--------------------------*/
+        case Z51_SEQ_STATE:
+            *valueP = llHdl->seqRun ? (int32)llHdl->seqPc : -1;
+            break;
+
+        case Z51_BLK_SEQ_TIMING:
+            error = seqTiming( llHdl, (M_SG_BLOCK*)value32_or_64P );
+            break;
+
+        /*--------------------------+
+        |  marker events            |
+        +--------------------------*/
+        case Z51_MARKER_COUNT:
+            *valueP = llHdl->markIn - llHdl->markOut;
+            break;
+
+        case Z51_MARKER_LOST:
+            *valueP = llHdl->markLost;
+            break;
+
+        case Z51_MARKER_TIME:
+            *valueP = usecNow( llHdl );
+            break;
+
+        case Z51_BLK_MARKER_EVENTS:
+            error = markEvents( llHdl, (M_SG_BLOCK*)value32_or_64P );
+            break;
+
+        /*--------------------------+
+        |  status snapshot          |
+        +--------------------------*/
+        case Z51_BLK_STATUS:
+            error = statusGet( llHdl, lane / 2, (M_SG_BLOCK*)value32_or_64P );
+            break;
+
+        /*--------------------------+
+        |  (unknown)                |
+        +--------------------------*/
+        default:
+            error = ERR_LL_UNK_CODE;
+    }
+
+    return(error);
+}
+
+/******************************* Z51_BlockRead ******************************/
+/** Read a data block from the device
+ *
+ *  \param llHdl       \IN  low-level handle
+ *  \param ch          \IN  current channel
+ *  \param buf         \IN  data buffer
+ *  \param size        \IN  data buffer size
+ *  \param nbrRdBytesP \OUT number of read bytes
+ *
+ *  \return            \c 0 on success or error code
+ */
+static int32 Z51_BlockRead(
+     LL_HANDLE *llHdl,
+     int32     ch,
+     void      *buf,
+     int32     size,
+     int32     *nbrRdBytesP
+)
+{
+    DBGWRT_1((DBH, "LL - Z51_BlockRead: ch=%d, size=%d\n",ch,size));
+
+    /* return number of read bytes */
+    *nbrRdBytesP = 0;
+
+    return(ERR_LL_ILL_FUNC);
+}
+
+/****************************** Z51_BlockWrite *****************************/
+/** Write a data block to the device
+ *
+ *  On channels 0 and 1 the buffer holds 16-bit input values, on channel 2
+ *  32-bit values composed like the M_write() argument ((B << 16) | A).
+ *  A frame of the group channel holds one such 32-bit value per unit,
+ *  unit 0 first. The same applies to the channels of further units.
+ *
+ *  With Z51_BLK_FORMAT set to Z51_FMT_RLE (channels 0 and 1 only) the buffer
+ *  holds an encoded byte stream which is decoded on the fly. Tokens may be
+ *  split across consecutive blocks. With Z51_FMT_S16 the values are signed
+ *  (-0x8000 = lowest, 0x7fff = highest output) and converted on the fly.
+ *  With Z51_FMT_RAW the buffer holds complete DAC command words, which are
+ *  checked once and written without interpolation and calibration.
+ *
+ *  Each input value is expanded into Z51_INTERP_FACTOR output values using
+ *  the channel's Z51_INTERP_MODE, calibrated and written to the DAC. The
+ *  output values are spaced by Z51_SAMPLE_PERIOD microseconds. Channel 2
+ *  uses the settings of channel 0 for both outputs, the group channel
+ *  those of unit 0's channel 0 for all outputs.
+ *
+ *  \param llHdl       \IN  low-level handle
+ *  \param ch          \IN  current channel
+ *  \param buf         \IN  data buffer
+ *  \param size        \IN  data buffer size
+ *  \param nbrWrBytesP \OUT number of written bytes
+ *
+ *  \return            \c 0 on success or error code
+ */
+static int32 Z51_BlockWrite(
+     LL_HANDLE *llHdl,
+     int32     ch,
+     void      *buf,
+     int32     size,
+     int32     *nbrWrBytesP
+)
+{
+    int32 error;
+    PACE  pace;
+
+    /* return number of written bytes */
+    *nbrWrBytesP = 0;
+
+    if( (error = LOCK_DEV()) )
+        return( error );
+
+    pace.error = ERR_SUCCESS;
+    error = blockWrite( llHdl, ch, buf, size, nbrWrBytesP, &pace );
+
+    /* device lock not regained after a paced wait */
+    if( pace.error )
+        return( pace.error );
+
+    UNLOCK_DEV();
+    return( error );
+}
+
+/**********************************************************************/
+/** Write a data block with the device locked (see Z51_BlockWrite())
+ *
+ *  Writing stops when the safe state is entered meanwhile. With a sample
+ *  period the device is unlocked while waiting for the next output (see
+ *  paceWait()); if it cannot be locked again, writing stops and
+ *  pace->error is set.
+ *
+ *  \param llHdl       \IN  low-level handle
+ *  \param ch          \IN  current channel
+ *  \param buf         \IN  data buffer
+ *  \param size        \IN  data buffer size
+ *  \param nbrWrBytesP \OUT number of written bytes
+ *  \param pace        \IN  pace->error = 0
+ *                     \OUT pacing state
+ *
+ *  \return            \c 0 on success or error code
+ */
+static int32 blockWrite(
+     LL_HANDLE *llHdl,
+     int32     ch,
+     void      *buf,
+     int32     size,
+     int32     *nbrWrBytesP,
+     PACE      *pace
+)
+{
+    u_int32 setCh;                          /* lane holding the settings */
+    u_int32 lanes;
+    u_int32 format;
+    u_int32 flip;                           /* offset binary conversion */
+
+    DBGWRT_1((DBH, "LL - Z51_BlockWrite: ch=%d, size=%d\n",ch,size));
+
+    /* return number of written bytes */
+    *nbrWrBytesP = 0;
+
+    if( !IN_RANGE( ch, 0, (int32)llHdl->chNumber-1 ) )
+        return( ERR_LL_ILL_CHAN );
+
+    lanes  = chanLanes( llHdl, ch, &setCh );
+    format = llHdl->chan[setCh].format;
+    flip   = (format == Z51_FMT_S16) ? 0x80008000 : 0;
+
+    /* frames are 16 bits per lane, raw command words 32 bits */
+    if( size <= 0 ||
+        (format != Z51_FMT_RLE &&
+         size % ((format == Z51_FMT_RAW) ? 4 : 2 * (int32)lanes)) )
+        return( ERR_LL_ILL_PARAM );
+
+    if( (lanes > 1 && format == Z51_FMT_RLE) ||
+        (ch == CH_GROUP( llHdl ) && format == Z51_FMT_RAW) )
+        return( ERR_LL_ILL_CHAN );
+
+    if( llHdl->safe )
+        return( ERR_LL_DEV_NOTRDY );
+
+    dacInit( llHdl );
+
+    if( llHdl->async ) {
+        int32   error;
+        u_int32 ticket;
+
+        if( ch >= UNIT_CHANNELS )
+            return( ERR_LL_ILL_CHAN );
+
+        if( format == Z51_FMT_RLE || format == Z51_FMT_RAW )
+            return( ERR_LL_ILL_PARAM );
+
+        if( (error = asyncSubmit( llHdl, ch, buf, size, flip,
+                                  &ticket )) == ERR_SUCCESS )
+            *nbrWrBytesP = size;
+
+        return( error );
+    }
+
+    /* outputs are paced from now on */
+    pace->period = llHdl->chan[setCh].period;
+    pace->due    = usecNow( llHdl );
+
+    if( format == Z51_FMT_RAW ) {
+        if( !rawCheck( (u_int32*)buf, size / 4 ) )
+            return( ERR_LL_ILL_PARAM );
+
+        rawWrite( llHdl, setCh / 2, (u_int32*)buf, size / 4, pace );
+    }
+    else if( lanes > 1 ) {
+        writeFrames( llHdl, ch, (u_int32*)buf, size / (2 * lanes), flip,
+                     pace );
+    }
+    else if( format == Z51_FMT_RLE ) {
+        const u_int8 *src = (const u_int8*)buf;
+        const u_int8 *end = src + size;
+        u_int16      chunk[RLE_CHUNK+1];
+        u_int32      n, got;
+        int32        error;
+
+        /*
+         * Decode into a chunk and output all but its last value, which is
+         * kept as lookahead for the spline and becomes the chunk's first.
+         */
+        n = 0;
+        do {
+            if( pace->error )
+                return( pace->error );
+            if( llHdl->safe )
+                return( ERR_LL_DEV_NOTRDY );
+
+            error = rleDecode( &llHdl->chan[setCh].rle, &src, end,
+                               &chunk[n], RLE_CHUNK+1-n, &got );
+            n += got;
+
+            /* output what was decoded before the bad token */
+            if( error ) {
+                if( n )
+                    writeSamples( llHdl, ch, chunk, n, NULL, 0, pace );
+                *nbrWrBytesP = (int32)(src - (const u_int8*)buf);
+                return( error );
+            }
+
+            if( n == RLE_CHUNK+1 ) {
+                writeSamples( llHdl, ch, chunk, RLE_CHUNK, &chunk[RLE_CHUNK],
+                              0, pace );
+                chunk[0] = chunk[RLE_CHUNK];
+                n = 1;
+            }
+        } while( src < end || llHdl->chan[setCh].rle.holdLeft );
+
+        if( n )
+            writeSamples( llHdl, ch, chunk, n, NULL, 0, pace );
+    }
+    else {
+        writeSamples( llHdl, ch, (u_int16*)buf, size / 2, NULL,
+                      (u_int16)flip, pace );
+    }
+
+    /* stopped by the device lock or the safe state */
+    if( pace->error )
+        return( pace->error );
+    if( llHdl->safe )
+        return( ERR_LL_DEV_NOTRDY );
+
+    *nbrWrBytesP = size;
+
+    return(ERR_SUCCESS);
+}
+
+
+/****************************** Z51_Irq ************************************/
+/** Interrupt service routine
+ *
+ *  The interrupt is triggered when the FPGA detects a hardware malfunction.
+ *
+ *  If the driver can detect the interrupt's cause it returns
+ *  LL_IRQ_DEVICE or LL_IRQ_DEV_NOT, otherwise LL_IRQ_UNKNOWN.
+ *
+ *  \param llHdl       \IN  low-level handle
+ *  \return LL_IRQ_DEVICE   irq caused by device
+ *          LL_IRQ_DEV_NOT  irq not caused by device
+ *          LL_IRQ_UNKNOWN  unknown
+ */
+static int32 Z51_Irq(
+   LL_HANDLE *llHdl
+)
+{
+    MACCESS ma;
+    u_int32 u;
+    int     mine = FALSE;
+
+    for( u=0; u<llHdl->units; u++ ) {
+        ma = llHdl->unitMa[u];
+
+        /* interrupt came from this unit ? */
+        if( (MREAD_D32( ma, DAC_IRQ_REG ) & DAC_IRQ_MASK) != DAC_IRQ_MASK )
+            continue;
+
+        /* 
+         * The interrupt must be disabled here, because on hardware
+         * malfunction the watchdog circuit will never release the IRQ line.
+         */
+        MWRITE_D32( ma, DAC_IER_REG, 0 );
+
+        /* clear interrupt */
+        MWRITE_D32( ma, DAC_IRQ_REG, DAC_IRQ_MASK );
+        mine = TRUE;
+    }
+
+    /* interrupt came from my device ? */
+    if( !mine )
+        return( LL_IRQ_DEV_NOT );
+
+    IDBGWRT_1((DBH, ">>> Z51_Irq:\n"));
+
+    /* try to enable on next write */
+    llHdl->initDac = 1;
+
+    if( llHdl->safeOnFault && safeEnter( llHdl, TRUE ) && llHdl->asyncSig )
+        OSS_SigSend( OSH, llHdl->asyncSig );
+
+    /* if requested send signal to application */
+    if( llHdl->hwSig ) {
+        OSS_SigSend( OSH, llHdl->hwSig );
+    }
+
+    llHdl->irqCount++;
+
+    return( LL_IRQ_DEVICE );
+}
+
+/****************************** Z51_Info ***********************************/
+/** Get information about hardware and driver requirements
+ *
+ *  The following info codes are supported:
+ *
+ * \code
+ *  Code                      Description
+ *  ------------------------  -----------------------------
+ *  LL_INFO_HW_CHARACTER      hardware characteristics
+ *  LL_INFO_ADDRSPACE_COUNT   nr of required address spaces
+ *  LL_INFO_ADDRSPACE         address space information
+ *  LL_INFO_IRQ               interrupt required
+ *  LL_INFO_LOCKMODE          process lock mode required
+ * \endcode
+ *
+ *  The LL_INFO_HW_CHARACTER code returns all address and
+ *  data modes (ORed) which are supported by the hardware
+ *  (MDIS_MAxx, MDIS_MDxx).
+ *
+ *  The LL_INFO_ADDRSPACE_COUNT code returns the number
+ *  of address spaces used by the driver.
+ *
+ *  The LL_INFO_ADDRSPACE code returns information about one
+ *  specific address space (MDIS_MAxx, MDIS_MDxx). The returned
+ *  data mode represents the widest hardware access used by
+ *  the driver.
+ *
+ *  The LL_INFO_IRQ code returns whether the driver supports an
+ *  interrupt routine (TRUE or FALSE).
+ *
+ *  The LL_INFO_LOCKMODE code returns which process locking
+ *  mode the driver needs (LL_LOCK_xxx).
+ *
+ *  \param infoType    \IN  info code
+ *  \param ...         \IN  argument(s)
+ *
+ *  \return            \c 0 on success or error code
+ */
+static int32 Z51_Info(
+   int32  infoType,
+   ...
+)
+{
+    int32   error = ERR_SUCCESS;
+    va_list argptr;
+
+    va_start(argptr, infoType );
+
+    switch(infoType) {
+        /*-------------------------------+
+        |  hardware characteristics      |
+        |  (all addr/data modes ORed)   |
+        +-------------------------------*/
+        case LL_INFO_HW_CHARACTER:
+        {
+            u_int32 *addrModeP = va_arg(argptr, u_int32*);
+            u_int32 *dataModeP = va_arg(argptr, u_int32*);
+
+            *addrModeP = MDIS_MA08;
+            *dataModeP = MDIS_MD08 | MDIS_MD16;
+            break;
+        }
+        /*-------------------------------+
+        |  nr of required address spaces |
+        |  (total spaces used)           |
+        +-------------------------------*/
+        case LL_INFO_ADDRSPACE_COUNT:
+        {
+            u_int32 *nbrOfAddrSpaceP = va_arg(argptr, u_int32*);
+
+            *nbrOfAddrSpaceP = ADDRSPACE_COUNT;
+            break;
+        }
+        /*-------------------------------+
+        |  address space type            |
+        |  (widest used data mode)       |
+        +-------------------------------*/
+        case LL_INFO_ADDRSPACE:
+        {
+            u_int32 addrSpaceIndex = va_arg(argptr, u_int32);
+            u_int32 *addrModeP = va_arg(argptr, u_int32*);
+            u_int32 *dataModeP = va_arg(argptr, u_int32*);
+            u_int32 *addrSizeP = va_arg(argptr, u_int32*);
+
+            if (addrSpaceIndex >= ADDRSPACE_COUNT)
+                error = ERR_LL_ILL_PARAM;
+            else {
+                *addrModeP = MDIS_MA08;
+                *dataModeP = MDIS_MD32;
+                *addrSizeP = ADDRSPACE_SIZE;
+            }
+
+            break;
+        }
+        /*-------------------------------+
+        |   interrupt required           |
+        +-------------------------------*/
+        case LL_INFO_IRQ:
+        {
+            u_int32 *useIrqP = va_arg(argptr, u_int32*);
+
+            *useIrqP = USE_IRQ;
+            break;
+        }
+        /*-------------------------------+
+        |   process lock mode            |
+        +-------------------------------*/
+        case LL_INFO_LOCKMODE:
+        {
+            u_int32 *lockModeP = va_arg(argptr, u_int32*);
+
+            *lockModeP = LL_LOCK_NONE;   /* see LOCK_DEV() */
+            break;
+        }
+        /*-------------------------------+
+        |   (unknown)                    |
+        +-------------------------------*/
+        default:
+          error = ERR_LL_ILL_PARAM;
+    }
+
+    va_end(argptr);
+    return(error);
+}
+
+/*******************************  Ident  ***********************************/
+/** Return ident string
+ *
+ *  \return            pointer to ident string
+ */
+static char* Ident( void )
+{
+    return( (char*) IdentString );
+}
+
+/********************************* Cleanup *********************************/
+/** Close all handles, free memory and return error code
+ *
+ *  \warning The low-level handle is invalid after this function is called.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param retCode    \IN  return value
+ *
+ *  \return           \IN   retCode
+ */
+static int32 Cleanup(
+   LL_HANDLE    *llHdl,
+   int32        retCode
+)
+{
+    /*------------------------------+
+    |  close handles                |
+    +------------------------------*/
+    /* leave synchronized start before the timer is removed */
+    if (llHdl->syncRef)
+        syncLeave(llHdl);
+
+    /* clean up timer */
+    if (llHdl->timer)
+        OSS_TimerRemove(llHdl->osHdl, &llHdl->timer);
+
+    /* clean up completion and underrun signals */
+    if (llHdl->asyncSig)
+        OSS_SigRemove(llHdl->osHdl, &llHdl->asyncSig);
+    if (llHdl->underSig)
+        OSS_SigRemove(llHdl->osHdl, &llHdl->underSig);
+    if (llHdl->seqSig)
+        OSS_SigRemove(llHdl->osHdl, &llHdl->seqSig);
+    if (llHdl->markSig)
+        OSS_SigRemove(llHdl->osHdl, &llHdl->markSig);
+
+    /* release the list of armed devices */
+    if (llHdl->syncRef) {
+        if (--G_syncRef == 0)
+            OSS_SemRemove(llHdl->osHdl, &G_syncSem);
+    }
+
+    /* clean up desc */
+    if (llHdl->descHdl)
+        DESC_Exit(&llHdl->descHdl);
+
+    /* clean up debug */
+    DBGEXIT((&DBH));
+
+    /*------------------------------+
+    |  free memory                  |
+    +------------------------------*/
+    /* free waveforms, queues and pool */
+    if (llHdl->arena)
+        OSS_MemFree(llHdl->osHdl, (int8*)llHdl->arena, llHdl->arenaAlloc);
+
+    /* free my handle */
+    OSS_MemFree(llHdl->osHdl, (int8*)llHdl, llHdl->memAlloc);
+
+    /*------------------------------+
+    |  return error code            |
+    +------------------------------*/
+    return(retCode);
+}
+
+
+/**********************************************************************/
+/** Correct output value according to calibration values
+ *
+ *  With a calibration profile active (Z51_CAL_PROFILE), the value is
+ *  looked up in the compiled profile. Otherwise the output value is
+ *  computed using the formula
+ *    new = offset + value * gain / 0xffff
+ *
+ *  If gain is zero then no correction is done and the input value 
+ *  is returned unchanged.
+ *
+ *  \param value      \IN  input value
+ *  \param c          \IN  lane
+ *
+ *  \return corrected value
+ */
+static u_int16 calibrate( 
+    LL_HANDLE  *llHdl,
+    u_int16    value,
+    const CHAN *c )
+{
+    const CAL_PROFILE *cal = c->cal;    /* read once, may be switched */
+    u_int16 tmp;
+
+    if( cal )
+        return( calLookup( cal, value ) );
+
+    if( c->gain == 0 )
+        return( value );
+
+    /* unsigned: value * gain exceeds the int range for large values */
+    tmp =  (u_int16)(c->offset + ((u_int32)value * c->gain) / 0xffff);
+    DBGWRT_3((DBH, "%d -> %d (o=0x%x, g=0x%x)\n", 
+              value, tmp, c->offset, c->gain ));
+
+    return( tmp );
+}
+
+/**********************************************************************/
+/** Look up a value in a compiled calibration profile
+ *
+ *  \param prof       \IN  profile
+ *  \param value      \IN  input value
+ *
+ *  \return corrected value
+ */
+static u_int16 calLookup( const CAL_PROFILE *prof, u_int16 value )
+{
+    const CAL_SEG *s = &prof->seg[prof->first[value >> 8]];
+    u_int32 dx, dy;
+
+    /* points are Z51_CAL_SPACING apart: at most one more segment starts */
+    if( value >= s[1].x )
+        s++;
+
+    /* |dy| = slope * dx >> 16, rounded, in 32 bits */
+    dx = value - s->x;
+    dy = (s->slope >> 16) * dx +
+         (((s->slope & 0xffff) * dx + 0x8000) >> 16);
+
+    return( (u_int16)(s->neg ? s->y - dy : s->y + dy) );
+}
+
+/**********************************************************************/
+/** Compile the points of a calibration profile into segments
+ *
+ *  Below the first and above the last point the output holds. The
+ *  output at a point is exact, between points it is within 1 LSB of
+ *  the straight line.
+ *
+ *  \param prof       \OUT compiled profile
+ *  \param pt         \IN  checked points, Z51_CAL_KEY(in,out)
+ *  \param n          \IN  number of points
+ */
+static void calCompile( CAL_PROFILE *prof, const u_int32 *pt, u_int32 n )
+{
+    CAL_SEG *s = prof->seg;
+    u_int32 i, b, dx, dy;
+
+    if( CAL_IN( pt[0] ) > 0 ) {
+        s->x     = 0;
+        s->y     = (u_int16)CAL_OUT( pt[0] );
+        s->neg   = 0;
+        s->slope = 0;
+        s++;
+    }
+
+    for( i=0; i<n; i++, s++ ) {
+        s->x     = CAL_IN( pt[i] );
+        s->y     = (u_int16)CAL_OUT( pt[i] );
+        s->neg   = 0;
+        s->slope = 0;
+
+        if( i < n - 1 ) {
+            dx = CAL_IN( pt[i+1] ) - s->x;
+            s->neg = CAL_OUT( pt[i+1] ) < s->y;
+            dy = s->neg ? s->y - CAL_OUT( pt[i+1] ) : CAL_OUT( pt[i+1] ) - s->y;
+
+            /* (dy << 16) / dx rounded down, without 64 bit division */
+            s->slope = ((dy / dx) << 16) + ((dy % dx) << 16) / dx;
+        }
+    }
+
+    s->x     = CAL_END;
+    s->y     = 0;
+    s->neg   = 0;
+    s->slope = 0;
+
+    for( b=0, i=0; b<CAL_BINS; b++ ) {
+        while( prof->seg[i+1].x <= (b << 8) )
+            i++;
+        prof->first[b] = (u_int8)i;
+    }
+
+    for( i=0; i<n; i++ )
+        prof->point[i] = pt[i];
+    prof->points = n;
+}
+
+/**********************************************************************/
+/** Check, compile and store a calibration profile of a lane
+ *
+ *  The active profile of the lane is not reloaded (ERR_LL_DEV_BUSY), so
+ *  the output paths never see a half compiled table and the scheduler
+ *  stays unlocked while compiling. With \a n = 0 the profile is deleted,
+ *  a lane using it falls back to profile 0.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param lane       \IN  lane
+ *  \param profile    \IN  profile 1..Z51_CAL_PROFILES
+ *  \param pt         \IN  points, Z51_CAL_KEY(in,out)
+ *  \param n          \IN  number of points
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 calLoad(
+    LL_HANDLE     *llHdl,
+    u_int32       lane,
+    u_int32       profile,
+    const u_int32 *pt,
+    u_int32       n )
+{
+    CHAN          *c = &llHdl->chan[lane];
+    CAL_PROFILE   *prof;
+    u_int32       i;
+    OSS_IRQ_STATE state;
+
+    if( !IN_RANGE( profile, 1, Z51_CAL_PROFILES ) ||
+        (n && !IN_RANGE( n, Z51_CAL_POINTS_MIN, Z51_CAL_POINTS_MAX )) )
+        return( ERR_LL_ILL_PARAM );
+
+    for( i=1; i<n; i++ ) {
+        if( CAL_IN( pt[i] ) < CAL_IN( pt[i-1] ) + Z51_CAL_SPACING )
+            return( ERR_LL_ILL_PARAM );
+    }
+
+    prof = &llHdl->calProf[lane * Z51_CAL_PROFILES + profile - 1];
+
+    if( n ) {
+        if( c->cal == prof )
+            return( ERR_LL_DEV_BUSY );
+        calCompile( prof, pt, n );
+    }
+    else {
+        LOCK_SCHED( state );
+        prof->points = 0;
+        if( c->cal == prof ) {
+            c->cal    = NULL;
+            c->calSel = 0;
+        }
+        UNLOCK_SCHED( state );
+    }
+
+    DBGWRT_2((DBH, " lane %d: profile %d, %d points\n", lane, profile, n));
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Select the calibration profile of a lane (Z51_CAL_PROFILE)
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param lane       \IN  lane
+ *  \param profile    \IN  0 = offset/gain, 1..Z51_CAL_PROFILES = loaded
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 calSelect( LL_HANDLE *llHdl, u_int32 lane, u_int32 profile )
+{
+    CHAN        *c = &llHdl->chan[lane];
+    CAL_PROFILE *prof = NULL;
+
+    if( profile ) {
+        if( profile > Z51_CAL_PROFILES )
+            return( ERR_LL_ILL_PARAM );
+
+        prof = &llHdl->calProf[lane * Z51_CAL_PROFILES + profile - 1];
+        if( prof->points == 0 )
+            return( ERR_LL_ILL_PARAM );
+    }
+
+    /* the output paths read the pointer once per value */
+    c->calSel = profile;
+    c->cal    = prof;
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Load a calibration profile (Z51_BLK_CAL_LOAD)
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param lane       \IN  lane
+ *  \param blk        \IN  Z51_CAL_HDR and points
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 calSet( LL_HANDLE *llHdl, u_int32 lane, M_SG_BLOCK *blk )
+{
+    const Z51_CAL_HDR   *hdr = (const Z51_CAL_HDR*)blk->data;
+    const Z51_CAL_POINT *src = (const Z51_CAL_POINT*)(hdr + 1);
+    u_int32 pt[Z51_CAL_POINTS_MAX];
+    u_int32 i;
+
+    if( blk->size < (int32)sizeof(Z51_CAL_HDR) ||
+        hdr->points > Z51_CAL_POINTS_MAX ||
+        blk->size < (int32)(sizeof(Z51_CAL_HDR) +
+                            hdr->points * sizeof(Z51_CAL_POINT)) )
+        return( ERR_LL_ILL_PARAM );
+
+    for( i=0; i<hdr->points; i++ )
+        pt[i] = Z51_CAL_KEY( src[i].in, src[i].out );
+
+    return( calLoad( llHdl, lane, hdr->profile, pt, hdr->points ) );
+}
+
+/**********************************************************************/
+/** Read back the points of a calibration profile (Z51_BLK_CAL_LOAD)
+ *
+ *  The caller sets Z51_CAL_HDR.profile, the driver returns the points.
+ *  Z51_CAL_HDR.points is 0 if the profile was not loaded.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param lane       \IN  lane
+ *  \param blk        \IN  Z51_CAL_HDR
+ *                    \OUT Z51_CAL_HDR and points, size of returned data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 calGet( LL_HANDLE *llHdl, u_int32 lane, M_SG_BLOCK *blk )
+{
+    Z51_CAL_HDR       *hdr = (Z51_CAL_HDR*)blk->data;
+    Z51_CAL_POINT     *dst = (Z51_CAL_POINT*)(hdr + 1);
+    const CAL_PROFILE *prof;
+    u_int32           i;
+
+    if( blk->size < (int32)sizeof(Z51_CAL_HDR) )
+        return( ERR_LL_USERBUF );
+
+    if( !IN_RANGE( hdr->profile, 1, Z51_CAL_PROFILES ) )
+        return( ERR_LL_ILL_PARAM );
+
+    prof = &llHdl->calProf[lane * Z51_CAL_PROFILES + hdr->profile - 1];
+    if( blk->size < (int32)(sizeof(Z51_CAL_HDR) +
+                            prof->points * sizeof(Z51_CAL_POINT)) )
+        return( ERR_LL_USERBUF );
+
+    hdr->points = prof->points;
+    for( i=0; i<prof->points; i++ ) {
+        dst[i].in  = (u_int16)CAL_IN( prof->point[i] );
+        dst[i].out = (u_int16)CAL_OUT( prof->point[i] );
+    }
+
+    blk->size = sizeof(Z51_CAL_HDR) + prof->points * sizeof(Z51_CAL_POINT);
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Initialize DAC communication and IRQ if required
+ *
+ *  If this is the first write we have to initialize the communication
+ *  between the FPGA and the DAC. This also connects the DAC's outputs to
+ *  the output drivers of the module.
+ *  So before the first access we have always 0mA output current (on F401).
+ *
+ *  \param llHdl      \IN  low-level handle
+ */
+static void dacInit( LL_HANDLE *llHdl )
+{
+    u_int32 u;
+
+    if( !llHdl->initDac )
+        return;
+
+    /* before enabling: an interrupt at DAC_IER_REG requests the next init */
+    llHdl->initDac = 0;
+
+    for( u=0; u<llHdl->units; u++ )
+        MWRITE_D32( llHdl->unitMa[u], DAC_SCLK_REG, DAC_SCLK_DEFAULT );
+
+    /*
+     * In order to avoid an unwanted interrupt we have to wait for the
+     * watchdog circuit to release the IRQ input before we can enable
+     * the interrupt.
+     */
+    if( llHdl->irqEnable ) {
+        DBGWRT_3((DBH, "delay for watchdog to come up...\n"));
+        OSS_Delay( OSH, 1010 );  /* worst case = 1000ms */
+        for( u=0; u<llHdl->units; u++ )
+            MWRITE_D32( llHdl->unitMa[u], DAC_IER_REG, DAC_IRQ_MASK );
+    }
+    llHdl->hwInit = 1;
+}
+
+/**********************************************************************/
+/** Calibrate and write one output frame
+ *
+ *  Dependant on the channel output A, B or both of a unit are set. For
+ *  the channel driving both outputs they are updated simultaneously.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel (not the group channel)
+ *  \param valA       \IN  value for output A (or B on B channels)
+ *  \param valB       \IN  value for output B (channels driving both)
+ */
+static void outputFrame(
+    LL_HANDLE *llHdl,
+    int32     ch,
+    u_int16   valA,
+    u_int16   valB )
+{
+    u_int32 unit = (u_int32)ch / UNIT_CHANNELS;
+    MACCESS ma = llHdl->unitMa[unit];
+    CHAN    *c = &llHdl->chan[2 * unit];
+    u_int32 frame;
+
+    /* the safe state was entered meanwhile */
+    if( llHdl->safe )
+        return;
+
+    combineFlush( llHdl, unit );
+
+    switch( ch - unit * UNIT_CHANNELS ) {
+        case 0:
+            c[0].bufVal = c[0].outVal = valA;
+            MWRITE_D32( ma, DAC_CTRL_REG,
+                        DAC_CMD_LOAD_A | DAC_CMD_BUF_A |
+                        calibrate( llHdl, valA, &c[0] ));
+            break;
+
+        case 1:
+            c[1].bufVal = c[1].outVal = valA;
+            MWRITE_D32( ma, DAC_CTRL_REG,
+                        DAC_CMD_LOAD_B | DAC_CMD_BUF_B |
+                        calibrate( llHdl, valA, &c[1] ));
+            break;
+
+        default:
+            frame = ((u_int32)valB << 16) | valA;
+            outputBank( llHdl, unit, 1, &frame );
+    }
+}
+
+/**********************************************************************/
+/** Calibrate and write one frame to consecutive units
+ *
+ *  Output A of all units is buffered first, then each unit loads both
+ *  outputs, so the whole bank changes within a few register accesses.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param unit       \IN  first unit
+ *  \param n          \IN  number of units
+ *  \param frame      \IN  (B << 16) | A per unit
+ */
+static void outputBank(
+    LL_HANDLE     *llHdl,
+    u_int32       unit,
+    u_int32       n,
+    const u_int32 *frame )
+{
+    CHAN    *c = &llHdl->chan[2 * unit];
+    u_int32 u;
+
+    /* the safe state was entered meanwhile */
+    if( llHdl->safe )
+        return;
+
+    for( u=0; u<n; u++, c+=2 ) {
+        combineFlush( llHdl, unit + u );
+        c[0].bufVal = c[0].outVal = frame[u] & 0xffff;
+        c[1].bufVal = c[1].outVal = frame[u] >> 16;
+        MWRITE_D32( llHdl->unitMa[unit + u], DAC_CTRL_REG,
+                    DAC_CMD_BUF_A |
+                    calibrate( llHdl, (u_int16)c[0].bufVal, &c[0] ) );
+    }
+
+    OSS_MikroDelay(OSH, 1);
+
+    c = &llHdl->chan[2 * unit];
+    for( u=0; u<n; u++, c+=2 )
+        MWRITE_D32( llHdl->unitMa[unit + u], DAC_CTRL_REG,
+                    DAC_CMD_LOAD_AB | DAC_CMD_BUF_B |
+                    calibrate( llHdl, (u_int16)c[1].bufVal, &c[1] ) );
+}
+
+/**********************************************************************/
+/** Output the value of an M_write() call
+ *
+ *  Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel
+ *  \param value      \IN  value
+ *  \param start      \IN  usecNow() at the call
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 writeValue(
+    LL_HANDLE *llHdl,
+    int32     ch,
+    int32     value,
+    u_int32   start )
+{
+    u_int32 frame[UNITS_MAX];
+    u_int32 first, lanes, u;
+
+    if( llHdl->safe )
+        return( ERR_LL_DEV_NOTRDY );
+
+    if( ch == CH_GROUP( llHdl ) ) {
+        /* same value pair on all units */
+        for( u=0; u<llHdl->units; u++ )
+            frame[u] = (u_int32)value;
+        outputBank( llHdl, 0, llHdl->units, frame );
+    }
+    else
+        outputFrame( llHdl, ch, (u_int16)value,
+                     (u_int16)((u_int32)value >> 16) );
+
+    prioCount( llHdl, ch, start );
+
+    /* next block write interpolates starting from this value */
+    lanes = chanLanes( llHdl, ch, &first );
+    while( lanes-- )
+        llHdl->chan[first + lanes].histValid = 0;
+
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Count the latency of an M_write() call in its priority class
+ *
+ *  Called with the scheduler locked after the value was written.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel
+ *  \param start      \IN  usecNow() at the call
+ */
+static void prioCount( LL_HANDLE *llHdl, int32 ch, u_int32 start )
+{
+    PRIO_STAT *st = &llHdl->prio[llHdl->chPrio[ch]];
+    u_int32   lat = usecNow( llHdl ) - start;
+
+    st->writes++;
+    st->latSum += lat;
+    if( lat > st->latMax )
+        st->latMax = lat;
+}
+
+/**********************************************************************/
+/** Get the latency of the priority classes (Z51_BLK_PRIO_STATS)
+ *
+ *  Fills the block with one Z51_PRIO_STATS per class, as far as the
+ *  block size permits, and returns the used size.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param blk        \IN  block data
+ *                    \OUT size of returned data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 prioStats( LL_HANDLE *llHdl, M_SG_BLOCK *blk )
+{
+    Z51_PRIO_STATS *st = (Z51_PRIO_STATS*)blk->data;
+    u_int32        i, n = blk->size / sizeof(Z51_PRIO_STATS);
+    OSS_IRQ_STATE  state;
+
+    if( n > PRIO_CLASSES )
+        n = PRIO_CLASSES;
+
+    LOCK_SCHED( state );
+    for( i=0; i<n; i++ ) {
+        st[i].writes = llHdl->prio[i].writes;
+        st[i].latMax = llHdl->prio[i].latMax;
+        st[i].latSum = llHdl->prio[i].latSum;
+    }
+    UNLOCK_SCHED( state );
+
+    blk->size = n * sizeof(Z51_PRIO_STATS);
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Write output A or B of a unit, combined with a write of the other
+ *
+ *  If the other lane's write is waiting, this value is buffered and both
+ *  outputs are loaded with one frame (DAC_CMD_LOAD_AB). Otherwise the
+ *  value is only buffered and the call waits up to the combining window,
+ *  with the device unlocked, for a write of the other lane on another
+ *  path. Without one it loads its lane itself: every unpaired write is
+ *  delayed by the full window, both its output and the return of the
+ *  call. A second write of the same lane while one is waiting is output
+ *  at once.
+ *
+ *  The window ends at a usecNow() deadline. A clock of tick resolution
+ *  lags, so the wait is also limited to one OSS_MikroDelay() per
+ *  microsecond of the window.
+ *
+ *  The safe state is entered without the device lock, so it is checked
+ *  again with the scheduler locked; a value buffered when it is entered
+ *  is never loaded.
+ *
+ *  Called with the device locked after dacInit(), returns with the
+ *  device unlocked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel (output A or B of a unit)
+ *  \param value      \IN  value
+ *  \param start      \IN  usecNow() at the call
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 combineWrite(
+    LL_HANDLE *llHdl,
+    int32     ch,
+    u_int16   value,
+    u_int32   start )
+{
+    u_int32 unit = (u_int32)ch / UNIT_CHANNELS;
+    u_int32 lane = (u_int32)ch - unit * UNIT_CHANNELS;
+    MACCESS ma = llHdl->unitMa[unit];
+    CHAN    *c = &llHdl->chan[2 * unit];
+    u_int32 cmd, pend, mine = 0, t;
+    int32   error = ERR_SUCCESS;
+    OSS_IRQ_STATE state;
+
+    LOCK_SCHED( state );
+    if( llHdl->safe ) {
+        UNLOCK_SCHED( state );
+        UNLOCK_DEV();
+        return( ERR_LL_DEV_NOTRDY );
+    }
+
+    cmd  = (lane ? DAC_CMD_BUF_B : DAC_CMD_BUF_A) |
+           calibrate( llHdl, value, &c[lane] );
+    pend = llHdl->combPend[unit];
+    c[lane].bufVal = value;
+
+    if( pend && (u_int32)COMB_LANE(pend) != lane ) {
+        /* the other lane is buffered: load both */
+        MWRITE_D32( ma, DAC_CTRL_REG, DAC_CMD_LOAD_AB | cmd );
+        c[0].outVal = c[0].bufVal;
+        c[1].outVal = c[1].bufVal;
+        llHdl->combPend[unit] = 0;
+        llHdl->combHits++;
+    }
+    else if( pend ) {
+        /* same lane again: the newer value replaces the buffered one */
+        MWRITE_D32( ma, DAC_CTRL_REG,
+                    (lane ? DAC_CMD_LOAD_B : DAC_CMD_LOAD_A) | cmd );
+        c[lane].outVal = value;
+        llHdl->combPend[unit] = 0;
+        llHdl->combMisses++;
+    }
+    else {
+        MWRITE_D32( ma, DAC_CTRL_REG, cmd );
+        mine = (++llHdl->combGen << 2) | (lane + 1);
+        llHdl->combPend[unit] = mine;
+        llHdl->combCmd[unit]  = cmd;
+    }
+    prioCount( llHdl, ch, start );
+    UNLOCK_SCHED( state );
+
+    /* next block write interpolates starting from this value */
+    c[lane].histValid = 0;
+    UNLOCK_DEV();
+
+    if( !mine )
+        return( ERR_SUCCESS );
+
+    /* the other lane's write or the safe state clears combPend */
+    for( t=0; t<llHdl->combWindow && llHdl->combPend[unit] == mine &&
+              US_BEFORE( usecNow( llHdl ), start + llHdl->combWindow ); t++ )
+        OSS_MikroDelay( OSH, 1 );
+
+    LOCK_SCHED( state );
+    if( llHdl->combPend[unit] == mine )
+        error = combineFlush( llHdl, unit );
+    UNLOCK_SCHED( state );
+
+    return( error );
+}
+
+/**********************************************************************/
+/** Load the buffered value of a waiting combined write
+ *
+ *  Called with the scheduler locked before other DAC commands of the
+ *  unit, which would overwrite or load the buffer. The buffered command
+ *  is rewritten with load bits. In the safe state it is dropped.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param unit       \IN  unit
+ *
+ *  \return           \c 0 or ERR_LL_DEV_NOTRDY if dropped
+ */
+static int32 combineFlush( LL_HANDLE *llHdl, u_int32 unit )
+{
+    u_int32 pend = llHdl->combPend[unit];
+    u_int32 lane;
+
+    if( !pend )
+        return( ERR_SUCCESS );
+
+    if( llHdl->safe ) {
+        llHdl->combPend[unit] = 0;
+        return( ERR_LL_DEV_NOTRDY );
+    }
+
+    lane = COMB_LANE(pend);
+    MWRITE_D32( llHdl->unitMa[unit], DAC_CTRL_REG,
+                (lane ? DAC_CMD_LOAD_B : DAC_CMD_LOAD_A) |
+                llHdl->combCmd[unit] );
+    llHdl->chan[2 * unit + lane].outVal = llHdl->chan[2 * unit + lane].bufVal;
+    llHdl->combPend[unit] = 0;
+    llHdl->combMisses++;
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Prime the interpolation history of a channel
+ *
+ *  After a reset (mode or factor changed, M_write()) the history is
+ *  filled with the first input value, so the first segment is flat.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param lane       \IN  DAC channel (0=A, 1=B)
+ *  \param histP      \IN  history of the channel
+ *  \param sample     \IN  current input value
+ */
+static void interpSample(
+    LL_HANDLE *llHdl,
+    int       lane,
+    int32     *histP,
+    int32     sample )
+{
+    if( llHdl->chan[lane].histValid )
+        return;
+
+    histP[0] = histP[1] = sample;
+    llHdl->chan[lane].histValid = 1;
+}
+
+/**********************************************************************/
+/** Compute one interpolated value between two input values
+ *
+ *  Computes output value k (1..factor) of the segment from p1 to p2.
+ *  For k == factor the result equals p2. p0 and p3 are the neighbouring
+ *  input values which are only used by the cubic (Catmull-Rom) spline.
+ *  Fixed-point arithmetic is used throughout.
+ *
+ *  \param mode       \IN  interpolation mode (Z51_INTERP_xxx)
+ *  \param factor     \IN  interpolation factor
+ *  \param k          \IN  index of output value within the segment
+ *  \param p0         \IN  input value before p1
+ *  \param p1         \IN  segment start
+ *  \param p2         \IN  segment end
+ *  \param p3         \IN  input value after p2
+ *
+ *  \return interpolated value
+ */
+static u_int16 interpolate(
+    u_int32 mode,
+    u_int32 factor,
+    u_int32 k,
+    int32   p0,
+    int32   p1,
+    int32   p2,
+    int32   p3 )
+{
+    int32 t, v;
+
+    switch( mode ) {
+        case Z51_INTERP_LINEAR:
+            v = p1 + ((p2 - p1) * (int32)k) / (int32)factor;
+            break;
+
+        case Z51_INTERP_CUBIC:
+            /* 2*p(t) = ((a*t + b)*t + c)*t + 2*p1, t in 0..1 */
+            t = (int32)((k << INTERP_FRAC_BITS) / factor);
+            v = ((-p0 + 3*p1 - 3*p2 + p3) * t) >> INTERP_FRAC_BITS;
+            v = ((v + 2*p0 - 5*p1 + 4*p2 - p3) * t) >> INTERP_FRAC_BITS;
+            v = ((v - p0 + p2) * t) >> INTERP_FRAC_BITS;
+            v = (v + 2*p1 + 1) >> 1;
+            break;
+
+        default:
+            v = p2;
+    }
+
+    if( v < 0 )
+        v = 0;
+    else if( v > 0xffff )
+        v = 0xffff;
+
+    return( (u_int16)v );
+}
+
+/**********************************************************************/
+/** Wait for the next output of a block write
+ *
+ *  The outputs are due at absolute deadlines, start + i * period, so the
+ *  time for interpolation, calibration and the DAC access is not added
+ *  to each period and the rate doesn't drift over a block. An output
+ *  which is late by more than a period restarts the deadlines, so a
+ *  preempted call doesn't burst out the missed outputs. The device is
+ *  unlocked while waiting, so other paths are not blocked for a whole
+ *  paced block.
+ *
+ *  Called with the device locked after an output.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param pace       \IN  pacing state
+ *                    \OUT next deadline, error if the device lock could
+ *                         not be taken again (returns unlocked)
+ *
+ *  \return TRUE to continue
+ */
+static int paceWait( LL_HANDLE *llHdl, PACE *pace )
+{
+    int32 left;
+
+    if( pace->period == 0 )
+        return( TRUE );
+
+    pace->due += pace->period;
+    left = (int32)(pace->due - usecNow( llHdl ));
+
+    if( left <= 0 ) {
+        if( -left > (int32)pace->period )
+            pace->due -= left;
+        return( TRUE );
+    }
+
+    /* a clock of tick resolution lags: never wait more than a period */
+    if( left > (int32)pace->period )
+        left = (int32)pace->period;
+
+    UNLOCK_DEV();
+    OSS_MikroDelay( OSH, (u_int32)left );
+    pace->error = LOCK_DEV();
+
+    return( pace->error == ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Check raw DAC command words
+ *
+ *  Scalar code: the words are ORed together into four accumulators
+ *  without branches, which costs a fraction of the output. The driver
+ *  uses no SIMD instructions; kernels don't save the vector registers
+ *  for it.
+ *
+ *  \param data       \IN  command words
+ *  \param n          \IN  number of words
+ *
+ *  \return           TRUE if all words are valid
+ */
+static int rawCheck( const u_int32 *data, u_int32 n )
+{
+    u_int32 acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+    u_int32 i = 0;
+
+    for( ; i + 4 <= n; i += 4 ) {
+        acc0 |= data[i];
+        acc1 |= data[i+1];
+        acc2 |= data[i+2];
+        acc3 |= data[i+3];
+    }
+    for( ; i < n; i++ )
+        acc0 |= data[i];
+
+    return( ((acc0 | acc1 | acc2 | acc3) & ~DAC_CMD_VALID) == 0 );
+}
+
+/**********************************************************************/
+/** Write raw DAC command words
+ *
+ *  Without sample period the words are written back to back, RAW_CHUNK
+ *  words per lock of the scheduler.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param unit       \IN  unit the words are written to
+ *  \param data       \IN  checked command words
+ *  \param n          \IN  number of words
+ *  \param pace       \IN  pacing state (see paceWait())
+ */
+static void rawWrite(
+    LL_HANDLE     *llHdl,
+    u_int32       unit,
+    const u_int32 *data,
+    u_int32       n,
+    PACE          *pace )
+{
+    MACCESS ma = llHdl->unitMa[unit];
+    u_int32 i, end;
+    OSS_IRQ_STATE state;
+
+    for( i=0; i<n && !llHdl->safe; ) {
+        end = pace->period ? i + 1 : i + RAW_CHUNK;
+        if( end > n )
+            end = n;
+
+        LOCK_SCHED( state );
+        combineFlush( llHdl, unit );
+        for( ; i<end && !llHdl->safe; i++ )
+            MWRITE_D32( ma, DAC_CTRL_REG, data[i] );
+        UNLOCK_SCHED( state );
+
+        if( !paceWait( llHdl, pace ) )
+            break;
+    }
+}
+
+/**********************************************************************/
+/** Interpolate, calibrate and output a sequence of values on channel 0/1
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel (0 or 1)
+ *  \param data       \IN  input values
+ *  \param n          \IN  number of input values
+ *  \param nextP      \IN  input value following data[n-1] or NULL if
+ *                         unknown (then it is extrapolated)
+ *  \param flip       \IN  XOR mask applied to all input values
+ *                         (0x8000 for Z51_FMT_S16)
+ *  \param pace       \IN  pacing state (see paceWait())
+ */
+static void writeSamples(
+    LL_HANDLE     *llHdl,
+    int32         ch,
+    const u_int16 *data,
+    u_int32       n,
+    const u_int16 *nextP,
+    u_int16       flip,
+    PACE          *pace )
+{
+    u_int32 lane;
+    u_int32 i, k;
+    int32   next;
+    u_int16 cur, val;
+    u_int32 factor, mode;
+    int32   *hist;
+    OSS_IRQ_STATE state;
+
+    chanLanes( llHdl, ch, &lane );
+    factor = llHdl->chan[lane].interpFactor;
+    mode   = llHdl->chan[lane].interpMode;
+    hist   = llHdl->chan[lane].hist;
+
+    for( i=0; i<n && !llHdl->safe; i++ ) {
+        cur = data[i] ^ flip;
+        interpSample( llHdl, lane, hist, cur );
+
+        /* lookahead for the spline, extrapolated at the block end */
+        if( i + 1 < n )
+            next = (u_int16)(data[i+1] ^ flip);
+        else if( nextP )
+            next = *nextP ^ flip;
+        else
+            next = 2 * (int32)cur - hist[1];
+
+        for( k=1; k<=factor; k++ ) {
+            val = interpolate( mode, factor, k, hist[0], hist[1], cur, next );
+
+            LOCK_SCHED( state );
+            outputFrame( llHdl, ch, val, 0 );
+            UNLOCK_SCHED( state );
+
+            if( !paceWait( llHdl, pace ) )
+                return;
+        }
+
+        hist[0] = hist[1];
+        hist[1] = cur;
+    }
+}
+
+/**********************************************************************/
+/** Interpolate, calibrate and write frames driving both outputs
+ *
+ *  Used for the channels driving both outputs of a unit and for the group
+ *  channel. Each frame holds one 32-bit value ((B << 16) | A) per unit.
+ *  All lanes use the settings of the channel's first lane; each lane
+ *  keeps its own interpolation history.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel
+ *  \param data       \IN  frames
+ *  \param n          \IN  number of frames
+ *  \param flip       \IN  XOR mask converting to offset binary
+ *  \param pace       \IN  pacing state (see paceWait())
+ */
+static void writeFrames(
+    LL_HANDLE     *llHdl,
+    int32         ch,
+    const u_int32 *data,
+    u_int32       n,
+    u_int32       flip,
+    PACE          *pace )
+{
+    u_int32 first, lanes = chanLanes( llHdl, ch, &first );
+    u_int32 words = lanes / 2;
+    CHAN    *c = &llHdl->chan[first];
+    u_int32 factor = c->interpFactor;
+    u_int32 mode   = c->interpMode;
+    u_int32 frame[UNITS_MAX];
+    int32   cur[2*UNITS_MAX], next[2*UNITS_MAX];
+    u_int32 i, k, l, w;
+    OSS_IRQ_STATE state;
+
+    for( i=0; i<n && !llHdl->safe; i++, data+=words ) {
+        for( l=0; l<lanes; l++ ) {
+            cur[l] = ((data[l/2] ^ flip) >> (16 * (l & 1))) & 0xffff;
+            interpSample( llHdl, first + l, c[l].hist, cur[l] );
+
+            /* lookahead for the spline, extrapolated at the block end */
+            if( i + 1 < n )
+                next[l] = ((data[words + l/2] ^ flip) >> (16 * (l & 1))) &
+                          0xffff;
+            else
+                next[l] = 2 * cur[l] - c[l].hist[1];
+        }
+
+        for( k=1; k<=factor; k++ ) {
+            for( w=0; w<words; w++ ) {
+                frame[w] =
+                    interpolate( mode, factor, k, c[2*w].hist[0],
+                                 c[2*w].hist[1], cur[2*w], next[2*w] ) |
+                    ((u_int32)interpolate( mode, factor, k, c[2*w+1].hist[0],
+                                           c[2*w+1].hist[1], cur[2*w+1],
+                                           next[2*w+1] ) << 16);
+            }
+
+            LOCK_SCHED( state );
+            outputBank( llHdl, first / 2, words, frame );
+            UNLOCK_SCHED( state );
+
+            if( !paceWait( llHdl, pace ) )
+                return;
+        }
+
+        for( l=0; l<lanes; l++ ) {
+            c[l].hist[0] = c[l].hist[1];
+            c[l].hist[1] = cur[l];
+        }
+    }
+}
+
+/**********************************************************************/
+/** Streaming decoder for Z51_FMT_RLE encoded data
+ *
+ *  Decodes tokens from *srcP until either \a max values were produced or
+ *  the source is exhausted. Incomplete tokens and unfinished holds are
+ *  kept in \a dec and continued with the next call. A reserved tag
+ *  resets the decoder state; the values decoded before it are returned.
+ *
+ *  \param dec        \IN  decoder state
+ *  \param srcP       \IN  pointer to encoded data
+ *                    \OUT advanced behind the consumed bytes, on error
+ *                         to the reserved tag
+ *  \param end        \IN  end of encoded data
+ *  \param dst        \OUT decoded values
+ *  \param max        \IN  max. number of values to decode
+ *  \param nP         \OUT number of decoded values
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 rleDecode(
+    RLE_DEC       *dec,
+    const u_int8  **srcP,
+    const u_int8  *end,
+    u_int16       *dst,
+    u_int32       max,
+    u_int32       *nP )
+{
+    const u_int8 *src = *srcP;
+    u_int32      n = 0, need;
+    u_int8       tag;
+    int32        error = ERR_SUCCESS;
+
+    while( n < max ) {
+        /* finish pending hold */
+        if( dec->holdLeft ) {
+            dst[n++] = dec->prev;
+            dec->holdLeft--;
+            continue;
+        }
+
+        if( src == end )
+            break;
+
+        /* collect token */
+        tag = dec->tokLen ? dec->tok[0] : *src;
+
+        if( tag < Z51_RLE_LHOLD )
+            need = 1;
+        else if( tag < Z51_RLE_RSVD )
+            need = 2;
+        else if( tag == Z51_RLE_RAW )
+            need = 3;
+        else
+            need = 0;
+
+        if( dec->tokLen >= need || dec->tokLen >= sizeof(dec->tok) ) {
+            dec->tokLen   = 0;
+            dec->holdLeft = 0;
+            error = ERR_LL_ILL_PARAM;
+            break;
+        }
+        dec->tok[dec->tokLen++] = *src++;
+
+        if( dec->tokLen < need )
+            continue;
+        dec->tokLen = 0;
+
+        /* process token */
+        if( tag < Z51_RLE_HOLD ) {
+            /* 7-bit signed delta */
+            dec->prev = (u_int16)(dec->prev + ((int8)(tag << 1) >> 1));
+            dst[n++] = dec->prev;
+        }
+        else if( tag < Z51_RLE_LHOLD )
+            dec->holdLeft = (tag & 0x3f) + 1;
+        else if( tag < Z51_RLE_RSVD )
+            dec->holdLeft = (((tag & 0x1f) << 8) | dec->tok[1]) + 65;
+        else {
+            dec->prev = (u_int16)(dec->tok[1] | (dec->tok[2] << 8));
+            dst[n++] = dec->prev;
+        }
+    }
+
+    *srcP = src;
+    *nP = n;
+    return( error );
+}
+
+/**********************************************************************/
+/** Check if a status code addresses a single DAC channel
+ *
+ *  \param code       \IN  status code
+ *
+ *  \return TRUE if code is only valid on channels 0 and 1
+ */
+static int chanCode( int32 code )
+{
+    switch( code ) {
+        case Z51_OFFSET:
+        case Z51_GAIN:
+        case Z51_POWERDOWN:
+        case Z51_SAMPLE_PERIOD:
+        case Z51_INTERP_MODE:
+        case Z51_INTERP_FACTOR:
+        case Z51_BLK_FORMAT:
+        case Z51_UNDERRUN_MODE:
+        case Z51_SAFE_VALUE:
+        case Z51_RAMP_LEN:
+        case Z51_CAL_PROFILE:
+        case Z51_BLK_CAL_LOAD:
+        case Z51_SAFE_PD:
+            return( TRUE );
+    }
+    return( FALSE );
+}
+
+/**********************************************************************/
+/** Add the size of an array to a buffer size
+ *
+ *  \param sizeP      \IN  buffer size [bytes]
+ *                    \OUT buffer size plus n * elemSize
+ *  \param n          \IN  number of elements
+ *  \param elemSize   \IN  element size [bytes]
+ *
+ *  \return FALSE if the size does not fit into 32 bits
+ */
+static int sizeAdd( u_int32 *sizeP, u_int32 n, u_int32 elemSize )
+{
+    if( elemSize && n > (0xffffffff - *sizeP) / elemSize )
+        return( FALSE );
+
+    *sizeP += n * elemSize;
+    return( TRUE );
+}
+
+/**********************************************************************/
+/** Check if a status code addresses a player or the sequencer
+ *
+ *  \param code       \IN  status code
+ *
+ *  \return TRUE if code is only valid on the channels of unit 0
+ */
+static int playCode( int32 code )
+{
+    switch( code ) {
+        case Z51_WAVE_START:
+        case Z51_WAVE_STOP:
+        case Z51_WAVE_STATE:
+        case Z51_BLK_WAVE_LOAD:
+        case Z51_SYNC_ARM:
+        case Z51_ASYNC_EOS:
+        case Z51_ASYNC_TICKET:
+        case Z51_BLK_ASYNC_SUBMIT:
+        case Z51_ASYNC_DONE:
+        case Z51_ASYNC_FREE:
+        case Z51_ASYNC_HWM:
+        case Z51_BLK_MARKER_SET:
+        case Z51_SEQ_START:
+        case Z51_SEQ_STOP:
+        case Z51_SEQ_STATE:
+        case Z51_SEQ_SIG_SET:
+        case Z51_SEQ_SIG_CLR:
+        case Z51_BLK_SEQ_LOAD:
+        case Z51_BLK_SEQ_TIMING:
+            return( TRUE );
+    }
+    return( FALSE );
+}
+
+/**********************************************************************/
+/** Check if a SetStat code starts or changes output
+ *
+ *  \param code       \IN  status code
+ *
+ *  \return TRUE if code is rejected in the safe state
+ */
+static int outputCode( int32 code )
+{
+    switch( code ) {
+        case Z51_POWERDOWN:
+        case Z51_WAVE_START:
+        case Z51_SYNC_ARM:
+        case Z51_SEQ_START:
+        case Z51_BLK_STATUS:
+            return( TRUE );
+    }
+    return( FALSE );
+}
+
+/**********************************************************************/
+/** Get the DAC outputs (lanes) driven by a channel
+ *
+ *  Channel 3*u drives output A of unit u, 3*u+1 output B and 3*u+2 both.
+ *  The group channel drives all outputs of all units.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel
+ *  \param firstP     \OUT first lane, which holds the channel's settings
+ *
+ *  \return number of lanes
+ */
+static u_int32 chanLanes( LL_HANDLE *llHdl, int32 ch, u_int32 *firstP )
+{
+    u_int32 unit = (u_int32)ch / UNIT_CHANNELS;
+
+    if( ch == CH_GROUP( llHdl ) ) {
+        *firstP = 0;
+        return( 2 * llHdl->units );
+    }
+
+    switch( ch - unit * UNIT_CHANNELS ) {
+        case 0:  *firstP = 2 * unit;     return( 1 );
+        case 1:  *firstP = 2 * unit + 1; return( 1 );
+        default: *firstP = 2 * unit;     return( 2 );
+    }
+}
+
+/**********************************************************************/
+/** Playback timer callback
+ *
+ *  Called every Z51_TICK_MS milliseconds. Outputs all frames whose
+ *  deadline lies within the current tick, always serving the player with
+ *  the earliest deadline first. Frames within a tick are output back to
+ *  back; the timer isn't held up to space them, the next call of the
+ *  periodic timer serves the next tick. If the deadlines of channel 0 and
+ *  1 coincide, both values are output as one combined frame
+ *  (DAC_CMD_LOAD_AB). Sequencer steps are executed before frames with the
+ *  same deadline. The scheduler time advances by one tick per call.
+ *
+ *  A tick may hold thousands of frames (short period, interpolation,
+ *  Z51_TICK_MS > 1), so the scheduler lock is released between frames;
+ *  interrupts are only masked while one frame or sequencer step is
+ *  output.
+ *
+ *  \param arg        \IN  low-level handle
+ */
+static void schedTimer( void *arg )
+{
+    LL_HANDLE *llHdl = (LL_HANDLE*)arg;
+    PLAYER    *play, *playA = &llHdl->play[0], *playB = &llHdl->play[1];
+    u_int32   tickEnd, due, valA, valB;
+    int       okA, okB, seq;
+    OSS_IRQ_STATE state;
+
+    LOCK_SCHED( state );
+    tickEnd = llHdl->schedNow + llHdl->tickMs * 1000;
+
+    /* synchronized start due */
+    if( llHdl->syncPend && !US_BEFORE( usecNow( llHdl ), llHdl->syncAt ) )
+        syncRelease( llHdl );
+
+    for(;;) {
+        /* let interrupts and other calls in between the frames */
+        UNLOCK_SCHED( state );
+        LOCK_SCHED( state );
+
+        play = schedNext( llHdl );
+        seq  = llHdl->seqRun &&
+               (play == NULL || !US_BEFORE( play->next, llHdl->seqNext ));
+
+        if( seq )
+            due = llHdl->seqNext;
+        else if( play )
+            due = play->next;
+        else
+            break;
+
+        if( !US_BEFORE( due, tickEnd ) )
+            break;
+
+        if( seq ) {
+            seqExec( llHdl );
+            continue;
+        }
+
+        if( PLAY_ACTIVE( playA ) && PLAY_ACTIVE( playB ) &&
+            playA->next == playB->next ) {
+            /* coinciding deadlines of channel 0 and 1 */
+            lateCheck( llHdl, playA );
+            lateCheck( llHdl, playB );
+            okA = playFrame( llHdl, playA, &valA );
+            okB = playFrame( llHdl, playB, &valB );
+
+            if( okA && okB )
+                outputFrame( llHdl, 2, (u_int16)valA, (u_int16)valB );
+            else if( okA )
+                outputFrame( llHdl, 0, (u_int16)valA, 0 );
+            else if( okB )
+                outputFrame( llHdl, 1, (u_int16)valB, 0 );
+
+            markRecord( llHdl, playA );
+            markRecord( llHdl, playB );
+        }
+        else {
+            lateCheck( llHdl, play );
+            if( playFrame( llHdl, play, &valA ) )
+                outputFrame( llHdl, play->ch, (u_int16)valA,
+                             (u_int16)(valA >> 16) );
+
+            markRecord( llHdl, play );
+        }
+    }
+
+    llHdl->schedNow = tickEnd;
+    UNLOCK_SCHED( state );
+}
+
+/**********************************************************************/
+/** Get the active player with the earliest deadline
+ *
+ *  Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *
+ *  \return player or NULL if no player is active
+ */
+static PLAYER* schedNext( LL_HANDLE *llHdl )
+{
+    PLAYER *playA = &llHdl->play[0], *playB = &llHdl->play[1];
+
+    if( !PLAY_ACTIVE( playB ) )
+        return( PLAY_ACTIVE( playA ) ? playA : NULL );
+
+    if( !PLAY_ACTIVE( playA ) || US_BEFORE( playB->next, playA->next ) )
+        return( playB );
+
+    return( playA );
+}
+
+/**********************************************************************/
+/** Get the next frame of a player and advance it
+ *
+ *  Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ *  \param valP       \OUT frame (channel 2: (B << 16) | A)
+ *
+ *  \return TRUE if the frame is to be output
+ */
+static int playFrame( LL_HANDLE *llHdl, PLAYER *play, u_int32 *valP )
+{
+    u_int8 *frame;
+
+    if( play->stream )
+        return( streamFrame( llHdl, play, valP ) );
+
+    frame = llHdl->pool.mem + (play->blk << llHdl->pool.blkShift) + play->ofs;
+    if( play->wave->width == 2 )
+        *valP = *(u_int16*)frame;
+    else
+        *valP = *(u_int32*)frame;
+
+    if( llHdl->markCnt )
+        markCheck( llHdl, play, MARK_WAVE, play->wave->id, play->pos );
+
+    playAdvance( llHdl, play );
+    return( TRUE );
+}
+
+/**********************************************************************/
+/** Account the lateness of the frame due next
+ *
+ *  Frames output more than one sample period (one tick if the period is
+ *  0) after their deadline are counted as late. Called with the scheduler
+ *  locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ */
+static void lateCheck( LL_HANDLE *llHdl, PLAYER *play )
+{
+    u_int32 late  = usecNow( llHdl ) - (play->next + llHdl->schedOfs);
+    u_int32 limit = llHdl->chan[(play->ch == 2) ? 0 : play->ch].period;
+
+    if( (int32)late <= 0 )
+        return;
+
+    if( late > (limit ? limit : llHdl->tickMs * 1000) )
+        llHdl->lateCount++;
+    if( late > llHdl->lateMax )
+        llHdl->lateMax = late;
+}
+
+/**********************************************************************/
+/** Get the player serving a channel
+ *
+ *  Channel 0 and 2 are served by player 0, channel 1 by player 1 unless
+ *  player 0 is busy with channel 2.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel
+ *
+ *  \return player
+ */
+static PLAYER* chanPlayer( LL_HANDLE *llHdl, int32 ch )
+{
+    PLAYER *playA = &llHdl->play[0];
+
+    if( ch != 1 || (playA->ch == 2 && PLAY_BUSY( playA )) )
+        return( playA );
+
+    return( &llHdl->play[1] );
+}
+
+/**********************************************************************/
+/** Check if playback on a channel collides with the other player
+ *
+ *  Channel 2 needs both DAC channels.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  channel to be started
+ *
+ *  \return TRUE if the other player is busy
+ */
+static int chanConflict( LL_HANDLE *llHdl, int32 ch )
+{
+    if( ch == 2 )
+        return( PLAY_BUSY( &llHdl->play[1] ) );
+
+    if( ch == 1 )
+        return( llHdl->play[0].ch == 2 && PLAY_BUSY( &llHdl->play[0] ) );
+
+    return( FALSE );
+}
+
+/**********************************************************************/
+/** Find cached waveform
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param id         \IN  waveform ID
+ *
+ *  \return waveform or NULL if not cached
+ */
+static WAVE* waveFind( LL_HANDLE *llHdl, u_int32 id )
+{
+    u_int32 i;
+
+    for( i=0; i<Z51_WAVE_MAX; i++ )
+        if( llHdl->wave[i].used && llHdl->wave[i].id == id )
+            return( &llHdl->wave[i] );
+
+    return( NULL );
+}
+
+/**********************************************************************/
+/** Remove waveform from cache and free its memory
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param wave       \IN  waveform (must not be playing)
+ */
+static void waveFree( LL_HANDLE *llHdl, WAVE *wave )
+{
+    poolFree( &llHdl->pool, wave->first, wave->last, wave->blocks );
+    llHdl->waveMemUsed -= wave->frames * wave->width;
+    wave->used = 0;
+}
+
+/**********************************************************************/
+/** Upload waveform into the cache
+ *
+ *  The block starts with a Z51_WAVE_HDR followed by the frames: 16-bit
+ *  values on channel 0/1, 32-bit values ((B << 16) | A) on channel 2.
+ *  A cached waveform with the same ID is replaced. If the cache memory
+ *  is exhausted the least recently used waveforms are evicted, playing
+ *  waveforms are kept. Nothing is freed or evicted unless the waveform
+ *  fits then.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  current channel
+ *  \param blk        \IN  block data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 waveLoad( LL_HANDLE *llHdl, int32 ch, M_SG_BLOCK *blk )
+{
+    Z51_WAVE_HDR *hdr = (Z51_WAVE_HDR*)blk->data;
+    u_int32      width = (ch == 2) ? 4 : 2;
+    u_int32      size, i, need, pb, chunk, avail;
+    int          slot;
+    u_int8       *src;
+    WAVE         *wave, *lru;
+
+    if( blk->size < (int32)sizeof(Z51_WAVE_HDR) )
+        return( ERR_LL_USERBUF );
+
+    size = blk->size - sizeof(Z51_WAVE_HDR);
+    need = (size + llHdl->pool.blkSize - 1) >> llHdl->pool.blkShift;
+    if( size == 0 || size % width || need > llHdl->pool.blocks ||
+        hdr->id > 0xffff )
+        return( ERR_LL_ILL_PARAM );
+
+    /* an existing waveform with this ID is replaced */
+    if( (wave = waveFind( llHdl, hdr->id )) &&
+        (wave == llHdl->play[0].wave || wave == llHdl->play[1].wave) )
+        return( ERR_LL_DEV_BUSY );
+
+    /* check that it fits before anything is freed */
+    avail = llHdl->pool.freeCnt;
+    slot  = FALSE;
+    for( i=0; i<Z51_WAVE_MAX; i++ ) {
+        lru = &llHdl->wave[i];
+        if( !lru->used )
+            slot = TRUE;
+        else if( lru != llHdl->play[0].wave && lru != llHdl->play[1].wave ) {
+            avail += lru->blocks;
+            slot = TRUE;
+        }
+    }
+    if( need > avail || !slot )
+        return( ERR_OSS_MEM_ALLOC );
+
+    if( wave )
+        waveFree( llHdl, wave );
+
+    /* evict least recently used waveforms until it fits */
+    for(;;) {
+        wave = lru = NULL;
+        for( i=0; i<Z51_WAVE_MAX; i++ ) {
+            if( !llHdl->wave[i].used ) {
+                if( wave == NULL )
+                    wave = &llHdl->wave[i];
+            }
+            else if( &llHdl->wave[i] != llHdl->play[0].wave &&
+                     &llHdl->wave[i] != llHdl->play[1].wave &&
+                     (lru == NULL || US_BEFORE( llHdl->wave[i].lastUse,
+                                                lru->lastUse )) )
+                lru = &llHdl->wave[i];
+        }
+
+        if( wave && need <= llHdl->pool.freeCnt )
+            break;
+
+        if( lru == NULL )
+            return( ERR_OSS_MEM_ALLOC );
+
+        DBGWRT_2((DBH, " evict waveform %d\n", lru->id));
+        waveFree( llHdl, lru );
+    }
+
+    wave->first = poolAlloc( &llHdl->pool, need, &wave->last );
+
+    /* copy frames block by block */
+    src = (u_int8*)(hdr + 1);
+    for( pb=wave->first, i=0; i<size; i+=chunk, pb=llHdl->pool.link[pb] ) {
+        chunk = size - i;
+        if( chunk > llHdl->pool.blkSize )
+            chunk = llHdl->pool.blkSize;
+        OSS_MemCopy( OSH, chunk, (char*)(src + i),
+                     (char*)(llHdl->pool.mem + (pb << llHdl->pool.blkShift)) );
+    }
+
+    wave->used     = 1;
+    wave->id       = hdr->id;
+    wave->width    = width;
+    wave->frames   = size / width;
+    wave->blocks   = need;
+    wave->lastUse  = llHdl->waveStamp++;
+    wave->starts   = 0;
+    llHdl->waveMemUsed += size;
+
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Start or arm playback of a cached waveform
+ *
+ *  Channel 0 and 1 have their own players, channel 2 occupies both. A
+ *  running or armed playback of the channel is replaced. The frames are
+ *  output directly from the cache, no data is copied.
+ *
+ *  When armed, the first frame is written into the DAC's buffers without
+ *  loading the outputs and the device waits for Z51_SYNC_TRIGGER.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  output channel
+ *  \param arg        \IN  waveform ID (bits 15..0) and number of passes
+ *                         (bits 31..16, 0 = endless)
+ *  \param arm        \IN  TRUE: arm only
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 waveStart( LL_HANDLE *llHdl, int32 ch, u_int32 arg, int arm )
+{
+    MACCESS ma = llHdl->ma;
+    WAVE    *wave = waveFind( llHdl, arg & 0xffff );
+    PLAYER  *play = &llHdl->play[(ch == 2) ? 0 : ch];
+    u_int32 val;
+    u_int8  *frame;
+    OSS_IRQ_STATE state;
+
+    if( wave == NULL || wave->width != ((ch == 2) ? 4u : 2u) )
+        return( ERR_LL_ILL_PARAM );
+
+    /* asynchronous blocks pending or other channel busy */
+    if( play->stream || chanConflict( llHdl, ch ) )
+        return( ERR_LL_DEV_BUSY );
+
+    dacInit( llHdl );
+
+    LOCK_SCHED( state );
+    play->wave   = wave;
+    play->ch     = ch;
+    play->pos    = 0;
+    play->blk    = wave->first;
+    play->ofs    = 0;
+    play->repeat = arg >> 16;
+    play->period = llHdl->chan[(ch == 2) ? 0 : ch].period;
+    play->next   = llHdl->schedNow;
+    play->armed  = arm;
+    wave->lastUse = llHdl->waveStamp++;
+    wave->starts++;
+
+    if( arm ) {
+        /* stage first frame */
+        combineFlush( llHdl, 0 );
+        frame = llHdl->pool.mem + (wave->first << llHdl->pool.blkShift);
+        if( wave->width == 2 )
+            val = *(u_int16*)frame;
+        else
+            val = *(u_int32*)frame;
+
+        if( ch != 1 ) {
+            llHdl->chan[0].bufVal  = (u_int16)val;
+            llHdl->chan[0].syncVal = calibrate( llHdl, (u_int16)val,
+                                                     &llHdl->chan[0] );
+            MWRITE_D32( ma, DAC_CTRL_REG, DAC_CMD_BUF_A | llHdl->chan[0].syncVal );
+        }
+        if( ch == 2 )
+            OSS_MikroDelay( OSH, 1 );
+        if( ch != 0 ) {
+            llHdl->chan[1].bufVal  = (u_int16)(val >> (ch == 2 ? 16 : 0));
+            llHdl->chan[1].syncVal = calibrate( llHdl,
+                                           (u_int16)(val >> (ch == 2 ? 16 : 0)),
+                                           &llHdl->chan[1] );
+            MWRITE_D32( ma, DAC_CTRL_REG, DAC_CMD_BUF_B | llHdl->chan[1].syncVal );
+        }
+    }
+    UNLOCK_SCHED( state );
+
+    syncUpdate( llHdl );
+
+    /* an armed device's timer waits for the deadline of the trigger */
+    if( !llHdl->timerRun )
+        return( timerStart( llHdl ) );
+
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Stop or disarm waveform playback
+ *
+ *  Pending asynchronous blocks are discarded. On channel 2 both players
+ *  are stopped. The outputs keep the last value.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  current channel
+ */
+static void waveStop( LL_HANDLE *llHdl, int32 ch )
+{
+    PLAYER *sel = chanPlayer( llHdl, ch );
+    PLAYER *play;
+    u_int32 i;
+    OSS_IRQ_STATE state;
+
+    for( i=0; i<2; i++ ) {
+        play = &llHdl->play[i];
+        if( ch != 2 && play != sel )
+            continue;
+
+        asyncCancel( llHdl, play );
+
+        LOCK_SCHED( state );
+        play->wave  = NULL;
+        play->armed = 0;
+        UNLOCK_SCHED( state );
+    }
+
+    syncUpdate( llHdl );
+    timerStopIdle( llHdl );
+}
+
+/**********************************************************************/
+/** Advance player to the next frame
+ *
+ *  Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ */
+static void playAdvance( LL_HANDLE *llHdl, PLAYER *play )
+{
+    /* end of waveform reached? */
+    if( ++play->pos == play->wave->frames ) {
+        play->pos = 0;
+        play->blk = play->wave->first;
+        play->ofs = 0;
+        if( play->repeat && --play->repeat == 0 )
+            play->wave = NULL;
+    }
+    else if( (play->ofs += play->wave->width) == llHdl->pool.blkSize ) {
+        play->blk = llHdl->pool.link[play->blk];
+        play->ofs = 0;
+    }
+
+    play->next += play->period ? play->period : llHdl->tickMs * 1000;
+}
+
+/**********************************************************************/
+/** Get info about cached waveforms
+ *
+ *  Fills the block with one Z51_WAVE_INFO per cached waveform, as far
+ *  as the block size permits, and returns the used size.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param blk        \IN  block data
+ *                    \OUT size of returned data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 waveInfo( LL_HANDLE *llHdl, M_SG_BLOCK *blk )
+{
+    Z51_WAVE_INFO *info = (Z51_WAVE_INFO*)blk->data;
+    u_int32       i, j, n = 0, max = blk->size / sizeof(Z51_WAVE_INFO);
+    WAVE          *wave;
+
+    for( i=0; i<Z51_WAVE_MAX && n<max; i++ ) {
+        wave = &llHdl->wave[i];
+        if( !wave->used )
+            continue;
+
+        info[n].id     = wave->id;
+        info[n].ch     = (wave->width == 4) ? 2 : 0;
+        info[n].frames = wave->frames;
+        info[n].starts = wave->starts;
+
+        /* rank = number of more recently used waveforms */
+        info[n].lru = 0;
+        for( j=0; j<Z51_WAVE_MAX; j++ )
+            if( llHdl->wave[j].used &&
+                US_BEFORE( wave->lastUse, llHdl->wave[j].lastUse ) )
+                info[n].lru++;
+        n++;
+    }
+
+    blk->size = n * sizeof(Z51_WAVE_INFO);
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Get a microsecond timestamp
+ *
+ *  On Linux the kernel's monotonic clock is used, otherwise the OSS tick
+ *  counter, which limits the resolution to one tick.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *
+ *  \return timestamp [us], wraps around
+ */
+static u_int32 usecNow( LL_HANDLE *llHdl )
+{
+#if defined(LINUX) && defined(__KERNEL__)
+    return( (u_int32)ktime_to_us( ktime_get() ) );
+#else
+    return( OSS_TickGet( OSH ) * (1000000 / OSS_TickRateGet( OSH )) );
+#endif
+}
+
+/**********************************************************************/
+/** Add device to or remove it from the list of armed devices
+ *
+ *  The device is listed while one of its players is armed and not yet
+ *  triggered.
+ *
+ *  \param llHdl      \IN  low-level handle
+ */
+static void syncUpdate( LL_HANDLE *llHdl )
+{
+    int       armed = (llHdl->play[0].armed || llHdl->play[1].armed) &&
+                      !llHdl->syncPend;
+    LL_HANDLE **pp;
+
+    if( armed == llHdl->syncLinked )
+        return;
+
+    OSS_SemWait( OSH, G_syncSem, OSS_SEM_WAITFOREVER );
+    if( armed && !llHdl->syncLinked ) {
+        llHdl->syncNext = G_syncList;
+        G_syncList = llHdl;
+        llHdl->syncLinked = 1;
+    }
+    else if( !armed && llHdl->syncLinked ) {
+        for( pp = &G_syncList; *pp; pp = (LL_HANDLE**)&(*pp)->syncNext ) {
+            if( *pp == llHdl ) {
+                *pp = (LL_HANDLE*)llHdl->syncNext;
+                break;
+            }
+        }
+        llHdl->syncLinked = 0;
+    }
+    OSS_SemSignal( OSH, G_syncSem );
+}
+
+/**********************************************************************/
+/** Remove device from the lists of synchronized start for good
+ *
+ *  Called before the device's timer and hardware go away. A trigger or
+ *  Z51_SYNC_SKEW on another device holds G_syncSem while it touches the
+ *  listed devices, so G_syncSem is taken even if the device is listed
+ *  in neither: a trigger may just have taken it from G_syncList.
+ *  Afterwards no other device uses this one.
+ *
+ *  \param llHdl      \IN  low-level handle
+ */
+static void syncLeave( LL_HANDLE *llHdl )
+{
+    OSS_IRQ_STATE state;
+    LL_HANDLE     **pp;
+
+    OSS_SemWait( OSH, G_syncSem, OSS_SEM_WAITFOREVER );
+
+    LOCK_SCHED( state );
+    llHdl->play[0].armed = llHdl->play[1].armed = 0;
+    llHdl->syncPend = 0;
+    UNLOCK_SCHED( state );
+
+    if( llHdl->syncLinked ) {
+        for( pp = &G_syncList; *pp; pp = (LL_HANDLE**)&(*pp)->syncNext ) {
+            if( *pp == llHdl ) {
+                *pp = (LL_HANDLE*)llHdl->syncNext;
+                break;
+            }
+        }
+        llHdl->syncLinked = 0;
+    }
+    if( llHdl->syncGrouped ) {
+        for( pp = &G_syncGroup; *pp; pp = (LL_HANDLE**)&(*pp)->syncGrpNext ) {
+            if( *pp == llHdl ) {
+                *pp = (LL_HANDLE*)llHdl->syncGrpNext;
+                break;
+            }
+        }
+        llHdl->syncGrouped = 0;
+    }
+
+    OSS_SemSignal( OSH, G_syncSem );
+}
+
+/**********************************************************************/
+/** Release all armed devices at a common deadline
+ *
+ *  Hands the deadline to the playback timer of each armed device, which
+ *  runs since the device was armed. Each timer releases its device at
+ *  its first tick at or after the deadline, so the devices are up to one
+ *  tick apart (see syncSpread()); the caller doesn't wait for it. The
+ *  armed devices become the group of this trigger.
+ *
+ *  \param llHdl      \IN  low-level handle (any device)
+ *  \param delay      \IN  deadline relative to now [us]
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 syncTrigger( LL_HANDLE *llHdl, u_int32 delay )
+{
+    LL_HANDLE *dev, *next;
+    u_int32   deadline;
+
+    if( delay > SYNC_DELAY_MAX )
+        return( ERR_LL_ILL_PARAM );
+
+    OSS_SemWait( OSH, G_syncSem, OSS_SEM_WAITFOREVER );
+
+    if( G_syncList == NULL ) {
+        OSS_SemSignal( OSH, G_syncSem );
+        return( ERR_LL_DEV_NOTRDY );
+    }
+
+    deadline = usecNow( llHdl ) + delay;
+
+    for( dev = G_syncGroup; dev; dev = next ) {
+        next = (LL_HANDLE*)dev->syncGrpNext;
+        dev->syncGrouped = 0;
+    }
+    G_syncGroup = NULL;
+
+    for( dev = G_syncList; dev; dev = next ) {
+        next = (LL_HANDLE*)dev->syncNext;
+        dev->syncLinked  = 0;
+        dev->syncGrpNext = G_syncGroup;
+        dev->syncGrouped = 1;
+        G_syncGroup = dev;
+        syncSchedule( dev, deadline );
+    }
+    G_syncList = NULL;
+
+    OSS_SemSignal( OSH, G_syncSem );
+
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Hand the release deadline to an armed device's timer
+ *
+ *  Called by the triggering device with G_syncSem held, which keeps the
+ *  device from leaving. Only the deadline is set, with the device's
+ *  scheduler locked; its own timer acts on it.
+ *
+ *  \param llHdl      \IN  low-level handle of armed device
+ *  \param deadline   \IN  release deadline [us]
+ */
+static void syncSchedule( LL_HANDLE *llHdl, u_int32 deadline )
+{
+    OSS_IRQ_STATE state;
+
+    LOCK_SCHED( state );
+    llHdl->syncAt   = deadline;
+    llHdl->syncPend = 1;
+    UNLOCK_SCHED( state );
+}
+
+/**********************************************************************/
+/** Load the staged frames of a triggered device and start its playback
+ *
+ *  Called by the playback timer with the scheduler locked. The outputs
+ *  of all armed players are loaded with one command; players disarmed
+ *  since the trigger are skipped.
+ *
+ *  \param llHdl      \IN  low-level handle of triggered device
+ */
+static void syncRelease( LL_HANDLE *llHdl )
+{
+    MACCESS ma = llHdl->ma;
+    PLAYER  *play;
+    u_int32 i, lanes = 0;
+
+    llHdl->syncPend = 0;
+
+    for( i=0; i<2; i++ )
+        if( llHdl->play[i].armed )
+            lanes |= (llHdl->play[i].ch == 2) ? 3 : (1 << llHdl->play[i].ch);
+
+    if( lanes == 0 || llHdl->safe )
+        return;
+
+    combineFlush( llHdl, 0 );
+    switch( lanes ) {
+        case 1:
+            MWRITE_D32( ma, DAC_CTRL_REG,
+                        DAC_CMD_LOAD_A | DAC_CMD_BUF_A | llHdl->chan[0].syncVal );
+            break;
+        case 2:
+            MWRITE_D32( ma, DAC_CTRL_REG,
+                        DAC_CMD_LOAD_B | DAC_CMD_BUF_B | llHdl->chan[1].syncVal );
+            break;
+        case 3:
+            MWRITE_D32( ma, DAC_CTRL_REG,
+                        DAC_CMD_LOAD_AB | DAC_CMD_BUF_B | llHdl->chan[1].syncVal );
+    }
+    if( lanes & 1 )
+        llHdl->chan[0].outVal = llHdl->chan[0].bufVal;
+    if( lanes & 2 )
+        llHdl->chan[1].outVal = llHdl->chan[1].bufVal;
+    llHdl->syncLate = (int32)(usecNow( llHdl ) - llHdl->syncAt);
+
+    for( i=0; i<2; i++ ) {
+        play = &llHdl->play[i];
+        if( !play->armed )
+            continue;
+
+        play->armed = 0;
+        play->next  = llHdl->schedNow;
+        playAdvance( llHdl, play );
+    }
+}
+
+/**********************************************************************/
+/** Get the release time of a device relative to the deadline
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param lateP      \OUT release time - deadline [us]
+ *
+ *  \return           TRUE if released, FALSE if the release is pending
+ */
+static int syncLate( LL_HANDLE *llHdl, int32 *lateP )
+{
+    OSS_IRQ_STATE state;
+    int           done;
+
+    LOCK_SCHED( state );
+    done   = !llHdl->syncPend;
+    *lateP = llHdl->syncLate;
+    UNLOCK_SCHED( state );
+
+    return( done );
+}
+
+/**********************************************************************/
+/** Get the spread of the release times of the last trigger
+ *
+ *  The spread is the difference between the latest and the earliest
+ *  release of all devices of the group of the last trigger.
+ *
+ *  \param llHdl      \IN  low-level handle (device of the group)
+ *  \param valueP     \OUT spread [us]
+ *
+ *  \return           \c 0 on success or error code:
+ *                    ERR_LL_DEV_NOTRDY device not released by the last
+ *                    trigger, ERR_LL_DEV_BUSY release pending
+ */
+static int32 syncSpread( LL_HANDLE *llHdl, int32 *valueP )
+{
+    LL_HANDLE *dev;
+    int32     late, min = 0, max = 0;
+    int32     error = ERR_SUCCESS;
+
+    OSS_SemWait( OSH, G_syncSem, OSS_SEM_WAITFOREVER );
+
+    if( !llHdl->syncGrouped )
+        error = ERR_LL_DEV_NOTRDY;
+
+    for( dev = G_syncGroup; dev && !error; dev = (LL_HANDLE*)dev->syncGrpNext ) {
+        if( !syncLate( dev, &late ) )
+            error = ERR_LL_DEV_BUSY;
+        else if( dev == G_syncGroup )
+            min = max = late;
+        else if( late < min )
+            min = late;
+        else if( late > max )
+            max = late;
+    }
+
+    OSS_SemSignal( OSH, G_syncSem );
+
+    if( !error )
+        *valueP = max - min;
+    return( error );
+}
+
+/**********************************************************************/
+/** Queue a block for asynchronous output
+ *
+ *  The frames are copied into the channel's queue and output by the
+ *  playback timer with the sample period and interpolation settings of the
+ *  channel. The function never waits: if the block does not fit into the
+ *  queue it is rejected as a whole. A block copied while the safe state
+ *  is entered is not queued.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  current channel
+ *  \param buf        \IN  frames (Z51_FMT_NATIVE or Z51_FMT_S16)
+ *  \param size       \IN  size of buf [bytes]
+ *  \param flip       \IN  XOR mask converting frames to unsigned values
+ *  \param ticketP    \OUT ticket of the queued block
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 asyncSubmit(
+    LL_HANDLE *llHdl,
+    int32     ch,
+    void      *buf,
+    int32     size,
+    u_int32   flip,
+    u_int32   *ticketP )
+{
+    PLAYER  *play = &llHdl->play[(ch == 2) ? 0 : ch];
+    STREAM  *strm = &play->strm;
+    u_int32 n = size / ((ch == 2) ? 4 : 2);
+    u_int32 in, i, used;
+    int32   error = ERR_SUCCESS;
+    OSS_IRQ_STATE state;
+
+    if( n > strm->mask + 1 )
+        return( ERR_LL_ILL_PARAM );
+
+    LOCK_SCHED( state );
+    used = streamUsed( llHdl, strm, (ch == 2) ? 0 : ch );
+    if( play->wave || play->armed || (play->stream && play->ch != ch) ||
+        chanConflict( llHdl, ch ) ||
+        strm->ticket - strm->done == ASYNC_BLOCKS ||
+        n > strm->mask + 1 - used )
+        error = ERR_LL_DEV_BUSY;
+    in = strm->in;
+    UNLOCK_SCHED( state );
+
+    if( error )
+        return( error );
+
+    /* the timer reads only queued frames, so copy unlocked */
+    if( ch == 2 ) {
+        for( i=0; i<n; i++ )
+            strm->ring[(in + i) & strm->mask] = ((u_int32*)buf)[i] ^ flip;
+    }
+    else {
+        for( i=0; i<n; i++ )
+            strm->ring[(in + i) & strm->mask] =
+                (u_int16)(((u_int16*)buf)[i] ^ flip);
+    }
+
+    LOCK_SCHED( state );
+    /* safe state entered while copying: drop the reserved frames */
+    if( llHdl->safe ) {
+        UNLOCK_SCHED( state );
+        return( ERR_LL_DEV_NOTRDY );
+    }
+
+    strm->in = in + n;
+    if( strm->in - strm->out > strm->hwm )
+        strm->hwm = strm->in - strm->out;
+    strm->begin[strm->ticket & (ASYNC_BLOCKS - 1)] = in;
+    strm->end[strm->ticket & (ASYNC_BLOCKS - 1)] = strm->in;
+    *ticketP = ++strm->ticket;
+    strm->eos = 0;
+    strm->starving = 0;
+
+    if( !play->stream ) {
+        play->stream = 1;
+        play->ch     = ch;
+        play->next   = llHdl->schedNow;
+        strm->k      = 0;
+    }
+    UNLOCK_SCHED( state );
+
+    DBGWRT_2((DBH, " async ticket %d: %d frames\n", strm->ticket, n));
+
+    if( !llHdl->timerRun )
+        return( timerStart( llHdl ) );
+
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Queue a block and return its ticket (Z51_BLK_ASYNC_SUBMIT)
+ *
+ *  Works like an asynchronous M_setblock() in any Z51_BLK_ASYNC mode,
+ *  but the ticket is taken together with the submission, so another
+ *  thread queueing on the same channel cannot mix it up.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  current channel (0..2)
+ *  \param blk        \IN  Z51_ASYNC_HDR and frames
+ *                    \OUT Z51_ASYNC_HDR.ticket
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 asyncBlock( LL_HANDLE *llHdl, int32 ch, M_SG_BLOCK *blk )
+{
+    Z51_ASYNC_HDR *hdr = (Z51_ASYNC_HDR*)blk->data;
+    int32         size = blk->size - (int32)sizeof(Z51_ASYNC_HDR);
+    u_int32       setCh, lanes, format;
+
+    lanes  = chanLanes( llHdl, ch, &setCh );
+    format = llHdl->chan[setCh].format;
+
+    if( blk->size < (int32)sizeof(Z51_ASYNC_HDR) )
+        return( ERR_LL_USERBUF );
+
+    if( size <= 0 || size % (2 * (int32)lanes) ||
+        format == Z51_FMT_RLE || format == Z51_FMT_RAW )
+        return( ERR_LL_ILL_PARAM );
+
+    if( llHdl->safe )
+        return( ERR_LL_DEV_NOTRDY );
+
+    dacInit( llHdl );
+
+    blk->size = sizeof(Z51_ASYNC_HDR);
+    return( asyncSubmit( llHdl, ch, hdr + 1, size,
+                         (format == Z51_FMT_S16) ? 0x80008000 : 0,
+                         &hdr->ticket ) );
+}
+
+/**********************************************************************/
+/** Get the used space of an asynchronous queue
+ *
+ *  With Z51_UNDERRUN_REPEAT the timer may rewind to the last completed
+ *  block at any time, also while asyncSubmit() copies frames unlocked,
+ *  so that block stays reserved. Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param strm       \IN  queue
+ *  \param setCh      \IN  channel with the underrun mode (0 or 1)
+ *
+ *  \return number of frames
+ */
+static u_int32 streamUsed( LL_HANDLE *llHdl, STREAM *strm, int32 setCh )
+{
+    if( llHdl->chan[setCh].underMode == Z51_UNDERRUN_REPEAT )
+        return( strm->in - strm->last );
+
+    return( strm->in - strm->out );
+}
+
+/**********************************************************************/
+/** Discard all pending asynchronous blocks of a player
+ *
+ *  The discarded blocks are reported as completed, so no client waits
+ *  for them forever.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ */
+static void asyncCancel( LL_HANDLE *llHdl, PLAYER *play )
+{
+    int    pending;
+    OSS_IRQ_STATE state;
+
+    LOCK_SCHED( state );
+    pending = asyncDiscard( llHdl, play );
+    UNLOCK_SCHED( state );
+
+    if( pending && llHdl->asyncSig )
+        OSS_SigSend( OSH, llHdl->asyncSig );
+}
+
+/**********************************************************************/
+/** Discard all pending asynchronous blocks of a player, without signal
+ *
+ *  Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ *
+ *  \return TRUE if blocks were pending
+ */
+static int asyncDiscard( LL_HANDLE *llHdl, PLAYER *play )
+{
+    STREAM *strm = &play->strm;
+    int    pending = (strm->done != strm->ticket);
+
+    strm->out  = strm->in;
+    strm->done = strm->ticket;
+    strm->k    = 0;
+    strm->last = strm->in;
+    strm->rampLeft  = 0;
+    strm->pdPending = 0;
+    play->stream = 0;
+    markDrop( llHdl, play );
+
+    return( pending );
+}
+
+/**********************************************************************/
+/** Get the next frame of the asynchronous queue
+ *
+ *  Each queued frame is expanded into Z51_INTERP_FACTOR output frames.
+ *  Completed blocks are counted and signalled. When the queue runs empty
+ *  the channel's underrun policy is applied. Called with the scheduler
+ *  locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ *  \param valP       \OUT frame (channel 2: (B << 16) | A)
+ *
+ *  \return TRUE if the frame is to be output
+ */
+static int streamFrame( LL_HANDLE *llHdl, PLAYER *play, u_int32 *valP )
+{
+    STREAM  *strm = &play->strm;
+    int32   setCh = (play->ch == 2) ? 0 : play->ch;
+    u_int32 factor = llHdl->chan[setCh].interpFactor;
+    u_int32 period = llHdl->chan[setCh].period;
+    u_int32 cur, nxt, lanes, l;
+    int32   lane, p2, p3, *hist;
+
+    if( strm->out == strm->in ) {
+        /* underrun ramp */
+        if( strm->rampLeft ) {
+            streamRamp( llHdl, play, valP );
+            return( TRUE );
+        }
+
+        /* underrun powerdown at the missed deadline */
+        if( strm->pdPending ) {
+            strm->pdPending = 0;
+            strm->pdDone    = 1;
+            for( lane=0; lane<2; lane++ ) {
+                if( play->ch != 2 && play->ch != lane )
+                    continue;
+                l = UNDER_PD( &llHdl->chan[lane] );
+                setPowerdown( llHdl, lane, l );
+                llHdl->chan[lane].powerdown = l;
+            }
+        }
+        play->stream = 0;
+        return( FALSE );
+    }
+
+    /* new data aborts the underrun handling */
+    if( strm->rampLeft || strm->pdPending ) {
+        strm->rampLeft  = 0;
+        strm->pdPending = 0;
+        if( play->ch != 1 )
+            llHdl->chan[0].histValid = 0;
+        if( play->ch != 0 )
+            llHdl->chan[1].histValid = 0;
+    }
+
+    /* ... and its first value powers the outputs up again */
+    if( strm->pdDone ) {
+        strm->pdDone = 0;
+        if( play->ch != 1 )
+            llHdl->chan[0].powerdown = 0;
+        if( play->ch != 0 )
+            llHdl->chan[1].powerdown = 0;
+    }
+
+    cur = strm->ring[strm->out & strm->mask];
+    nxt = strm->ring[(strm->out + 1) & strm->mask];
+    lanes = (play->ch == 2) ? 2 : 1;
+
+    *valP = 0;
+    for( l=0; l<lanes; l++ ) {
+        lane = (play->ch == 2) ? (int32)l : play->ch;
+        hist = llHdl->chan[lane].hist;
+        p2   = (cur >> (16 * l)) & 0xffff;
+
+        interpSample( llHdl, lane, hist, p2 );
+
+        /* lookahead for the spline, extrapolated if not yet queued */
+        if( strm->out + 1 != strm->in )
+            p3 = (nxt >> (16 * l)) & 0xffff;
+        else
+            p3 = 2 * p2 - hist[1];
+
+        *valP |= (u_int32)interpolate( llHdl->chan[setCh].interpMode, factor,
+                                       strm->k + 1, hist[0], hist[1],
+                                       p2, p3 ) << (16 * l);
+    }
+
+    if( ++strm->k >= factor ) {
+        strm->k = 0;
+
+        for( l=0; l<lanes; l++ ) {
+            hist = llHdl->chan[(play->ch == 2) ? (int32)l : play->ch].hist;
+            hist[0] = hist[1];
+            hist[1] = (cur >> (16 * l)) & 0xffff;
+        }
+
+        /* the queued frame itself is output with the last step */
+        if( llHdl->markCnt )
+            markCheck( llHdl, play, MARK_BLOCK, 0, strm->out );
+
+        strm->out++;
+
+        /* blocks completed? */
+        while( strm->done != strm->ticket &&
+               strm->end[strm->done & (ASYNC_BLOCKS - 1)] == strm->out ) {
+            strm->last = strm->begin[strm->done & (ASYNC_BLOCKS - 1)];
+            strm->done++;
+            if( llHdl->asyncSig )
+                OSS_SigSend( OSH, llHdl->asyncSig );
+        }
+
+        if( strm->out == strm->in )
+            streamEmpty( llHdl, play );
+    }
+
+    play->next += period ? period : llHdl->tickMs * 1000;
+    return( TRUE );
+}
+
+/**********************************************************************/
+/** Handle the asynchronous queue running empty
+ *
+ *  Unless the end of the stream was announced by Z51_ASYNC_EOS, this is an
+ *  underrun: it is counted and signalled once until new data is queued,
+ *  and the underrun policy of the channel is applied. Ramp and powerdown
+ *  take effect at the next deadline. Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ */
+static void streamEmpty( LL_HANDLE *llHdl, PLAYER *play )
+{
+    STREAM  *strm = &play->strm;
+    int32   setCh = (play->ch == 2) ? 0 : play->ch;
+    u_int32 l;
+
+    if( strm->eos ) {
+        strm->eos = 0;
+        play->stream = 0;
+        return;
+    }
+
+    if( !strm->starving ) {
+        strm->starving = 1;
+        llHdl->underruns++;
+        if( llHdl->underSig )
+            OSS_SigSend( OSH, llHdl->underSig );
+    }
+
+    switch( llHdl->chan[setCh].underMode ) {
+        case Z51_UNDERRUN_REPEAT:
+            /* output last block again, new data is queued behind it */
+            if( strm->last != strm->in ) {
+                strm->out = strm->last;
+                break;
+            }
+            play->stream = 0;
+            break;
+
+        case Z51_UNDERRUN_RAMP:
+            for( l=0; l<2; l++ )
+                strm->rampFrom[l] = llHdl->chan[l].hist[1];
+            strm->rampLeft = llHdl->chan[setCh].rampLen;
+            break;
+
+        case Z51_UNDERRUN_POWERDOWN:
+            strm->pdPending = 1;
+            break;
+
+        default:
+            /* Z51_UNDERRUN_HOLD: keep last value */
+            play->stream = 0;
+    }
+}
+
+/**********************************************************************/
+/** Get the next value of the underrun ramp
+ *
+ *  Ramps linearly from the last output value to the safe value of the
+ *  channel, which is then held. Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ *  \param valP       \OUT frame (channel 2: (B << 16) | A)
+ */
+static void streamRamp( LL_HANDLE *llHdl, PLAYER *play, u_int32 *valP )
+{
+    STREAM  *strm = &play->strm;
+    int32   setCh = (play->ch == 2) ? 0 : play->ch;
+    int32   len = llHdl->chan[setCh].rampLen;
+    int32   left = --strm->rampLeft;
+    u_int32 period = llHdl->chan[setCh].period;
+    int32   safeA, safeB, fromA;
+
+    /* channel 1 keeps its values in lane 1 */
+    fromA = strm->rampFrom[(play->ch == 1) ? 1 : 0];
+    safeA = llHdl->chan[setCh].safeValue;
+    safeB = llHdl->chan[1].safeValue;
+
+    *valP = (u_int16)(safeA + ((fromA - safeA) * left) / len) |
+            (u_int32)(u_int16)(safeB + (((int32)strm->rampFrom[1] - safeB)
+                                        * left) / len) << 16;
+
+    if( left == 0 )
+        play->stream = 0;
+
+    play->next += period ? period : llHdl->tickMs * 1000;
+}
+
+/**********************************************************************/
+/** Add markers (Z51_BLK_MARKER_SET)
+ *
+ *  Markers of type Z51_MARK_WAVE refer to a frame of a cached waveform
+ *  and fire on every pass. Markers of type Z51_MARK_BLOCK refer to a frame
+ *  of a block queued on the current channel (Z51_ASYNC_TICKET) and fire
+ *  once; the frame must not have been output yet. Either all markers of
+ *  the block are added or none.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  current channel (0..2)
+ *  \param blk        \IN  Z51_MARKER array
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 markSet( LL_HANDLE *llHdl, int32 ch, M_SG_BLOCK *blk )
+{
+    const Z51_MARKER *src = (const Z51_MARKER*)blk->data;
+    u_int32 n = blk->size / sizeof(Z51_MARKER);
+    u_int32 p = (ch == 2) ? 0 : ch;
+    STREAM  *strm = &llHdl->play[p].strm;
+    MARK    mark[MARK_MAX];
+    WAVE    *wave;
+    u_int32 i, idx;
+    int32   error = ERR_SUCCESS;
+    OSS_IRQ_STATE state;
+
+    if( n == 0 || n > MARK_MAX || blk->size % sizeof(Z51_MARKER) )
+        return( ERR_LL_ILL_PARAM );
+
+    LOCK_SCHED( state );
+    for( i=0; i<n && !error; i++ ) {
+        mark[i].id     = src[i].id;
+        mark[i].target = src[i].target;
+        mark[i].frame  = src[i].frame;
+        mark[i].type   = src[i].type;
+        mark[i].pos    = 0;
+        mark[i].play   = p;
+
+        switch( src[i].type ) {
+            case Z51_MARK_WAVE:
+                wave = waveFind( llHdl, src[i].target );
+                if( wave == NULL || src[i].frame >= wave->frames )
+                    error = ERR_LL_ILL_PARAM;
+                break;
+
+            case Z51_MARK_BLOCK:
+                /* block must be queued, its frame not yet output */
+                idx = (src[i].target - 1) & (ASYNC_BLOCKS - 1);
+                mark[i].pos = strm->begin[idx] + src[i].frame;
+                if( Z51_ASYNC_COMPLETED( strm->done, src[i].target ) ||
+                    (int32)(strm->ticket - src[i].target) < 0 ||
+                    src[i].frame >= strm->end[idx] - strm->begin[idx] ||
+                    (int32)(mark[i].pos - strm->out) < 0 )
+                    error = ERR_LL_ILL_PARAM;
+                break;
+
+            default:
+                error = ERR_LL_ILL_PARAM;
+        }
+    }
+
+    if( !error && n > MARK_MAX - llHdl->markCnt )
+        error = ERR_LL_DEV_BUSY;
+
+    if( !error ) {
+        for( i=0; i<n; i++ )
+            llHdl->mark[llHdl->markCnt++] = mark[i];
+    }
+    UNLOCK_SCHED( state );
+
+    return( error );
+}
+
+/**********************************************************************/
+/** Note the markers of the frame a player outputs next
+ *
+ *  Called with the scheduler locked, only if markers exist.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ *  \param type       \IN  MARK_WAVE or MARK_BLOCK
+ *  \param target     \IN  MARK_WAVE: waveform ID
+ *  \param pos        \IN  MARK_WAVE: frame, MARK_BLOCK: queue position
+ */
+static void markCheck(
+    LL_HANDLE *llHdl,
+    PLAYER    *play,
+    u_int32   type,
+    u_int32   target,
+    u_int32   pos )
+{
+    MARK    *m = llHdl->mark;
+    u_int32 p = (u_int32)(play - llHdl->play);
+    u_int32 i;
+
+    for( i=0; i<llHdl->markCnt; i++, m++ ) {
+        if( m->type != type )
+            continue;
+
+        if( type == MARK_WAVE ?
+            (m->target == target && m->frame == pos) :
+            (m->play == p && m->pos == pos) )
+            play->markHit |= 1U << i;
+    }
+}
+
+/**********************************************************************/
+/** Record the events of the markers of the frame just output
+ *
+ *  Takes the time right after the frame was written to the DAC. Block
+ *  markers are removed once recorded. If the event queue is full, the
+ *  events are counted as lost. Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ */
+static void markRecord( LL_HANDLE *llHdl, PLAYER *play )
+{
+    u_int32    hit = play->markHit;
+    u_int32    now, i;
+    MARK       *m;
+    MARK_EVENT *ev;
+
+    if( hit == 0 )
+        return;
+
+    now = usecNow( llHdl );
+    play->markHit = 0;
+
+    for( i=0; i<llHdl->markCnt; i++ ) {
+        if( !(hit & (1U << i)) )
+            continue;
+
+        if( llHdl->markIn - llHdl->markOut == MARK_EVENTS ) {
+            llHdl->markLost++;
+            continue;
+        }
+
+        m  = &llHdl->mark[i];
+        ev = &llHdl->markEv[llHdl->markIn++ & (MARK_EVENTS - 1)];
+        ev->id     = m->id;
+        ev->time   = now;
+        ev->target = m->target;
+        ev->frame  = m->frame;
+    }
+
+    /* remove fired block markers, from the end so indices stay valid */
+    for( i=llHdl->markCnt; i-- > 0; ) {
+        if( (hit & (1U << i)) && llHdl->mark[i].type == MARK_BLOCK )
+            markRemove( llHdl, i );
+    }
+
+    if( llHdl->markSig )
+        OSS_SigSend( OSH, llHdl->markSig );
+}
+
+/**********************************************************************/
+/** Remove the block markers of a player, e.g. when its queue is flushed
+ *
+ *  Called with the scheduler locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param play       \IN  player
+ */
+static void markDrop( LL_HANDLE *llHdl, PLAYER *play )
+{
+    u_int32 p = (u_int32)(play - llHdl->play);
+    u_int32 i;
+
+    play->markHit = 0;
+    for( i=llHdl->markCnt; i-- > 0; ) {
+        if( llHdl->mark[i].type == MARK_BLOCK && llHdl->mark[i].play == p )
+            markRemove( llHdl, i );
+    }
+}
+
+/**********************************************************************/
+/** Remove a marker, the last marker takes its place
+ *
+ *  Moves the pending hits of the last marker along, since the other
+ *  player may not have recorded its frame yet. Called with the scheduler
+ *  locked.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param i          \IN  marker index
+ */
+static void markRemove( LL_HANDLE *llHdl, u_int32 i )
+{
+    u_int32 last = --llHdl->markCnt;
+    u_int32 p;
+
+    llHdl->mark[i] = llHdl->mark[last];
+    for( p=0; p<2; p++ ) {
+        PLAYER *play = &llHdl->play[p];
+
+        play->markHit &= ~(1U << i);
+        if( play->markHit & (1U << last) )
+            play->markHit = (play->markHit & ~(1U << last)) | (1U << i);
+    }
+}
+
+/**********************************************************************/
+/** Take recorded marker events (Z51_BLK_MARKER_EVENTS)
+ *
+ *  Fills the block with the oldest events, as far as the block size
+ *  permits, and returns the used size.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param blk        \IN  block data
+ *                    \OUT size of returned data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 markEvents( LL_HANDLE *llHdl, M_SG_BLOCK *blk )
+{
+    Z51_MARK_EVENT *dst = (Z51_MARK_EVENT*)blk->data;
+    u_int32        max = blk->size / sizeof(Z51_MARK_EVENT);
+    u_int32        n;
+    MARK_EVENT     *ev;
+    OSS_IRQ_STATE  state;
+
+    LOCK_SCHED( state );
+    for( n=0; n<max && llHdl->markOut != llHdl->markIn; n++ ) {
+        ev = &llHdl->markEv[llHdl->markOut++ & (MARK_EVENTS - 1)];
+        dst[n].id     = ev->id;
+        dst[n].time   = ev->time;
+        dst[n].target = ev->target;
+        dst[n].frame  = ev->frame;
+    }
+    UNLOCK_SCHED( state );
+
+    blk->size = n * sizeof(Z51_MARK_EVENT);
+    return( ERR_SUCCESS );
+}
+
+/**********************************************************************/
+/** Write powerdown command for one DAC channel
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param ch         \IN  DAC channel (0=A, 1=B)
+ *  \param mode       \IN  powerdown mode (see Z51_POWERDOWN)
+ */
+static void setPowerdown( LL_HANDLE *llHdl, int32 ch, u_int32 mode )
+{
+    u_int32 unit = (u_int32)ch / UNIT_CHANNELS;
+    MACCESS ma = llHdl->unitMa[unit];
+    u_int32 pdMode = pdBits( mode );
+
+    combineFlush( llHdl, unit );
+
+    /* dependant on channel turn off output A or B */
+    switch( ch - unit * UNIT_CHANNELS ) {
+        case 0:
+            MWRITE_D32( ma, DAC_CTRL_REG,
+                        DAC_CMD_LOAD_A | DAC_CMD_BUF_A | pdMode );
+            break;
+
+        case 1:
+            MWRITE_D32( ma, DAC_CTRL_REG,
+                        DAC_CMD_LOAD_B | DAC_CMD_BUF_B | pdMode );
+            break;
+    }
+}
+
+/**********************************************************************/
+/** Get the DAC command bits of a powerdown mode
+ *
+ *  \param mode       \IN  powerdown mode (see Z51_POWERDOWN)
+ *
+ *  \return DAC_CMD_PD_xxx
+ */
+static u_int32 pdBits( u_int32 mode )
+{
+    switch( mode ) {
+        case 1:  return( DAC_CMD_PD_1K );
+        case 2:  return( DAC_CMD_PD_100K );
+        case 3:  return( DAC_CMD_PD_HIGHZ );
+    }
+    return( DAC_CMD_PD_NONE );
+}
+
+/**********************************************************************/
+/** Enter the safe state
+ *
+ *  Stops the sequencer and both players, discards queued blocks (they
+ *  are reported as completed) and drives every output to its
+ *  Z51_SAFE_VALUE or Z51_SAFE_PD mode: output A of all units is buffered
+ *  first, then each unit loads both outputs. Calls in progress stop at
+ *  their next output, new output is rejected until safeLeave().
+ *
+ *  Does not wait for the device lock. Called with the scheduler locked or
+ *  from the interrupt routine; after a malfunction (\a fault) the DAC
+ *  communication is restarted first, the interrupt stays disabled until
+ *  the next dacInit().
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param fault      \IN  called on malfunction
+ *
+ *  \return TRUE if queued blocks were discarded (send asyncSig)
+ */
+static int safeEnter( LL_HANDLE *llHdl, int fault )
+{
+    u_int32 start = usecNow( llHdl );
+    CHAN    *c;
+    u_int32 u, took;
+    int     pending = 0;
+
+    llHdl->safe     = 1;
+    llHdl->seqRun   = 0;
+    llHdl->syncPend = 0;
+
+    for( u=0; u<2; u++ ) {
+        pending |= asyncDiscard( llHdl, &llHdl->play[u] );
+        llHdl->play[u].wave  = NULL;
+        llHdl->play[u].armed = 0;
+    }
+
+    if( fault ) {
+        for( u=0; u<llHdl->units; u++ )
+            MWRITE_D32( llHdl->unitMa[u], DAC_SCLK_REG, DAC_SCLK_DEFAULT );
+    }
+
+    /* pending combined writes are overwritten, not loaded */
+    for( u=0, c=llHdl->chan; u<llHdl->units; u++, c+=2 ) {
+        llHdl->combPend[u] = 0;
+        MWRITE_D32( llHdl->unitMa[u], DAC_CTRL_REG,
+                    DAC_CMD_BUF_A | safeCmd( llHdl, &c[0] ) );
+    }
+
+    OSS_MikroDelay( OSH, 1 );
+
+    for( u=0, c=llHdl->chan; u<llHdl->units; u++, c+=2 )
+        MWRITE_D32( llHdl->unitMa[u], DAC_CTRL_REG,
+                    DAC_CMD_LOAD_AB | DAC_CMD_BUF_B | safeCmd( llHdl, &c[1] ) );
+
+    took = usecNow( llHdl ) - start;
+    if( took > llHdl->safeTime )
+        llHdl->safeTime = took;
+
+    return( pending );
+}
+
+/**********************************************************************/
+/** Get the DAC command of a lane's safe state and note it as its output
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param c          \IN  lane
+ *
+ *  \return powerdown bits or calibrated Z51_SAFE_VALUE
+ */
+static u_int32 safeCmd( LL_HANDLE *llHdl, CHAN *c )
+{
+    c->bufVal    = c->outVal = c->safeValue;
+    c->powerdown = c->safePd;
+    c->histValid = 0;
+
+    if( c->safePd )
+        return( pdBits( c->safePd ) );
+
+    return( calibrate( llHdl, (u_int16)c->safeValue, c ) );
+}
+
+/**********************************************************************/
+/** Leave the safe state
+ *
+ *  The outputs keep their safe values until the next output.
+ *
+ *  \param llHdl      \IN  low-level handle
+ */
+static void safeLeave( LL_HANDLE *llHdl )
+{
+    OSS_IRQ_STATE state;
+
+    LOCK_SCHED( state );
+    llHdl->safe = 0;
+    UNLOCK_SCHED( state );
+
+    syncUpdate( llHdl );
+    timerStopIdle( llHdl );
+}
+
+/**********************************************************************/
+/** Start the playback timer
+ *
+ *  The first callback is due one tick from now; this fixes the relation
+ *  between scheduler time and real time used for the late accounting.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 timerStart( LL_HANDLE *llHdl )
+{
+    llHdl->schedOfs = usecNow( llHdl ) + llHdl->tickMs * 1000 - llHdl->schedNow;
+    llHdl->timerRun = 1;
+
+    return( OSS_TimerStart( OSH, llHdl->timer, llHdl->tickMs, 1 ) );
+}
+
+/**********************************************************************/
+/** Stop the playback timer if neither player nor sequencer is busy
+ *
+ *  \param llHdl      \IN  low-level handle
+ */
+static void timerStopIdle( LL_HANDLE *llHdl )
+{
+    if( llHdl->timerRun && !llHdl->seqRun && !llHdl->syncPend &&
+        !PLAY_BUSY( &llHdl->play[0] ) && !PLAY_BUSY( &llHdl->play[1] ) ) {
+        OSS_TimerStop( OSH, llHdl->timer );
+        llHdl->timerRun = 0;
+    }
+}
+
+/**********************************************************************/
+/** Validate and store a sequencer program
+ *
+ *  The block contains an array of Z51_SEQ_STEP. The whole program is
+ *  checked before it replaces the stored one. Each loop must contain a
+ *  wait step, so the timer context is never blocked by a sequence, and
+ *  each load step must follow a stage step (see seqStageCheck()).
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param blk        \IN  block data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 seqLoad( LL_HANDLE *llHdl, M_SG_BLOCK *blk )
+{
+    Z51_SEQ_STEP *prog = (Z51_SEQ_STEP*)blk->data;
+    u_int32      n = blk->size / sizeof(Z51_SEQ_STEP);
+    u_int32      i, j;
+    int          ok;
+
+    if( llHdl->seqRun )
+        return( ERR_LL_DEV_BUSY );
+
+    if( blk->size % sizeof(Z51_SEQ_STEP) || n == 0 || n > SEQ_STEPS_MAX )
+        return( ERR_LL_ILL_PARAM );
+
+    for( i=0; i<n; i++ ) {
+        switch( prog[i].op ) {
+            case Z51_SEQ_WRITE:
+                ok = prog[i].par <= 2 &&
+                     (prog[i].par == 2 || prog[i].arg <= 0xffff);
+                break;
+            case Z51_SEQ_STAGE:
+                ok = prog[i].par <= 1 && prog[i].arg <= 0xffff;
+                break;
+            case Z51_SEQ_LOAD:
+                ok = IN_RANGE( prog[i].arg, 1, 3 ) &&
+                     seqStageCheck( prog, n, i );
+                break;
+            case Z51_SEQ_POWERDOWN:
+                ok = prog[i].par <= 1 && prog[i].arg <= 3;
+                break;
+            case Z51_SEQ_WAIT:
+                ok = prog[i].arg <= SEQ_WAIT_MAX;
+                break;
+            case Z51_SEQ_LOOP:
+                /* backward jump over at least one wait */
+                ok = FALSE;
+                for( j=prog[i].arg; j<i; j++ )
+                    if( prog[j].op == Z51_SEQ_WAIT && prog[j].arg )
+                        ok = TRUE;
+                break;
+            case Z51_SEQ_SIGNAL:
+                ok = TRUE;
+                break;
+            default:
+                ok = FALSE;
+        }
 
-    /* return number of read bytes */
-    *nbrRdBytesP = 0;
+        if( !ok ) {
+            DBGWRT_ERR((DBH, "*** Z51 seqLoad: illegal step %d\n", i));
+            return( ERR_LL_ILL_PARAM );
+        }
+    }
 
-    return(ERR_LL_ILL_FUNC);
+    OSS_MemFill( OSH, sizeof(llHdl->seq), (char*)llHdl->seq, 0 );
+    for( i=0; i<n; i++ ) {
+        llHdl->seq[i].op  = prog[i].op;
+        llHdl->seq[i].par = prog[i].par;
+        llHdl->seq[i].arg = prog[i].arg;
+    }
+    llHdl->seqLen = n;
+
+    return( ERR_SUCCESS );
 }
 
-/****************************** Z51_BlockWrite *****************************/
-/** Write a data block from the device
+/**********************************************************************/
+/** Check that a load step finds its buffer staged
  *
- *  \param llHdl       \IN  low-level handle
- *  \param ch          \IN  current channel
- *  \param buf         \IN  data buffer
- *  \param size        \IN  data buffer size
- *  \param nbrWrBytesP \OUT number of written bytes
+ *  Z51_SEQ_LOAD rewrites the last buffer it loads (A for arg 1, else B)
+ *  with the value of the last Z51_SEQ_STAGE step of that channel, so this
+ *  step must be executed after the load step before on every path. The
+ *  check is conservative: going back from the load step, the stage step
+ *  must come before another load step or a write of the channel, and
+ *  before the target of a loop which jumps back over the load step.
  *
- *  \return            \c 0 on success or error code
+ *  \param prog       \IN  program
+ *  \param n          \IN  number of steps
+ *  \param i          \IN  index of the load step
+ *
+ *  \return TRUE if the buffer is staged
  */
-static int32 Z51_BlockWrite(
-     LL_HANDLE *llHdl,
-     int32     ch,
-     void      *buf,
-     int32     size,
-     int32     *nbrWrBytesP
-)
+static int seqStageCheck( const Z51_SEQ_STEP *prog, u_int32 n, u_int32 i )
 {
-    DBGWRT_1((DBH, "LL - Z51_BlockWrite: ch=%d, size=%d\n",ch,size));
+    u_int32 par = (prog[i].arg == 1) ? 0 : 1;
+    u_int32 j, k;
+
+    for( j=i; ; j-- ) {
+        if( j < i ) {
+            if( prog[j].op == Z51_SEQ_STAGE && prog[j].par == par )
+                return( TRUE );
+
+            if( prog[j].op == Z51_SEQ_LOAD ||
+                (prog[j].op == Z51_SEQ_WRITE &&
+                 (prog[j].par == par || prog[j].par == 2)) )
+                return( FALSE );
+        }
 
-    /* return number of written bytes */
-    *nbrWrBytesP = 0;
+        /* entered from a loop step after the load step */
+        for( k=i+1; k<n; k++ )
+            if( prog[k].op == Z51_SEQ_LOOP && prog[k].arg == j )
+                return( FALSE );
 
-    return(ERR_LL_ILL_FUNC);
+        if( j == 0 )
+            return( FALSE );
+    }
 }
 
-
-/****************************** Z51_Irq ************************************/
-/** Interrupt service routine
+/**********************************************************************/
+/** Start the stored sequencer program
  *
- *  The interrupt is triggered when the FPGA detects a hardware malfunction.
+ *  A running program is restarted from its first step.
  *
- *  If the driver can detect the interrupt's cause it returns
- *  LL_IRQ_DEVICE or LL_IRQ_DEV_NOT, otherwise LL_IRQ_UNKNOWN.
+ *  \param llHdl      \IN  low-level handle
  *
- *  \param llHdl       \IN  low-level handle
- *  \return LL_IRQ_DEVICE   irq caused by device
- *          LL_IRQ_DEV_NOT  irq not caused by device
- *          LL_IRQ_UNKNOWN  unknown
+ *  \return           \c 0 on success or error code
  */
-static int32 Z51_Irq(
-   LL_HANDLE *llHdl
-)
+static int32 seqStart( LL_HANDLE *llHdl )
 {
-    MACCESS ma = llHdl->ma;
-    u_int32 irqReg = MREAD_D32( ma, DAC_IRQ_REG );
-
-    /* interrupt came from my device ? */
-    if( (irqReg & DAC_IRQ_MASK) != DAC_IRQ_MASK )
-        return( LL_IRQ_DEV_NOT );
-
-    IDBGWRT_1((DBH, ">>> Z51_Irq:\n"));
+    u_int32 i;
+    int32   error = ERR_SUCCESS;
+    OSS_IRQ_STATE state;
 
-    /* 
-     * The interrupt must be disabled here, because on hardware malfunction
-     * the watchdog circuit will never release the IRQ line.
-     */
-    MWRITE_D32( ma, DAC_IER_REG, 0 );
+    if( llHdl->seqLen == 0 )
+        return( ERR_LL_DEV_NOTRDY );
 
-    /* clear interrupt */
-    MWRITE_D32( ma, DAC_IRQ_REG, DAC_IRQ_MASK );
+    dacInit( llHdl );
 
-    /* try to enable on next write */
-    llHdl->initDac = 1;
+    if( !llHdl->timerRun )
+        error = timerStart( llHdl );
 
-    /* if requested send signal to application */
-    if( llHdl->hwSig ) {
-        OSS_SigSend( OSH, llHdl->hwSig );
+    LOCK_SCHED( state );
+    for( i=0; i<llHdl->seqLen; i++ ) {
+        llHdl->seq[i].loopLeft = llHdl->seq[i].par;
+        llHdl->seq[i].count    = 0;
+        llHdl->seq[i].time     = 0;
+        llHdl->seq[i].late     = 0;
     }
+    llHdl->seqPc    = 0;
+    llHdl->seqNext  = llHdl->schedNow;
+    llHdl->seqStart = llHdl->schedNow + llHdl->schedOfs;
+    llHdl->seqRun   = 1;
+    UNLOCK_SCHED( state );
 
-    llHdl->irqCount++;
-
-    return( LL_IRQ_DEVICE );
+    return( error );
 }
 
-/****************************** Z51_Info ***********************************/
-/** Get information about hardware and driver requirements
- *
- *  The following info codes are supported:
- *
- * \code
- *  Code                      Description
- *  ------------------------  -----------------------------
- *  LL_INFO_HW_CHARACTER      hardware characteristics
- *  LL_INFO_ADDRSPACE_COUNT   nr of required address spaces
- *  LL_INFO_ADDRSPACE         address space information
- *  LL_INFO_IRQ               interrupt required
- *  LL_INFO_LOCKMODE          process lock mode required
- * \endcode
- *
- *  The LL_INFO_HW_CHARACTER code returns all address and
- *  data modes (ORed) which are supported by the hardware
- *  (MDIS_MAxx, MDIS_MDxx).
- *
- *  The LL_INFO_ADDRSPACE_COUNT code returns the number
- *  of address spaces used by the driver.
- *
- *  The LL_INFO_ADDRSPACE code returns information about one
- *  specific address space (MDIS_MAxx, MDIS_MDxx). The returned
- *  data mode represents the widest hardware access used by
- *  the driver.
- *
- *  The LL_INFO_IRQ code returns whether the driver supports an
- *  interrupt routine (TRUE or FALSE).
- *
- *  The LL_INFO_LOCKMODE code returns which process locking
- *  mode the driver needs (LL_LOCK_xxx).
+/**********************************************************************/
+/** Execute sequencer steps due now
  *
- *  \param infoType    \IN  info code
- *  \param ...         \IN  argument(s)
+ *  Executes steps back to back until a wait step moves the deadline or
+ *  the program ends. Called with the scheduler locked.
  *
- *  \return            \c 0 on success or error code
+ *  \param llHdl      \IN  low-level handle
  */
-static int32 Z51_Info(
-   int32  infoType,
-   ...
-)
+static void seqExec( LL_HANDLE *llHdl )
 {
-    int32   error = ERR_SUCCESS;
-    va_list argptr;
-
-    va_start(argptr, infoType );
-
-    switch(infoType) {
-        /*-------------------------------+
-        |  hardware characteristics      |
-        |  (all addr/data modes ORed)   |
-        +-------------------------------*/
-        case LL_INFO_HW_CHARACTER:
-        {
-            u_int32 *addrModeP = va_arg(argptr, u_int32*);
-            u_int32 *dataModeP = va_arg(argptr, u_int32*);
+    MACCESS  ma = llHdl->ma;
+    SEQ_STEP *step;
+    u_int32  now;
 
-            *addrModeP = MDIS_MA08;
-            *dataModeP = MDIS_MD08 | MDIS_MD16;
+    while( llHdl->seqRun ) {
+        if( llHdl->seqPc == llHdl->seqLen ) {
+            llHdl->seqRun = 0;
             break;
         }
-        /*-------------------------------+
-        |  nr of required address spaces |
-        |  (total spaces used)           |
-        +-------------------------------*/
-        case LL_INFO_ADDRSPACE_COUNT:
-        {
-            u_int32 *nbrOfAddrSpaceP = va_arg(argptr, u_int32*);
 
-            *nbrOfAddrSpaceP = ADDRSPACE_COUNT;
-            break;
-        }
-        /*-------------------------------+
-        |  address space type            |
-        |  (widest used data mode)       |
-        +-------------------------------*/
-        case LL_INFO_ADDRSPACE:
-        {
-            u_int32 addrSpaceIndex = va_arg(argptr, u_int32);
-            u_int32 *addrModeP = va_arg(argptr, u_int32*);
-            u_int32 *dataModeP = va_arg(argptr, u_int32*);
-            u_int32 *addrSizeP = va_arg(argptr, u_int32*);
+        step = &llHdl->seq[llHdl->seqPc++];
+        now  = usecNow( llHdl );
+        step->count++;
+        step->time = now - llHdl->seqStart;
+        step->late = (int32)(now - (llHdl->seqNext + llHdl->schedOfs));
 
-            if (addrSpaceIndex >= ADDRSPACE_COUNT)
-                error = ERR_LL_ILL_PARAM;
-            else {
-                *addrModeP = MDIS_MA08;
-                *dataModeP = MDIS_MD32;
-                *addrSizeP = ADDRSPACE_SIZE;
-            }
+        switch( step->op ) {
+            case Z51_SEQ_WRITE:
+                outputFrame( llHdl, step->par, (u_int16)step->arg,
+                             (u_int16)(step->arg >> 16) );
+                break;
 
-            break;
-        }
-        /*-------------------------------+
-        |   interrupt required           |
-        +-------------------------------*/
-        case LL_INFO_IRQ:
-        {
-            u_int32 *useIrqP = va_arg(argptr, u_int32*);
+            case Z51_SEQ_STAGE:
+                combineFlush( llHdl, 0 );
+                llHdl->chan[step->par].bufVal = step->arg;
+                llHdl->chan[step->par].seqStaged =
+                    calibrate( llHdl, (u_int16)step->arg,
+                               &llHdl->chan[step->par] );
+                MWRITE_D32( ma, DAC_CTRL_REG,
+                            (step->par ? DAC_CMD_BUF_B : DAC_CMD_BUF_A) |
+                            llHdl->chan[step->par].seqStaged );
+                break;
 
-            *useIrqP = USE_IRQ;
-            break;
-        }
-        /*-------------------------------+
-        |   process lock mode            |
-        +-------------------------------*/
-        case LL_INFO_LOCKMODE:
-        {
-            u_int32 *lockModeP = va_arg(argptr, u_int32*);
+            case Z51_SEQ_LOAD:
+                /* rewrite staged value of the last buffer with load bits */
+                combineFlush( llHdl, 0 );
+                switch( step->arg ) {
+                    case 1:
+                        MWRITE_D32( ma, DAC_CTRL_REG, DAC_CMD_LOAD_A |
+                                    DAC_CMD_BUF_A | llHdl->chan[0].seqStaged );
+                        break;
+                    case 2:
+                        MWRITE_D32( ma, DAC_CTRL_REG, DAC_CMD_LOAD_B |
+                                    DAC_CMD_BUF_B | llHdl->chan[1].seqStaged );
+                        break;
+                    default:
+                        MWRITE_D32( ma, DAC_CTRL_REG, DAC_CMD_LOAD_AB |
+                                    DAC_CMD_BUF_B | llHdl->chan[1].seqStaged );
+                }
+                if( step->arg & 1 )
+                    llHdl->chan[0].outVal = llHdl->chan[0].bufVal;
+                if( step->arg & 2 )
+                    llHdl->chan[1].outVal = llHdl->chan[1].bufVal;
+                break;
 
-            *lockModeP = LL_LOCK_CALL;
-            break;
+            case Z51_SEQ_POWERDOWN:
+                setPowerdown( llHdl, step->par, step->arg );
+                llHdl->chan[step->par].powerdown = step->arg;
+                break;
+
+            case Z51_SEQ_SIGNAL:
+                if( llHdl->seqSig )
+                    OSS_SigSend( OSH, llHdl->seqSig );
+                break;
+
+            case Z51_SEQ_LOOP:
+                if( step->par == 0 || step->loopLeft-- ) {
+                    llHdl->seqPc = step->arg;
+                    break;
+                }
+                /* loop done, rearm for an enclosing loop */
+                step->loopLeft = step->par;
+                break;
+
+            case Z51_SEQ_WAIT:
+                if( step->arg ) {
+                    llHdl->seqNext += step->arg;
+                    return;
+                }
+                break;
         }
-        /*-------------------------------+
-        |   (unknown)                    |
-        +-------------------------------*/
-        default:
-          error = ERR_LL_ILL_PARAM;
     }
-
-    va_end(argptr);
-    return(error);
 }
 
-/*******************************  Ident  ***********************************/
-/** Return ident string
+/**********************************************************************/
+/** Get timing of the sequencer steps
  *
- *  \return            pointer to ident string
+ *  Fills the block with one Z51_SEQ_TIMING per step of the stored
+ *  program, as far as the block size permits, and returns the used size.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param blk        \IN  block data
+ *                    \OUT size of returned data
+ *
+ *  \return           \c 0 on success or error code
  */
-static char* Ident( void )
+static int32 seqTiming( LL_HANDLE *llHdl, M_SG_BLOCK *blk )
 {
-    return( (char*) IdentString );
+    Z51_SEQ_TIMING *tm = (Z51_SEQ_TIMING*)blk->data;
+    u_int32        i, n = blk->size / sizeof(Z51_SEQ_TIMING);
+    OSS_IRQ_STATE  state;
+
+    if( n > llHdl->seqLen )
+        n = llHdl->seqLen;
+
+    LOCK_SCHED( state );
+    for( i=0; i<n; i++ ) {
+        tm[i].count = llHdl->seq[i].count;
+        tm[i].time  = llHdl->seq[i].time;
+        tm[i].late  = llHdl->seq[i].late;
+    }
+    UNLOCK_SCHED( state );
+
+    blk->size = n * sizeof(Z51_SEQ_TIMING);
+    return( ERR_SUCCESS );
 }
 
-/********************************* Cleanup *********************************/
-/** Close all handles, free memory and return error code
+/**********************************************************************/
+/** Get a snapshot of configuration, state and counters
  *
- *  \warning The low-level handle is invalid after this function is called.
+ *  All values are read with the scheduler locked, so they are consistent
+ *  with each other. The channel values are those of one unit.
  *
  *  \param llHdl      \IN  low-level handle
- *  \param retCode    \IN  return value
+ *  \param unit       \IN  unit of the channel values
+ *  \param blk        \IN  block data
+ *                    \OUT size of returned data
  *
- *  \return           \IN   retCode
+ *  \return           \c 0 on success or error code
  */
-static int32 Cleanup(
-   LL_HANDLE    *llHdl,
-   int32        retCode
-)
+static int32 statusGet( LL_HANDLE *llHdl, u_int32 unit, M_SG_BLOCK *blk )
 {
-    /*------------------------------+
-    |  close handles                |
-    +------------------------------*/
-    /* clean up desc */
-    if (llHdl->descHdl)
-        DESC_Exit(&llHdl->descHdl);
+    Z51_STATUS    *st = (Z51_STATUS*)blk->data;
+    MACCESS       ma = llHdl->unitMa[unit];
+    CHAN          *c = &llHdl->chan[2 * unit];
+    u_int32       i;
+    OSS_IRQ_STATE state;
+
+    if( blk->size < (int32)sizeof(Z51_STATUS) )
+        return( ERR_LL_USERBUF );
+
+    OSS_MemFill( OSH, sizeof(Z51_STATUS), (char*)st, 0 );
+    st->version = Z51_STATUS_VERSION;
+    st->size    = sizeof(Z51_STATUS);
+
+    LOCK_SCHED( state );
+    for( i=0; i<2; i++ ) {
+        st->ch[i].offset    = c[i].offset;
+        st->ch[i].gain      = c[i].gain;
+        st->ch[i].powerdown = c[i].powerdown;
+        st->ch[i].output    = c[i].outVal;
+        st->ch[i].calProfile = c[i].calSel;
+        st->ch[i].safeValue  = c[i].safeValue;
+        st->ch[i].safePd     = c[i].safePd;
+    }
+    st->dbgLevel = llHdl->dbgLevel;
+
+    if( llHdl->irqCount && llHdl->initDac )
+        st->flags |= Z51_STATUS_FAULT;
+    if( llHdl->hwInit && (MREAD_D32( ma, DAC_IRQ_REG ) & DAC_IRQ_MASK) )
+        st->flags |= Z51_STATUS_IRQ_PEND;
+    if( llHdl->irqEnable )
+        st->flags |= Z51_STATUS_IRQ_EN;
+    if( llHdl->hwSig )
+        st->flags |= Z51_STATUS_SIG_HW;
+    if( llHdl->asyncSig )
+        st->flags |= Z51_STATUS_SIG_ASYNC;
+    if( llHdl->underSig )
+        st->flags |= Z51_STATUS_SIG_UNDER;
+    if( llHdl->seqSig )
+        st->flags |= Z51_STATUS_SIG_SEQ;
+    if( llHdl->markSig )
+        st->flags |= Z51_STATUS_SIG_MARK;
+    if( llHdl->safe )
+        st->flags |= Z51_STATUS_SAFE;
+
+    st->irqCount  = llHdl->irqCount;
+    st->underruns = llHdl->underruns;
+    st->lateCount = llHdl->lateCount;
+    st->lateMax   = llHdl->lateMax;
+
+    st->poolBlocks  = llHdl->pool.blocks;
+    st->poolBlkSize = llHdl->pool.blkSize;
+    st->poolFree    = llHdl->pool.freeCnt;
+    st->poolHwm     = llHdl->pool.hwm;
+    UNLOCK_SCHED( state );
+
+    blk->size = sizeof(Z51_STATUS);
+    return( ERR_SUCCESS );
+}
 
-    /* clean up debug */
-    DBGEXIT((&DBH));
+/**********************************************************************/
+/** Apply the configuration part of a snapshot
+ *
+ *  Calibration, powerdown modes, safe state settings and debug level of
+ *  both channels are checked first and then applied together with the
+ *  scheduler locked. Read-only members are ignored.
+ *
+ *  \param llHdl      \IN  low-level handle
+ *  \param unit       \IN  unit of the channel values
+ *  \param blk        \IN  block data
+ *
+ *  \return           \c 0 on success or error code
+ */
+static int32 statusSet( LL_HANDLE *llHdl, u_int32 unit, M_SG_BLOCK *blk )
+{
+    Z51_STATUS    *st = (Z51_STATUS*)blk->data;
+    CHAN          *c = &llHdl->chan[2 * unit];
+    u_int32       i;
+    OSS_IRQ_STATE state;
+
+    if( blk->size < (int32)sizeof(Z51_STATUS) ||
+        st->version != Z51_STATUS_VERSION )
+        return( ERR_LL_ILL_PARAM );
+
+    for( i=0; i<2; i++ ) {
+        if( st->ch[i].powerdown > 3 || st->ch[i].safePd > 3 ||
+            st->ch[i].safeValue > 0xffff ||
+            st->ch[i].calProfile > Z51_CAL_PROFILES )
+            return( ERR_LL_ILL_PARAM );
+
+        /* a profile must be loaded before it is selected */
+        if( st->ch[i].calProfile &&
+            llHdl->calProf[(2 * unit + i) * Z51_CAL_PROFILES +
+                           st->ch[i].calProfile - 1].points == 0 )
+            return( ERR_LL_ILL_PARAM );
+    }
 
-    /*------------------------------+
-    |  free memory                  |
-    +------------------------------*/
-    /* free my handle */
-    OSS_MemFree(llHdl->osHdl, (int8*)llHdl, llHdl->memAlloc);
+    LOCK_SCHED( state );
+    for( i=0; i<2; i++ ) {
+        c[i].offset    = st->ch[i].offset;
+        c[i].gain      = st->ch[i].gain;
+        c[i].safeValue = st->ch[i].safeValue;
+        c[i].safePd    = st->ch[i].safePd;
+        calSelect( llHdl, 2 * unit + i, st->ch[i].calProfile );
+
+        if( st->ch[i].powerdown != c[i].powerdown ) {
+            setPowerdown( llHdl, unit * UNIT_CHANNELS + i,
+                          st->ch[i].powerdown );
+            c[i].powerdown = st->ch[i].powerdown;
+        }
+    }
+    llHdl->dbgLevel = st->dbgLevel;
+    UNLOCK_SCHED( state );
 
-    /*------------------------------+
-    |  return error code            |
-    +------------------------------*/
-    return(retCode);
+    return( ERR_SUCCESS );
 }
 
-
 /**********************************************************************/
-/** Correct output value according to calibration values
- *
- *  The output value is computed using the formula
- *    new = offset + value * gain / 0xffff
+/** Take blocks from the pool
  *
- *  If gain is zero then no correction is done and the input value 
- *  is returned unchanged.
+ *  The blocks are chained through the pool's link array. Each block is
+ *  taken in constant time from the head of the free list.
  *
- *  \param value      \IN  input value
- *  \param offset     \IN  offset
- *  \param gain       \IN  gain
+ *  \param pool       \IN  pool
+ *  \param n          \IN  number of blocks (n > 0, at most pool->freeCnt)
+ *  \param lastP      \OUT last block of the chain
  *
- *  \return corrected value
+ *  \return first block of the chain
  */
-static u_int16 calibrate( 
-    LL_HANDLE *llHdl,
-    u_int16   value,
-    int       offset,
-    int       gain )
+static u_int32 poolAlloc( POOL *pool, u_int32 n, u_int32 *lastP )
 {
-    u_int16 tmp;
+    u_int32 first = pool->freeHead, last = first;
 
-    if( gain == 0 )
-        return( value );
+    pool->freeCnt -= n;
+    while( --n )
+        last = pool->link[last];
 
-    tmp =  (u_int16)(offset + (value * gain) / 0xffff);
-    DBGWRT_3((DBH, "%d -> %d (o=0x%x, g=0x%x)\n", 
-              value, tmp, offset, gain ));
+    pool->freeHead = pool->link[last];
+    pool->link[last] = POOL_NIL;
+    *lastP = last;
 
-    return( tmp );
+    if( pool->blocks - pool->freeCnt > pool->hwm )
+        pool->hwm = pool->blocks - pool->freeCnt;
+
+    return( first );
 }
 
+/**********************************************************************/
+/** Return a chain of blocks to the pool in constant time
+ *
+ *  \param pool       \IN  pool
+ *  \param first      \IN  first block of the chain
+ *  \param last       \IN  last block of the chain
+ *  \param n          \IN  number of blocks in the chain
+ */
+static void poolFree( POOL *pool, u_int32 first, u_int32 last, u_int32 n )
+{
+    pool->link[last] = pool->freeHead;
+    pool->freeHead = first;
+    pool->freeCnt += n;
+}
@@ -27,10 +27,12 @@ STAMPED_REVISION="13Z051-06_01_04-5-gca494d4-dirty_2019-05-30"
 DEF_REVISION=MAK_REVISION=$(STAMPED_REVISION)
 MAK_SWITCH=$(SW_PREFIX)$(DEF_REVISION)
 
-MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/mdis_api$(LIB_SUFFIX)	\
+MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/z51_api$(LIB_SUFFIX)	\
+		 $(LIB_PREFIX)$(MEN_LIB_DIR)/mdis_api$(LIB_SUFFIX)	\
 		 $(LIB_PREFIX)$(MEN_LIB_DIR)/usr_oss$(LIB_SUFFIX)	\
 
 MAK_INCL=$(MEN_INC_DIR)/z51_drv.h	\
+         $(MEN_INC_DIR)/z51_api.h	\
          $(MEN_INC_DIR)/men_typs.h	\
          $(MEN_INC_DIR)/mdis_api.h	\
          $(MEN_INC_DIR)/usr_oss.h	\
@@ -11,9 +11,10 @@
  *
  *               Causes the Z51 to set its outputs either on a constant 
  *               current/voltage or output a sawtooth wave on both outputs.
- *               See usage info.
+ *               The output rate is paced on absolute deadlines by the
+ *               z51_api pacer. See usage info.
  *
- *     Required: libraries: mdis_api, usr_oss
+ *     Required: libraries: mdis_api, usr_oss, z51_api
  *     \switches (none)
  */
  /*
@@ -42,6 +43,7 @@
 #include <MEN/mdis_api.h>
 #include <MEN/usr_oss.h>
 #include <MEN/z51_drv.h>
+#include <MEN/z51_api.h>
 
 /*--------------------------------------+
 |   DEFINES                             |
@@ -87,8 +89,11 @@ static void __MAPILIB SignalHandler( u_int32 sig );
 int main(int argc, char *argv[])
 {
 	int32		chan, i, oldSigCount, value;
-	int32		delay = -1, time = -1, step = 1;
-	u_int32		startTime, currTime, deltaTime;
+	int32		time = -1, step = 1;
+	double		delay = -1;
+	u_int64		endTime = 0;
+	Z51_PACE	*pace = NULL;
+	Z51_PACE_STATS st;
 	MDIS_PATH 	path;
 	char		*device;
 	int			ret=0;
@@ -105,6 +110,7 @@ int main(int argc, char *argv[])
 		printf("    value        output value (0..65535)\n");
 		printf("                   -1 to generate sawtooth wave\n");
 		printf("    delay        time [ms] to output each value\n");
+		printf("                   fractions allowed, e.g. 0.02 (50kHz)\n");
 		printf("                   if omitted fast as possible\n");
 		printf("    step         step width for sawtooth waves\n");
 		printf("                   if omitted increment one\n");
@@ -120,7 +126,7 @@ int main(int argc, char *argv[])
         value = strtol( argv[3], NULL, 0 );
 
     if( argc > 4 )
-        delay = strtol( argv[4], NULL, 0 );
+        delay = strtod( argv[4], NULL );
 
     if( argc > 5 )
         step = strtol( argv[5], NULL, 0 );
@@ -128,11 +134,20 @@ int main(int argc, char *argv[])
     if( argc > 6 )
         time = strtol( argv[6], NULL, 0 );
 
+    /* deadlines of the outputs */
+    if( delay > 0 &&
+        (pace = Z51_PaceCreate( (u_int64)(delay * 1000000.0),
+                                Z51_PACE_SPIN_DEFAULT )) == NULL ) {
+        printf( "*** can't create pacer\n" );
+        return(1);
+    }
+
 	/*--------------------+
     |  open path          |
     +--------------------*/
 	if ((path = M_open(device)) < 0) {
         printf( "open failed: %s\n",M_errstring(UOS_ErrnoGet()) );
+        Z51_PaceDelete( pace );
 		return(1);
 	}
 
@@ -155,9 +170,13 @@ int main(int argc, char *argv[])
     if( value == -1 ) {
 
 		if( time != -1 ){
-	    	startTime = UOS_MsecTimerGet();
+	    	endTime = Z51_NsecTimerGet() + (u_int64)time * 1000000;
 	    }
-   	
+
+        /* first output now, the next one a period later */
+        if( pace )
+            Z51_PaceReset( pace );
+
         for( ;; ) {
             for( i=0; i<65535; i+=step ) {
 
@@ -169,8 +188,9 @@ int main(int argc, char *argv[])
                     FAIL_UNLESS( M_write( path, i ) == 0 );
                 }
 
-				if( delay != -1 )
-			    	UOS_Delay( delay );
+                /* skipped periods advance the wave, so its frequency holds */
+				if( pace )
+			    	i += step * Z51_PaceWait( pace );
             }
 
             /* report signal */
@@ -180,14 +200,7 @@ int main(int argc, char *argv[])
             }
             
        		if( time != -1 ){
-		    	currTime = UOS_MsecTimerGet();
-		    	
-		    	if( currTime < startTime )
-		    		deltaTime = (0xffffffff - startTime) + currTime;
-		    	else
-		    		deltaTime = currTime - startTime;
-		    	
-		    	if( deltaTime > (u_int32)time )
+		    	if( Z51_NsecTimerGet() >= endTime )
 		    		goto ABORT;
 		    }
         }
@@ -200,8 +213,11 @@ int main(int argc, char *argv[])
             FAIL_UNLESS( M_write( path, value ) == 0 );
         }
 
-		if( delay != -1 ){
-	    	UOS_Delay( delay );
+		if( delay >= 0 ){
+            if( pace ) {
+                Z51_PaceReset( pace );
+                Z51_PaceWait( pace );
+            }
     }
 	    else{
     printf( "Hit any key to finish program\n" );
@@ -213,6 +229,15 @@ int main(int argc, char *argv[])
     |  cleanup            |
     +--------------------*/
  ABORT:
+    if( pace && value == -1 ) {
+        Z51_PaceStats( pace, &st );
+        printf( "Pacing: %u periods, %u overruns (%u periods skipped), "
+                "late avg/max %u/%u ns\n", st.periods, st.overruns,
+                st.missed, st.periods > st.overruns ? (u_int32)
+                (st.lateSum / (st.periods - st.overruns)) : 0, st.lateMax );
+    }
+    Z51_PaceDelete( pace );
+
     M_setstat( path, Z51_CLR_SIGNAL, 0 );
     UOS_SigRemove( UOS_SIG_USR1 );
     UOS_SigExit();
@@ -0,0 +1,44 @@
+#***************************  M a k e f i l e  *******************************
+#
+#         Author: ub
+#
+#    Description: Makefile definitions for the Z51 output server z51d
+#
+#-----------------------------------------------------------------------------
+#   Copyright 2026, MEN Mikro Elektronik GmbH
+#*****************************************************************************
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+MAK_NAME=z51d
+# the next line is updated during the MDIS installation
+STAMPED_REVISION="13Z051-06_01_04-5-gca494d4-dirty_2019-05-30"
+
+DEF_REVISION=MAK_REVISION=$(STAMPED_REVISION)
+MAK_SWITCH=$(SW_PREFIX)$(DEF_REVISION)
+
+MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/z51_api$(LIB_SUFFIX)	\
+		 $(LIB_PREFIX)$(MEN_LIB_DIR)/mdis_api$(LIB_SUFFIX)	\
+		 $(LIB_PREFIX)$(MEN_LIB_DIR)/usr_oss$(LIB_SUFFIX)	\
+
+MAK_INCL=$(MEN_INC_DIR)/z51_drv.h	\
+         $(MEN_INC_DIR)/z51_api.h	\
+         $(MEN_INC_DIR)/z51d.h	\
+         $(MEN_INC_DIR)/men_typs.h	\
+         $(MEN_INC_DIR)/mdis_api.h	\
+         $(MEN_INC_DIR)/mdis_err.h	\
+         $(MEN_INC_DIR)/usr_oss.h	\
+
+MAK_INP1=z51d$(INP_SUFFIX)
+
+MAK_INP=$(MAK_INP1)
@@ -0,0 +1,815 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                      Z51D                          ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *         \file z51d.c
+ *       \author ub
+ *
+ *       \brief  Output server for Z51 devices
+ *
+ *               Keeps the Z51 devices open and serves client sessions of
+ *               the z51d_api library: control requests over a Unix socket,
+ *               values over one ring per session in shared memory. The
+ *               values of all sessions of a device are put into one
+ *               Z51_MPSC queue and written by Z51_MpscDispatch(), so
+ *               updates of several sessions are merged into pair and group
+ *               channel writes. Each session owns the outputs of its
+ *               channel exclusively.
+ *
+ *               See usage info.
+ *
+ *     Required: libraries: z51_api, mdis_api, usr_oss, POSIX
+ *     \switches -
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/usr_oss.h>
+#include <MEN/z51_drv.h>
+#include <MEN/z51_api.h>
+#include <MEN/z51d.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define DEV_MAX             16          /* max. devices */
+#define SESS_MAX            64          /* max. sessions */
+#define DEV_SLOTS           4096        /* default device queue size */
+#define DRAIN_MAX           256         /* max. values per ring and poll */
+#define SHM_TEMPLATE        "/dev/shm/z51d.XXXXXX"
+
+/* ring fields shared with the clients, see z51d_api.c */
+#define ATOMIC_LOAD(p)      __atomic_load_n( (p), __ATOMIC_SEQ_CST )
+#define ATOMIC_STORE(p,v)   __atomic_store_n( (p), (v), __ATOMIC_SEQ_CST )
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** served device */
+typedef struct {
+    char            name[Z51D_NAME_MAX];    /* device name, "" if unused */
+    MDIS_PATH       path;           /* written by Z51_MpscDispatch() */
+    MDIS_PATH       ctrl;           /* SetStat/GetStat of sessions */
+    int32           ctrlCh;         /* current channel of ctrl or -1 */
+    int32           chNumber;       /* channels of the device */
+    u_int32         units;          /* units of the device */
+    u_int32         owned;          /* outputs (lanes) used by sessions */
+    u_int32         pending;        /* values queued since last dispatch */
+    Z51_MPSC        *q;             /* values of all sessions */
+} DEV;
+
+/** client session */
+typedef struct {
+    int             sock;           /* control socket, -1 if unused */
+    DEV             *dev;           /* device or NULL before open */
+    int32           ch;             /* channel */
+    u_int32         lanes;          /* outputs driven by ch */
+    Z51D_RING       *ring;          /* shared ring */
+    u_int32         slots;          /* ring size */
+    u_int32         tail;           /* values taken (ring->tail is only
+                                       written, the client may change it) */
+} SESS;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage( void );
+static void sigStop( int sig );
+static int Serve( void );
+static u_int32 Pump( void );
+static int Idle( int idle );
+static void Accept( void );
+static void Request( SESS *s );
+static int32 SessOpen( SESS *s, Z51D_REQ *req, int *shm );
+static void SessClose( SESS *s );
+static int SessHead( SESS *s, u_int32 *headP );
+static u_int32 SessDrain( SESS *s, u_int32 head, u_int32 max );
+static int32 SessFlush( SESS *s );
+static int32 SessStat( SESS *s, Z51D_REQ *req, int32 *valueP );
+static DEV *DevOpen( const char *name, int32 *errorP );
+static void DevClose( DEV *dev );
+static void DevDispatch( DEV *dev );
+static u_int32 ChLanes( DEV *dev, int32 ch );
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static DEV              G_dev[DEV_MAX];
+static SESS             G_sess[SESS_MAX];
+static int              G_listen = -1;      /* control socket */
+static int              G_bell[2] = { -1, -1 }; /* doorbell pipe */
+static u_int32          G_devSlots = DEV_SLOTS;
+static int              G_verbose;
+static volatile sig_atomic_t G_stop;
+
+/********************************* usage ***********************************/
+/** Print program usage
+ */
+static void usage( void )
+{
+    printf("Syntax: z51d [<opts>]\n");
+    printf("Function: Z51 output server for z51d_api clients\n");
+    printf("Options:\n");
+    printf("    -s=<socket>  control socket         [%s]\n", Z51D_SOCKET);
+    printf("    -m=<mode>    socket access mode     [0660]\n");
+    printf("    -q=<slots>   device queue size      [%d]\n", DEV_SLOTS);
+    printf("    -v           print sessions and device counters\n");
+    printf("\n");
+}
+
+/********************************* main ************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+int main( int argc, char *argv[] )
+{
+    struct sockaddr_un addr;
+    const char *name = Z51D_SOCKET;
+    mode_t     mode = 0660;
+    int        i, ret;
+
+    for( i=1; i<argc; i++ ) {
+        if( strncmp( argv[i], "-s=", 3 ) == 0 )
+            name = argv[i] + 3;
+        else if( strncmp( argv[i], "-m=", 3 ) == 0 )
+            mode = (mode_t)strtoul( argv[i] + 3, NULL, 8 );
+        else if( strncmp( argv[i], "-q=", 3 ) == 0 )
+            G_devSlots = strtoul( argv[i] + 3, NULL, 0 );
+        else if( strcmp( argv[i], "-v" ) == 0 )
+            G_verbose = 1;
+        else {
+            usage();
+            return(1);
+        }
+    }
+
+    if( strlen( name ) >= sizeof(addr.sun_path) || G_devSlots < 1 ) {
+        usage();
+        return(1);
+    }
+
+    for( i=0; i<SESS_MAX; i++ )
+        G_sess[i].sock = -1;
+
+    signal( SIGINT, sigStop );
+    signal( SIGTERM, sigStop );
+    signal( SIGPIPE, SIG_IGN );
+
+    /* doorbell: clients write to it while the server is idle */
+    if( pipe( G_bell ) ||
+        fcntl( G_bell[0], F_SETFL, O_NONBLOCK ) ||
+        fcntl( G_bell[1], F_SETFL, O_NONBLOCK ) ) {
+        printf("*** pipe: %s\n", strerror(errno));
+        return(1);
+    }
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, name );
+    unlink( name );
+
+    if( (G_listen = socket( AF_UNIX, SOCK_SEQPACKET, 0 )) < 0 ||
+        bind( G_listen, (struct sockaddr*)&addr, sizeof(addr) ) ||
+        chmod( name, mode ) ||
+        listen( G_listen, SESS_MAX ) ||
+        fcntl( G_listen, F_SETFL, O_NONBLOCK ) ) {
+        printf("*** socket %s: %s\n", name, strerror(errno));
+        return(1);
+    }
+
+    if( G_verbose )
+        printf("z51d: listening on %s\n", name);
+
+    ret = Serve();
+
+    for( i=0; i<SESS_MAX; i++ )
+        if( G_sess[i].sock >= 0 )
+            SessClose( &G_sess[i] );
+    for( i=0; i<DEV_MAX; i++ )
+        if( G_dev[i].name[0] )
+            DevClose( &G_dev[i] );
+
+    close( G_listen );
+    unlink( name );
+    return( ret );
+}
+
+/**********************************************************************/
+/** Signal handler for SIGINT/SIGTERM
+ *
+ *  \param sig        \IN  signal
+ */
+static void sigStop( int sig )
+{
+    G_stop = 1;
+}
+
+/**********************************************************************/
+/** Main loop
+ *
+ *  While values arrive, the rings are polled and control requests are
+ *  checked in between without blocking. When all rings are empty, the
+ *  server sets the idle flag of the rings and sleeps until a request or
+ *  the doorbell arrives.
+ *
+ *  \return           success (0) or error (1)
+ */
+static int Serve( void )
+{
+    struct pollfd fds[2 + SESS_MAX];
+    SESS          *map[SESS_MAX];
+    u_int8        buf[64];
+    int           i, n, timeout;
+
+    while( !G_stop ) {
+        timeout = 0;
+        if( Pump() == 0 && Idle( 1 ) )
+            timeout = -1;
+
+        fds[0].fd     = G_listen;
+        fds[0].events = POLLIN;
+        fds[1].fd     = G_bell[0];
+        fds[1].events = POLLIN;
+        for( i=0, n=2; i<SESS_MAX; i++ ) {
+            if( G_sess[i].sock < 0 )
+                continue;
+            fds[n].fd     = G_sess[i].sock;
+            fds[n].events = POLLIN;
+            map[n - 2]    = &G_sess[i];
+            n++;
+        }
+
+        if( poll( fds, n, timeout ) < 0 ) {
+            if( errno == EINTR )
+                continue;
+            printf("*** poll: %s\n", strerror(errno));
+            return(1);
+        }
+
+        if( timeout ) {
+            Idle( 0 );
+            while( read( G_bell[0], buf, sizeof(buf) ) > 0 )
+                ;
+        }
+
+        for( i=2; i<n; i++ )
+            if( fds[i].revents )
+                Request( map[i - 2] );
+
+        if( fds[0].revents )
+            Accept();
+    }
+    return(0);
+}
+
+/**********************************************************************/
+/** Move the values of all rings to the devices
+ *
+ *  \return           number of values taken
+ */
+static u_int32 Pump( void )
+{
+    SESS    *s;
+    u_int32 i, head, n = 0;
+
+    for( i=0; i<SESS_MAX; i++ ) {
+        s = &G_sess[i];
+        if( s->ring == NULL )
+            continue;
+
+        if( !SessHead( s, &head ) ) {
+            if( G_verbose )
+                printf("z51d: %s ch %d: bad ring head\n", s->dev->name,
+                       (int)s->ch);
+            SessClose( s );                 /* protocol error */
+            continue;
+        }
+        n += SessDrain( s, head, DRAIN_MAX );
+    }
+
+    for( i=0; i<DEV_MAX; i++ )
+        if( G_dev[i].pending )
+            DevDispatch( &G_dev[i] );
+
+    return( n );
+}
+
+/**********************************************************************/
+/** Set or clear the idle flag of all rings
+ *
+ *  After setting, the rings are checked once more: a client which
+ *  published a value before it saw the flag doesn't ring the doorbell.
+ *
+ *  \param idle       \IN  set (1) or clear (0)
+ *
+ *  \return           TRUE if set and all rings are empty
+ */
+static int Idle( int idle )
+{
+    u_int32 i;
+    int     empty = TRUE;
+
+    for( i=0; i<SESS_MAX; i++ )
+        if( G_sess[i].ring )
+            ATOMIC_STORE( &G_sess[i].ring->idle, (u_int32)idle );
+
+    if( !idle )
+        return( FALSE );
+
+    for( i=0; i<SESS_MAX; i++ ) {
+        if( G_sess[i].ring &&
+            ATOMIC_LOAD( &G_sess[i].ring->head ) != G_sess[i].tail )
+            empty = FALSE;
+    }
+
+    if( !empty )
+        Idle( 0 );
+    return( empty );
+}
+
+/**********************************************************************/
+/** Accept new clients
+ */
+static void Accept( void )
+{
+    int sock;
+    u_int32 i;
+
+    while( (sock = accept( G_listen, NULL, NULL )) >= 0 ) {
+        for( i=0; i<SESS_MAX && G_sess[i].sock >= 0; i++ )
+            ;
+
+        if( i == SESS_MAX ) {
+            if( G_verbose )
+                printf("z51d: too many sessions\n");
+            close( sock );
+            continue;
+        }
+
+        fcntl( sock, F_SETFL, O_NONBLOCK );
+        memset( &G_sess[i], 0, sizeof(SESS) );
+        G_sess[i].sock = sock;
+    }
+}
+
+/**********************************************************************/
+/** Handle a control request or the end of a session
+ *
+ *  \param s          \IN  session
+ */
+static void Request( SESS *s )
+{
+    union {
+        struct cmsghdr hdr;
+        u_int8         buf[CMSG_SPACE(2 * sizeof(int))];
+    } ctl;
+    struct msghdr  msg;
+    struct iovec   iov;
+    struct cmsghdr *cm;
+    Z51D_REQ       req;
+    Z51D_REPLY     rep;
+    int            shm = -1;
+    ssize_t        n;
+
+    n = recv( s->sock, &req, sizeof(req), 0 );
+    if( n < 0 && (errno == EAGAIN || errno == EINTR) )
+        return;
+    if( n != sizeof(req) ) {
+        SessClose( s );                     /* closed or protocol error */
+        return;
+    }
+
+    memset( &rep, 0, sizeof(rep) );
+    if( req.op == Z51D_OP_OPEN )
+        rep.error = SessOpen( s, &req, &shm );
+    else if( s->dev == NULL )
+        rep.error = ERR_LL_DEV_NOTRDY;
+    else if( req.op == Z51D_OP_FLUSH )
+        rep.error = SessFlush( s );
+    else if( req.op == Z51D_OP_SETSTAT || req.op == Z51D_OP_GETSTAT )
+        rep.error = SessStat( s, &req, &rep.value );
+    else
+        rep.error = ERR_LL_ILL_FUNC;
+
+    memset( &msg, 0, sizeof(msg) );
+    iov.iov_base   = &rep;
+    iov.iov_len    = sizeof(rep);
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+
+    if( shm >= 0 ) {
+        /* pass ring and doorbell */
+        rep.value          = (int32)s->slots;
+        msg.msg_control    = ctl.buf;
+        msg.msg_controllen = sizeof(ctl.buf);
+        cm = CMSG_FIRSTHDR( &msg );
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type  = SCM_RIGHTS;
+        cm->cmsg_len   = CMSG_LEN(2 * sizeof(int));
+        memcpy( CMSG_DATA(cm), &shm, sizeof(int) );
+        memcpy( CMSG_DATA(cm) + sizeof(int), &G_bell[1], sizeof(int) );
+    }
+
+    n = sendmsg( s->sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT );
+    if( shm >= 0 )
+        close( shm );
+    if( n != sizeof(rep) )
+        SessClose( s );                     /* client doesn't read */
+}
+
+/**********************************************************************/
+/** Open a session: reserve the channel and create the ring
+ *
+ *  \param s          \IN  session
+ *  \param req        \IN  request
+ *  \param shm        \OUT descriptor of the ring's shared memory
+ *
+ *  \return           0 or error code
+ */
+static int32 SessOpen( SESS *s, Z51D_REQ *req, int *shm )
+{
+    char    path[] = SHM_TEMPLATE;
+    DEV     *dev;
+    u_int32 lanes, slots;
+    int32   error;
+    void    *mem;
+    int     fd;
+
+    if( s->dev )
+        return( ERR_LL_DEV_BUSY );          /* one channel per session */
+    if( req->arg < 1 || req->arg > Z51D_SLOTS_MAX )
+        return( ERR_LL_ILL_PARAM );
+
+    for( slots=1; slots<req->arg; slots<<=1 )
+        ;
+
+    req->dev[Z51D_NAME_MAX - 1] = 0;
+    if( (dev = DevOpen( req->dev, &error )) == NULL )
+        return( error );
+
+    if( req->ch < 0 || req->ch >= dev->chNumber )
+        return( ERR_LL_ILL_CHAN );
+
+    lanes = ChLanes( dev, req->ch );
+    if( dev->owned & lanes )
+        return( ERR_LL_DEV_BUSY );
+
+    /*
+     * Unlinked file in shared memory, only the descriptor is passed.
+     * The reply carries MDIS error codes, so a failure is reported as
+     * ERR_OSS_MEM_ALLOC.
+     */
+    if( (fd = mkstemp( path )) < 0 ) {
+        if( G_verbose )
+            printf("*** z51d: mkstemp: %s\n", strerror(errno));
+        return( ERR_OSS_MEM_ALLOC );
+    }
+    unlink( path );
+
+    if( ftruncate( fd, Z51D_RING_SIZE( slots ) ) ) {
+        if( G_verbose )
+            printf("*** z51d: ftruncate: %s\n", strerror(errno));
+        close( fd );
+        return( ERR_OSS_MEM_ALLOC );
+    }
+
+    mem = mmap( NULL, Z51D_RING_SIZE( slots ), PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0 );
+    if( mem == MAP_FAILED ) {
+        if( G_verbose )
+            printf("*** z51d: mmap: %s\n", strerror(errno));
+        close( fd );
+        return( ERR_OSS_MEM_ALLOC );
+    }
+
+    s->dev   = dev;
+    s->ch    = req->ch;
+    s->lanes = lanes;
+    s->ring  = (Z51D_RING*)mem;
+    s->slots = slots;
+    s->tail  = 0;
+    s->ring->slots = slots;
+    dev->owned |= lanes;
+
+    if( G_verbose )
+        printf("z51d: %s ch %d: opened (%u slots)\n", dev->name,
+               (int)s->ch, (unsigned)slots);
+
+    *shm = fd;
+    return( 0 );
+}
+
+/**********************************************************************/
+/** End a session: output the values left, release the channel
+ *
+ *  \param s          \IN  session
+ */
+static void SessClose( SESS *s )
+{
+    if( s->ring ) {
+        SessFlush( s );
+        s->dev->owned &= ~s->lanes;
+        munmap( s->ring, Z51D_RING_SIZE( s->slots ) );
+
+        if( G_verbose )
+            printf("z51d: %s ch %d: closed\n", s->dev->name, (int)s->ch);
+    }
+
+    close( s->sock );
+    memset( s, 0, sizeof(SESS) );
+    s->sock = -1;
+}
+
+/**********************************************************************/
+/** Get the head of a ring written by the client
+ *
+ *  The head is read once; the caller works on this snapshot.
+ *
+ *  \param s          \IN  session
+ *  \param headP      \OUT values written by the client
+ *
+ *  \return           FALSE if the head is more than one ring ahead
+ */
+static int SessHead( SESS *s, u_int32 *headP )
+{
+    *headP = ATOMIC_LOAD( &s->ring->head );
+    return( *headP - s->tail <= s->slots );
+}
+
+/**********************************************************************/
+/** Move the values of a ring to the device queue
+ *
+ *  Stops when the device queue is full; the rest stays in the ring.
+ *
+ *  \param s          \IN  session
+ *  \param head       \IN  checked head (see SessHead())
+ *  \param max        \IN  max. number of values
+ *
+ *  \return           number of values taken
+ */
+static u_int32 SessDrain( SESS *s, u_int32 head, u_int32 max )
+{
+    Z51D_RING  *r = s->ring;
+    Z51D_ENTRY e;
+    u_int32    tail = s->tail, n;
+
+    n = head - tail;
+    if( n > max )
+        n = max;
+
+    while( n ) {
+        e = r->entry[tail & (s->slots - 1)];
+        if( Z51_MpscPutAt( s->dev->q, s->ch, e.value, e.deadline ) )
+            break;
+        tail++;
+        n--;
+        s->dev->pending++;
+    }
+
+    n = tail - s->tail;
+    s->tail = tail;
+    ATOMIC_STORE( &r->tail, tail );
+    return( n );
+}
+
+/**********************************************************************/
+/** Output all values in the ring of a session
+ *
+ *  Values written by the client during the flush are left for the next
+ *  poll, so the work is limited to one ring size.
+ *
+ *  \param s          \IN  session
+ *
+ *  \return           first write error since the last flush or 0
+ */
+static int32 SessFlush( SESS *s )
+{
+    Z51D_RING *r = s->ring;
+    u_int32   head, n;
+    int32     error;
+
+    if( !SessHead( s, &head ) )
+        return( ERR_LL_ILL_PARAM );
+
+    /* an emptied device queue takes at least one value */
+    DevDispatch( s->dev );
+    while( head != s->tail && !r->error ) {
+        n = SessDrain( s, head, s->slots );
+        DevDispatch( s->dev );
+        if( n == 0 )
+            break;
+    }
+
+    error = r->error;
+    r->error = 0;
+    if( error == 0 && head != s->tail )
+        error = ERR_LL_DEV_BUSY;
+    return( error );
+}
+
+/**********************************************************************/
+/** SetStat/GetStat on the channel of a session
+ *
+ *  Only codes affecting the session's single output are accepted.
+ *
+ *  \param s          \IN  session
+ *  \param req        \IN  request
+ *  \param valueP     \OUT GetStat value
+ *
+ *  \return           0 or error code
+ */
+static int32 SessStat( SESS *s, Z51D_REQ *req, int32 *valueP )
+{
+    DEV   *dev = s->dev;
+    int32 code = (int32)req->arg;
+    int32 error;
+
+    if( code != Z51_OFFSET && code != Z51_GAIN && code != Z51_POWERDOWN )
+        return( ERR_LL_UNK_CODE );
+    if( s->ch % 3 == 2 || s->ch >= (int32)dev->units * 3 )
+        return( ERR_LL_ILL_CHAN );
+
+    /* values written before apply first */
+    if( req->op == Z51D_OP_SETSTAT && (error = SessFlush( s )) )
+        return( error );
+
+    if( dev->ctrlCh != s->ch ) {
+        if( M_setstat( dev->ctrl, M_MK_CH_CURRENT, s->ch ) ) {
+            dev->ctrlCh = -1;
+            return( UOS_ErrnoGet() );
+        }
+        dev->ctrlCh = s->ch;
+    }
+
+    if( req->op == Z51D_OP_SETSTAT ?
+        M_setstat( dev->ctrl, code, req->value ) :
+        M_getstat( dev->ctrl, code, valueP ) )
+        return( UOS_ErrnoGet() );
+
+    return( 0 );
+}
+
+/**********************************************************************/
+/** Get a served device, open it on first use
+ *
+ *  Devices stay open until the server exits.
+ *
+ *  \param name       \IN  device name
+ *  \param errorP     \OUT error code if NULL is returned
+ *
+ *  \return           device or NULL on error
+ */
+static DEV *DevOpen( const char *name, int32 *errorP )
+{
+    DEV     *dev = NULL;
+    u_int32 i;
+
+    for( i=0; i<DEV_MAX; i++ ) {
+        if( strcmp( G_dev[i].name, name ) == 0 )
+            return( &G_dev[i] );
+        if( dev == NULL && G_dev[i].name[0] == 0 )
+            dev = &G_dev[i];
+    }
+
+    if( dev == NULL || name[0] == 0 ) {
+        *errorP = ERR_LL_DEV_BUSY;
+        return( NULL );
+    }
+
+    memset( dev, 0, sizeof(DEV) );
+    dev->ctrl   = -1;
+    dev->ctrlCh = -1;
+
+    if( (dev->path = M_open( name )) < 0 ||
+        (dev->ctrl = M_open( name )) < 0 ||
+        M_getstat( dev->path, M_LL_CH_NUMBER, &dev->chNumber ) ) {
+        *errorP = UOS_ErrnoGet();
+        goto ABORT;
+    }
+
+    dev->units = dev->chNumber / 3;
+    if( (dev->q = Z51_MpscCreate( G_devSlots, dev->units )) == NULL ) {
+        *errorP = ERR_OSS_MEM_ALLOC;
+        goto ABORT;
+    }
+
+    strcpy( dev->name, name );
+    if( G_verbose )
+        printf("z51d: %s: opened (%u units)\n", name, (unsigned)dev->units);
+    return( dev );
+
+ABORT:
+    if( dev->ctrl >= 0 )
+        M_close( dev->ctrl );
+    if( dev->path >= 0 )
+        M_close( dev->path );
+    return( NULL );
+}
+
+/**********************************************************************/
+/** Close a device
+ *
+ *  \param dev        \IN  device
+ */
+static void DevClose( DEV *dev )
+{
+    Z51_MPSC_STATS st;
+
+    if( G_verbose ) {
+        Z51_MpscStats( dev->q, &st );
+        printf("z51d: %s: %u values, %u coalesced, %u expired, "
+               "%u writes\n", dev->name, (unsigned)st.puts,
+               (unsigned)st.coalesced, (unsigned)st.expired,
+               (unsigned)st.writes);
+    }
+
+    Z51_MpscDelete( dev->q );
+    M_close( dev->ctrl );
+    M_close( dev->path );
+    dev->name[0] = 0;
+}
+
+/**********************************************************************/
+/** Write the queued values of a device
+ *
+ *  A write error is reported to all sessions of the device with their
+ *  next Z51D_Flush().
+ *
+ *  \param dev        \IN  device
+ */
+static void DevDispatch( DEV *dev )
+{
+    int32   error;
+    u_int32 i;
+
+    if( dev->pending == 0 )
+        return;
+    dev->pending = 0;
+
+    if( Z51_MpscDispatch( dev->q, dev->path ) >= 0 )
+        return;
+
+    error = UOS_ErrnoGet();
+    for( i=0; i<SESS_MAX; i++ ) {
+        if( G_sess[i].dev == dev && G_sess[i].ring->error == 0 )
+            G_sess[i].ring->error = error;
+    }
+}
+
+/**********************************************************************/
+/** Outputs driven by a channel, bit 2 * unit + 0/1 for output A/B
+ *
+ *  \param dev        \IN  device
+ *  \param ch         \IN  valid channel
+ *
+ *  \return           lane mask
+ */
+static u_int32 ChLanes( DEV *dev, int32 ch )
+{
+    if( ch == (int32)dev->units * 3 )               /* group channel */
+        return( (1 << (2 * dev->units)) - 1 );
+
+    switch( ch % 3 ) {
+        case 0:  return( 1 << (2 * (ch / 3)) );
+        case 1:  return( 2 << (2 * (ch / 3)) );
+        default: return( 3 << (2 * (ch / 3)) );
+    }
+}
@@ -0,0 +1,1112 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                   Z51_BENCH                        ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *         \file z51_bench.c
+ *       \author ub
+ *
+ *       \brief  Benchmarks for the Z51 driver and user library
+ *
+ *               See usage info.
+ *
+ *     Required: libraries: z51_api, z51d_api, mdis_api, usr_oss,
+ *               POSIX threads
+ *     \switches _WIN32 (set by the compiler) - no multi-thread and
+ *               z51d benchmarks
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/z51_drv.h>
+#include <MEN/z51_api.h>
+
+#ifndef _WIN32
+# include <pthread.h>
+# include <sched.h>
+# include <MEN/z51d.h>
+#endif
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MIN_RUNTIME         500         /* min. time per measurement [ms] */
+#define SYNC_DEV_MAX        16          /* max. devices for sync test */
+#define SYNC_RUNS           100         /* trigger runs for sync test */
+#define SYNC_WAVE_ID        0xfff0      /* waveform ID used by sync test */
+#define MPSC_THREADS_MAX    64          /* max. producers for mpsc test */
+#define MPSC_SLOTS          1024        /* queue size for mpsc test */
+#define MIX_BUF_LEN         4096        /* buffer layer length for mix test */
+#define OPEN_LOOPS          100         /* open/close pairs for z51d test */
+#define PACE_DELAY_LOOPS    1000        /* UOS_Delay(1) calls of pace test */
+#define SAFE_RUNS           100         /* safe state entries per method */
+#define SAFE_WAVE_ID        0xfff1      /* waveform ID used by safe test */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** profile generator */
+typedef struct {
+    const char  *name;
+    void        (*gen)( u_int16 *buf, u_int32 n );
+} PROFILE;
+
+#ifndef _WIN32
+/** state of the mpsc test */
+typedef struct {
+    Z51_MPSC        *q;             /* queue or NULL for mutex baseline */
+    pthread_mutex_t lock;           /* mutex baseline: serializes writes */
+    MDIS_PATH       path;           /* device or -1 */
+    int32           curCh;          /* mutex baseline: current channel */
+    u_int32         shadow[Z51_MPSC_CH_MAX];   /* writes without device */
+    u_int32         puts;           /* updates per producer */
+    u_int32         units;          /* units of the device */
+    volatile int    stop;           /* producers done */
+    int             error;
+} MPSC_BENCH;
+
+/** producer of the mpsc test */
+typedef struct {
+    MPSC_BENCH      *b;
+    int32           ch;
+} MPSC_PRODUCER;
+#endif
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage( void );
+static u_int32 elapsed( u_int32 startTime );
+static int BenchRle( int argc, char *argv[] );
+static int BenchSync( int argc, char *argv[] );
+static int BenchUnits( int argc, char *argv[] );
+static int BenchMpsc( int argc, char *argv[] );
+static int BenchMix( int argc, char *argv[] );
+static int BenchZ51d( int argc, char *argv[] );
+static int BenchPace( int argc, char *argv[] );
+static int BenchSafe( int argc, char *argv[] );
+#ifndef _WIN32
+static int MpscRun( MPSC_BENCH *b, u_int32 threads, u_int32 *msP );
+static void *MpscProducer( void *arg );
+static void *MpscDispatcher( void *arg );
+#endif
+static void GenPlateau( u_int16 *buf, u_int32 n );
+static void GenRamp( u_int16 *buf, u_int32 n );
+static void GenSine( u_int16 *buf, u_int32 n );
+static void GenNoise( u_int16 *buf, u_int32 n );
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const PROFILE G_profile[] = {
+    { "plateau+ramp", GenPlateau },
+    { "slow ramp",    GenRamp },
+    { "slow sine",    GenSine },
+    { "noise",        GenNoise },
+};
+
+/********************************* usage ***********************************/
+/** Print program usage
+ */
+static void usage( void )
+{
+    printf("Syntax: z51_bench <test> [<args>]\n");
+    printf("Function: Z51 driver and library benchmarks\n");
+    printf("Tests:\n");
+    printf("    rle [<samples>]      Z51_FMT_RLE compression ratio and\n");
+    printf("                         encode/decode throughput\n");
+    printf("                         (default 1000000 samples)\n");
+    printf("    sync <dev> <dev>...  start lateness and spread of synchronized playback\n");
+    printf("                         (channel 0, outputs are changed!)\n");
+    printf("    units [<samples>]    engineering unit conversion: check\n");
+    printf("                         against reference and throughput\n");
+    printf("                         (default 1000000 samples)\n");
+    printf("    mpsc [<threads> [<puts> [<dev>]]]\n");
+    printf("                         many threads updating one path:\n");
+    printf("                         mutex around M_write() against the\n");
+    printf("                         submission queue with one dispatcher\n");
+    printf("                         (default 4 threads, 100000 updates\n");
+    printf("                         each; without <dev> no writes,\n");
+    printf("                         with <dev> outputs are changed!)\n");
+    printf("    mix [<samples>]      waveform mixer throughput for 1..%d\n",
+           Z51_MIX_LAYERS_MAX);
+    printf("                         layers (default 1000000 samples)\n");
+    printf("    z51d <dev> [<writes>]\n");
+    printf("                         open latency and write throughput\n");
+    printf("                         of M_open()/M_write() against a z51d\n");
+    printf("                         session (channel 0, default 100000\n");
+    printf("                         writes, outputs are changed!)\n");
+    printf("    pace [<rate> [<periods>]]\n");
+    printf("                         pacer: drift, overruns and delay\n");
+    printf("                         after the deadlines at <rate> [Hz]\n");
+    printf("                         (default 1k, 10k and 100k, 1s each)\n");
+    printf("                         against UOS_Delay(1) loops\n");
+    printf("    safe <dev> <dev>...  time to safe state of all devices\n");
+    printf("                         while playing a waveform: parallel\n");
+    printf("                         (Z51_SafeFire()) against one device\n");
+    printf("                         after the other (channel 0, outputs\n");
+    printf("                         are changed!)\n");
+    printf("\n");
+}
+
+/********************************* main ************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+int main( int argc, char *argv[] )
+{
+    if( argc < 2 || strcmp(argv[1],"-?")==0 ) {
+        usage();
+        return(1);
+    }
+
+    if( strcmp( argv[1], "rle" ) == 0 )
+        return( BenchRle( argc - 2, argv + 2 ) );
+    if( strcmp( argv[1], "sync" ) == 0 )
+        return( BenchSync( argc - 2, argv + 2 ) );
+    if( strcmp( argv[1], "units" ) == 0 )
+        return( BenchUnits( argc - 2, argv + 2 ) );
+    if( strcmp( argv[1], "mpsc" ) == 0 )
+        return( BenchMpsc( argc - 2, argv + 2 ) );
+    if( strcmp( argv[1], "mix" ) == 0 )
+        return( BenchMix( argc - 2, argv + 2 ) );
+    if( strcmp( argv[1], "z51d" ) == 0 )
+        return( BenchZ51d( argc - 2, argv + 2 ) );
+    if( strcmp( argv[1], "pace" ) == 0 )
+        return( BenchPace( argc - 2, argv + 2 ) );
+    if( strcmp( argv[1], "safe" ) == 0 )
+        return( BenchSafe( argc - 2, argv + 2 ) );
+
+    usage();
+    return(1);
+}
+
+/**********************************************************************/
+/** Return milliseconds since startTime (handles timer wraparound)
+ *
+ *  \param startTime  \IN  value of UOS_MsecTimerGet()
+ *
+ *  \return elapsed time [ms]
+ */
+static u_int32 elapsed( u_int32 startTime )
+{
+    return( UOS_MsecTimerGet() - startTime );
+}
+
+/**********************************************************************/
+/** Benchmark Z51_FMT_RLE encoding
+ *
+ *  For each profile the compression ratio and the encode and decode
+ *  throughput of the user library are measured. The library decoder
+ *  uses the same algorithm as the driver's streaming decoder.
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchRle( int argc, char *argv[] )
+{
+    u_int32  n = 1000000, p, loops, t;
+    u_int16  *raw, *dec;
+    u_int8   *enc;
+    int32    encSize = 0;
+    double   encRate, decRate;
+
+    if( argc > 0 )
+        n = strtoul( argv[0], NULL, 0 );
+
+    raw = malloc( n * sizeof(u_int16) );
+    dec = malloc( n * sizeof(u_int16) );
+    enc = malloc( Z51_RLE_MAXSIZE(n) );
+    if( !raw || !dec || !enc ) {
+        printf("*** out of memory\n");
+        return(1);
+    }
+
+    printf("%-14s %10s %10s %7s %12s %12s\n", "profile", "raw [B]",
+           "enc [B]", "ratio", "enc [MS/s]", "dec [MS/s]");
+
+    for( p=0; p<sizeof(G_profile)/sizeof(G_profile[0]); p++ ) {
+        G_profile[p].gen( raw, n );
+
+        /* encode */
+        t = UOS_MsecTimerGet();
+        for( loops=0; loops == 0 || elapsed(t) < MIN_RUNTIME; loops++ )
+            encSize = Z51_RleEncode( raw, n, enc, Z51_RLE_MAXSIZE(n) );
+        encRate = (double)n * loops / (elapsed(t) + 1) / 1000.0;
+
+        /* decode */
+        t = UOS_MsecTimerGet();
+        for( loops=0; loops == 0 || elapsed(t) < MIN_RUNTIME; loops++ ) {
+            if( Z51_RleDecode( enc, encSize, dec, n ) != (int32)n ) {
+                printf("*** %s: decode failed\n", G_profile[p].name );
+                return(1);
+            }
+        }
+        decRate = (double)n * loops / (elapsed(t) + 1) / 1000.0;
+
+        if( memcmp( raw, dec, n * sizeof(u_int16) ) ) {
+            printf("*** %s: decoded data differs\n", G_profile[p].name );
+            return(1);
+        }
+
+        printf("%-14s %10u %10d %6.1f:1 %12.1f %12.1f\n", G_profile[p].name,
+               (unsigned)(n * sizeof(u_int16)), (int)encSize,
+               (double)n * sizeof(u_int16) / encSize, encRate, decRate );
+    }
+
+    free( raw );
+    free( dec );
+    free( enc );
+    return(0);
+}
+
+/**********************************************************************/
+/** Benchmark synchronized start of several devices
+ *
+ *  Arms a short waveform on channel 0 of each device, releases all with
+ *  one Z51_SYNC_TRIGGER and collects the lateness of each device
+ *  (Z51_SYNC_LATE) and the spread of all (Z51_SYNC_SKEW).
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchSync( int argc, char *argv[] )
+{
+    MDIS_PATH   path[SYNC_DEV_MAX];
+    int32       skew, skewMin[SYNC_DEV_MAX+1], skewMax[SYNC_DEV_MAX+1];
+    double      skewSum[SYNC_DEV_MAX+1];
+    int         nDev, i, run, ret = 1;
+    struct {
+        Z51_WAVE_HDR hdr;
+        u_int16      data[2];
+    } wave;
+    M_SG_BLOCK  blk;
+
+    if( argc < 1 || argc > SYNC_DEV_MAX ) {
+        usage();
+        return(1);
+    }
+
+    wave.hdr.id  = SYNC_WAVE_ID;
+    wave.data[0] = 0x8000;
+    wave.data[1] = 0x0000;
+    blk.size = sizeof(wave);
+    blk.data = &wave;
+
+    for( nDev=0; nDev<argc; nDev++ ) {
+        if( (path[nDev] = M_open( argv[nDev] )) < 0 ) {
+            printf("*** open %s: %s\n", argv[nDev],
+                   M_errstring(UOS_ErrnoGet()));
+            goto ABORT;
+        }
+        if( M_setstat( path[nDev], M_MK_CH_CURRENT, 0 ) ||
+            M_setstat( path[nDev], Z51_SAMPLE_PERIOD, 1000 ) ||
+            M_setstat( path[nDev], Z51_BLK_WAVE_LOAD, (INT32_OR_64)&blk ) ) {
+            printf("*** setup %s: %s\n", argv[nDev],
+                   M_errstring(UOS_ErrnoGet()));
+            nDev++;
+            goto ABORT;
+        }
+        skewMin[nDev] = 0x7fffffff;
+        skewMax[nDev] = -0x7fffffff;
+        skewSum[nDev] = 0;
+    }
+    skewMin[nDev] = 0x7fffffff;
+    skewMax[nDev] = -0x7fffffff;
+    skewSum[nDev] = 0;
+
+    for( run=0; run<SYNC_RUNS; run++ ) {
+        for( i=0; i<nDev; i++ ) {
+            if( M_setstat( path[i], Z51_SYNC_ARM,
+                           Z51_WAVE_START_ARG(SYNC_WAVE_ID, 1) ) ) {
+                printf("*** arm %s: %s\n", argv[i],
+                       M_errstring(UOS_ErrnoGet()));
+                goto ABORT;
+            }
+        }
+
+        if( M_setstat( path[0], Z51_SYNC_TRIGGER, 1000 ) ) {
+            printf("*** trigger: %s\n", M_errstring(UOS_ErrnoGet()));
+            goto ABORT;
+        }
+
+        /* the timers release the devices at the deadline (1 ms) */
+        UOS_Delay( 3 );
+
+        /* lateness of each device, last entry: spread of all */
+        for( i=0; i<=nDev; i++ ) {
+            if( (i < nDev) ? M_getstat( path[i], Z51_SYNC_LATE, &skew ) :
+                             M_getstat( path[0], Z51_SYNC_SKEW, &skew ) ) {
+                printf("*** release: %s\n", M_errstring(UOS_ErrnoGet()));
+                goto ABORT;
+            }
+            if( skew < skewMin[i] )
+                skewMin[i] = skew;
+            if( skew > skewMax[i] )
+                skewMax[i] = skew;
+            skewSum[i] += skew;
+        }
+        UOS_Delay( 5 );
+    }
+
+    printf("%-20s %10s %10s %10s\n", "late", "min [us]", "avg [us]",
+           "max [us]");
+    for( i=0; i<=nDev; i++ )
+        printf("%-20s %10d %10.1f %10d\n", (i < nDev) ? argv[i] : "spread",
+               (int)skewMin[i], skewSum[i] / SYNC_RUNS, (int)skewMax[i]);
+    ret = 0;
+
+ ABORT:
+    for( i=0; i<nDev; i++ ) {
+        M_setstat( path[i], Z51_WAVE_STOP, 0 );
+        M_setstat( path[i], Z51_WAVE_DELETE, SYNC_WAVE_ID );
+        M_close( path[i] );
+    }
+    return( ret );
+}
+
+/**********************************************************************/
+/** Check and benchmark conversion of engineering units
+ *
+ *  Converts random values around a -10..10 V range together with edge
+ *  cases (exact ties, out of range, infinity, NaN) with Z51_UnitsToCode()
+ *  and the scalar Z51_UnitsToCodeRef(), requires bit-exact results and
+ *  measures the throughput of both.
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchUnits( int argc, char *argv[] )
+{
+    const float lo = -10.0f, hi = 10.0f;
+    const float special[] = { -10.0f, 10.0f, 0.0f, -0.0f, -1e30f, 1e30f,
+                              1.0f / 0.0f, -1.0f / 0.0f, 0.0f / 0.0f };
+    u_int32     n = 1000000, i, loops, t, diff = 0;
+    u_int16     *code, *ref;
+    float       *val, step = (hi - lo) / 65535.0f;
+    double      rate, refRate;
+
+    if( argc > 0 )
+        n = strtoul( argv[0], NULL, 0 );
+
+    val  = malloc( n * sizeof(float) );
+    code = malloc( n * sizeof(u_int16) );
+    ref  = malloc( n * sizeof(u_int16) );
+    if( !val || !code || !ref ) {
+        printf("*** out of memory\n");
+        return(1);
+    }
+
+    srand( 1 );
+    for( i=0; i<n; i++ ) {
+        switch( i % 4 ) {
+            case 0:     /* anywhere, 10% beyond both ends */
+                val[i] = lo * 1.1f + (hi - lo) * 1.1f * rand() / RAND_MAX;
+                break;
+            case 1:     /* halfway between two input values */
+                val[i] = lo + step * ((rand() & 0xffff) + 0.5f);
+                break;
+            case 2:     /* exact input value */
+                val[i] = lo + step * (rand() & 0xffff);
+                break;
+            default:
+                val[i] = special[(i / 4) % (sizeof(special)/sizeof(float))];
+        }
+    }
+
+    Z51_UnitsToCode( val, n, lo, hi, code );
+    Z51_UnitsToCodeRef( val, n, lo, hi, ref );
+    for( i=0; i<n; i++ ) {
+        if( code[i] != ref[i] && diff++ < 10 )
+            printf("*** value %g: 0x%04x, reference 0x%04x\n",
+                   val[i], code[i], ref[i]);
+    }
+
+    t = UOS_MsecTimerGet();
+    for( loops=0; loops == 0 || elapsed(t) < MIN_RUNTIME; loops++ )
+        Z51_UnitsToCode( val, n, lo, hi, code );
+    rate = (double)n * loops / (elapsed(t) + 1) / 1000.0;
+
+    t = UOS_MsecTimerGet();
+    for( loops=0; loops == 0 || elapsed(t) < MIN_RUNTIME; loops++ )
+        Z51_UnitsToCodeRef( val, n, lo, hi, ref );
+    refRate = (double)n * loops / (elapsed(t) + 1) / 1000.0;
+
+    printf("%-14s %12s %12s %10s\n", "conversion", "[MS/s]", "ref [MS/s]",
+           "mismatch");
+    printf("%-14s %12.1f %12.1f %10u\n", "float->u16", rate, refRate,
+           (unsigned)diff );
+
+    free( val );
+    free( code );
+    free( ref );
+    return( diff ? 1 : 0 );
+}
+
+/**********************************************************************/
+/** Benchmark many threads updating outputs over one path
+ *
+ *  Each producer thread updates its own output (single output channels,
+ *  spread over all units) as fast as it can. Baseline: the threads share
+ *  the path under a mutex and write directly. Queue: the threads submit
+ *  to a Z51_MPSC queue, one dispatcher thread writes the coalesced
+ *  updates with Z51_MpscDispatch(). Without device the baseline only
+ *  stores the values and the dispatcher only drains the queue, which
+ *  shows the cost of the synchronization alone.
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchMpsc( int argc, char *argv[] )
+{
+#ifdef _WIN32
+    printf("*** mpsc test needs POSIX threads\n");
+    return(1);
+#else
+    MPSC_BENCH      b;
+    Z51_MPSC_STATS  st;
+    u_int32         threads = 4, ms, total;
+    int32           chNumber;
+    int             ret = 1;
+
+    memset( &b, 0, sizeof(b) );
+    b.path  = -1;
+    b.puts  = 100000;
+    b.units = 1;
+
+    if( argc > 0 )
+        threads = strtoul( argv[0], NULL, 0 );
+    if( argc > 1 )
+        b.puts = strtoul( argv[1], NULL, 0 );
+    if( threads < 1 || threads > MPSC_THREADS_MAX || b.puts < 1 ) {
+        usage();
+        return(1);
+    }
+
+    pthread_mutex_init( &b.lock, NULL );
+
+    if( argc > 2 ) {
+        if( (b.path = M_open( argv[2] )) < 0 ) {
+            printf("*** open %s: %s\n", argv[2], M_errstring(UOS_ErrnoGet()));
+            goto ABORT;
+        }
+        if( M_getstat( b.path, M_LL_CH_NUMBER, &chNumber ) ) {
+            printf("*** getstat: %s\n", M_errstring(UOS_ErrnoGet()));
+            goto ABORT;
+        }
+        b.units = chNumber / 3;
+    }
+
+    total = threads * b.puts;
+
+    printf("%-8s %8s %10s %10s %10s %10s %10s\n", "method", "threads",
+           "updates", "[ns/upd]", "full", "coalesced", "writes");
+
+    /* baseline: mutex around the write */
+    b.curCh = -1;
+    if( MpscRun( &b, threads, &ms ) )
+        goto ABORT;
+    printf("%-8s %8u %10u %10.1f %10s %10s %10u\n", "mutex",
+           (unsigned)threads, (unsigned)total, ms * 1e6 / total, "-", "-",
+           (unsigned)(b.path >= 0 ? total : 0) );
+
+    /* submission queue */
+    if( (b.q = Z51_MpscCreate( MPSC_SLOTS, b.units )) == NULL ) {
+        printf("*** out of memory\n");
+        goto ABORT;
+    }
+    if( MpscRun( &b, threads, &ms ) )
+        goto ABORT;
+    Z51_MpscStats( b.q, &st );
+    printf("%-8s %8u %10u %10.1f %10u %9.1f%% %10u\n", "queue",
+           (unsigned)threads, (unsigned)total, ms * 1e6 / total,
+           (unsigned)st.full, 100.0 * st.coalesced / total,
+           (unsigned)st.writes );
+
+    ret = 0;
+
+ABORT:
+    if( b.error )
+        printf("*** write: %s\n", M_errstring(b.error));
+    Z51_MpscDelete( b.q );
+    pthread_mutex_destroy( &b.lock );
+    if( b.path >= 0 )
+        M_close( b.path );
+    return( ret || b.error ? 1 : 0 );
+#endif
+}
+
+/**********************************************************************/
+/** Benchmark the waveform mixer
+ *
+ *  Renders with 1, 2, 4... layers of all types (ramp, sine, looped
+ *  buffer, noise) and prints the cost per value and layer, which should
+ *  stay about the same as layers are added.
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchMix( int argc, char *argv[] )
+{
+    Z51_MIXER     *m;
+    Z51_MIX_LAYER layer;
+    u_int32       n = 1000000, layers, i, loops, t;
+    u_int16       *wave;
+    int16         *buf, *out;
+    double        ns;
+
+    if( argc > 0 )
+        n = strtoul( argv[0], NULL, 0 );
+
+    wave = malloc( MIX_BUF_LEN * sizeof(u_int16) );
+    buf  = malloc( MIX_BUF_LEN * sizeof(int16) );
+    out  = malloc( n * sizeof(int16) );
+    if( !wave || !buf || !out || (m = Z51_MixerCreate()) == NULL ) {
+        printf("*** out of memory\n");
+        return(1);
+    }
+
+    GenSine( wave, MIX_BUF_LEN );
+    for( i=0; i<MIX_BUF_LEN; i++ )
+        buf[i] = (int16)(wave[i] ^ 0x8000);
+
+    printf("%-8s %12s %12s %12s\n", "layers", "[MS/s]", "[ns/value]",
+           "[ns/layer]");
+
+    memset( &layer, 0, sizeof(layer) );
+    for( layers=1; layers<=Z51_MIX_LAYERS_MAX; layers*=2 ) {
+        /* add layers up to the count to measure */
+        for( i=layers/2; i<layers; i++ ) {
+            layer.type  = i % 4;
+            layer.gain  = Z51_MIX_GAIN_ONE / (i + 1);
+            layer.from  = -0x1000;
+            layer.to    = 0x1000;
+            layer.buf   = buf;
+            layer.len   = MIX_BUF_LEN;
+            layer.loop  = 1;
+            layer.step  = 0x00100000 * (i + 1);
+            layer.phase = i + 1;
+            if( Z51_MixerAdd( m, &layer ) < 0 ) {
+                printf("*** can't add layer\n");
+                return(1);
+            }
+        }
+
+        t = UOS_MsecTimerGet();
+        for( loops=0; loops == 0 || elapsed(t) < MIN_RUNTIME; loops++ )
+            Z51_MixerRender( m, out, n );
+        ns = (elapsed(t) + 1) * 1e6 / ((double)n * loops);
+
+        printf("%-8u %12.1f %12.2f %12.2f\n", (unsigned)layers, 1e3 / ns, ns,
+               ns / layers );
+    }
+
+    Z51_MixerDelete( m );
+    free( wave );
+    free( buf );
+    free( out );
+    return(0);
+}
+
+/**********************************************************************/
+/** Benchmark direct device access against sessions of the z51d server
+ *
+ *  Measures opening and closing a path/session and writing values to
+ *  channel 0 until they are output (M_write() against Z51D_Write() and a
+ *  final Z51D_Flush()). z51d must be running.
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchZ51d( int argc, char *argv[] )
+{
+#ifdef _WIN32
+    printf("*** z51d test needs POSIX\n");
+    return(1);
+#else
+    Z51D_CLIENT *c;
+    MDIS_PATH   path;
+    u_int32     writes = 100000, i, t, msOpen, msWrite;
+
+    if( argc < 1 ) {
+        usage();
+        return(1);
+    }
+    if( argc > 1 )
+        writes = strtoul( argv[1], NULL, 0 );
+
+    printf("%-8s %14s %14s\n", "method", "open [us]", "write [ns]");
+
+    /* direct: every open initializes the device */
+    t = UOS_MsecTimerGet();
+    for( i=0; i<OPEN_LOOPS; i++ ) {
+        if( (path = M_open( argv[0] )) < 0 ) {
+            printf("*** open %s: %s\n", argv[0], M_errstring(UOS_ErrnoGet()));
+            return(1);
+        }
+        M_close( path );
+    }
+    msOpen = elapsed( t );
+
+    if( (path = M_open( argv[0] )) < 0 ) {
+        printf("*** open %s: %s\n", argv[0], M_errstring(UOS_ErrnoGet()));
+        return(1);
+    }
+    t = UOS_MsecTimerGet();
+    for( i=0; i<writes; i++ ) {
+        if( M_write( path, i & 0xffff ) < 0 ) {
+            printf("*** write: %s\n", M_errstring(UOS_ErrnoGet()));
+            M_close( path );
+            return(1);
+        }
+    }
+    msWrite = elapsed( t );
+    M_close( path );
+
+    printf("%-8s %14.1f %14.1f\n", "direct", msOpen * 1e3 / OPEN_LOOPS,
+           msWrite * 1e6 / writes);
+
+    /* session: the device stays open in the server */
+    t = UOS_MsecTimerGet();
+    for( i=0; i<OPEN_LOOPS; i++ ) {
+        if( (c = Z51D_Open( argv[0], 0, 0 )) == NULL ) {
+            printf("*** z51d open %s: %s\n", argv[0],
+                   M_errstring(UOS_ErrnoGet()));
+            return(1);
+        }
+        Z51D_Close( c );
+    }
+    msOpen = elapsed( t );
+
+    if( (c = Z51D_Open( argv[0], 0, 0 )) == NULL ) {
+        printf("*** z51d open %s: %s\n", argv[0], M_errstring(UOS_ErrnoGet()));
+        return(1);
+    }
+    t = UOS_MsecTimerGet();
+    for( i=0; i<writes; i++ ) {
+        while( Z51D_Write( c, i & 0xffff ) )
+            sched_yield();                  /* ring full: let z51d run */
+    }
+    if( Z51D_Flush( c ) ) {
+        printf("*** z51d write: %s\n", M_errstring(UOS_ErrnoGet()));
+        Z51D_Close( c );
+        return(1);
+    }
+    msWrite = elapsed( t );
+    Z51D_Close( c );
+
+    printf("%-8s %14.1f %14.1f\n", "z51d", msOpen * 1e3 / OPEN_LOOPS,
+           msWrite * 1e6 / writes);
+    return(0);
+#endif
+}
+
+/**********************************************************************/
+/** Benchmark the pacer against UOS_Delay() loops
+ *
+ *  Paces an empty loop and reports the drift of the whole run, overruns
+ *  and the delay after the deadlines. UOS_Delay(1) loops, as used before
+ *  for pacing, show the drift of relative sleeps.
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchPace( int argc, char *argv[] )
+{
+    static const u_int32 rates[] = { 1000, 10000, 100000 };
+    Z51_PACE       *p;
+    Z51_PACE_STATS st;
+    u_int32        rate, periods, i, n, r;
+    u_int64        t;
+    double         ms;
+
+    printf("%-8s %10s %10s %9s %9s %9s %9s\n", "[Hz]", "periods",
+           "drift[us]", "overruns", "skipped", "avg[ns]", "max[ns]");
+
+    for( r=0; r<sizeof(rates)/sizeof(rates[0]); r++ ) {
+        rate    = argc > 0 ? strtoul( argv[0], NULL, 0 ) : rates[r];
+        periods = argc > 1 ? strtoul( argv[1], NULL, 0 ) : rate;
+
+        if( rate < 1 || periods < 1 ||
+            (p = Z51_PaceCreate( 1000000000 / rate,
+                                 Z51_PACE_SPIN_DEFAULT )) == NULL ) {
+            usage();
+            return(1);
+        }
+
+        /* n: periods including the skipped ones */
+        t = Z51_NsecTimerGet();
+        Z51_PaceReset( p );
+        for( i=0, n=0; i<periods; i++ )
+            n += 1 + Z51_PaceWait( p );
+        t = Z51_NsecTimerGet() - t;
+
+        Z51_PaceStats( p, &st );
+        Z51_PaceDelete( p );
+
+        printf("%-8u %10u %10.1f %9u %9u %9.0f %9u\n", rate, n,
+               (t - (double)n * (1000000000 / rate)) / 1e3, st.overruns,
+               st.missed, st.periods > st.overruns ?
+               (double)st.lateSum / (st.periods - st.overruns) : 0.0,
+               st.lateMax);
+
+        if( argc > 0 )
+            break;
+    }
+
+    /* relative sleeps: each adds its wake-up latency */
+    t = Z51_NsecTimerGet();
+    for( i=0; i<PACE_DELAY_LOOPS; i++ )
+        UOS_Delay( 1 );
+    ms = (Z51_NsecTimerGet() - t) / 1e6;
+
+    printf("\nUOS_Delay(1) x %u: %.1f ms, drift %.1f us/period\n",
+           PACE_DELAY_LOOPS, ms, (ms - PACE_DELAY_LOOPS) * 1e3 /
+           PACE_DELAY_LOOPS);
+    return(0);
+}
+
+/**********************************************************************/
+/** Benchmark the time to safe state of several devices
+ *
+ *  Starts an endless waveform on all devices and puts them into the safe
+ *  state, SAFE_RUNS times with Z51_SafeFire() and SAFE_RUNS times with
+ *  M_setstat() one device after the other. Reports the time until all
+ *  devices were safe and, per device, the worst case measured by the
+ *  driver (Z51_SAFE_TIME), which excludes the system call.
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+static int BenchSafe( int argc, char *argv[] )
+{
+    static const char *method[] = { "parallel", "sequential" };
+    MDIS_PATH   path[Z51_SAFE_DEV_MAX];
+    Z51_SAFE    *s = NULL;
+    u_int64     ns, nsMax[2] = { 0, 0 };
+    double      nsSum[2] = { 0, 0 };
+    int32       driverMax;
+    int         nDev, i, m, run, ret = 1;
+    struct {
+        Z51_WAVE_HDR hdr;
+        u_int16      data[2];
+    } wave;
+    M_SG_BLOCK  blk;
+
+    if( argc < 1 || argc > Z51_SAFE_DEV_MAX ) {
+        usage();
+        return(1);
+    }
+
+    wave.hdr.id  = SAFE_WAVE_ID;
+    wave.data[0] = 0x8000;
+    wave.data[1] = 0x0000;
+    blk.size = sizeof(wave);
+    blk.data = &wave;
+
+    for( nDev=0; nDev<argc; nDev++ ) {
+        if( (path[nDev] = M_open( argv[nDev] )) < 0 ) {
+            printf("*** open %s: %s\n", argv[nDev],
+                   M_errstring(UOS_ErrnoGet()));
+            goto ABORT;
+        }
+        if( M_setstat( path[nDev], M_MK_CH_CURRENT, 0 ) ||
+            M_setstat( path[nDev], Z51_SAMPLE_PERIOD, 1000 ) ||
+            M_setstat( path[nDev], Z51_BLK_WAVE_LOAD, (INT32_OR_64)&blk ) ||
+            M_setstat( path[nDev], Z51_SAFE_TIME, 0 ) ) {
+            printf("*** setup %s: %s\n", argv[nDev],
+                   M_errstring(UOS_ErrnoGet()));
+            nDev++;
+            goto ABORT;
+        }
+    }
+
+    if( (s = Z51_SafeCreate( path, nDev )) == NULL ) {
+        printf("*** can't create safe state trigger\n");
+        goto ABORT;
+    }
+
+    for( m=0; m<2; m++ ) {
+        for( run=0; run<SAFE_RUNS; run++ ) {
+            for( i=0; i<nDev; i++ ) {
+                if( M_setstat( path[i], Z51_SAFE_STATE, 0 ) ||
+                    M_setstat( path[i], Z51_WAVE_START,
+                               Z51_WAVE_START_ARG(SAFE_WAVE_ID, 0) ) ) {
+                    printf("*** start %s: %s\n", argv[i],
+                           M_errstring(UOS_ErrnoGet()));
+                    goto ABORT;
+                }
+            }
+            UOS_Delay( 5 );
+
+            if( m == 0 ) {
+                if( Z51_SafeFire( s, &ns ) ) {
+                    printf("*** safe state failed\n");
+                    goto ABORT;
+                }
+            }
+            else {
+                ns = Z51_NsecTimerGet();
+                for( i=0; i<nDev; i++ ) {
+                    if( M_setstat( path[i], Z51_SAFE_STATE, 1 ) ) {
+                        printf("*** safe state %s: %s\n", argv[i],
+                               M_errstring(UOS_ErrnoGet()));
+                        goto ABORT;
+                    }
+                }
+                ns = Z51_NsecTimerGet() - ns;
+            }
+
+            nsSum[m] += (double)ns;
+            if( ns > nsMax[m] )
+                nsMax[m] = ns;
+        }
+    }
+
+    printf("%-20s %10s %10s\n", "method", "avg [us]", "max [us]");
+    for( m=0; m<2; m++ )
+        printf("%-20s %10.1f %10.1f\n", method[m],
+               nsSum[m] / SAFE_RUNS / 1e3, nsMax[m] / 1e3);
+
+    printf("\n%-20s %10s\n", "device", "drv [us]");
+    for( i=0; i<nDev; i++ ) {
+        M_getstat( path[i], Z51_SAFE_TIME, &driverMax );
+        printf("%-20s %10d\n", argv[i], (int)driverMax);
+    }
+    ret = 0;
+
+ ABORT:
+    Z51_SafeDelete( s );
+    for( i=0; i<nDev; i++ ) {
+        M_setstat( path[i], Z51_SAFE_STATE, 0 );
+        M_setstat( path[i], Z51_WAVE_STOP, 0 );
+        M_setstat( path[i], Z51_WAVE_DELETE, SAFE_WAVE_ID );
+        M_close( path[i] );
+    }
+    return( ret );
+}
+
+#ifndef _WIN32
+/**********************************************************************/
+/** Run one pass of the mpsc test
+ *
+ *  \param b          \IN  test state, b->q selects the method
+ *  \param threads    \IN  number of producers
+ *  \param msP        \OUT time until all updates were written [ms]
+ *
+ *  \return           success (0) or error (1)
+ */
+static int MpscRun( MPSC_BENCH *b, u_int32 threads, u_int32 *msP )
+{
+    MPSC_PRODUCER   prod[MPSC_THREADS_MAX];
+    pthread_t       tid[MPSC_THREADS_MAX], disp;
+    u_int32         i, n, t;
+
+    b->stop = 0;
+    t = UOS_MsecTimerGet();
+
+    if( b->q && pthread_create( &disp, NULL, MpscDispatcher, b ) ) {
+        printf("*** can't create dispatcher thread\n");
+        return(1);
+    }
+
+    for( n=0; n<threads; n++ ) {
+        prod[n].b  = b;
+        prod[n].ch = 3 * ((n / 2) % b->units) + (n % 2);
+        if( pthread_create( &tid[n], NULL, MpscProducer, &prod[n] ) ) {
+            printf("*** can't create producer thread\n");
+            break;
+        }
+    }
+
+    for( i=0; i<n; i++ )
+        pthread_join( tid[i], NULL );
+
+    b->stop = 1;
+    if( b->q )
+        pthread_join( disp, NULL );
+
+    *msP = elapsed( t ) + 1;
+    return( n < threads || b->error ? 1 : 0 );
+}
+
+/**********************************************************************/
+/** Producer thread of the mpsc test
+ *
+ *  \param arg        \IN  MPSC_PRODUCER
+ */
+static void *MpscProducer( void *arg )
+{
+    MPSC_PRODUCER *p = (MPSC_PRODUCER*)arg;
+    MPSC_BENCH    *b = p->b;
+    u_int32       i, value;
+
+    for( i=0; i<b->puts && !b->error; i++ ) {
+        value = i & 0xffff;
+
+        if( b->q ) {
+            while( Z51_MpscPut( b->q, p->ch, value ) )
+                sched_yield();              /* full: let the dispatcher run */
+            continue;
+        }
+
+        pthread_mutex_lock( &b->lock );
+        if( b->path < 0 ) {
+            b->shadow[p->ch] = value;
+        }
+        else if( (b->curCh != p->ch &&
+                  M_setstat( b->path, M_MK_CH_CURRENT, p->ch )) ||
+                 M_write( b->path, value ) < 0 ) {
+            b->error = UOS_ErrnoGet();
+            b->curCh = -1;
+        }
+        else {
+            b->curCh = p->ch;
+        }
+        pthread_mutex_unlock( &b->lock );
+    }
+    return( NULL );
+}
+
+/**********************************************************************/
+/** Dispatcher thread of the mpsc test
+ *
+ *  \param arg        \IN  MPSC_BENCH
+ */
+static void *MpscDispatcher( void *arg )
+{
+    MPSC_BENCH      *b = (MPSC_BENCH*)arg;
+    Z51_MPSC_ENTRY  e[Z51_MPSC_CH_MAX];
+    int32           n;
+    int             stop;
+
+    do {
+        stop = b->stop;                     /* sample before the last drain */
+
+        if( b->path >= 0 ) {
+            if( (n = Z51_MpscDispatch( b->q, b->path )) < 0 ) {
+                b->error = UOS_ErrnoGet();
+                break;
+            }
+        }
+        else {
+            n = Z51_MpscDrain( b->q, UOS_MsecTimerGet(), e );
+        }
+
+        if( n == 0 )
+            sched_yield();
+    } while( !stop || n );
+
+    return( NULL );
+}
+#endif
+
+/**********************************************************************/
+/** Test profile: plateaus connected by slow ramps
+ */
+static void GenPlateau( u_int16 *buf, u_int32 n )
+{
+    u_int32 i = 0, k;
+    int32   level = 0x1000, target;
+
+    while( i < n ) {
+        /* hold 20ms @ 100kS/s */
+        for( k=0; k<2000 && i<n; k++ )
+            buf[i++] = (u_int16)level;
+
+        /* ramp with 25 codes/sample to next level */
+        target = (level + 0x3000) & 0xffff;
+        while( level != target && i < n ) {
+            if( target > level )
+                level = level + 25 < target ? level + 25 : target;
+            else
+                level = level - 25 > target ? level - 25 : target;
+            buf[i++] = (u_int16)level;
+        }
+    }
+}
+
+/**********************************************************************/
+/** Test profile: sawtooth with one code per sample
+ */
+static void GenRamp( u_int16 *buf, u_int32 n )
+{
+    u_int32 i;
+
+    for( i=0; i<n; i++ )
+        buf[i] = (u_int16)i;
+}
+
+/**********************************************************************/
+/** Test profile: full scale sine, 10000 samples per period
+ */
+static void GenSine( u_int16 *buf, u_int32 n )
+{
+    /* y[i+1] = 2cos(w) * y[i] - y[i-1], w = 2pi/10000 */
+    double  c2 = 1.9999996052158369, y0 = 0.0,
+            y1 = 0.0006283184893762572, y;
+    u_int32 i;
+
+    for( i=0; i<n; i++ ) {
+        buf[i] = (u_int16)(0x8000 + 0x7fff * y0);
+        y  = c2 * y1 - y0;
+        y0 = y1;
+        y1 = y;
+    }
+}
+
+/**********************************************************************/
+/** Test profile: white noise (worst case)
+ */
+static void GenNoise( u_int16 *buf, u_int32 n )
+{
+    u_int32 i, x = 0x12345678;
+
+    for( i=0; i<n; i++ ) {
+        x = x * 1664525 + 1013904223;
+        buf[i] = (u_int16)(x >> 16);
+    }
+}
@@ -0,0 +1,56 @@
+#***************************  M a k e f i l e  *******************************
+#
+#         Author: ub
+#
+#    Description: Makefile definitions for the Z51 trace replay
+#
+#                 Links the driver source built with Z51_SIM; OSS and DESC
+#                 are simulated by z51_sim.c of the soak test.
+#
+#-----------------------------------------------------------------------------
+#   Copyright 2026, MEN Mikro Elektronik GmbH
+#*****************************************************************************
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+MAK_NAME=z51_replay
+# the next line is updated during the MDIS installation
+STAMPED_REVISION="13Z051-06_01_04-5-gca494d4-dirty_2019-05-30"
+
+DEF_REVISION=MAK_REVISION=$(STAMPED_REVISION)
+MAK_SWITCH=$(SW_PREFIX)$(DEF_REVISION) \
+		$(SW_PREFIX)MAC_MEM_MAPPED \
+		$(SW_PREFIX)Z51_SIM \
+
+MAK_LIBS=
+
+MAK_INCL=$(MEN_INC_DIR)/z51_drv.h	\
+         $(MEN_INC_DIR)/men_typs.h	\
+         $(MEN_INC_DIR)/oss.h		\
+         $(MEN_INC_DIR)/mdis_err.h	\
+         $(MEN_INC_DIR)/maccess.h	\
+         $(MEN_INC_DIR)/desc.h		\
+         $(MEN_INC_DIR)/mdis_api.h	\
+         $(MEN_INC_DIR)/mdis_com.h	\
+         $(MEN_INC_DIR)/modcom.h	\
+         $(MEN_INC_DIR)/ll_defs.h	\
+         $(MEN_INC_DIR)/ll_entry.h	\
+         $(MEN_INC_DIR)/dbg.h		\
+
+MAK_INP1=z51_replay$(INP_SUFFIX)
+MAK_INP2=z51_replay_sim$(INP_SUFFIX)
+MAK_INP3=z51_replay_drv$(INP_SUFFIX)
+
+MAK_INP=$(MAK_INP1) \
+        $(MAK_INP2) \
+        $(MAK_INP3)
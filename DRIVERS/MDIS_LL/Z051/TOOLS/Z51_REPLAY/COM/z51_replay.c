@@ -0,0 +1,868 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                   Z51_REPLAY                       ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *         \file z51_replay.c
+ *       \author ub
+ *
+ *       \brief  Trace replay of Z51 driver calls on simulated hardware
+ *
+ *               Replays a recorded sequence of M_write(), M_setblock()
+ *               and M_setstat() calls against the driver on the simulated
+ *               16Z051 register window of the soak test (z51_sim.c), with
+ *               the recorded timing or sped up. Reports the latency of
+ *               each call and records the resulting DAC_CTRL_REG stream.
+ *               Streams recorded with two driver builds can be compared,
+ *               so a change to the driver shows up as a difference in
+ *               latency or output instead of only on hardware.
+ *
+ *               Time is virtual, so a replay is fast and reproducible.
+ *
+ *               See usage info.
+ *
+ *     Required: -
+ *     \switches Z51_SIM (set by program.mak)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/maccess.h>
+#include <MEN/oss.h>
+#include <MEN/desc.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/ll_defs.h>
+#include <MEN/ll_entry.h>
+#include <MEN/z51_drv.h>
+#include "../../Z51_SOAK/COM/z51_sim.h"
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define LINE_MAX            65536       /* trace/stream line length */
+
+/* call types */
+#define CALL_WRITE          0           /* M_write() */
+#define CALL_SETBLOCK       1           /* M_setblock() */
+#define CALL_SETSTAT        2           /* M_setstat() */
+#define CALL_SETSTAT_BLK    3           /* M_setstat() of a block code */
+#define CALL_TYPES          4
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** recorded call and its replay result */
+typedef struct {
+    u_int32     line;           /* trace line */
+    u_int64     at;             /* recorded time [ns] */
+    int         type;           /* CALL_xxx */
+    int32       ch;
+    int32       code;           /* setstat code */
+    int32       value;          /* write/setstat value */
+    u_int8      *data;          /* block data */
+    int32       size;           /* ... [bytes] */
+    u_int64     lag;            /* started after its time [ns] */
+    u_int64     lat;            /* latency [ns] */
+    int32       expect;         /* expected error */
+    int32       error;
+} CALL;
+
+/** driver error by name */
+typedef struct {
+    int32       code;
+    const char  *name;
+} ERRNAME;
+
+/** DAC_CTRL_REG write */
+typedef struct {
+    u_int64     at;             /* [ns] after replay start */
+    u_int32     unit;
+    u_int32     val;
+    u_int32     line;           /* trace line of the call or 0 */
+    int         lost;           /* unit faulty */
+} CTRL;
+
+/** DAC_CTRL_REG stream */
+typedef struct {
+    CTRL        *w;
+    u_int32     n;
+    u_int32     max;
+} STREAM;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage( void );
+static int TraceLoad( const char *name );
+static char* Token( char **pP );
+static int ErrLoad( char *p, int32 *errorP );
+static int DataLoad( char *p, CALL *c );
+static int32 Replay( void );
+static void CtrlHook( u_int64 at, u_int32 unit, u_int32 val, int lost );
+static int CtrlAdd( STREAM *s, const CTRL *w );
+static int StreamSave( const char *name, const char *trace );
+static int StreamLoad( const char *name, STREAM *s );
+static int Compare( const char *nameA, const char *nameB );
+static void Report( const char *trace );
+
+/* driver (Z51_SIM build of z51_drv.c) */
+extern void __Z51_GetEntry( LL_ENTRY *drvP );
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const char *G_callName[CALL_TYPES] = {
+    "write", "setblock", "setstat", "setstatblk"
+};
+
+static const ERRNAME G_errName[] = {
+    { ERR_LL_ILL_PARAM,     "ERR_LL_ILL_PARAM" },
+    { ERR_LL_ILL_CHAN,      "ERR_LL_ILL_CHAN" },
+    { ERR_LL_ILL_DIR,       "ERR_LL_ILL_DIR" },
+    { ERR_LL_ILL_FUNC,      "ERR_LL_ILL_FUNC" },
+    { ERR_LL_UNK_CODE,      "ERR_LL_UNK_CODE" },
+    { ERR_LL_DEV_BUSY,      "ERR_LL_DEV_BUSY" },
+    { ERR_LL_DEV_NOTRDY,    "ERR_LL_DEV_NOTRDY" },
+    { ERR_LL_USERBUF,       "ERR_LL_USERBUF" },
+};
+
+static SIM_CONFIG G_cfg = {
+    1,          /* units */
+    1,          /* irqEnable */
+    1000,       /* wdMs (worst case) */
+    200,        /* accessNs */
+    1000,       /* ctrlNs */
+};
+
+static u_int32  G_speed     = 1;        /* speed-up, 0: back to back */
+static u_int32  G_tailMs    = 100;      /* run on after the last call */
+static u_int32  G_limitUs   = 0;        /* max. time shift or 0 */
+static int      G_verbose   = 0;
+
+static CALL     *G_call     = NULL;     /* trace */
+static u_int32  G_calls     = 0;
+static u_int32  G_callsMax  = 0;
+
+static STREAM   G_stream;               /* recorded by CtrlHook() */
+static u_int64  G_t0;                   /* replay start [ns] */
+static u_int32  G_line      = 0;        /* trace line of the running call */
+static u_int64  G_end;                  /* replay end [ns] */
+static int32    G_leak;                 /* memory blocks not freed by exit */
+
+static char     G_buf[LINE_MAX];
+
+/********************************* usage ***********************************/
+/** Print program usage
+ */
+static void usage( void )
+{
+    printf("Syntax: z51_replay [<opts>] <trace>\n");
+    printf("        z51_replay [-l=<us>] -c <stream-a> <stream-b>\n");
+    printf("Function: Replay a trace of Z51 driver calls on simulated\n");
+    printf("          hardware (virtual time, no device needed) and\n");
+    printf("          compare the DAC_CTRL_REG streams of two builds\n");
+    printf("Trace lines ('#' starts a comment, time in us, data hex bytes\n");
+    printf("in memory order):\n");
+    printf("    <us> write <ch> <value>\n");
+    printf("    <us> setblock <ch> <data>\n");
+    printf("    <us> setstat <ch> <code> <value>\n");
+    printf("    <us> setstatblk <ch> <code> <data>\n");
+    printf("A call may end with '= <error>', the error it must return\n");
+    printf("(number or ERR_LL_xxx name).\n");
+    printf("Options:\n");
+    printf("    -s=<n>       speed-up, 0: calls back to back ........ [1]\n");
+    printf("    -t=<ms>      run on after the last call ........... [100]\n");
+    printf("    -o=<file>    save the DAC_CTRL_REG stream\n");
+    printf("    -u=<n>       DAC units (Z51_UNITS) .................. [1]\n");
+    printf("    -i=<0|1>     IRQ_ENABLE ............................. [1]\n");
+    printf("    -w=<ms>      watchdog start-up time .............. [1000]\n");
+    printf("    -x=<ns>      DAC_CTRL_REG write time ............. [1000]\n");
+    printf("    -a=<ns>      other register access time ........... [200]\n");
+    printf("    -v           list each call\n");
+    printf("    -c           compare two saved streams\n");
+    printf("    -l=<us>      fail if equal writes are shifted more\n");
+    printf("\n");
+}
+
+/********************************* main ************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+int main( int argc, char *argv[] )
+{
+    const char *file[2];
+    const char *outName = NULL;
+    int        i, n = 0, compare = 0, fail = 0;
+    u_int32    k;
+
+    for( i=1; i<argc; i++ ) {
+        char *v = argv[i] + 3;
+
+        if( strncmp( argv[i], "-s=", 3 ) == 0 )
+            G_speed = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-t=", 3 ) == 0 )
+            G_tailMs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-o=", 3 ) == 0 )
+            outName = v;
+        else if( strncmp( argv[i], "-u=", 3 ) == 0 )
+            G_cfg.units = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-i=", 3 ) == 0 )
+            G_cfg.irqEnable = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-w=", 3 ) == 0 )
+            G_cfg.wdMs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-x=", 3 ) == 0 )
+            G_cfg.ctrlNs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-a=", 3 ) == 0 )
+            G_cfg.accessNs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-l=", 3 ) == 0 )
+            G_limitUs = strtoul( v, NULL, 0 );
+        else if( strcmp( argv[i], "-v" ) == 0 )
+            G_verbose = 1;
+        else if( strcmp( argv[i], "-c" ) == 0 )
+            compare = 1;
+        else if( *argv[i] != '-' && n < 2 )
+            file[n++] = argv[i];
+        else {
+            usage();
+            return(1);
+        }
+    }
+
+    if( compare ) {
+        if( n != 2 ) {
+            usage();
+            return(1);
+        }
+        return( Compare( file[0], file[1] ) );
+    }
+
+    if( n != 1 || G_cfg.units < 1 || G_cfg.units > SIM_UNITS_MAX ) {
+        usage();
+        return(1);
+    }
+
+    if( TraceLoad( file[0] ) || Replay() )
+        return(1);
+
+    Report( file[0] );
+
+    for( k=0; k<G_calls; k++ )
+        if( G_call[k].error != G_call[k].expect )
+            fail = 1;
+    if( G_leak )
+        fail = 1;
+
+    if( outName && StreamSave( outName, file[0] ) )
+        fail = 1;
+
+    return( fail );
+}
+
+/**********************************************************************/
+/** Read the trace
+ *
+ *  Times must not decrease; they are taken relative to the first call.
+ *
+ *  \param name       \IN  file name
+ *
+ *  \return 0 or 1 on error
+ */
+static int TraceLoad( const char *name )
+{
+    FILE    *fp;
+    char    *p, *tok[4], *end;
+    double  us;
+    CALL    *c;
+    int32   expect;
+    int     nr = 0, n, bad;
+
+    if( (fp = fopen( name, "r" )) == NULL ) {
+        printf("*** can't open %s\n", name);
+        return(1);
+    }
+
+    while( fgets( G_buf, sizeof(G_buf), fp ) ) {
+        nr++;
+        if( strchr( G_buf, '\n' ) == NULL && !feof( fp ) ) {
+            printf("*** %s:%d: line too long\n", name, nr);
+            fclose( fp );
+            return(1);
+        }
+        if( (p = strchr( G_buf, '#' )) != NULL )
+            *p = '\0';
+
+        /* expected error */
+        expect = 0;
+        if( (p = strchr( G_buf, '=' )) != NULL ) {
+            *p++ = '\0';
+            if( ErrLoad( p, &expect ) ) {
+                printf("*** %s:%d: bad error\n", name, nr);
+                fclose( fp );
+                return(1);
+            }
+        }
+
+        /* time, call, channel */
+        p = G_buf;
+        for( n=0; n<3 && (tok[n] = Token( &p )) != NULL; n++ )
+            ;
+
+        /* empty line */
+        if( n == 0 )
+            continue;
+
+        if( G_calls == G_callsMax ) {
+            G_callsMax = G_callsMax ? 2 * G_callsMax : 1024;
+            if( (c = realloc( G_call, G_callsMax * sizeof(CALL) )) == NULL ) {
+                printf("*** out of memory\n");
+                fclose( fp );
+                return(1);
+            }
+            G_call = c;
+        }
+
+        c = &G_call[G_calls];
+        memset( c, 0, sizeof(*c) );
+        c->line = nr;
+        c->expect = expect;
+
+        bad = ( n < 3 );
+        if( !bad ) {
+            us = strtod( tok[0], &end );
+            c->at = (u_int64)(us * 1000);
+            c->ch = strtol( tok[2], NULL, 0 );
+            bad = ( *end || us < 0 ||
+                    (G_calls && c->at < G_call[G_calls-1].at) );
+
+            for( c->type=0; c->type<CALL_TYPES; c->type++ )
+                if( strcmp( tok[1], G_callName[c->type] ) == 0 )
+                    break;
+        }
+
+        if( !bad ) {
+            if( c->type == CALL_SETSTAT || c->type == CALL_SETSTAT_BLK ) {
+                bad = ( (tok[3] = Token( &p )) == NULL );
+                if( !bad )
+                    c->code = strtol( tok[3], NULL, 0 );
+            }
+
+            switch( c->type ) {
+                case CALL_WRITE:
+                case CALL_SETSTAT:
+                    bad = bad || ( (tok[3] = Token( &p )) == NULL ||
+                                   Token( &p ) != NULL );
+                    if( !bad )
+                        c->value = strtol( tok[3], NULL, 0 );
+                    break;
+                case CALL_SETBLOCK:
+                case CALL_SETSTAT_BLK:
+                    bad = bad || DataLoad( p, c );
+                    break;
+                default:
+                    bad = 1;
+            }
+        }
+
+        if( bad ) {
+            printf("*** %s:%d: bad call\n", name, nr);
+            free( c->data );
+            fclose( fp );
+            return(1);
+        }
+        G_calls++;
+    }
+
+    fclose( fp );
+
+    if( G_calls == 0 ) {
+        printf("*** %s: no calls\n", name);
+        return(1);
+    }
+    return(0);
+}
+
+/**********************************************************************/
+/** Split off the next token of a line
+ *
+ *  \param pP         \INOUT line, behind the token on return
+ *
+ *  \return token or NULL at the end of the line
+ */
+static char* Token( char **pP )
+{
+    char *p = *pP, *tok;
+
+    for( ; *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'; p++ )
+        ;
+    if( *p == '\0' )
+        return( NULL );
+
+    for( tok = p; *p && *p != ' ' && *p != '\t' && *p != '\r' &&
+             *p != '\n'; p++ )
+        ;
+    if( *p )
+        *p++ = '\0';
+
+    *pP = p;
+    return( tok );
+}
+
+/**********************************************************************/
+/** Convert the expected error of a trace line
+ *
+ *  \param p          \IN  rest of the line behind '='
+ *  \param errorP     \OUT error code
+ *
+ *  \return 0 or 1 on error
+ */
+static int ErrLoad( char *p, int32 *errorP )
+{
+    char    *tok, *end;
+    u_int32 k;
+
+    if( (tok = Token( &p )) == NULL || Token( &p ) != NULL )
+        return(1);
+
+    for( k=0; k<sizeof(G_errName)/sizeof(ERRNAME); k++ ) {
+        if( strcmp( tok, G_errName[k].name ) == 0 ) {
+            *errorP = G_errName[k].code;
+            return(0);
+        }
+    }
+
+    *errorP = strtol( tok, &end, 0 );
+    return( *end != '\0' );
+}
+
+/**********************************************************************/
+/** Convert the hex data of a trace line
+ *
+ *  White space between the bytes is allowed.
+ *
+ *  \param p          \IN  rest of the line
+ *  \param c          \OUT call with data and size
+ *
+ *  \return 0 or 1 on error
+ */
+static int DataLoad( char *p, CALL *c )
+{
+    char    *tok, hex[3] = { 0, 0, 0 }, *end;
+    int32   len = (int32)strlen( p ) / 2 + 1;
+
+    if( (c->data = malloc( len )) == NULL )
+        return(1);
+
+    while( (tok = Token( &p )) != NULL ) {
+        for( ; *tok; tok += 2 ) {
+            hex[0] = tok[0];
+            hex[1] = tok[1];
+            c->data[c->size++] = (u_int8)strtoul( hex, &end, 16 );
+            if( end != hex + 2 )
+                return(1);
+        }
+    }
+    return( c->size == 0 );
+}
+
+/**********************************************************************/
+/** Replay the trace
+ *
+ *  A call starts at its recorded time divided by the speed-up, or when
+ *  the previous call returned if that is later (lag).
+ *
+ *  \return 0 or driver error
+ */
+static int32 Replay( void )
+{
+    LL_ENTRY   entry;
+    LL_HANDLE  *llHdl;
+    M_SG_BLOCK blk;
+    int32      error, nbr;
+    u_int64    due, start;
+    CALL       *c;
+    u_int32    k;
+
+    SimInit( &G_cfg );
+    __Z51_GetEntry( &entry );
+
+    if( (error = SimOpen( &entry, &llHdl )) ) {
+        printf("*** driver init: error 0x%x\n", error);
+        return( error );
+    }
+
+    SimCtrlHook( CtrlHook );
+    G_t0 = SimNow();
+
+    for( k=0; k<G_calls; k++ ) {
+        c = &G_call[k];
+        due = G_t0;
+        if( G_speed )
+            due += (c->at - G_call[0].at) / G_speed;
+
+        SimIdle( due );
+        start = SimNow();
+        c->lag = start > due ? start - due : 0;
+        G_line = c->line;
+
+        switch( c->type ) {
+            case CALL_WRITE:
+                c->error = entry.write( llHdl, c->ch, c->value );
+                break;
+            case CALL_SETBLOCK:
+                c->error = entry.blockWrite( llHdl, c->ch, c->data, c->size,
+                                             &nbr );
+                break;
+            case CALL_SETSTAT:
+                c->error = entry.setStat( llHdl, c->code, c->ch,
+                                          (INT32_OR_64)c->value );
+                break;
+            case CALL_SETSTAT_BLK:
+                blk.size = c->size;
+                blk.data = c->data;
+                c->error = entry.setStat( llHdl, c->code, c->ch,
+                                          (INT32_OR_64)&blk );
+                break;
+        }
+
+        G_line = 0;
+        c->lat = SimNow() - start;
+    }
+
+    /* queued output and timers */
+    SimIdle( SimNow() + (u_int64)G_tailMs * SIM_NS_MS );
+    G_end = SimNow() - G_t0;
+    SimCtrlHook( NULL );
+
+    if( (error = SimClose( &llHdl )) ) {
+        printf("*** driver exit: error 0x%x\n", error);
+        return( error );
+    }
+    G_leak = SimStats()->memBlocks;
+    return( 0 );
+}
+
+/**********************************************************************/
+/** Record a DAC_CTRL_REG write (SIM_CTRL_HOOK)
+ *
+ *  \param at         \IN  time [ns]
+ *  \param unit       \IN  unit
+ *  \param val        \IN  value
+ *  \param lost       \IN  unit faulty
+ */
+static void CtrlHook( u_int64 at, u_int32 unit, u_int32 val, int lost )
+{
+    CTRL w;
+
+    w.at   = at - G_t0;
+    w.unit = unit;
+    w.val  = val;
+    w.line = G_line;
+    w.lost = lost;
+
+    if( CtrlAdd( &G_stream, &w ) ) {
+        printf("*** out of memory, stream stopped\n");
+        SimCtrlHook( NULL );
+    }
+}
+
+/**********************************************************************/
+/** Append a write to a stream
+ *
+ *  \param s          \INOUT stream
+ *  \param w          \IN    write
+ *
+ *  \return 0 or 1 if out of memory
+ */
+static int CtrlAdd( STREAM *s, const CTRL *w )
+{
+    CTRL *p;
+
+    if( s->n == s->max ) {
+        s->max = s->max ? 2 * s->max : 4096;
+        if( (p = realloc( s->w, s->max * sizeof(CTRL) )) == NULL )
+            return(1);
+        s->w = p;
+    }
+    s->w[s->n++] = *w;
+    return(0);
+}
+
+/**********************************************************************/
+/** Save the DAC_CTRL_REG stream
+ *
+ *  One line per write: '<ns> <unit> <value> <line> [lost]', line is
+ *  the trace line of the call that did the write or 0 (timer,
+ *  interrupt).
+ *
+ *  \param name       \IN  file name
+ *  \param trace      \IN  trace file name (comment)
+ *
+ *  \return 0 or 1 on error
+ */
+static int StreamSave( const char *name, const char *trace )
+{
+    FILE    *fp;
+    CTRL    *w;
+    u_int32 k;
+
+    if( (fp = fopen( name, "w" )) == NULL ) {
+        printf("*** can't create %s\n", name);
+        return(1);
+    }
+
+    fprintf( fp, "# z51_replay DAC_CTRL_REG stream of %s, speed-up %u\n",
+             trace, G_speed );
+    fprintf( fp, "# time[ns] unit value line\n" );
+
+    for( k=0; k<G_stream.n; k++ ) {
+        w = &G_stream.w[k];
+        fprintf( fp, "%llu %u 0x%08x %u%s\n", (unsigned long long)w->at,
+                 w->unit, w->val, w->line, w->lost ? " lost" : "" );
+    }
+
+    if( fclose( fp ) ) {
+        printf("*** can't write %s\n", name);
+        return(1);
+    }
+    return(0);
+}
+
+/**********************************************************************/
+/** Read a saved DAC_CTRL_REG stream
+ *
+ *  \param name       \IN  file name
+ *  \param s          \OUT stream
+ *
+ *  \return 0 or 1 on error
+ */
+static int StreamLoad( const char *name, STREAM *s )
+{
+    FILE    *fp;
+    CTRL    w;
+    char    *p;
+    int     nr = 0;
+
+    if( (fp = fopen( name, "r" )) == NULL ) {
+        printf("*** can't open %s\n", name);
+        return(1);
+    }
+
+    memset( s, 0, sizeof(*s) );
+    while( fgets( G_buf, sizeof(G_buf), fp ) ) {
+        nr++;
+        if( (p = strchr( G_buf, '#' )) != NULL )
+            *p = '\0';
+
+        memset( &w, 0, sizeof(w) );
+        w.at = strtoull( G_buf, &p, 0 );
+        if( p == G_buf ) {
+            /* empty line */
+            for( ; *p == ' ' || *p == '\t'; p++ )
+                ;
+            if( *p == '\0' || *p == '\n' || *p == '\r' )
+                continue;
+        }
+
+        if( p == G_buf ) {
+            printf("*** %s:%d: bad write\n", name, nr);
+            fclose( fp );
+            return(1);
+        }
+        w.unit = strtoul( p, &p, 0 );
+        w.val  = strtoul( p, &p, 0 );
+        w.line = strtoul( p, &p, 0 );
+        w.lost = ( strstr( p, "lost" ) != NULL );
+
+        if( CtrlAdd( s, &w ) ) {
+            printf("*** out of memory\n");
+            fclose( fp );
+            return(1);
+        }
+    }
+
+    fclose( fp );
+    return(0);
+}
+
+/**********************************************************************/
+/** Compare the DAC_CTRL_REG streams of two builds
+ *
+ *  Writes are compared in order: a write differs if unit, value or
+ *  'lost' differ. Equal writes may be shifted in time.
+ *
+ *  \param nameA      \IN  stream of build a
+ *  \param nameB      \IN  stream of build b
+ *
+ *  \return 0: equal, 1: different or error
+ */
+static int Compare( const char *nameA, const char *nameB )
+{
+    STREAM  a, b;
+    CTRL    *wa, *wb;
+    u_int32 k, n, diffs = 0, equal = 0, first = 0;
+    double  shift, shiftSum = 0, shiftMax = 0;
+    int     fail;
+
+    if( StreamLoad( nameA, &a ) || StreamLoad( nameB, &b ) )
+        return(1);
+
+    n = a.n < b.n ? a.n : b.n;
+
+    for( k=0; k<n; k++ ) {
+        wa = &a.w[k];
+        wb = &b.w[k];
+
+        if( wa->unit != wb->unit || wa->val != wb->val ||
+            wa->lost != wb->lost ) {
+            if( diffs++ == 0 )
+                first = k;
+            continue;
+        }
+
+        shift = ((double)wb->at - (double)wa->at) / 1000;
+        shiftSum += shift;
+        if( (shift < 0 ? -shift : shift) > (shiftMax < 0 ? -shiftMax :
+                                                           shiftMax) )
+            shiftMax = shift;
+        equal++;
+    }
+
+    printf("\nz51_replay: DAC_CTRL_REG streams\n");
+    printf("    a: %-30s %8u writes, last %12.3f ms\n", nameA, a.n,
+           a.n ? (double)a.w[a.n-1].at / SIM_NS_MS : 0.0);
+    printf("    b: %-30s %8u writes, last %12.3f ms\n\n", nameB, b.n,
+           b.n ? (double)b.w[b.n-1].at / SIM_NS_MS : 0.0);
+
+    printf("differing writes   %8u of %u\n", diffs, n);
+    if( a.n != b.n )
+        printf("writes only in %s   %8u\n", a.n > b.n ? "a" : "b",
+               a.n > b.n ? a.n - b.n : b.n - a.n);
+    if( equal )
+        printf("time shift b-a     avg %10.3f us, max %10.3f us\n",
+               shiftSum / equal, shiftMax);
+
+    if( diffs ) {
+        wa = &a.w[first];
+        wb = &b.w[first];
+        printf("\nfirst difference: write %u\n", first);
+        printf("    a: %12.3f us unit %u 0x%08x line %u%s\n",
+               (double)wa->at / 1000, wa->unit, wa->val, wa->line,
+               wa->lost ? " lost" : "");
+        printf("    b: %12.3f us unit %u 0x%08x line %u%s\n",
+               (double)wb->at / 1000, wb->unit, wb->val, wb->line,
+               wb->lost ? " lost" : "");
+    }
+
+    fail = ( diffs || a.n != b.n );
+    if( G_limitUs && (shiftMax < 0 ? -shiftMax : shiftMax) > G_limitUs ) {
+        printf("*** time shift above %u us\n", G_limitUs);
+        fail = 1;
+    }
+    printf("\n%s\n", fail ? "DIFFERENT" : "equal");
+
+    free( a.w );
+    free( b.w );
+    return( fail );
+}
+
+/**********************************************************************/
+/** Print the latency per call type (and of each call with -v)
+ *
+ *  \param trace      \IN  trace file name
+ */
+static void Report( const char *trace )
+{
+    u_int32 count[CALL_TYPES], errors[CALL_TYPES], k, lost = 0;
+    u_int64 latSum[CALL_TYPES], latMax[CALL_TYPES], lagMax[CALL_TYPES];
+    CALL    *c;
+    int     t;
+
+    memset( count, 0, sizeof(count) );
+    memset( errors, 0, sizeof(errors) );
+    memset( latSum, 0, sizeof(latSum) );
+    memset( latMax, 0, sizeof(latMax) );
+    memset( lagMax, 0, sizeof(lagMax) );
+
+    printf("\nz51_replay: %s, %u calls, speed-up %u%s\n", trace, G_calls,
+           G_speed, G_speed ? "" : " (back to back)");
+    printf("            %u unit(s), IRQ_ENABLE=%u, watchdog %u ms, "
+           "register access %u/%u ns\n\n", G_cfg.units, G_cfg.irqEnable,
+           G_cfg.wdMs, G_cfg.accessNs, G_cfg.ctrlNs);
+
+    if( G_verbose )
+        printf(" line      due [us] call       ch    lag [us] "
+               " latency [us] error\n");
+
+    for( k=0; k<G_calls; k++ ) {
+        c = &G_call[k];
+        t = c->type;
+
+        count[t]++;
+        latSum[t] += c->lat;
+        if( c->lat > latMax[t] )
+            latMax[t] = c->lat;
+        if( c->lag > lagMax[t] )
+            lagMax[t] = c->lag;
+        if( c->error != c->expect )
+            errors[t]++;
+
+        if( G_verbose ) {
+            printf("%5u %13.3f %-10s %2d %11.3f %13.3f ", c->line,
+                   (double)(c->at - G_call[0].at) / 1000, G_callName[t],
+                   c->ch, (double)c->lag / 1000, (double)c->lat / 1000);
+            if( c->error )
+                printf(" 0x%04x%s\n", c->error,
+                       c->error == c->expect ? " (expected)" : "");
+            else
+                printf("     -\n");
+        }
+    }
+    if( G_verbose )
+        printf("\n");
+
+    printf("call        count failed  latency avg/max [us]      "
+           "lag max [us]\n");
+    for( t=0; t<CALL_TYPES; t++ ) {
+        if( count[t] == 0 )
+            continue;
+        printf("%-10s %6u %6u  %12.3f %12.3f  %12.3f\n", G_callName[t],
+               count[t], errors[t], (double)latSum[t] / count[t] / 1000,
+               (double)latMax[t] / 1000, (double)lagMax[t] / 1000);
+    }
+
+    for( k=0; k<G_stream.n; k++ )
+        if( G_stream.w[k].lost )
+            lost++;
+
+    printf("\nDAC_CTRL_REG writes %u (lost %u), replay %.3f ms\n",
+           G_stream.n, lost, (double)G_end / SIM_NS_MS);
+
+    if( G_leak )
+        printf("*** %d memory blocks not freed\n", G_leak);
+}
@@ -0,0 +1,34 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  z51_replay_sim.c
+ *
+ *      \author  ub
+ *
+ *      \brief   Simulated hardware for the trace replay z51_replay
+ *
+ *               The register window and OSS/DESC environment of the soak
+ *               test z51_soak, shared unchanged.
+ *
+ *     Required: -
+ *     \switches -
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../../Z51_SOAK/COM/z51_sim.c"
@@ -0,0 +1,758 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  z51_sim.c
+ *
+ *      \author  ub
+ *
+ *      \brief   Simulated 16Z051 register window and OSS/DESC environment
+ *               for the soak test z51_soak and the trace replay z51_replay
+ *
+ *               Each unit models the registers DAC_CTRL_REG ... DAC_IER_REG
+ *               and the fault behaviour the driver handles: a faulty unit
+ *               asserts DAC_IRQ_REG and ignores DAC_CTRL_REG until
+ *               DAC_SCLK_REG is rewritten; after that the watchdog holds
+ *               the IRQ input for its start-up time. The interrupt is
+ *               delivered whenever it is asserted, enabled and not masked
+ *               by OSS_IrqMaskR().
+ *
+ *               Single threaded, virtual time [ns]. Driver timer and
+ *               interrupt run from SimEvents() and don't nest, like a
+ *               timer softirq and an interrupt on one CPU.
+ *
+ *     Required: -
+ *     \switches -
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <MEN/men_typs.h>
+#include <MEN/maccess.h>
+#include <MEN/oss.h>
+#include <MEN/desc.h>
+#include <MEN/mdis_err.h>
+#include <MEN/ll_defs.h>
+#include <MEN/ll_entry.h>
+#include "z51_sim.h"
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+/* register window (see z51_drv.c) */
+#define WIN_SIZE            256         /* address space of the device */
+#define UNIT_REG_SIZE       0x10        /* registers of a unit */
+#define DAC_CTRL_REG        0x00
+#define DAC_SCLK_REG        0x04
+#define DAC_IRQ_REG         0x08
+#define DAC_IER_REG         0x0c
+#define DAC_IRQ_MASK        0x00000001
+#define DAC_CMD_LOAD_AB     0x300000    /* output A and/or B loaded */
+
+#define TIMERS_MAX          4           /* OSS timers */
+#define KEY_MAX             64          /* descriptor key length */
+
+#define OSH_SIM             ((OSS_HANDLE*)&G_sim)
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** one DAC unit */
+typedef struct {
+    u_int32 ctrl;               /* last DAC_CTRL_REG value */
+    u_int32 sclk;               /* DAC_SCLK_REG */
+    u_int32 ier;                /* DAC_IER_REG */
+    u_int32 irq;                /* DAC_IRQ_REG (fault latched) */
+    int     down;               /* not converting until DAC_SCLK_REG */
+    u_int64 wdAt;               /* watchdog releases the IRQ input */
+} SIM_UNIT;
+
+/** OSS timer */
+typedef struct {
+    void    (*func)( void *arg );
+    void    *arg;
+    u_int64 due;                /* next expiry */
+    u_int64 period;             /* cyclic period or 0 */
+    int     active;
+} SIM_TIMER;
+
+/** OSS semaphore */
+typedef struct {
+    int32   count;
+} SIM_SEM;
+
+/** OSS signal */
+typedef struct {
+    int32   sig;
+} SIM_SIG;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static struct {
+    SIM_CONFIG  cfg;
+    u_int64     now;                    /* virtual time [ns] */
+    u_int8      win[WIN_SIZE];          /* address of the register window */
+    MACCESS     ma;
+    SIM_UNIT    unit[SIM_UNITS_MAX];
+    SIM_FAULT   fault[SIM_FAULTS_MAX];  /* sorted by time */
+    u_int32     faults;
+    u_int32     injected;               /* faults[0..injected-1] happened */
+    SIM_TIMER   *timer[TIMERS_MAX];
+    OSS_IRQ_STATE masked;               /* OSS_IrqMaskR() active */
+    int         inEvents;               /* in SimEvents() */
+    LL_ENTRY    *entry;                 /* driver, NULL while closed */
+    LL_HANDLE   *llHdl;
+    SIM_STATS   stats;
+    SIM_CTRL_HOOK *ctrlHook;            /* DAC_CTRL_REG writes or NULL */
+} G_sim;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void SimEvents( void );
+static int SimIrqLine( void );
+static SIM_UNIT* SimUnit( MACCESS ma, u_int32 offs, u_int32 *regP );
+
+/**********************************************************************/
+/** Reset the simulation
+ *
+ *  All units are down until the driver writes DAC_SCLK_REG; the clock
+ *  starts at 0.
+ *
+ *  \param cfg        \IN  configuration
+ */
+void SimInit( const SIM_CONFIG *cfg )
+{
+    u_int32 i;
+
+    for( i=0; i<TIMERS_MAX; i++ )
+        free( G_sim.timer[i] );
+
+    memset( &G_sim, 0, sizeof(G_sim) );
+    G_sim.cfg = *cfg;
+    if( G_sim.cfg.units > SIM_UNITS_MAX )
+        G_sim.cfg.units = SIM_UNITS_MAX;
+
+    G_sim.ma = (MACCESS)G_sim.win;
+    for( i=0; i<SIM_UNITS_MAX; i++ )
+        G_sim.unit[i].down = 1;
+}
+
+/**********************************************************************/
+/** Schedule a fault
+ *
+ *  Faults in the past are injected on the next event.
+ *
+ *  \param at         \IN  time [ns]
+ *  \param unit       \IN  faulty unit
+ *
+ *  \return 0, ERR_OSS_MEM_ALLOC (too many faults) or ERR_LL_ILL_PARAM
+ */
+int32 SimFaultAdd( u_int64 at, u_int32 unit )
+{
+    u_int32 i;
+
+    if( unit >= G_sim.cfg.units )
+        return( ERR_LL_ILL_PARAM );
+    if( G_sim.faults >= SIM_FAULTS_MAX )
+        return( ERR_OSS_MEM_ALLOC );
+
+    if( at < G_sim.now )
+        at = G_sim.now;
+
+    /* insert sorted, behind all injected faults */
+    for( i=G_sim.faults; i>G_sim.injected && G_sim.fault[i-1].at > at; i-- )
+        G_sim.fault[i] = G_sim.fault[i-1];
+
+    memset( &G_sim.fault[i], 0, sizeof(SIM_FAULT) );
+    G_sim.fault[i].at = at;
+    G_sim.fault[i].unit = unit;
+    G_sim.faults++;
+    return( 0 );
+}
+
+/**********************************************************************/
+/** Get the scripted faults and their events
+ *
+ *  \param nP         \OUT number of faults
+ *
+ *  \return faults
+ */
+SIM_FAULT* SimFaults( u_int32 *nP )
+{
+    *nP = G_sim.faults;
+    return( G_sim.fault );
+}
+
+/**********************************************************************/
+/** Get the counters
+ *
+ *  \return counters since SimInit()
+ */
+SIM_STATS* SimStats( void )
+{
+    return( &G_sim.stats );
+}
+
+/**********************************************************************/
+/** Watch the DAC_CTRL_REG writes
+ *
+ *  The hook is called before the write takes effect. SimInit() removes
+ *  it.
+ *
+ *  \param hook       \IN  hook or NULL
+ */
+void SimCtrlHook( SIM_CTRL_HOOK *hook )
+{
+    G_sim.ctrlHook = hook;
+}
+
+/**********************************************************************/
+/** Initialize the driver on the simulated hardware
+ *
+ *  \param entry      \IN  driver jump table
+ *  \param llHdlP     \OUT low-level handle
+ *
+ *  \return error code of the driver's init
+ */
+int32 SimOpen( LL_ENTRY *entry, LL_HANDLE **llHdlP )
+{
+    static SIM_SEM devSem;
+    static char    irqDummy;
+    int32 error;
+
+    /* device semaphore of the driver's entry points (LL_LOCK_NONE) */
+    devSem.count = 1;
+    error = entry->init( (DESC_SPEC*)&G_sim.cfg, OSH_SIM, &G_sim.ma,
+                         (OSS_SEM_HANDLE*)&devSem,
+                         (OSS_IRQ_HANDLE*)&irqDummy, llHdlP );
+    if( error )
+        return( error );
+
+    G_sim.entry = entry;
+    G_sim.llHdl = *llHdlP;
+    return( 0 );
+}
+
+/**********************************************************************/
+/** Deinitialize the driver
+ *
+ *  No interrupt is delivered while the driver exits.
+ *
+ *  \param llHdlP     \IN  low-level handle, set to NULL
+ *
+ *  \return error code of the driver's exit
+ */
+int32 SimClose( LL_HANDLE **llHdlP )
+{
+    LL_ENTRY *entry = G_sim.entry;
+
+    G_sim.entry = NULL;
+    G_sim.llHdl = NULL;
+    return( entry->exit( llHdlP ) );
+}
+
+/**********************************************************************/
+/** Get the virtual time
+ *
+ *  \return time [ns]
+ */
+u_int64 SimNow( void )
+{
+    return( G_sim.now );
+}
+
+/**********************************************************************/
+/** Let time pass, processing faults, timers and interrupts
+ *
+ *  \param until      \IN  end time [ns]
+ */
+void SimIdle( u_int64 until )
+{
+    u_int64 next;
+    u_int32 i;
+
+    for(;;) {
+        SimEvents();
+        if( G_sim.now >= until )
+            break;
+
+        /* step to the next event */
+        next = until;
+        if( G_sim.injected < G_sim.faults &&
+            G_sim.fault[G_sim.injected].at > G_sim.now &&
+            G_sim.fault[G_sim.injected].at < next )
+            next = G_sim.fault[G_sim.injected].at;
+
+        for( i=0; i<TIMERS_MAX; i++ )
+            if( G_sim.timer[i] && G_sim.timer[i]->active &&
+                G_sim.timer[i]->due > G_sim.now &&
+                G_sim.timer[i]->due < next )
+                next = G_sim.timer[i]->due;
+
+        for( i=0; i<G_sim.cfg.units; i++ )
+            if( G_sim.unit[i].wdAt > G_sim.now && G_sim.unit[i].wdAt < next )
+                next = G_sim.unit[i].wdAt;
+
+        G_sim.now = next;
+    }
+}
+
+/**********************************************************************/
+/** Process due faults, the interrupt and due timers
+ *
+ *  Calls from the interrupt routine or the timer (register accesses)
+ *  only advance time; their events follow on the next call.
+ */
+static void SimEvents( void )
+{
+    SIM_FAULT *f;
+    SIM_TIMER *t;
+    int32     ret;
+    u_int32   i;
+
+    if( G_sim.inEvents )
+        return;
+    G_sim.inEvents = 1;
+
+    /* inject due faults */
+    while( G_sim.injected < G_sim.faults &&
+           G_sim.fault[G_sim.injected].at <= G_sim.now ) {
+        f = &G_sim.fault[G_sim.injected++];
+        G_sim.unit[f->unit].irq = DAC_IRQ_MASK;
+        G_sim.unit[f->unit].down = 1;
+        G_sim.stats.faults++;
+    }
+
+    /* interrupt */
+    if( G_sim.llHdl && !G_sim.masked && SimIrqLine() ) {
+        ret = G_sim.entry->irq( G_sim.llHdl );
+        G_sim.stats.irqs++;
+
+        if( ret == LL_IRQ_DEV_NOT )
+            G_sim.stats.irqsNotMine++;
+        else {
+            for( i=0; i<G_sim.injected; i++ )
+                if( G_sim.fault[i].irqAt == SIM_NEVER )
+                    G_sim.fault[i].irqAt = G_sim.now;
+        }
+    }
+
+    /* timers */
+    for( i=0; i<TIMERS_MAX; i++ ) {
+        t = G_sim.timer[i];
+        if( !t || !t->active || t->due > G_sim.now || G_sim.masked )
+            continue;
+
+        if( t->period )
+            t->due += t->period;
+        else
+            t->active = 0;
+
+        t->func( t->arg );
+        G_sim.stats.timerRuns++;
+    }
+
+    G_sim.inEvents = 0;
+}
+
+/**********************************************************************/
+/** Check the interrupt line
+ *
+ *  \return TRUE if a unit requests an enabled interrupt
+ */
+static int SimIrqLine( void )
+{
+    SIM_UNIT *u;
+    u_int32  i;
+
+    for( i=0; i<G_sim.cfg.units; i++ ) {
+        u = &G_sim.unit[i];
+        if( u->ier && (u->irq || u->wdAt > G_sim.now) )
+            return( TRUE );
+    }
+    return( FALSE );
+}
+
+/**********************************************************************/
+/** Decode a register address
+ *
+ *  An access outside the units is a driver bug and ends the test.
+ *
+ *  \param ma         \IN  unit window of the driver
+ *  \param offs       \IN  register offset
+ *  \param regP       \OUT register offset within the unit
+ *
+ *  \return unit
+ */
+static SIM_UNIT* SimUnit( MACCESS ma, u_int32 offs, u_int32 *regP )
+{
+    u_int32 addr = (u_int32)((volatile u_int8*)ma - G_sim.win) + offs;
+
+    if( addr >= WIN_SIZE || addr / UNIT_REG_SIZE >= G_sim.cfg.units ||
+        (addr & 3) ) {
+        fprintf( stderr, "*** z51_sim: bad register access at 0x%x\n",
+                 addr );
+        exit(1);
+    }
+
+    *regP = addr % UNIT_REG_SIZE;
+    return( &G_sim.unit[addr / UNIT_REG_SIZE] );
+}
+
+/**********************************************************************/
+/** Read a register (MREAD_D32 of the driver)
+ *
+ *  \param ma         \IN  unit window
+ *  \param offs       \IN  register offset
+ *
+ *  \return register value
+ */
+u_int32 Z51_SimRead( MACCESS ma, u_int32 offs )
+{
+    u_int32  reg, val = 0;
+    SIM_UNIT *u = SimUnit( ma, offs, &reg );
+
+    G_sim.now += G_sim.cfg.accessNs;
+
+    switch( reg ) {
+        case DAC_CTRL_REG:  val = u->ctrl;  break;
+        case DAC_SCLK_REG:  val = u->sclk;  break;
+        case DAC_IER_REG:   val = u->ier;   break;
+        case DAC_IRQ_REG:
+            val = (u->irq || u->wdAt > G_sim.now) ? DAC_IRQ_MASK : 0;
+            break;
+    }
+
+    SimEvents();
+    return( val );
+}
+
+/**********************************************************************/
+/** Write a register (MWRITE_D32 of the driver)
+ *
+ *  \param ma         \IN  unit window
+ *  \param offs       \IN  register offset
+ *  \param val        \IN  value
+ */
+void Z51_SimWrite( MACCESS ma, u_int32 offs, u_int32 val )
+{
+    u_int32  reg, n, i;
+    SIM_UNIT *u = SimUnit( ma, offs, &reg );
+
+    n = (u_int32)(u - G_sim.unit);
+
+    switch( reg ) {
+        case DAC_CTRL_REG:
+            G_sim.now += G_sim.cfg.ctrlNs;
+            u->ctrl = val;
+            G_sim.stats.ctrlWrites++;
+
+            if( G_sim.ctrlHook )
+                G_sim.ctrlHook( G_sim.now, n, val, u->down );
+
+            if( u->down ) {
+                G_sim.stats.ctrlLost++;
+                break;
+            }
+
+            if( val & DAC_CMD_LOAD_AB )
+                for( i=0; i<G_sim.injected; i++ )
+                    if( G_sim.fault[i].unit == n &&
+                        G_sim.fault[i].recoverAt == SIM_NEVER )
+                        G_sim.fault[i].recoverAt = G_sim.now;
+            break;
+
+        case DAC_SCLK_REG:
+            G_sim.now += G_sim.cfg.accessNs;
+            u->sclk = val;
+
+            /* restarts conversion and the watchdog */
+            if( u->down ) {
+                u->down = 0;
+                u->wdAt = G_sim.now + (u_int64)G_sim.cfg.wdMs * SIM_NS_MS;
+                G_sim.stats.reinits++;
+            }
+            break;
+
+        case DAC_IRQ_REG:
+            G_sim.now += G_sim.cfg.accessNs;
+            if( val & DAC_IRQ_MASK )
+                u->irq = 0;
+            break;
+
+        case DAC_IER_REG:
+            G_sim.now += G_sim.cfg.accessNs;
+            u->ier = val & DAC_IRQ_MASK;
+
+            if( u->ier && !u->down )
+                for( i=0; i<G_sim.injected; i++ )
+                    if( G_sim.fault[i].unit == n &&
+                        G_sim.fault[i].rearmAt == SIM_NEVER )
+                        G_sim.fault[i].rearmAt = G_sim.now;
+            break;
+    }
+
+    SimEvents();
+}
+
+/*--------------------------------------+
+|   OSS                                 |
++--------------------------------------*/
+char* OSS_Ident( void )
+{
+    return( "OSS z51_sim" );
+}
+
+void* OSS_MemGet( OSS_HANDLE *osHdl, u_int32 size, u_int32 *gotsizeP )
+{
+    void *p = malloc( size ? size : 1 );
+
+    /* OSS memory isn't cleared, make the driver notice */
+    if( p ) {
+        memset( p, 0xa5, size );
+        G_sim.stats.memBlocks++;
+    }
+    *gotsizeP = p ? size : 0;
+    return( p );
+}
+
+int32 OSS_MemFree( OSS_HANDLE *osHdl, void *addr, u_int32 size )
+{
+    free( addr );
+    G_sim.stats.memBlocks--;
+    return( 0 );
+}
+
+void OSS_MemFill( OSS_HANDLE *osHdl, u_int32 size, char *adr, int8 value )
+{
+    memset( adr, value, size );
+}
+
+void OSS_MemCopy( OSS_HANDLE *osHdl, u_int32 size, char *src, char *dest )
+{
+    memmove( dest, src, size );
+}
+
+int32 OSS_Delay( OSS_HANDLE *osHdl, int32 msec )
+{
+    SimIdle( G_sim.now + (u_int64)msec * SIM_NS_MS );
+    return( msec );
+}
+
+int32 OSS_MikroDelay( OSS_HANDLE *osHdl, u_int32 mikroSec )
+{
+    SimIdle( G_sim.now + (u_int64)mikroSec * 1000 );
+    return( 0 );
+}
+
+u_int32 OSS_TickGet( OSS_HANDLE *osHdl )
+{
+    return( (u_int32)(G_sim.now / SIM_NS_MS) );
+}
+
+int32 OSS_TickRateGet( OSS_HANDLE *osHdl )
+{
+    return( 1000 );
+}
+
+OSS_IRQ_STATE OSS_IrqMaskR( OSS_HANDLE *osHdl, OSS_IRQ_HANDLE *irqHdl )
+{
+    OSS_IRQ_STATE old = G_sim.masked;
+
+    G_sim.masked = 1;
+    return( old );
+}
+
+void OSS_IrqRestore( OSS_HANDLE *osHdl, OSS_IRQ_HANDLE *irqHdl,
+                     OSS_IRQ_STATE oldState )
+{
+    G_sim.masked = oldState;
+
+    /* deliver what came in while masked */
+    if( !G_sim.masked )
+        SimEvents();
+}
+
+int32 OSS_SemCreate( OSS_HANDLE *osHdl, int32 semType, int32 initVal,
+                     OSS_SEM_HANDLE **semP )
+{
+    SIM_SEM *s = (SIM_SEM*)malloc( sizeof(SIM_SEM) );
+
+    if( !s )
+        return( ERR_OSS_MEM_ALLOC );
+    s->count = initVal;
+    *semP = (OSS_SEM_HANDLE*)s;
+    return( 0 );
+}
+
+int32 OSS_SemRemove( OSS_HANDLE *osHdl, OSS_SEM_HANDLE **semP )
+{
+    free( *semP );
+    *semP = NULL;
+    return( 0 );
+}
+
+int32 OSS_SemWait( OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem, int32 msec )
+{
+    SIM_SEM *s = (SIM_SEM*)sem;
+
+    /* single threaded: nobody could signal it */
+    if( s->count == 0 )
+        return( ERR_OSS_TIMEOUT );
+    s->count--;
+    return( 0 );
+}
+
+int32 OSS_SemSignal( OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem )
+{
+    ((SIM_SEM*)sem)->count++;
+    return( 0 );
+}
+
+int32 OSS_SigCreate( OSS_HANDLE *osHdl, int32 value, OSS_SIG_HANDLE **sigP )
+{
+    SIM_SIG *s = (SIM_SIG*)malloc( sizeof(SIM_SIG) );
+
+    if( !s )
+        return( ERR_OSS_MEM_ALLOC );
+    s->sig = value;
+    *sigP = (OSS_SIG_HANDLE*)s;
+    return( 0 );
+}
+
+int32 OSS_SigSend( OSS_HANDLE *osHdl, OSS_SIG_HANDLE *sig )
+{
+    u_int32 i;
+
+    G_sim.stats.sigs++;
+    for( i=0; i<G_sim.injected; i++ )
+        if( G_sim.fault[i].sigAt == SIM_NEVER )
+            G_sim.fault[i].sigAt = G_sim.now;
+    return( 0 );
+}
+
+int32 OSS_SigRemove( OSS_HANDLE *osHdl, OSS_SIG_HANDLE **sigP )
+{
+    free( *sigP );
+    *sigP = NULL;
+    return( 0 );
+}
+
+int32 OSS_TimerCreate( OSS_HANDLE *osHdl, void (*funcP)( void *arg ),
+                       void *arg, OSS_TIMER_HANDLE **timerP )
+{
+    SIM_TIMER *t;
+    u_int32   i;
+
+    for( i=0; i<TIMERS_MAX && G_sim.timer[i]; i++ )
+        ;
+    if( i == TIMERS_MAX ||
+        (t = (SIM_TIMER*)calloc( 1, sizeof(SIM_TIMER) )) == NULL )
+        return( ERR_OSS_MEM_ALLOC );
+
+    t->func = funcP;
+    t->arg = arg;
+    G_sim.timer[i] = t;
+    *timerP = (OSS_TIMER_HANDLE*)t;
+    return( 0 );
+}
+
+int32 OSS_TimerRemove( OSS_HANDLE *osHdl, OSS_TIMER_HANDLE **timerP )
+{
+    u_int32 i;
+
+    for( i=0; i<TIMERS_MAX; i++ )
+        if( G_sim.timer[i] == (SIM_TIMER*)*timerP )
+            G_sim.timer[i] = NULL;
+
+    free( *timerP );
+    *timerP = NULL;
+    return( 0 );
+}
+
+int32 OSS_TimerStart( OSS_HANDLE *osHdl, OSS_TIMER_HANDLE *timer,
+                      int32 msec, int32 cyclic )
+{
+    SIM_TIMER *t = (SIM_TIMER*)timer;
+
+    t->due = G_sim.now + (u_int64)msec * SIM_NS_MS;
+    t->period = cyclic ? (u_int64)msec * SIM_NS_MS : 0;
+    t->active = 1;
+    return( 0 );
+}
+
+int32 OSS_TimerStop( OSS_HANDLE *osHdl, OSS_TIMER_HANDLE *timer )
+{
+    ((SIM_TIMER*)timer)->active = 0;
+    return( 0 );
+}
+
+/*--------------------------------------+
+|   DESC                                |
++--------------------------------------*/
+/* the descriptor is the SIM_CONFIG, all other keys are not found */
+
+char* DESC_Ident( void )
+{
+    return( "DESC z51_sim" );
+}
+
+int32 DESC_Init( DESC_SPEC *descSpec, OSS_HANDLE *osHdl,
+                 DESC_HANDLE **descHdlP )
+{
+    *descHdlP = (DESC_HANDLE*)descSpec;
+    return( 0 );
+}
+
+int32 DESC_Exit( DESC_HANDLE **descHdlP )
+{
+    *descHdlP = NULL;
+    return( 0 );
+}
+
+int32 DESC_DbgLevelSet( DESC_HANDLE *descHdl, u_int32 level )
+{
+    return( 0 );
+}
+
+int32 DESC_GetUInt32( DESC_HANDLE *descHdl, u_int32 defVal,
+                      u_int32 *valueP, char *keyFmt, ... )
+{
+    SIM_CONFIG *cfg = (SIM_CONFIG*)descHdl;
+    char       key[KEY_MAX];
+    va_list    ap;
+
+    va_start( ap, keyFmt );
+    vsnprintf( key, sizeof(key), keyFmt, ap );
+    va_end( ap );
+
+    if( strcmp( key, "IRQ_ENABLE" ) == 0 )
+        *valueP = cfg->irqEnable;
+    else if( strcmp( key, "Z51_UNITS" ) == 0 )
+        *valueP = cfg->units;
+    else {
+        *valueP = defVal;
+        return( ERR_DESC_KEY_NOTFOUND );
+    }
+    return( 0 );
+}
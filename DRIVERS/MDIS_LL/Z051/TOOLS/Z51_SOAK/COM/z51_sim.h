@@ -0,0 +1,115 @@
+/***********************  I n c l u d e  -  F i l e  ***********************/
+/*!
+ *        \file  z51_sim.h
+ *
+ *      \author  ub
+ *
+ *       \brief  Simulated 16Z051 hardware and OSS/DESC environment of the
+ *               soak test z51_soak and the trace replay z51_replay
+ *
+ *  The driver is linked into the soak test with the switch Z51_SIM, so
+ *  its register accesses go to Z51_SimRead()/Z51_SimWrite(). Time is
+ *  virtual [ns]: register accesses, OSS_Delay() and OSS_MikroDelay()
+ *  advance it, scripted faults, the driver timer and the interrupt are
+ *  processed as time passes.
+ *
+ *    \switches  -
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z51_SIM_H
+#define _Z51_SIM_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define SIM_UNITS_MAX       8           /**< DAC units of the register window */
+#define SIM_FAULTS_MAX      4096        /**< max. scripted faults per run */
+#define SIM_NS_MS           1000000     /**< ns per ms */
+#define SIM_NEVER           0           /**< time of events not (yet) seen */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** hardware and descriptor configuration of a run */
+typedef struct {
+    u_int32 units;          /**< DAC units (Z51_UNITS) */
+    u_int32 irqEnable;      /**< IRQ_ENABLE */
+    u_int32 wdMs;           /**< watchdog start-up after DAC_SCLK_REG [ms] */
+    u_int32 accessNs;       /**< register access time [ns] */
+    u_int32 ctrlNs;         /**< DAC_CTRL_REG write incl. transfer [ns] */
+} SIM_CONFIG;
+
+/**
+ *  Scripted fault: the unit asserts DAC_IRQ_REG and stops converting
+ *  until the driver rewrites DAC_SCLK_REG. Times are SIM_NEVER until
+ *  the event was seen.
+ */
+typedef struct {
+    u_int64 at;             /**< injection time [ns] */
+    u_int32 unit;           /**< faulty unit */
+    u_int64 irqAt;          /**< first interrupt handled */
+    u_int64 sigAt;          /**< first signal sent */
+    u_int64 recoverAt;      /**< first DAC_CTRL_REG load taking effect */
+    u_int64 rearmAt;        /**< DAC_IER_REG enabled on the working unit */
+} SIM_FAULT;
+
+/** counters of a run */
+typedef struct {
+    u_int32 faults;         /**< faults injected */
+    u_int32 irqs;           /**< interrupt routine calls */
+    u_int32 irqsNotMine;    /**< ... returning LL_IRQ_DEV_NOT */
+    u_int32 sigs;           /**< signals sent */
+    u_int32 ctrlWrites;     /**< DAC_CTRL_REG writes */
+    u_int32 ctrlLost;       /**< ... to a faulty unit */
+    u_int32 reinits;        /**< DAC_SCLK_REG writes to a faulty unit */
+    u_int32 timerRuns;      /**< driver timer calls */
+    int32   memBlocks;      /**< OSS_MemGet() blocks not freed */
+} SIM_STATS;
+
+/** called for each DAC_CTRL_REG write: time [ns], unit, value, unit faulty */
+typedef void SIM_CTRL_HOOK( u_int64 at, u_int32 unit, u_int32 val, int lost );
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+extern void SimInit( const SIM_CONFIG *cfg );
+extern int32 SimFaultAdd( u_int64 at, u_int32 unit );
+extern SIM_FAULT* SimFaults( u_int32 *nP );
+extern SIM_STATS* SimStats( void );
+extern void SimCtrlHook( SIM_CTRL_HOOK *hook );
+extern int32 SimOpen( LL_ENTRY *entry, LL_HANDLE **llHdlP );
+extern int32 SimClose( LL_HANDLE **llHdlP );
+extern u_int64 SimNow( void );
+extern void SimIdle( u_int64 until );
+
+/* register window, called by the driver (Z51_SIM) */
+extern u_int32 Z51_SimRead( MACCESS ma, u_int32 offs );
+extern void Z51_SimWrite( MACCESS ma, u_int32 offs, u_int32 val );
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _Z51_SIM_H */
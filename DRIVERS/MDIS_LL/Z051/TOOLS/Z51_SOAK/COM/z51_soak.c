@@ -0,0 +1,577 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                   Z51_SOAK                         ************
+ ************                                                    ************
+ ****************************************************************************/
+/*!
+ *         \file z51_soak.c
+ *       \author ub
+ *
+ *       \brief  Fault-injection soak test of the Z51 driver
+ *
+ *               Runs the driver on a simulated 16Z051 register window
+ *               (z51_sim.c) and injects scripted hardware faults: the
+ *               unit asserts DAC_IRQ_REG and stops converting until the
+ *               driver reinitializes it. A writer calls the driver's
+ *               write routine at a fixed period, like an application
+ *               doing M_write(). Each fault pattern is compared against a
+ *               run without faults:
+ *
+ *               - recovery: fault until the first output load that takes
+ *                 effect again, rearm: until the interrupt is enabled
+ *               - lost writes: writes that didn't reach the output
+ *               - blocked writes: write periods missed because a write
+ *                 blocked
+ *               - throughput: writes per second that took effect
+ *
+ *               Time is virtual, so a run of many seconds takes
+ *               milliseconds and is reproducible.
+ *
+ *               See usage info.
+ *
+ *     Required: -
+ *     \switches Z51_SIM (set by program.mak)
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/maccess.h>
+#include <MEN/oss.h>
+#include <MEN/desc.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/ll_defs.h>
+#include <MEN/ll_entry.h>
+#include <MEN/z51_drv.h>
+#include "z51_sim.h"
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define PATTERNS_MAX        5           /* baseline + patterns */
+#define SOAK_SIG            1           /* signal for Z51_SET_SIGNAL */
+#define LINE_MAX            128         /* script line length */
+
+/* fault patterns */
+#define PAT_NONE            0           /* baseline */
+#define PAT_SINGLE          1
+#define PAT_BURST           2
+#define PAT_PERIODIC        3
+#define PAT_SCRIPT          4
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** result of one run */
+typedef struct {
+    int         pattern;
+    u_int32     faults;         /* injected */
+    u_int32     irqs;           /* interrupts handled */
+    u_int32     reinits;        /* units restarted */
+    u_int32     recovered;      /* faults recovered */
+    u_int64     recoverSum;     /* [ns] */
+    u_int64     recoverMax;     /* [ns] */
+    u_int64     rearmMax;       /* [ns] */
+    u_int32     unarmed;        /* faults without interrupt enabled again */
+    u_int32     calls;          /* writes */
+    u_int32     errors;         /* ... returning an error */
+    u_int32     lost;           /* ... not reaching the output */
+    u_int32     blocked;        /* write periods missed */
+    u_int64     callMax;        /* longest write [ns] */
+    u_int32     effective;      /* writes that took effect */
+    int32       leak;           /* memory blocks not freed by exit */
+} RESULT;
+
+/** scripted fault */
+typedef struct {
+    u_int64     at;             /* [ns] after start */
+    u_int32     unit;
+} SCRIPT;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage( void );
+static int ScriptLoad( const char *name );
+static int32 Run( int pattern, RESULT *r );
+static void Faults( int pattern, u_int64 t0 );
+static void Writer( LL_ENTRY *entry, LL_HANDLE *llHdl, RESULT *r );
+static void Evaluate( RESULT *r );
+static void Report( RESULT *res, int n );
+
+/* driver (Z51_SIM build of z51_drv.c) */
+extern void __Z51_GetEntry( LL_ENTRY *drvP );
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const char *G_patName[] = {
+    "none", "single", "burst", "periodic", "script"
+};
+
+static SIM_CONFIG G_cfg = {
+    1,          /* units */
+    1,          /* irqEnable */
+    1000,       /* wdMs (worst case) */
+    200,        /* accessNs */
+    1000,       /* ctrlNs */
+};
+
+static u_int32  G_durMs     = 10000;    /* run time */
+static u_int32  G_periodUs  = 100;      /* write period */
+static int32    G_ch        = 2;        /* write channel */
+static u_int32  G_faultUnit = 0;
+static u_int32  G_firstMs   = 1000;     /* first fault after start */
+static u_int32  G_burstN    = 5;
+static u_int32  G_burstUs   = 500;      /* gap between burst faults */
+static u_int32  G_everyMs   = 2000;     /* period of periodic faults */
+static u_int32  G_limitMs   = 0;        /* max. recovery or 0 */
+static int      G_verbose   = 0;
+
+static SCRIPT   G_script[SIM_FAULTS_MAX];
+static u_int32  G_scriptN   = 0;
+
+/********************************* usage ***********************************/
+/** Print program usage
+ */
+static void usage( void )
+{
+    printf("Syntax: z51_soak [<opts>] [<pattern>...]\n");
+    printf("Function: Z51 driver fault-injection soak test on simulated\n");
+    printf("          hardware (virtual time, no device needed)\n");
+    printf("Patterns (default: all, a run without faults is always done):\n");
+    printf("    single             one fault at -t\n");
+    printf("    burst              -n faults -g apart, from -t on\n");
+    printf("    periodic           a fault every -r, from -t on\n");
+    printf("    script             faults of the -s file\n");
+    printf("Options:\n");
+    printf("    -d=<ms>      run time .......................... [10000]\n");
+    printf("    -p=<us>      write period ......................... [100]\n");
+    printf("    -c=<ch>      write channel .......................... [2]\n");
+    printf("    -u=<n>       DAC units (Z51_UNITS) .................. [1]\n");
+    printf("    -i=<0|1>     IRQ_ENABLE ............................. [1]\n");
+    printf("    -f=<unit>    faulty unit ............................ [0]\n");
+    printf("    -t=<ms>      first fault after start ............. [1000]\n");
+    printf("    -n=<n>       faults of a burst ...................... [5]\n");
+    printf("    -g=<us>      gap between burst faults ............. [500]\n");
+    printf("    -r=<ms>      period of periodic faults ........... [2000]\n");
+    printf("    -s=<file>    fault script: lines '<ms> [<unit>]'\n");
+    printf("    -w=<ms>      watchdog start-up time .............. [1000]\n");
+    printf("    -x=<ns>      DAC_CTRL_REG write time ............. [1000]\n");
+    printf("    -a=<ns>      other register access time ........... [200]\n");
+    printf("    -l=<ms>      fail if a fault takes longer to recover\n");
+    printf("    -v           list each fault\n");
+    printf("\n");
+}
+
+/********************************* main ************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+int main( int argc, char *argv[] )
+{
+    RESULT  res[PATTERNS_MAX];
+    int     pat[PATTERNS_MAX];
+    int     i, p, n = 0, fail = 0;
+    u_int32 k;
+
+    for( i=1; i<argc; i++ ) {
+        char *v = argv[i] + 3;
+
+        if( strncmp( argv[i], "-d=", 3 ) == 0 )
+            G_durMs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-p=", 3 ) == 0 )
+            G_periodUs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-c=", 3 ) == 0 )
+            G_ch = strtol( v, NULL, 0 );
+        else if( strncmp( argv[i], "-u=", 3 ) == 0 )
+            G_cfg.units = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-i=", 3 ) == 0 )
+            G_cfg.irqEnable = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-f=", 3 ) == 0 )
+            G_faultUnit = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-t=", 3 ) == 0 )
+            G_firstMs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-n=", 3 ) == 0 )
+            G_burstN = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-g=", 3 ) == 0 )
+            G_burstUs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-r=", 3 ) == 0 )
+            G_everyMs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-s=", 3 ) == 0 ) {
+            if( ScriptLoad( v ) )
+                return(1);
+        }
+        else if( strncmp( argv[i], "-w=", 3 ) == 0 )
+            G_cfg.wdMs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-x=", 3 ) == 0 )
+            G_cfg.ctrlNs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-a=", 3 ) == 0 )
+            G_cfg.accessNs = strtoul( v, NULL, 0 );
+        else if( strncmp( argv[i], "-l=", 3 ) == 0 )
+            G_limitMs = strtoul( v, NULL, 0 );
+        else if( strcmp( argv[i], "-v" ) == 0 )
+            G_verbose = 1;
+        else {
+            for( p=PAT_SINGLE; p<=PAT_SCRIPT; p++ )
+                if( strcmp( argv[i], G_patName[p] ) == 0 )
+                    break;
+
+            if( p > PAT_SCRIPT || n == PATTERNS_MAX - 1 ) {
+                usage();
+                return(1);
+            }
+            pat[1 + n++] = p;
+        }
+    }
+
+    if( G_cfg.units < 1 || G_cfg.units > SIM_UNITS_MAX ||
+        G_faultUnit >= G_cfg.units || G_periodUs < 1 || G_durMs < 1 ||
+        G_everyMs < 1 ) {
+        usage();
+        return(1);
+    }
+
+    for( k=0; k<G_scriptN; k++ ) {
+        if( G_script[k].unit >= G_cfg.units ) {
+            printf("*** script: no unit %u\n", G_script[k].unit);
+            return(1);
+        }
+    }
+
+    /* default: all patterns */
+    if( n == 0 ) {
+        pat[++n] = PAT_SINGLE;
+        pat[++n] = PAT_BURST;
+        pat[++n] = PAT_PERIODIC;
+        if( G_scriptN )
+            pat[++n] = PAT_SCRIPT;
+    }
+    pat[0] = PAT_NONE;
+
+    for( i=0; i<=n; i++ ) {
+        if( Run( pat[i], &res[i] ) )
+            return(1);
+
+        if( res[i].errors || res[i].leak )
+            fail = 1;
+        if( G_limitMs && res[i].faults &&
+            (res[i].recovered < res[i].faults ||
+             res[i].recoverMax > (u_int64)G_limitMs * SIM_NS_MS) )
+            fail = 1;
+    }
+
+    Report( res, n + 1 );
+    return( fail );
+}
+
+/**********************************************************************/
+/** Read the fault script
+ *
+ *  \param name       \IN  file name
+ *
+ *  \return 0 or 1 on error
+ */
+static int ScriptLoad( const char *name )
+{
+    FILE    *fp;
+    char    line[LINE_MAX], *p;
+    double  ms;
+    int     nr = 0;
+
+    if( (fp = fopen( name, "r" )) == NULL ) {
+        printf("*** can't open %s\n", name);
+        return(1);
+    }
+
+    while( fgets( line, sizeof(line), fp ) ) {
+        nr++;
+        if( (p = strchr( line, '#' )) != NULL )
+            *p = '\0';
+
+        ms = strtod( line, &p );
+        if( p == line ) {
+            /* empty line */
+            for( ; *p == ' ' || *p == '\t'; p++ )
+                ;
+            if( *p == '\0' || *p == '\n' || *p == '\r' )
+                continue;
+        }
+
+        if( p == line || ms < 0 || G_scriptN == SIM_FAULTS_MAX ) {
+            printf("*** %s:%d: bad or too many faults\n", name, nr);
+            fclose( fp );
+            return(1);
+        }
+
+        G_script[G_scriptN].at = (u_int64)(ms * SIM_NS_MS);
+        G_script[G_scriptN].unit = strtoul( p, NULL, 0 );
+        G_scriptN++;
+    }
+
+    fclose( fp );
+    return(0);
+}
+
+/**********************************************************************/
+/** Run the driver with one fault pattern
+ *
+ *  The first write initializes the DAC and isn't measured.
+ *
+ *  \param pattern    \IN  PAT_xxx
+ *  \param r          \OUT result
+ *
+ *  \return 0 or driver error
+ */
+static int32 Run( int pattern, RESULT *r )
+{
+    LL_ENTRY  entry;
+    LL_HANDLE *llHdl;
+    SIM_STATS start;
+    int32     error;
+
+    memset( r, 0, sizeof(*r) );
+    r->pattern = pattern;
+
+    SimInit( &G_cfg );
+    __Z51_GetEntry( &entry );
+
+    if( (error = SimOpen( &entry, &llHdl )) ) {
+        printf("*** driver init: error 0x%x\n", error);
+        return( error );
+    }
+
+    if( (error = entry.setStat( llHdl, Z51_SET_SIGNAL, 0, SOAK_SIG )) ||
+        (error = entry.write( llHdl, G_ch, 0 )) ) {
+        printf("*** driver setup (ch %d): error 0x%x\n", G_ch, error);
+        SimClose( &llHdl );
+        return( error );
+    }
+
+    start = *SimStats();
+    Faults( pattern, SimNow() );
+    Writer( &entry, llHdl, r );
+
+    r->faults  = SimStats()->faults;
+    r->irqs    = SimStats()->irqs - start.irqs;
+    r->reinits = SimStats()->reinits - start.reinits;
+    Evaluate( r );
+
+    if( (error = SimClose( &llHdl )) ) {
+        printf("*** driver exit: error 0x%x\n", error);
+        return( error );
+    }
+    r->leak = SimStats()->memBlocks;
+    return( 0 );
+}
+
+/**********************************************************************/
+/** Schedule the faults of a pattern
+ *
+ *  \param pattern    \IN  PAT_xxx
+ *  \param t0         \IN  start time [ns]
+ */
+static void Faults( int pattern, u_int64 t0 )
+{
+    u_int64 first = t0 + (u_int64)G_firstMs * SIM_NS_MS;
+    u_int64 end = t0 + (u_int64)G_durMs * SIM_NS_MS;
+    u_int64 t;
+    u_int32 k;
+
+    switch( pattern ) {
+        case PAT_SINGLE:
+            SimFaultAdd( first, G_faultUnit );
+            break;
+
+        case PAT_BURST:
+            for( k=0; k<G_burstN; k++ )
+                SimFaultAdd( first + (u_int64)k * G_burstUs * 1000,
+                             G_faultUnit );
+            break;
+
+        case PAT_PERIODIC:
+            for( t=first; t<end; t+=(u_int64)G_everyMs * SIM_NS_MS )
+                if( SimFaultAdd( t, G_faultUnit ) )
+                    break;
+            break;
+
+        case PAT_SCRIPT:
+            for( k=0; k<G_scriptN; k++ )
+                SimFaultAdd( t0 + G_script[k].at, G_script[k].unit );
+            break;
+    }
+}
+
+/**********************************************************************/
+/** Write at a fixed period for the run time
+ *
+ *  A write that blocks longer than a period makes the writer skip the
+ *  periods it missed, like a control loop.
+ *
+ *  \param entry      \IN  driver
+ *  \param llHdl      \IN  low-level handle
+ *  \param r          \OUT write counters
+ */
+static void Writer( LL_ENTRY *entry, LL_HANDLE *llHdl, RESULT *r )
+{
+    u_int64 period = (u_int64)G_periodUs * 1000;
+    u_int64 due = SimNow();
+    u_int64 end = due + (u_int64)G_durMs * SIM_NS_MS;
+    u_int64 t, missed;
+    u_int32 lost;
+
+    while( due < end ) {
+        SimIdle( due );
+
+        t = SimNow();
+        lost = SimStats()->ctrlLost;
+
+        if( entry->write( llHdl, G_ch, (r->calls * 0x1001) & 0xffff ) )
+            r->errors++;
+        r->calls++;
+
+        if( SimStats()->ctrlLost != lost )
+            r->lost++;
+        else
+            r->effective++;
+
+        t = SimNow() - t;
+        if( t > r->callMax )
+            r->callMax = t;
+
+        /* periods that started while writing were missed */
+        missed = (SimNow() - due + period - 1) / period;
+        if( missed > 1 )
+            r->blocked += (u_int32)(missed - 1);
+        due += (missed ? missed : 1) * period;
+    }
+}
+
+/**********************************************************************/
+/** Evaluate the faults of a run
+ *
+ *  \param r          \INOUT result
+ */
+static void Evaluate( RESULT *r )
+{
+    SIM_FAULT *f;
+    u_int32   n, i;
+    u_int64   d;
+
+    f = SimFaults( &n );
+
+    for( i=0; i<n; i++, f++ ) {
+        if( G_verbose ) {
+            printf("%-8s fault %3u at %10.3f ms unit %u:",
+                   G_patName[r->pattern], i,
+                   (double)f->at / SIM_NS_MS, f->unit);
+            if( f->irqAt )
+                printf(" irq +%.3f", (double)(f->irqAt - f->at) / SIM_NS_MS);
+            if( f->sigAt )
+                printf(" sig +%.3f", (double)(f->sigAt - f->at) / SIM_NS_MS);
+            if( f->recoverAt )
+                printf(" recover +%.3f",
+                       (double)(f->recoverAt - f->at) / SIM_NS_MS);
+            if( f->rearmAt )
+                printf(" rearm +%.3f",
+                       (double)(f->rearmAt - f->at) / SIM_NS_MS);
+            printf(" [ms]\n");
+        }
+
+        if( f->recoverAt != SIM_NEVER ) {
+            d = f->recoverAt - f->at;
+            r->recovered++;
+            r->recoverSum += d;
+            if( d > r->recoverMax )
+                r->recoverMax = d;
+        }
+
+        if( f->rearmAt != SIM_NEVER ) {
+            d = f->rearmAt - f->at;
+            if( d > r->rearmMax )
+                r->rearmMax = d;
+        }
+        else
+            r->unarmed++;
+    }
+}
+
+/**********************************************************************/
+/** Print the report
+ *
+ *  \param res        \IN  results, baseline first
+ *  \param n          \IN  number of results
+ */
+static void Report( RESULT *res, int n )
+{
+    double base, rate;
+    RESULT *r;
+    int    i;
+
+    base = res[0].effective * 1000.0 / G_durMs;
+
+    printf("\nz51_soak: %u unit(s), channel %d, write period %u us, "
+           "run %u ms\n", G_cfg.units, G_ch, G_periodUs, G_durMs);
+    printf("          IRQ_ENABLE=%u, watchdog %u ms, register access "
+           "%u/%u ns\n\n", G_cfg.irqEnable, G_cfg.wdMs, G_cfg.accessNs,
+           G_cfg.ctrlNs);
+
+    printf("pattern  faults irqs reinit  recovery avg/max [ms] "
+           "rearm [ms]   lost blocked call [ms]  writes/s  loss\n");
+
+    for( i=0; i<n; i++ ) {
+        r = &res[i];
+        rate = r->effective * 1000.0 / G_durMs;
+
+        printf("%-8s %6u %4u %6u ", G_patName[r->pattern], r->faults,
+               r->irqs, r->reinits);
+
+        if( r->recovered )
+            printf(" %9.3f %9.3f%s", (double)r->recoverSum / r->recovered /
+                   SIM_NS_MS, (double)r->recoverMax / SIM_NS_MS,
+                   r->recovered < r->faults ? "+" : " ");
+        else
+            printf(" %9s %9s ", "-", r->faults ? "never" : "-");
+
+        if( r->faults && !r->unarmed )
+            printf("  %9.3f", (double)r->rearmMax / SIM_NS_MS);
+        else
+            printf("  %9s", r->faults ? "never" : "-");
+
+        printf(" %6u %7u %9.3f %9.0f %4.1f%%\n", r->lost, r->blocked,
+               (double)r->callMax / SIM_NS_MS, rate,
+               base > 0 ? 100.0 * (1.0 - rate / base) : 0.0);
+
+        if( r->errors )
+            printf("*** %u writes returned an error\n", r->errors);
+        if( r->leak )
+            printf("*** %d memory blocks not freed\n", r->leak);
+    }
+
+    printf("\n'+': not all faults recovered, 'loss': throughput against "
+           "'none'\n");
+}
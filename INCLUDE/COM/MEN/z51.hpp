@@ -0,0 +1,396 @@
+/***********************  I n c l u d e  -  F i l e  ***********************/
+/*!
+ *        \file  z51.hpp
+ *
+ *      \author  ub
+ *
+ *       \brief  Header-only C++17 interface to the Z51 driver
+ *
+ *  Wraps the MDIS calls for Z51 devices in RAII handles (z51::Path owns
+ *  an MDIS path, z51::Channel and z51::Group a path set to one channel):
+ *
+ *  \code
+ *  z51::Channel<0> a( "dac_1" );       // output A, 16-bit values
+ *  z51::Channel<2> ab( "dac_1" );      // outputs A and B, packed at once
+ *
+ *  a.write( 0x8000 );
+ *  ab.write( 0x1000, 0xf000 );         // same as M_write( (0xf000 << 16) | 0x1000 )
+ *
+ *  std::vector<u_int16> wave( 1024 );
+ *  a.setSamplePeriod( 100 );
+ *  a.write( wave );                    // one M_setblock(), no copy
+ *  \endcode
+ *
+ *  The channel index is a template parameter, so the value type and the
+ *  packing of channels driving both outputs are resolved at compile time.
+ *  Each channel object owns its own MDIS path with the channel selected
+ *  once at construction; every write is a single MDIS call. Errors are
+ *  reported as z51::Error exceptions.
+ *
+ *    \switches  none
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z51_HPP
+#define _Z51_HPP
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/usr_oss.h>
+#include <MEN/z51_drv.h>
+
+namespace z51 {
+
+/** MDIS error of a Z51 device */
+class Error : public std::runtime_error {
+public:
+    Error( const std::string &what, int32 code )
+        : std::runtime_error( what + ": " + M_errstring( code ) ),
+          code_( code ) {}
+
+    /** MDIS error code */
+    int32 code() const { return code_; }
+
+private:
+    int32 code_;
+};
+
+/** Throw the error of the last failed MDIS call */
+[[noreturn]] inline void fail( const char *what )
+{
+    throw Error( what, UOS_ErrnoGet() );
+}
+
+/** Compose the value of a channel driving outputs A and B */
+constexpr u_int32 pack( u_int16 a, u_int16 b ) noexcept
+{
+    return ( static_cast<u_int32>( b ) << 16 ) | a;
+}
+
+/**
+ *  Value written to the DAC for input \a value, computed like the driver
+ *  (y = offset + value * gain / 0xffff, unchanged if gain is 0)
+ */
+constexpr u_int16 calibrate( u_int16 value, u_int32 offset,
+                             u_int32 gain ) noexcept
+{
+    return gain == 0 ? value
+                     : static_cast<u_int16>(
+                           offset + static_cast<u_int32>( value ) * gain /
+                           0xffff );
+}
+
+/**
+ *  View of contiguous values (the part of C++20 std::span needed here).
+ *  Converts implicitly from arrays and from containers with data() and
+ *  size(), e.g. std::vector and std::array.
+ */
+template<class T>
+class Span {
+    template<class C>
+    using ContainerOf = std::enable_if_t<
+        std::is_convertible_v<
+            std::remove_pointer_t<decltype( std::declval<C&>().data() )>(*)[],
+            T(*)[]>>;
+
+public:
+    constexpr Span() noexcept : data_( nullptr ), size_( 0 ) {}
+    constexpr Span( T *data, std::size_t size ) noexcept
+        : data_( data ), size_( size ) {}
+
+    template<std::size_t N>
+    constexpr Span( T (&arr)[N] ) noexcept : data_( arr ), size_( N ) {}
+
+    template<class C, class = ContainerOf<C>>
+    constexpr Span( C &c ) noexcept : data_( c.data() ), size_( c.size() ) {}
+
+    constexpr T *data() const noexcept { return data_; }
+    constexpr std::size_t size() const noexcept { return size_; }
+    constexpr std::size_t size_bytes() const noexcept
+    {
+        return size_ * sizeof( T );
+    }
+    constexpr T *begin() const noexcept { return data_; }
+    constexpr T *end() const noexcept { return data_ + size_; }
+    constexpr T &operator[]( std::size_t i ) const noexcept
+    {
+        return data_[i];
+    }
+
+private:
+    T           *data_;
+    std::size_t size_;
+};
+
+/** MDIS path to a Z51 device, closed on destruction */
+class Path {
+public:
+    /** Closed path */
+    Path() noexcept : path_( -1 ) {}
+
+    /** Opens device \a name */
+    explicit Path( const char *name ) : path_( M_open( name ) )
+    {
+        if( path_ < 0 )
+            throw Error( std::string( "open " ) + name, UOS_ErrnoGet() );
+    }
+
+    Path( Path &&other ) noexcept
+        : path_( std::exchange( other.path_, -1 ) ) {}
+
+    Path& operator=( Path &&other ) noexcept
+    {
+        if( this != &other ) {
+            close();
+            path_ = std::exchange( other.path_, -1 );
+        }
+        return *this;
+    }
+
+    Path( const Path& ) = delete;
+    Path& operator=( const Path& ) = delete;
+
+    ~Path() { close(); }
+
+    /** Close the path (no-op if closed) */
+    void close() noexcept
+    {
+        if( path_ >= 0 ) {
+            M_close( path_ );
+            path_ = -1;
+        }
+    }
+
+    /** MDIS path, e.g. for calls not wrapped here */
+    MDIS_PATH path() const noexcept { return path_; }
+
+    explicit operator bool() const noexcept { return path_ >= 0; }
+
+    void setstat( int32 code, INT32_OR_64 value ) const
+    {
+        if( M_setstat( path_, code, value ) )
+            fail( "setstat" );
+    }
+
+    int32 getstat( int32 code ) const
+    {
+        int32 value;
+
+        if( M_getstat( path_, code, &value ) )
+            fail( "getstat" );
+        return value;
+    }
+
+    /** Block SetStat, e.g. Z51_BLK_STATUS */
+    template<class T>
+    void setblock( int32 code, const T &data ) const
+    {
+        M_SG_BLOCK blk;
+
+        blk.size = sizeof( T );
+        blk.data = const_cast<T*>( &data );
+        setstat( code, reinterpret_cast<INT32_OR_64>( &blk ) );
+    }
+
+    /** Block GetStat, returns the number of bytes filled in */
+    template<class T>
+    int32 getblock( int32 code, T &data ) const
+    {
+        M_SG_BLOCK blk;
+
+        blk.size = sizeof( T );
+        blk.data = &data;
+        if( M_getstat( path_, code, reinterpret_cast<int32*>( &blk ) ) )
+            fail( "getstat" );
+        return blk.size;
+    }
+
+    /** Select the current channel of this path */
+    void channel( int32 ch ) const { setstat( M_MK_CH_CURRENT, ch ); }
+
+    /** M_write() on the current channel */
+    void write( int32 value ) const
+    {
+        if( M_write( path_, value ) < 0 )
+            fail( "write" );
+    }
+
+    /** M_setblock() on the current channel */
+    void writeBlock( const void *buf, std::size_t size ) const
+    {
+        if( M_setblock( path_, static_cast<const u_int8*>( buf ),
+                        static_cast<int32>( size ) ) < 0 )
+            fail( "setblock" );
+    }
+
+private:
+    MDIS_PATH   path_;
+};
+
+/**
+ *  Channel \a Ch of a Z51 device: 3 * unit + 0 for output A, + 1 for
+ *  output B and + 2 for both outputs of a unit (see Z51_CH()).
+ */
+template<int32 Ch>
+class Channel {
+    static_assert( Ch >= 0 && Ch < Z51_UNITS_MAX * 3,
+                   "no such Z51 channel" );
+
+public:
+    static constexpr int32 index = Ch;
+    static constexpr int32 unit  = Ch / 3;
+    /** drives outputs A and B with one packed value */
+    static constexpr bool  pair  = ( Ch % 3 == 2 );
+
+    /** input value: 16 bits, or (B << 16) | A for pair channels */
+    using value_type  = std::conditional_t<pair, u_int32, u_int16>;
+    /** input value for the Z51_FMT_S16 block format */
+    using signed_type = std::make_signed_t<value_type>;
+
+    /** Opens device \a name for this channel */
+    explicit Channel( const char *name ) : dev_( name ) { dev_.channel( Ch ); }
+
+    /** Takes over an open path and selects this channel */
+    explicit Channel( Path &&path ) : dev_( std::move( path ) )
+    {
+        dev_.channel( Ch );
+    }
+
+    /** Path of the channel, e.g. for further status calls */
+    const Path &path() const noexcept { return dev_; }
+
+    /** Output a value */
+    void write( value_type value ) const
+    {
+        dev_.write( static_cast<int32>( value ) );
+    }
+
+    /** Output A and B at once (pair channels) */
+    template<bool P = pair, std::enable_if_t<P, int> = 0>
+    void write( u_int16 a, u_int16 b ) const
+    {
+        dev_.write( static_cast<int32>( pack( a, b ) ) );
+    }
+
+    /** Block write of \a values, passed to the driver without copy */
+    void write( Span<const value_type> values ) const
+    {
+        dev_.writeBlock( values.data(), values.size_bytes() );
+    }
+
+    /** Block write of signed values (block format Z51_FMT_S16) */
+    void write( Span<const signed_type> values ) const
+    {
+        dev_.writeBlock( values.data(), values.size_bytes() );
+    }
+
+    /*
+     * Per output settings; pair channels use the settings of their A
+     * channel, so these are only available on single output channels.
+     */
+    template<bool P = pair, std::enable_if_t<!P, int> = 0>
+    void setCalibration( u_int16 offset, u_int16 gain ) const
+    {
+        dev_.setstat( Z51_OFFSET, offset );
+        dev_.setstat( Z51_GAIN, gain );
+    }
+
+    template<bool P = pair, std::enable_if_t<!P, int> = 0>
+    void setPowerdown( int32 mode ) const
+    {
+        dev_.setstat( Z51_POWERDOWN, mode );
+    }
+
+    template<bool P = pair, std::enable_if_t<!P, int> = 0>
+    void setSamplePeriod( u_int32 us ) const
+    {
+        dev_.setstat( Z51_SAMPLE_PERIOD, us );
+    }
+
+    template<bool P = pair, std::enable_if_t<!P, int> = 0>
+    void setInterpolation( int32 mode, u_int32 factor ) const
+    {
+        dev_.setstat( Z51_INTERP_MODE, mode );
+        dev_.setstat( Z51_INTERP_FACTOR, factor );
+    }
+
+    template<bool P = pair, std::enable_if_t<!P, int> = 0>
+    void setFormat( int32 format ) const
+    {
+        dev_.setstat( Z51_BLK_FORMAT, format );
+    }
+
+private:
+    Path  dev_;
+};
+
+/**
+ *  Group channel of a device with \a Units units: drives both outputs of
+ *  all units (see Z51_CH_GROUP()). A frame holds (B << 16) | A per unit.
+ */
+template<int32 Units>
+class Group {
+    static_assert( Units > 1 && Units <= Z51_UNITS_MAX,
+                   "group channel needs 2..Z51_UNITS_MAX units" );
+
+public:
+    static constexpr int32 index = Z51_CH_GROUP( Units );
+
+    using frame_type = std::array<u_int32, Units>;
+    static_assert( sizeof( frame_type ) == Units * sizeof( u_int32 ),
+                   "padded frame" );
+
+    explicit Group( const char *name ) : dev_( name ) { dev_.channel( index ); }
+
+    explicit Group( Path &&path ) : dev_( std::move( path ) )
+    {
+        dev_.channel( index );
+    }
+
+    /** Path of the channel, e.g. for further status calls */
+    const Path &path() const noexcept { return dev_; }
+
+    /** Output (B << 16) | A on all units */
+    void write( u_int32 value ) const
+    {
+        dev_.write( static_cast<int32>( value ) );
+    }
+
+    /** Block write of frames, passed to the driver without copy */
+    void write( Span<const frame_type> frames ) const
+    {
+        dev_.writeBlock( frames.data(), frames.size_bytes() );
+    }
+
+private:
+    Path  dev_;
+};
+
+} /* namespace z51 */
+
+#endif /* _Z51_HPP */
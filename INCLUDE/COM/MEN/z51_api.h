@@ -0,0 +1,175 @@
+/***********************  I n c l u d e  -  F i l e  ***********************/
+/*!
+ *        \file  z51_api.h
+ *
+ *      \author  ub
+ *
+ *       \brief  Header file for the Z51 user library containing
+ *               helper functions for applications of the Z51 driver
+ *
+ *    \switches  -
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z51_API_H
+#define _Z51_API_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+/** worst case size of Z51_RleEncode() output for \a n values [bytes] */
+#define Z51_RLE_MAXSIZE(n)      (3 * (n))
+
+/** number of channels a submission queue handles (incl. group channel) */
+#define Z51_MPSC_CH_MAX         (Z51_UNITS_MAX * 3 + 1)
+
+/** max. number of layers of a mixer */
+#define Z51_MIX_LAYERS_MAX      16
+/** layer gain 1.0 (gains are signed, -2.0..+2.0) */
+#define Z51_MIX_GAIN_ONE        0x4000
+
+/** \name mixer layer types (Z51_MIX_LAYER.type) */
+/**@{*/
+#define Z51_MIX_BUFFER          0   /**< values from a buffer */
+#define Z51_MIX_DDS             1   /**< sine generator */
+#define Z51_MIX_RAMP            2   /**< linear ramp, then constant */
+#define Z51_MIX_NOISE           3   /**< uniform noise, e.g. dither */
+/**@}*/
+
+/** default spin tail of a pacer [ns] (covers the wake-up latency of sleep) */
+#define Z51_PACE_SPIN_DEFAULT   100000
+
+/** max. devices of a safe state trigger */
+#define Z51_SAFE_DEV_MAX        64
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** multi-producer submission queue (see Z51_MpscCreate()) */
+typedef struct Z51_MPSC Z51_MPSC;
+
+/** channel update, as returned by Z51_MpscDrain() */
+typedef struct {
+    int32       ch;             /**< channel */
+    u_int32     value;          /**< value as for M_write() */
+    u_int32     seq;            /**< submission order (free running) */
+    u_int32     deadline;       /**< UOS_MsecTimerGet() time or 0 */
+} Z51_MPSC_ENTRY;
+
+/** mixer (see Z51_MixerCreate()) */
+typedef struct Z51_MIXER Z51_MIXER;
+
+/** layer of a mixer, signed values (-0x8000..0x7fff) */
+typedef struct {
+    int32       type;           /**< Z51_MIX_xxx */
+    int16       gain;           /**< gain, Z51_MIX_GAIN_ONE is 1.0 */
+    int16       from;           /**< RAMP: start value */
+    int16       to;             /**< RAMP: end value */
+    const int16 *buf;           /**< BUFFER: values */
+    u_int32     len;            /**< BUFFER: values in buf,
+                                     RAMP: ramp length [values] */
+    u_int32     loop;           /**< BUFFER: repeat buf (1) or once (0) */
+    u_int32     step;           /**< DDS: phase step per value
+                                     (2^32 is one period per value) */
+    u_int32     phase;          /**< DDS: start phase, NOISE: seed */
+} Z51_MIX_LAYER;
+
+/** pacer (see Z51_PaceCreate()) */
+typedef struct Z51_PACE Z51_PACE;
+
+/** safe state trigger (see Z51_SafeCreate()) */
+typedef struct Z51_SAFE Z51_SAFE;
+
+/** counters of a pacer */
+typedef struct {
+    u_int32     periods;        /**< Z51_PaceWait() calls */
+    u_int32     overruns;       /**< ... called after the deadline */
+    u_int32     missed;         /**< periods skipped after overruns */
+    u_int32     sleeps;         /**< waits that slept before spinning */
+    u_int32     oversleeps;     /**< ... woke after the deadline */
+    u_int32     lateMax;        /**< max. delay after the deadline [ns] */
+    u_int64     lateSum;        /**< sum of delays after the deadline
+                                     (waits without overrun) [ns] */
+} Z51_PACE_STATS;
+
+/** counters of a submission queue */
+typedef struct {
+    u_int32     puts;           /**< entries taken from the queue */
+    u_int32     full;           /**< entries rejected, queue full */
+    u_int32     coalesced;      /**< entries replaced by a newer one */
+    u_int32     expired;        /**< entries dropped, deadline passed */
+    u_int32     writes;         /**< M_write()/M_setblock() calls */
+} Z51_MPSC_STATS;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+/* encoded block format (Z51_FMT_RLE) */
+extern int32 Z51_RleEncode( const u_int16 *src, u_int32 n,
+                            u_int8 *dst, u_int32 dstSize );
+extern int32 Z51_RleDecode( const u_int8 *src, u_int32 size,
+                            u_int16 *dst, u_int32 max );
+
+/* engineering units */
+extern void Z51_UnitsToCode( const float *src, u_int32 n, float lo, float hi,
+                             u_int16 *dst );
+extern void Z51_UnitsToCodeRef( const float *src, u_int32 n, float lo,
+                                float hi, u_int16 *dst );
+
+/* multi-producer submission queue */
+extern Z51_MPSC* Z51_MpscCreate( u_int32 slots, u_int32 units );
+extern void Z51_MpscDelete( Z51_MPSC *q );
+extern int32 Z51_MpscPut( Z51_MPSC *q, int32 ch, u_int32 value );
+extern int32 Z51_MpscPutAt( Z51_MPSC *q, int32 ch, u_int32 value,
+                            u_int32 deadline );
+extern int32 Z51_MpscDrain( Z51_MPSC *q, u_int32 now, Z51_MPSC_ENTRY *out );
+extern int32 Z51_MpscDispatch( Z51_MPSC *q, MDIS_PATH path );
+extern void Z51_MpscStats( Z51_MPSC *q, Z51_MPSC_STATS *st );
+
+/* waveform mixer */
+extern Z51_MIXER* Z51_MixerCreate( void );
+extern void Z51_MixerDelete( Z51_MIXER *m );
+extern int32 Z51_MixerAdd( Z51_MIXER *m, const Z51_MIX_LAYER *layer );
+extern int32 Z51_MixerRemove( Z51_MIXER *m, int32 id );
+extern int32 Z51_MixerGain( Z51_MIXER *m, int32 id, int16 gain );
+extern int32 Z51_MixerRender( Z51_MIXER *m, int16 *dst, u_int32 n );
+
+/* output pacing */
+extern u_int64 Z51_NsecTimerGet( void );
+extern Z51_PACE* Z51_PaceCreate( u_int64 periodNs, u_int32 spinNs );
+extern void Z51_PaceDelete( Z51_PACE *p );
+extern void Z51_PaceReset( Z51_PACE *p );
+extern int32 Z51_PaceWait( Z51_PACE *p );
+extern void Z51_PaceStats( Z51_PACE *p, Z51_PACE_STATS *st );
+
+/* safe state of several devices */
+extern Z51_SAFE* Z51_SafeCreate( const MDIS_PATH *path, u_int32 n );
+extern void Z51_SafeDelete( Z51_SAFE *s );
+extern int32 Z51_SafeFire( Z51_SAFE *s, u_int64 *nsP );
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _Z51_API_H */
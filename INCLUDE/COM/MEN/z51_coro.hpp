@@ -0,0 +1,388 @@
+/***********************  I n c l u d e  -  F i l e  ***********************/
+/*!
+ *        \file  z51_coro.hpp
+ *
+ *      \author  ub
+ *
+ *       \brief  C++20 coroutine wrapper for asynchronous Z51 block writes
+ *
+ *  Exposes asynchronous block writes (Z51_BLK_ASYNC_SUBMIT) as awaitable
+ *  objects, so one thread can keep many Z51 devices fed:
+ *
+ *  \code
+ *  z51::Task feed( z51::Device &dev, const u_int16 *buf, int32 size )
+ *  {
+ *      for(;;) {
+ *          u_int32 ticket = co_await dev.submit( buf, size );
+ *          ...
+ *          co_await dev.complete( ticket );
+ *      }
+ *  }
+ *
+ *  z51::Reactor reactor;
+ *  z51::Device  dev0( reactor, "z51_1", 0 ), dev1( reactor, "z51_2", 2 );
+ *  reactor.spawn( feed( dev0, ... ) );
+ *  reactor.spawn( feed( dev1, ... ) );
+ *  reactor.run();
+ *  \endcode
+ *
+ *  The reactor is single threaded and polls the driver's completion
+ *  counter (Z51_ASYNC_DONE) of all waiting devices. Errors are reported
+ *  as z51::Error exceptions.
+ *
+ *    \switches  none
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z51_CORO_HPP
+#define _Z51_CORO_HPP
+
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <MEN/z51.hpp>
+
+namespace z51 {
+
+class Reactor;
+
+/** Detached coroutine run by a Reactor */
+class Task {
+public:
+    struct promise_type {
+        std::exception_ptr error;
+
+        Task get_return_object()
+        {
+            return Task( std::coroutine_handle<promise_type>::from_promise( *this ) );
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task( Task &&other ) noexcept : h_( std::exchange( other.h_, nullptr ) ) {}
+    Task( const Task& ) = delete;
+    Task& operator=( const Task& ) = delete;
+    ~Task() { if( h_ ) h_.destroy(); }
+
+private:
+    friend class Reactor;
+    explicit Task( std::coroutine_handle<promise_type> h ) : h_( h ) {}
+
+    std::coroutine_handle<promise_type> h_;
+};
+
+/** Single threaded scheduler for Task coroutines */
+class Reactor {
+public:
+    /**
+     *  \param pollMs   sleep time if no waiting coroutine became ready [ms]
+     */
+    explicit Reactor( u_int32 pollMs = 1 ) : pollMs_( pollMs ) {}
+
+    Reactor( const Reactor& ) = delete;
+    Reactor& operator=( const Reactor& ) = delete;
+
+    ~Reactor()
+    {
+        for( auto h : tasks_ )
+            h.destroy();
+    }
+
+    /** Take over a task; it starts running in run() */
+    void spawn( Task &&task )
+    {
+        auto h = std::exchange( task.h_, nullptr );
+        tasks_.push_back( h );
+        ready_.push_back( h );
+    }
+
+    /**
+     *  Run until all tasks have finished. An exception leaving a task is
+     *  rethrown here after the task has been destroyed.
+     */
+    void run()
+    {
+        while( !tasks_.empty() ) {
+            bool progress = !ready_.empty();
+
+            while( !ready_.empty() ) {
+                auto h = ready_.front();
+                ready_.pop_front();
+                h.resume();
+            }
+
+            for( auto it = waits_.begin(); it != waits_.end(); ) {
+                if( it->ready() ) {
+                    ready_.push_back( it->h );
+                    it = waits_.erase( it );
+                    progress = true;
+                }
+                else
+                    ++it;
+            }
+
+            for( auto it = tasks_.begin(); it != tasks_.end(); ) {
+                if( it->done() ) {
+                    std::exception_ptr error = it->promise().error;
+
+                    it->destroy();
+                    it = tasks_.erase( it );
+                    if( error )
+                        std::rethrow_exception( error );
+                }
+                else
+                    ++it;
+            }
+
+            if( !progress )
+                UOS_Delay( pollMs_ );
+        }
+    }
+
+    /** Suspend coroutine \a h until \a ready returns true */
+    void wait( std::coroutine_handle<> h, std::function<bool()> ready )
+    {
+        waits_.push_back( { h, std::move( ready ) } );
+    }
+
+private:
+    struct Wait {
+        std::coroutine_handle<>  h;
+        std::function<bool()>    ready;
+    };
+
+    u_int32                                          pollMs_;
+    std::list<std::coroutine_handle<Task::promise_type>> tasks_;
+    std::list<std::coroutine_handle<>>               ready_;
+    std::list<Wait>                                  waits_;
+};
+
+/** Z51 channel fed by asynchronous block writes */
+class Device {
+public:
+    /**
+     *  Opens the device and selects the channel. Blocks are queued with
+     *  Z51_BLK_ASYNC_SUBMIT, so the device-wide Z51_BLK_ASYNC mode, which
+     *  also applies to M_setblock() on other paths, is left unchanged.
+     *
+     *  \param reactor  reactor of the coroutines using this device
+     *  \param name     device name
+     *  \param ch       output channel (0..2)
+     */
+    Device( Reactor &reactor, const char *name, int32 ch )
+        : reactor_( reactor ), path_( M_open( name ) )
+    {
+        if( path_ < 0 )
+            throw Error( std::string( "open " ) + name, UOS_ErrnoGet() );
+
+        if( M_setstat( path_, M_MK_CH_CURRENT, ch ) ) {
+            int32 code = UOS_ErrnoGet();
+
+            M_close( path_ );
+            throw Error( std::string( "setup " ) + name, code );
+        }
+    }
+
+    Device( const Device& ) = delete;
+    Device& operator=( const Device& ) = delete;
+
+    /** Discards pending blocks and closes the device */
+    ~Device()
+    {
+        M_setstat( path_, Z51_WAVE_STOP, 0 );
+        M_close( path_ );
+    }
+
+    /** MDIS path, e.g. for additional status calls */
+    MDIS_PATH path() const { return path_; }
+
+    class WriteAwaiter;
+
+    /**
+     *  Awaitable queueing of one block, yields the block's ticket. The
+     *  frames are copied behind a Z51_ASYNC_HDR, which returns the ticket
+     *  with the submission.
+     */
+    class SubmitAwaiter {
+    public:
+        SubmitAwaiter( Device &dev, const void *buf, int32 size )
+            : dev_( dev ), blk_( sizeof(Z51_ASYNC_HDR) + size )
+        {
+            std::memcpy( blk_.data() + sizeof(Z51_ASYNC_HDR), buf, size );
+        }
+
+        bool await_ready() { return poll(); }
+
+        void await_suspend( std::coroutine_handle<> h )
+        {
+            dev_.reactor_.wait( h, [this]{ return poll(); } );
+        }
+
+        u_int32 await_resume()
+        {
+            if( error_ )
+                throw Error( "submit", error_ );
+            return ticket_;
+        }
+
+    private:
+        friend class WriteAwaiter;
+
+        /* returns false while the queue is full */
+        bool poll()
+        {
+            M_SG_BLOCK blk;
+
+            blk.size = (int32)blk_.size();
+            blk.data = blk_.data();
+            if( M_getstat( dev_.path_, Z51_BLK_ASYNC_SUBMIT,
+                           reinterpret_cast<int32*>( &blk ) ) ) {
+                error_ = UOS_ErrnoGet();
+                return( error_ != ERR_LL_DEV_BUSY );
+            }
+
+            error_  = 0;
+            ticket_ = reinterpret_cast<Z51_ASYNC_HDR*>( blk_.data() )->ticket;
+            return true;
+        }
+
+        Device                  &dev_;
+        std::vector<u_int8>     blk_;
+        int32                   error_ = 0;
+        u_int32                 ticket_ = 0;
+    };
+
+    /** Awaitable completion of a block */
+    class CompleteAwaiter {
+    public:
+        CompleteAwaiter( Device &dev, u_int32 ticket )
+            : dev_( dev ), ticket_( ticket ) {}
+
+        bool await_ready() { return poll(); }
+
+        void await_suspend( std::coroutine_handle<> h )
+        {
+            dev_.reactor_.wait( h, [this]{ return poll(); } );
+        }
+
+        void await_resume()
+        {
+            if( error_ )
+                throw Error( "complete", error_ );
+        }
+
+    private:
+        friend class WriteAwaiter;
+
+        /* returns false while the block is pending */
+        bool poll()
+        {
+            int32 done;
+
+            if( M_getstat( dev_.path_, Z51_ASYNC_DONE, &done ) ) {
+                error_ = UOS_ErrnoGet();
+                return true;
+            }
+            return Z51_ASYNC_COMPLETED( (u_int32)done, ticket_ );
+        }
+
+        Device      &dev_;
+        u_int32     ticket_;
+        int32       error_ = 0;
+    };
+
+    /** Awaitable queueing and completion of one block */
+    class WriteAwaiter {
+    public:
+        WriteAwaiter( Device &dev, const void *buf, int32 size )
+            : dev_( dev ), submit_( dev, buf, size ), complete_( dev, 0 ) {}
+
+        bool await_ready() { return poll(); }
+
+        void await_suspend( std::coroutine_handle<> h )
+        {
+            dev_.reactor_.wait( h, [this]{ return poll(); } );
+        }
+
+        void await_resume()
+        {
+            submit_.await_resume();
+            complete_.await_resume();
+        }
+
+    private:
+        bool poll()
+        {
+            if( !submitted_ ) {
+                if( !submit_.poll() )
+                    return false;
+                submitted_ = true;
+                if( submit_.error_ )
+                    return true;
+                complete_.ticket_ = submit_.ticket_;
+            }
+            return complete_.poll();
+        }
+
+        Device          &dev_;
+        SubmitAwaiter   submit_;
+        CompleteAwaiter complete_;
+        bool            submitted_ = false;
+    };
+
+    /**
+     *  Queue a block (16-bit frames on channel 0/1, 32-bit on channel 2).
+     *  The buffer is copied, it may be reused at once.
+     */
+    SubmitAwaiter submit( const void *buf, int32 size )
+    {
+        return SubmitAwaiter( *this, buf, size );
+    }
+
+    /** Wait until the block with \a ticket has been output */
+    CompleteAwaiter complete( u_int32 ticket )
+    {
+        return CompleteAwaiter( *this, ticket );
+    }
+
+    /** Queue a block and wait until it has been output */
+    WriteAwaiter write( const void *buf, int32 size )
+    {
+        return WriteAwaiter( *this, buf, size );
+    }
+
+private:
+    Reactor     &reactor_;
+    MDIS_PATH   path_;
+};
+
+} /* namespace z51 */
+
+#endif /* _Z51_CORO_HPP */
@@ -41,7 +41,101 @@
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +-----------------------------------------*/
-/* none */
+/** header of a Z51_BLK_WAVE_LOAD block, followed by the frames */
+typedef struct {
+    u_int32 id;             /**< waveform ID (0..0xffff) */
+} Z51_WAVE_HDR;
+
+/** cached waveform info returned by Z51_BLK_WAVE_INFO */
+typedef struct {
+    u_int32 id;             /**< waveform ID */
+    u_int32 ch;             /**< 0: for channel 0/1, 2: for channel 2 */
+    u_int32 frames;         /**< number of frames */
+    u_int32 starts;         /**< number of playback starts */
+    u_int32 lru;            /**< 0 = most recently used, evicted last */
+} Z51_WAVE_INFO;
+
+/** sequencer step of a Z51_BLK_SEQ_LOAD block (see \ref seq_ops) */
+typedef struct {
+    u_int16 op;             /**< operation (Z51_SEQ_xxx) */
+    u_int16 par;            /**< channel or loop passes */
+    u_int32 arg;            /**< operand */
+} Z51_SEQ_STEP;
+
+/** DAC channel part of Z51_STATUS */
+typedef struct {
+    u_int32 offset;         /**< calibration offset (Z51_OFFSET) */
+    u_int32 gain;           /**< calibration gain (Z51_GAIN) */
+    u_int32 powerdown;      /**< powerdown mode (Z51_POWERDOWN) */
+    u_int32 output;         /**< last output value, uncalibrated (read only) */
+    u_int32 calProfile;     /**< calibration profile (Z51_CAL_PROFILE) */
+    u_int32 safeValue;      /**< safe state value (Z51_SAFE_VALUE) */
+    u_int32 safePd;         /**< safe state powerdown mode (Z51_SAFE_PD) */
+} Z51_STATUS_CH;
+
+/** configuration and status snapshot of Z51_BLK_STATUS */
+typedef struct {
+    u_int32 version;        /**< Z51_STATUS_VERSION */
+    u_int32 size;           /**< size of the structure (read only) */
+    Z51_STATUS_CH ch[2];    /**< DAC channel 0 and 1 */
+    u_int32 dbgLevel;       /**< driver debug level */
+    u_int32 flags;          /**< Z51_STATUS_xxx flags (read only) */
+    u_int32 irqCount;       /**< malfunction interrupts (read only) */
+    u_int32 underruns;      /**< see Z51_UNDERRUNS (read only) */
+    u_int32 lateCount;      /**< see Z51_LATE_COUNT (read only) */
+    u_int32 lateMax;        /**< see Z51_LATE_MAX (read only) */
+    u_int32 poolBlocks;     /**< waveform cache blocks (read only) */
+    u_int32 poolBlkSize;    /**< waveform cache block size (read only) */
+    u_int32 poolFree;       /**< see Z51_POOL_FREE (read only) */
+    u_int32 poolHwm;        /**< see Z51_POOL_HWM (read only) */
+} Z51_STATUS;
+
+/** per step timing returned by Z51_BLK_SEQ_TIMING */
+typedef struct {
+    u_int32 count;          /**< number of executions */
+    u_int32 time;           /**< last execution since start [us] */
+    int32   late;           /**< last execution after deadline [us] */
+} Z51_SEQ_TIMING;
+
+/** marker of a Z51_BLK_MARKER_SET block */
+typedef struct {
+    u_int32 id;             /**< event ID, reported in Z51_MARK_EVENT */
+    u_int32 target;         /**< waveform ID or ticket of a queued block */
+    u_int32 frame;          /**< frame index in the waveform or block */
+    u_int32 type;           /**< Z51_MARK_WAVE or Z51_MARK_BLOCK */
+} Z51_MARKER;
+
+/** marker event returned by Z51_BLK_MARKER_EVENTS */
+typedef struct {
+    u_int32 id;             /**< event ID of the marker */
+    u_int32 time;           /**< driver time the frame was written [us] */
+    u_int32 target;         /**< waveform ID or ticket of the marker */
+    u_int32 frame;          /**< frame index of the marker */
+} Z51_MARK_EVENT;
+
+/** point of a calibration profile */
+typedef struct {
+    u_int16 in;             /**< uncalibrated value */
+    u_int16 out;            /**< DAC value output for it */
+} Z51_CAL_POINT;
+
+/** latency of a priority class returned by Z51_BLK_PRIO_STATS */
+typedef struct {
+    u_int32 writes;         /**< M_write() calls of the class */
+    u_int32 latMax;         /**< max. latency [us] */
+    u_int32 latSum;         /**< sum of latencies [us], wraps around */
+} Z51_PRIO_STATS;
+
+/** header of a Z51_BLK_ASYNC_SUBMIT block, followed by the frames */
+typedef struct {
+    u_int32 ticket;         /**< ticket of the queued block (returned) */
+} Z51_ASYNC_HDR;
+
+/** header of a Z51_BLK_CAL_LOAD block, followed by the points */
+typedef struct {
+    u_int32 profile;        /**< profile 1..Z51_CAL_PROFILES */
+    u_int32 points;         /**< number of points (S: 0 = delete profile) */
+} Z51_CAL_HDR;
 
 /*-----------------------------------------+
 |  DEFINES                                 |
@@ -55,6 +149,244 @@
 #define Z51_POWERDOWN       M_DEV_OF+0x02   /**< G,S: Power-down mode */
 #define Z51_SET_SIGNAL      M_DEV_OF+0x03   /**<   S: Set signal sent on IRQ */
 #define Z51_CLR_SIGNAL      M_DEV_OF+0x04   /**<   S: Uninstall signal */
+#define Z51_SAMPLE_PERIOD   M_DEV_OF+0x05   /**< G,S: Block write sample period [us] */
+#define Z51_INTERP_MODE     M_DEV_OF+0x06   /**< G,S: Block write interpolation mode */
+#define Z51_INTERP_FACTOR   M_DEV_OF+0x07   /**< G,S: Block write interpolation factor */
+#define Z51_BLK_FORMAT      M_DEV_OF+0x08   /**< G,S: Block write data format */
+#define Z51_WAVE_START      M_DEV_OF+0x09   /**<   S: Start waveform playback */
+#define Z51_WAVE_STOP       M_DEV_OF+0x0a   /**<   S: Stop waveform playback */
+#define Z51_WAVE_DELETE     M_DEV_OF+0x0b   /**<   S: Delete cached waveform */
+#define Z51_WAVE_STATE      M_DEV_OF+0x0c   /**< G  : ID of playing waveform */
+#define Z51_WAVE_MEM_USED   M_DEV_OF+0x0d   /**< G  : Used waveform memory */
+#define Z51_SYNC_ARM        M_DEV_OF+0x0e   /**< G,S: Arm waveform playback */
+#define Z51_SYNC_TRIGGER    M_DEV_OF+0x0f   /**<   S: Release all armed devices */
+#define Z51_SYNC_SKEW       M_DEV_OF+0x10   /**< G  : Release spread of last trigger [us] */
+#define Z51_BLK_ASYNC       M_DEV_OF+0x11   /**< G,S: Queue block writes (all paths of the device) */
+#define Z51_ASYNC_TICKET    M_DEV_OF+0x12   /**< G  : Ticket of last queued block */
+#define Z51_ASYNC_DONE      M_DEV_OF+0x13   /**< G  : Ticket of last completed block */
+#define Z51_ASYNC_FREE      M_DEV_OF+0x14   /**< G  : Free queue space [frames] */
+#define Z51_ASYNC_SIG_SET   M_DEV_OF+0x15   /**<   S: Set signal sent on completion */
+#define Z51_ASYNC_SIG_CLR   M_DEV_OF+0x16   /**<   S: Uninstall completion signal */
+#define Z51_ASYNC_EOS       M_DEV_OF+0x17   /**<   S: Queue may run empty */
+#define Z51_UNDERRUN_MODE   M_DEV_OF+0x18   /**< G,S: Underrun policy */
+#define Z51_SAFE_VALUE      M_DEV_OF+0x19   /**< G,S: Underrun ramp target, safe value */
+#define Z51_RAMP_LEN        M_DEV_OF+0x1a   /**< G,S: Underrun ramp length [values] */
+#define Z51_UNDERRUNS       M_DEV_OF+0x1b   /**< G,S: Underruns (S: reset counters) */
+#define Z51_LATE_COUNT      M_DEV_OF+0x1c   /**< G  : Number of late values */
+#define Z51_LATE_MAX        M_DEV_OF+0x1d   /**< G  : Max. lateness [us] */
+#define Z51_UNDERRUN_SIG_SET M_DEV_OF+0x1e  /**<   S: Set signal sent on underrun */
+#define Z51_UNDERRUN_SIG_CLR M_DEV_OF+0x1f  /**<   S: Uninstall underrun signal */
+#define Z51_SEQ_START       M_DEV_OF+0x20   /**<   S: Start sequencer program */
+#define Z51_SEQ_STOP        M_DEV_OF+0x21   /**<   S: Stop sequencer program */
+#define Z51_SEQ_STATE       M_DEV_OF+0x22   /**< G  : Next step or -1 if idle */
+#define Z51_SEQ_SIG_SET     M_DEV_OF+0x23   /**<   S: Set signal for Z51_SEQ_SIGNAL */
+#define Z51_SEQ_SIG_CLR     M_DEV_OF+0x24   /**<   S: Uninstall sequencer signal */
+#define Z51_POOL_FREE       M_DEV_OF+0x25   /**< G  : Free waveform pool blocks */
+#define Z51_POOL_HWM        M_DEV_OF+0x26   /**< G,S: Max. used pool blocks (S: reset) */
+#define Z51_ASYNC_HWM       M_DEV_OF+0x27   /**< G,S: Max. queued frames (S: reset) */
+#define Z51_MARKER_CLR      M_DEV_OF+0x28   /**<   S: Remove all markers */
+#define Z51_MARKER_COUNT    M_DEV_OF+0x29   /**< G  : Number of queued marker events */
+#define Z51_MARKER_LOST     M_DEV_OF+0x2a   /**< G,S: Lost marker events (S: reset) */
+#define Z51_MARKER_SIG_SET  M_DEV_OF+0x2b   /**<   S: Set signal sent on marker events */
+#define Z51_MARKER_SIG_CLR  M_DEV_OF+0x2c   /**<   S: Uninstall marker signal */
+#define Z51_MARKER_TIME     M_DEV_OF+0x2d   /**< G  : Driver time [us] */
+#define Z51_CAL_PROFILE     M_DEV_OF+0x2e   /**< G,S: Active calibration profile */
+#define Z51_SAFE_STATE      M_DEV_OF+0x2f   /**< G,S: Enter (1) or leave (0) safe state */
+#define Z51_SAFE_PD         M_DEV_OF+0x30   /**< G,S: Powerdown mode in safe state */
+#define Z51_SAFE_ON_FAULT   M_DEV_OF+0x31   /**< G,S: Enter safe state on malfunction */
+#define Z51_SAFE_TIME       M_DEV_OF+0x32   /**< G,S: Max. time to safe state [us] (S: reset) */
+#define Z51_COMBINE_WINDOW  M_DEV_OF+0x33   /**< G,S: Write combining window [us] (0 = off) */
+#define Z51_COMBINE_HITS    M_DEV_OF+0x34   /**< G,S: Combined write pairs (S: reset counters) */
+#define Z51_COMBINE_MISSES  M_DEV_OF+0x35   /**< G  : Writes loaded alone */
+#define Z51_WRITE_PRIO      M_DEV_OF+0x36   /**< G,S: Priority class of M_write() */
+#define Z51_PRIO_CLR        M_DEV_OF+0x37   /**<   S: Reset Z51_BLK_PRIO_STATS */
+#define Z51_SYNC_LATE       M_DEV_OF+0x38   /**< G  : Release time - deadline [us] */
+/**@}*/
+
+/** \name Z51 specific Getstat/Setstat block codes
+ *  \anchor getstat_setstat_blk_codes
+ */
+/**@{*/
+#define Z51_BLK_WAVE_LOAD   M_DEV_BLK_OF+0x00 /**<   S: Upload waveform */
+#define Z51_BLK_WAVE_INFO   M_DEV_BLK_OF+0x01 /**< G  : Cached waveforms */
+#define Z51_BLK_SEQ_LOAD    M_DEV_BLK_OF+0x02 /**<   S: Load sequencer program */
+#define Z51_BLK_SEQ_TIMING  M_DEV_BLK_OF+0x03 /**< G  : Sequencer step timing */
+#define Z51_BLK_STATUS      M_DEV_BLK_OF+0x04 /**< G,S: Status snapshot/configuration */
+#define Z51_BLK_MARKER_SET  M_DEV_BLK_OF+0x05 /**<   S: Add markers */
+#define Z51_BLK_MARKER_EVENTS M_DEV_BLK_OF+0x06 /**< G  : Take marker events */
+#define Z51_BLK_CAL_LOAD    M_DEV_BLK_OF+0x07 /**< G,S: Calibration profile points */
+#define Z51_BLK_PRIO_STATS  M_DEV_BLK_OF+0x08 /**< G  : Latency per priority class */
+#define Z51_BLK_ASYNC_SUBMIT M_DEV_BLK_OF+0x09 /**< G  : Queue block, return its ticket */
+/**@}*/
+
+#define Z51_WAVE_MAX            32  /**< max. number of cached waveforms */
+
+/** \name DAC units and channels
+ *  \anchor units_channels
+ */
+/**@{*/
+#define Z51_UNITS_MAX           8   /**< max. value of descriptor Z51_UNITS */
+/** channel of \a unit: \a sub 0 = output A, 1 = output B, 2 = both */
+#define Z51_CH(unit,sub)        ((unit) * 3 + (sub))
+/** group channel driving all outputs of \a units units (units > 1) */
+#define Z51_CH_GROUP(units)     ((units) * 3)
+/**@}*/
+
+/** compose Z51_WAVE_START argument (passes = 0: endless) */
+#define Z51_WAVE_START_ARG(id,passes)   (((passes) << 16) | ((id) & 0xffff))
+
+/** TRUE if asynchronous block \a ticket was completed (Z51_ASYNC_DONE) */
+#define Z51_ASYNC_COMPLETED(done,ticket) ((int32)((done) - (ticket)) >= 0)
+
+/** \name Marker types (Z51_MARKER.type) and limits */
+/**@{*/
+#define Z51_MARK_WAVE       0   /**< frame of a cached waveform, every pass */
+#define Z51_MARK_BLOCK      1   /**< frame of a queued block, once */
+#define Z51_MARKER_MAX      32  /**< max. number of markers */
+#define Z51_MARK_EVENTS     64  /**< size of the marker event queue */
+/**@}*/
+
+/** \name Interpolation modes for Z51_INTERP_MODE
+ *  \anchor interp_modes
+ */
+/**@{*/
+#define Z51_INTERP_ZOH      0   /**< zero-order hold (repeat value) */
+#define Z51_INTERP_LINEAR   1   /**< linear interpolation */
+#define Z51_INTERP_CUBIC    2   /**< cubic (Catmull-Rom) interpolation */
+/**@}*/
+
+#define Z51_INTERP_FACTOR_MAX   256 /**< max. value for Z51_INTERP_FACTOR */
+
+#define Z51_COMBINE_MAX         1000 /**< max. value for Z51_COMBINE_WINDOW */
+
+/** \name Priority classes for Z51_WRITE_PRIO */
+/**@{*/
+#define Z51_PRIO_NORMAL     0   /**< wait for other calls (default) */
+#define Z51_PRIO_HIGH       1   /**< output between frames of other calls */
+#define Z51_PRIO_CLASSES    2   /**< number of classes */
+/**@}*/
+
+/** \name Version and flags of Z51_STATUS */
+/**@{*/
+#define Z51_STATUS_VERSION      2       /**< current layout of Z51_STATUS */
+#define Z51_STATUS_FAULT        0x01    /**< malfunction, DAC not yet reinit. */
+#define Z51_STATUS_IRQ_PEND     0x02    /**< malfunction interrupt pending */
+#define Z51_STATUS_IRQ_EN       0x04    /**< interrupt enabled (IRQ_ENABLE) */
+#define Z51_STATUS_SIG_HW       0x10    /**< Z51_SET_SIGNAL installed */
+#define Z51_STATUS_SIG_ASYNC    0x20    /**< Z51_ASYNC_SIG_SET installed */
+#define Z51_STATUS_SIG_UNDER    0x40    /**< Z51_UNDERRUN_SIG_SET installed */
+#define Z51_STATUS_SIG_SEQ      0x80    /**< Z51_SEQ_SIG_SET installed */
+#define Z51_STATUS_SIG_MARK     0x100   /**< Z51_MARKER_SIG_SET installed */
+#define Z51_STATUS_SAFE         0x200   /**< in safe state (Z51_SAFE_STATE) */
+/**@}*/
+
+/** \name Sequencer operations (Z51_SEQ_STEP.op)
+ *  \anchor seq_ops
+ *
+ *  \code
+ *  op                 par            arg
+ *  -----------------  -------------  ----------------------------------
+ *  Z51_SEQ_WRITE      channel 0..2   value, output at once
+ *                                    (channel 2: (B << 16) | A)
+ *  Z51_SEQ_STAGE      channel 0..1   value, written to buffer only
+ *  Z51_SEQ_LOAD       -              load staged buffers: 1=A, 2=B, 3=A+B
+ *  Z51_SEQ_POWERDOWN  channel 0..1   powerdown mode (see Z51_POWERDOWN)
+ *  Z51_SEQ_WAIT       -              time [us], 0..1000000
+ *  Z51_SEQ_LOOP       passes         index of first step of the loop
+ *                     (0 = endless)  (must contain a wait > 0)
+ *  Z51_SEQ_SIGNAL     -              -  (send Z51_SEQ_SIG_SET signal)
+ *  \endcode
+ *
+ *  Z51_SEQ_LOOP jumps back \a passes times, so the loop body is executed
+ *  passes + 1 times. Z51_SEQ_LOAD needs a Z51_SEQ_STAGE of channel 0
+ *  (arg 1) or 1 (arg 2, 3) since the previous load.
+ */
+/**@{*/
+#define Z51_SEQ_WRITE       0   /**< write and load value */
+#define Z51_SEQ_STAGE       1   /**< write value to buffer */
+#define Z51_SEQ_LOAD        2   /**< load staged buffers */
+#define Z51_SEQ_POWERDOWN   3   /**< set powerdown mode */
+#define Z51_SEQ_WAIT        4   /**< wait */
+#define Z51_SEQ_LOOP        5   /**< jump back */
+#define Z51_SEQ_SIGNAL      6   /**< send signal */
+/**@}*/
+
+#define Z51_SEQ_MAX         64  /**< max. steps of a sequencer program */
+
+/** \name Calibration profiles (Z51_CAL_PROFILE, Z51_BLK_CAL_LOAD)
+ *  \anchor cal_profiles
+ *
+ *  Profile 0 is the linear correction by Z51_OFFSET and Z51_GAIN.
+ *  Profiles 1..Z51_CAL_PROFILES interpolate linearly between points
+ *  (Z51_CAL_POINT) and hold the first/last out value outside of them.
+ *  The in values must ascend by at least Z51_CAL_SPACING.
+ */
+/**@{*/
+#define Z51_CAL_PROFILES    4   /**< profiles per output besides profile 0 */
+#define Z51_CAL_POINTS_MAX  32  /**< max. points of a profile */
+#define Z51_CAL_POINTS_MIN  2   /**< min. points of a profile */
+#define Z51_CAL_SPACING     256 /**< min. distance of in values */
+/** descriptor value of a point (Z51_CAL_n_p_k) */
+#define Z51_CAL_KEY(in,out)     (((u_int32)(in) << 16) | ((out) & 0xffff))
+/**@}*/
+
+/** \name Underrun policies for Z51_UNDERRUN_MODE
+ *  \anchor underrun_modes
+ */
+/**@{*/
+#define Z51_UNDERRUN_HOLD       0   /**< hold last value */
+#define Z51_UNDERRUN_REPEAT     1   /**< repeat last block */
+#define Z51_UNDERRUN_RAMP       2   /**< ramp to Z51_SAFE_VALUE */
+#define Z51_UNDERRUN_POWERDOWN  3   /**< powerdown (Z51_SAFE_PD mode, 1 if 0) */
+/**@}*/
+
+/** \name Block write data formats for Z51_BLK_FORMAT
+ *  \anchor blk_formats
+ */
+/**@{*/
+#define Z51_FMT_NATIVE      0   /**< 16-bit values (channel 2: 32-bit) */
+#define Z51_FMT_RLE         1   /**< delta/run-length encoded byte stream */
+#define Z51_FMT_S16         2   /**< signed 16-bit values (-0x8000 = lowest) */
+#define Z51_FMT_RAW         3   /**< 32-bit DAC command words (Z51_RAW_xxx) */
+/**@}*/
+
+/** \name Command word bits for Z51_FMT_RAW
+ *
+ *  A command word is (load | buffer | powerdown | calibrated value).
+ *  Other bits are rejected.
+ */
+/**@{*/
+#define Z51_RAW_LOAD_A      0x100000    /**< load buffer A to output A */
+#define Z51_RAW_LOAD_B      0x200000    /**< load buffer B to output B */
+#define Z51_RAW_LOAD_AB     0x300000    /**< load both buffers */
+#define Z51_RAW_BUF_A       0x000000    /**< write to buffer A */
+#define Z51_RAW_BUF_B       0x040000    /**< write to buffer B */
+#define Z51_RAW_PD_1K       0x010000    /**< powerdown, 1 kOhm to GND */
+#define Z51_RAW_PD_100K     0x020000    /**< powerdown, 100 kOhm to GND */
+#define Z51_RAW_PD_HIGHZ    0x030000    /**< powerdown, high impedance */
+#define Z51_RAW_VALID       0x37ffff    /**< all valid bits */
+/**@}*/
+
+/** \name Token tags of the Z51_FMT_RLE byte stream
+ *
+ *  \code
+ *  Tag        Bytes  Meaning
+ *  ---------  -----  ------------------------------------------------
+ *  0x00..7f   1      7-bit signed delta to previous value (-64..63)
+ *  0x80..bf   1      repeat previous value (tag & 0x3f) + 1 times
+ *  0xc0..df   2      repeat previous value ((tag & 0x1f) << 8 | b1) + 65
+ *                    times
+ *  0xe0..fe   -      reserved
+ *  0xff       3      raw value b1 | (b2 << 8)
+ *  \endcode
+ *
+ *  The previous value is initially 0.
+ */
+/**@{*/
+#define Z51_RLE_HOLD        0x80    /**< short hold */
+#define Z51_RLE_LHOLD       0xc0    /**< long hold */
+#define Z51_RLE_RSVD        0xe0    /**< first reserved tag */
+#define Z51_RLE_RAW         0xff    /**< raw value escape */
 /**@}*/
 
 
@@ -0,0 +1,130 @@
+/***********************  I n c l u d e  -  F i l e  ***********************/
+/*!
+ *        \file  z51d.h
+ *
+ *      \author  ub
+ *
+ *       \brief  Header file for the Z51 output server z51d and its client
+ *               library z51d_api
+ *
+ *  The server owns the Z51 devices, so clients don't pay the device
+ *  initialization on every open. A client session is one channel of one
+ *  device: control requests go over a Unix socket, values over a ring in
+ *  shared memory. The protocol types below are shared by server and
+ *  client library only; applications use the Z51D_xxx() functions.
+ *
+ *    \switches  -
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Z51D_H
+#define _Z51D_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+/** default control socket, clients use $Z51D_SOCKET if set */
+#define Z51D_SOCKET         "/var/run/z51d.sock"
+/** max. length of a device name incl. terminating 0 */
+#define Z51D_NAME_MAX       32
+/** default and max. ring size of a session [values] */
+#define Z51D_SLOTS          1024
+#define Z51D_SLOTS_MAX      0x10000
+
+/** \name control requests (Z51D_REQ.op) */
+/**@{*/
+#define Z51D_OP_OPEN        0   /**< open session: dev, ch, arg = slots */
+#define Z51D_OP_FLUSH       1   /**< output ring content, report errors */
+#define Z51D_OP_SETSTAT     2   /**< SetStat: arg = code, value */
+#define Z51D_OP_GETSTAT     3   /**< GetStat: arg = code */
+/**@}*/
+
+#define Z51D_LINE           64  /**< cache line size [bytes] */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** client session (see Z51D_Open()) */
+typedef struct Z51D_CLIENT Z51D_CLIENT;
+
+/** control request (one SOCK_SEQPACKET message) */
+typedef struct {
+    u_int32 op;             /**< Z51D_OP_xxx */
+    int32   ch;             /**< OPEN: channel */
+    u_int32 arg;            /**< OPEN: ring slots, SET/GETSTAT: code */
+    int32   value;          /**< SETSTAT: value */
+    char    dev[Z51D_NAME_MAX]; /**< OPEN: device name */
+} Z51D_REQ;
+
+/**
+ *  Reply to a control request. The reply to Z51D_OP_OPEN carries the
+ *  shared memory of the ring and the server's doorbell as SCM_RIGHTS
+ *  descriptors.
+ */
+typedef struct {
+    int32   error;          /**< 0 or error code */
+    int32   value;          /**< OPEN: ring slots, GETSTAT: value */
+} Z51D_REPLY;
+
+/** value in the ring */
+typedef struct {
+    u_int32 value;          /**< value as for M_write() */
+    u_int32 deadline;       /**< UOS_MsecTimerGet() time or 0 */
+} Z51D_ENTRY;
+
+/**
+ *  Ring in shared memory, single producer (client) and single consumer
+ *  (server); each side writes its own cache line only.
+ */
+typedef struct {
+    u_int32     slots;      /**< ring size, power of 2 (constant) */
+    u_int32     head;       /**< client: values written (free running) */
+    u_int8      pad0[Z51D_LINE - 8];
+    u_int32     tail;       /**< server: values taken (free running) */
+    u_int32     idle;       /**< server: sleeping, client rings doorbell */
+    int32       error;      /**< server: first write error or 0 */
+    u_int8      pad1[Z51D_LINE - 12];
+    Z51D_ENTRY  entry[1];   /**< slots entries */
+} Z51D_RING;
+
+/** size of a ring of \a slots values [bytes] */
+#define Z51D_RING_SIZE(slots) \
+    (sizeof(Z51D_RING) + ((slots) - 1) * sizeof(Z51D_ENTRY))
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+extern Z51D_CLIENT* Z51D_Open( const char *device, int32 ch, u_int32 slots );
+extern void Z51D_Close( Z51D_CLIENT *c );
+extern int32 Z51D_Write( Z51D_CLIENT *c, u_int32 value );
+extern int32 Z51D_WriteAt( Z51D_CLIENT *c, u_int32 value, u_int32 deadline );
+extern int32 Z51D_Flush( Z51D_CLIENT *c );
+extern int32 Z51D_SetStat( Z51D_CLIENT *c, int32 code, int32 value );
+extern int32 Z51D_GetStat( Z51D_CLIENT *c, int32 code, int32 *valueP );
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _Z51D_H */
@@ -0,0 +1,34 @@
+#***************************  M a k e f i l e  *******************************
+#
+#         Author: ub
+#
+#    Description: Makefile definitions for the z51d client library
+#
+#-----------------------------------------------------------------------------
+#   Copyright 2026, MEN Mikro Elektronik GmbH
+#*****************************************************************************
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+MAK_NAME=z51d_api
+
+MAK_LIBS=
+
+MAK_INCL=$(MEN_INC_DIR)/men_typs.h	\
+         $(MEN_INC_DIR)/mdis_err.h	\
+         $(MEN_INC_DIR)/usr_oss.h	\
+         $(MEN_INC_DIR)/z51d.h	\
+
+MAK_INP1=z51d_api$(INP_SUFFIX)
+
+MAK_INP=$(MAK_INP1)
@@ -0,0 +1,394 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  z51d_api.c
+ *
+ *      \author  ub
+ *
+ *      \brief   Client library of the Z51 output server z51d
+ *
+ *               A session connects to the server's control socket, which
+ *               opens the device (or uses the already open one), reserves
+ *               the channel for the session and returns a ring in shared
+ *               memory. Values are then written to the ring without any
+ *               system call as long as the server is busy; an idle server
+ *               is woken by one byte written to its doorbell pipe.
+ *
+ *     Required: usr_oss, POSIX (Unix sockets, mmap)
+ *     \switches -
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_err.h>
+#include <MEN/usr_oss.h>
+#include <MEN/z51d.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+/*
+ * Publishing a value and checking the server's idle flag must not be
+ * reordered (the server sets idle, then checks head), so both are
+ * sequentially consistent.
+ */
+#define ATOMIC_LOAD(p)      __atomic_load_n( (p), __ATOMIC_SEQ_CST )
+#define ATOMIC_STORE(p,v)   __atomic_store_n( (p), (v), __ATOMIC_SEQ_CST )
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+struct Z51D_CLIENT {
+    int         sock;           /* control socket */
+    int         bell;           /* server's doorbell (write end) */
+    Z51D_RING   *ring;          /* shared ring */
+    u_int32     mask;           /* ring slots - 1 */
+    u_int32     head;           /* local copy of ring->head */
+};
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static int32 request( Z51D_CLIENT *c, Z51D_REQ *req, Z51D_REPLY *rep,
+                      int *fds );
+
+/******************************* Z51D_Open *********************************/
+/** Open a session for one channel of a device served by z51d
+ *
+ *  The server socket is Z51D_SOCKET or the one named by the environment
+ *  variable Z51D_SOCKET. A channel (and the outputs it drives) can only be
+ *  used by one session at a time, including the group channel.
+ *
+ *  \param device     \IN  device name, as for M_open()
+ *  \param ch         \IN  channel
+ *  \param slots      \IN  ring size [values], 0 for Z51D_SLOTS
+ *
+ *  \return           session or NULL on error (see UOS_ErrnoGet(),
+ *                    ERR_LL_DEV_BUSY: channel used by another session)
+ */
+Z51D_CLIENT* Z51D_Open(
+    const char *device,
+    int32      ch,
+    u_int32    slots )
+{
+    struct sockaddr_un addr;
+    const char  *name = getenv( "Z51D_SOCKET" );
+    Z51D_CLIENT *c;
+    Z51D_REQ    req;
+    Z51D_REPLY  rep;
+    int         fds[2] = { -1, -1 };
+    int32       error;
+    void        *mem;
+
+    if( name == NULL )
+        name = Z51D_SOCKET;
+
+    if( strlen( device ) >= Z51D_NAME_MAX ||
+        strlen( name ) >= sizeof(addr.sun_path) ) {
+        UOS_ErrnoSet( ERR_LL_ILL_PARAM );
+        return( NULL );
+    }
+
+    if( (c = (Z51D_CLIENT*)calloc( 1, sizeof(Z51D_CLIENT) )) == NULL ) {
+        UOS_ErrnoSet( ERR_OSS_MEM_ALLOC );
+        return( NULL );
+    }
+    c->bell = -1;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, name );
+
+    if( (c->sock = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0 )) < 0 ||
+        connect( c->sock, (struct sockaddr*)&addr, sizeof(addr) ) ) {
+        error = errno;
+        goto ABORT;
+    }
+
+    memset( &req, 0, sizeof(req) );
+    req.op  = Z51D_OP_OPEN;
+    req.ch  = ch;
+    req.arg = slots ? slots : Z51D_SLOTS;
+    strcpy( req.dev, device );
+
+    if( (error = request( c, &req, &rep, fds )) )
+        goto ABORT;
+
+    mem = mmap( NULL, Z51D_RING_SIZE( (u_int32)rep.value ),
+                PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0 );
+    if( mem == MAP_FAILED ) {
+        error = errno;
+        goto ABORT;
+    }
+
+    close( fds[0] );
+    c->ring = (Z51D_RING*)mem;
+    c->bell = fds[1];
+    c->mask = (u_int32)rep.value - 1;
+    c->head = c->ring->head;
+    return( c );
+
+ABORT:
+    if( fds[0] >= 0 )
+        close( fds[0] );
+    if( fds[1] >= 0 )
+        close( fds[1] );
+    if( c->sock >= 0 )
+        close( c->sock );
+    free( c );
+    UOS_ErrnoSet( error );
+    return( NULL );
+}
+
+/******************************* Z51D_Close ********************************/
+/** Close a session
+ *
+ *  Values still in the ring are output by the server before it releases
+ *  the channel; use Z51D_Flush() before to learn about write errors.
+ *
+ *  \param c          \IN  session or NULL
+ */
+void Z51D_Close( Z51D_CLIENT *c )
+{
+    if( c == NULL )
+        return;
+
+    munmap( c->ring, Z51D_RING_SIZE( c->mask + 1 ) );
+    close( c->bell );
+    close( c->sock );
+    free( c );
+}
+
+/******************************* Z51D_Write ********************************/
+/** Write a value without deadline
+ *
+ *  \param c          \IN  session
+ *  \param value      \IN  value as for M_write() on the session's channel
+ *
+ *  \return           0 or -1 if the ring is full (ERR_LL_DEV_BUSY)
+ */
+int32 Z51D_Write(
+    Z51D_CLIENT *c,
+    u_int32     value )
+{
+    return( Z51D_WriteAt( c, value, 0 ) );
+}
+
+/******************************* Z51D_WriteAt ******************************/
+/** Write a value with deadline
+ *
+ *  Puts the value into the ring and returns at once. The server merges
+ *  the values of all sessions of a device like Z51_MpscDispatch(), so a
+ *  value may be replaced by a newer one of the same channel before it is
+ *  output. Values still in the ring at \a deadline are dropped.
+ *
+ *  \param c          \IN  session
+ *  \param value      \IN  value as for M_write() on the session's channel
+ *  \param deadline   \IN  UOS_MsecTimerGet() time the value is valid to,
+ *                         0 for no deadline
+ *
+ *  \return           0 or -1 if the ring is full (ERR_LL_DEV_BUSY)
+ */
+int32 Z51D_WriteAt(
+    Z51D_CLIENT *c,
+    u_int32     value,
+    u_int32     deadline )
+{
+    Z51D_RING  *r = c->ring;
+    Z51D_ENTRY *e;
+    u_int8     b = 0;
+
+    if( c->head - ATOMIC_LOAD( &r->tail ) > c->mask ) {
+        UOS_ErrnoSet( ERR_LL_DEV_BUSY );
+        return( -1 );
+    }
+
+    e = &r->entry[c->head & c->mask];
+    e->value    = value;
+    e->deadline = deadline;
+    ATOMIC_STORE( &r->head, ++c->head );          /* publish */
+
+    if( ATOMIC_LOAD( &r->idle ) && write( c->bell, &b, 1 ) < 0 ) {
+        /* doorbell full (non-blocking): the server wakes anyway */
+    }
+
+    return( 0 );
+}
+
+/******************************* Z51D_Flush ********************************/
+/** Wait until the server has output all values written so far
+ *
+ *  \param c          \IN  session
+ *
+ *  \return           0 or -1 on error (see UOS_ErrnoGet()), e.g. the
+ *                    first write error since the last Z51D_Flush()
+ */
+int32 Z51D_Flush( Z51D_CLIENT *c )
+{
+    Z51D_REQ   req;
+    Z51D_REPLY rep;
+    int32      error;
+
+    memset( &req, 0, sizeof(req) );
+    req.op = Z51D_OP_FLUSH;
+
+    if( (error = request( c, &req, &rep, NULL )) ) {
+        UOS_ErrnoSet( error );
+        return( -1 );
+    }
+    return( 0 );
+}
+
+/******************************* Z51D_SetStat ******************************/
+/** SetStat on the session's channel
+ *
+ *  The server accepts only codes which affect the session's outputs alone:
+ *  Z51_OFFSET, Z51_GAIN and Z51_POWERDOWN on single output channels.
+ *  Values written before are output first.
+ *
+ *  \param c          \IN  session
+ *  \param code       \IN  status code
+ *  \param value      \IN  value
+ *
+ *  \return           0 or -1 on error (see UOS_ErrnoGet())
+ */
+int32 Z51D_SetStat(
+    Z51D_CLIENT *c,
+    int32       code,
+    int32       value )
+{
+    Z51D_REQ   req;
+    Z51D_REPLY rep;
+    int32      error;
+
+    memset( &req, 0, sizeof(req) );
+    req.op    = Z51D_OP_SETSTAT;
+    req.arg   = (u_int32)code;
+    req.value = value;
+
+    if( (error = request( c, &req, &rep, NULL )) ) {
+        UOS_ErrnoSet( error );
+        return( -1 );
+    }
+    return( 0 );
+}
+
+/******************************* Z51D_GetStat ******************************/
+/** GetStat on the session's channel (codes as for Z51D_SetStat())
+ *
+ *  \param c          \IN  session
+ *  \param code       \IN  status code
+ *  \param valueP     \OUT value
+ *
+ *  \return           0 or -1 on error (see UOS_ErrnoGet())
+ */
+int32 Z51D_GetStat(
+    Z51D_CLIENT *c,
+    int32       code,
+    int32       *valueP )
+{
+    Z51D_REQ   req;
+    Z51D_REPLY rep;
+    int32      error;
+
+    memset( &req, 0, sizeof(req) );
+    req.op  = Z51D_OP_GETSTAT;
+    req.arg = (u_int32)code;
+
+    if( (error = request( c, &req, &rep, NULL )) ) {
+        UOS_ErrnoSet( error );
+        return( -1 );
+    }
+    *valueP = rep.value;
+    return( 0 );
+}
+
+/**********************************************************************/
+/** Send a control request and wait for the reply
+ *
+ *  \param c          \IN  session
+ *  \param req        \IN  request
+ *  \param rep        \OUT reply
+ *  \param fds        \OUT descriptors passed with the reply (2) or NULL
+ *
+ *  \return           0 or error code
+ */
+static int32 request(
+    Z51D_CLIENT *c,
+    Z51D_REQ    *req,
+    Z51D_REPLY  *rep,
+    int         *fds )
+{
+    union {
+        struct cmsghdr hdr;
+        u_int8         buf[CMSG_SPACE(2 * sizeof(int))];
+    } ctl;
+    struct msghdr  msg;
+    struct iovec   iov;
+    struct cmsghdr *cm;
+    int            got[2];
+    ssize_t        n;
+
+    if( send( c->sock, req, sizeof(*req), MSG_NOSIGNAL ) != sizeof(*req) )
+        return( errno );
+
+    memset( &msg, 0, sizeof(msg) );
+    iov.iov_base       = rep;
+    iov.iov_len        = sizeof(*rep);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+
+    do
+        n = recvmsg( c->sock, &msg, MSG_CMSG_CLOEXEC );
+    while( n < 0 && errno == EINTR );
+
+    if( n < 0 )
+        return( errno );
+    if( n != sizeof(*rep) )
+        return( ERR_LL_READ );              /* server gone */
+
+    cm = CMSG_FIRSTHDR( &msg );
+    if( cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS &&
+        cm->cmsg_len == CMSG_LEN(2 * sizeof(int)) ) {
+        memcpy( got, CMSG_DATA(cm), sizeof(got) );
+        if( fds ) {
+            fds[0] = got[0];
+            fds[1] = got[1];
+        }
+        else {
+            close( got[0] );
+            close( got[1] );
+        }
+    }
+
+    if( rep->error == 0 && fds && fds[1] < 0 )
+        return( ERR_LL_READ );
+
+    return( rep->error );
+}
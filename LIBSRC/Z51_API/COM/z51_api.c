@@ -0,0 +1,1535 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  z51_api.c
+ *
+ *      \author  ub
+ *
+ *      \brief   Z51 user library: encoder/decoder for the Z51_FMT_RLE
+ *               block write format, conversion of engineering units,
+ *               multi-producer submission queue, waveform mixer, output
+ *               pacing, safe state of several devices
+ *
+ *     Required: mdis_api, usr_oss, POSIX threads
+ *
+ *     \switches __SSE2__ (set by the compiler) - vectorized unit conversion
+ *               and mixing
+ *               __GNUC__, _MSC_VER (set by the compiler) - atomic operations
+ *               _WIN32 (set by the compiler) - clock and sleep of the pacer,
+ *               safe state fired device by device, else POSIX
+ */
+ /*
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/z51_drv.h>
+#include <MEN/z51_api.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <time.h>
+# include <errno.h>
+# include <pthread.h>
+#endif
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define RLE_SHORT_MAX       64          /* max. count of a short hold */
+#define RLE_LONG_MAX        (0x1fff + 65)   /* max. count of a long hold */
+
+/*
+ * Adding and subtracting 2^23 rounds a float in [0, 2^23) to the nearest
+ * integer (ties to even) with plain IEEE single precision operations, so
+ * the scalar and the vector code round identically.
+ */
+#define UNITS_ROUND         8388608.0f
+#define UNITS_CODE_MAX      65535.0f
+
+#define MPSC_LINE           64          /* cache line size [bytes] */
+
+#define MIX_CHUNK           256         /* values mixed per pass */
+#define MIX_SINE_BITS       10          /* log2 of sine table size */
+#define MIX_SINE_LEN        (1 << MIX_SINE_BITS)
+#define MIX_SINE_AMP        32767.0     /* sine table amplitude */
+#define MIX_COS_STEP        0.99998117528260111     /* cos(2 pi / 1024) */
+#define MIX_SIN_STEP        0.0061358846491544753   /* sin(2 pi / 1024) */
+
+/* mixer layer states, low bits of MIX_SLOT.state */
+#define MIX_FREE            0
+#define MIX_NEW             1           /* being filled by Z51_MixerAdd() */
+#define MIX_ACTIVE          2
+#define MIX_REMOVED         3           /* renderer frees it */
+#define MIX_STATE(st)       ((st) & 3)
+#define MIX_GEN(st)         (((st) >> 2) & 0x7ffffff)  /* id generation */
+
+#define PACE_NS             1000000000  /* ns per second */
+
+/* pause in the spin tail of the pacer */
+#ifdef __SSE2__
+# define PACE_RELAX()       _mm_pause()
+#else
+# define PACE_RELAX()
+#endif
+
+/*
+ * Atomic operations of the submission queue and the mixer: loads acquire,
+ * stores release, ATOMIC_CAS() is a full barrier and updates *(o) with the
+ * current value on failure.
+ */
+#if defined(__GNUC__)
+# define ATOMIC_LOAD(p)     __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+# define ATOMIC_STORE(p,v)  __atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+# define ATOMIC_CAS(p,o,v)  __atomic_compare_exchange_n( (p), (o), (v), 0, \
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )
+# define ATOMIC_INC(p)      __atomic_fetch_add( (p), 1, __ATOMIC_RELAXED )
+#elif defined(_MSC_VER)
+/* volatile accesses have acquire/release semantics with /volatile:ms */
+# define ATOMIC_LOAD(p)     (*(volatile u_int32*)(p))
+# define ATOMIC_STORE(p,v)  (*(volatile u_int32*)(p) = (v))
+# define ATOMIC_CAS(p,o,v)  atomicCas( (p), (o), (v) )
+# define ATOMIC_INC(p)      _InterlockedIncrement( (volatile long*)(p) )
+#else
+# error "z51_api: no atomic operations for this compiler"
+#endif
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/* slot of the submission queue */
+typedef struct {
+    u_int32     seq;            /* sequence number, see Z51_MpscPutAt() */
+    int32       ch;
+    u_int32     value;
+    u_int32     deadline;
+} MPSC_SLOT;
+
+/* submission queue, producer and consumer indices on own cache lines */
+struct Z51_MPSC {
+    u_int32     tail;           /* next slot to fill (producers) */
+    u_int32     full;           /* rejected entries (producers) */
+    u_int8      pad0[MPSC_LINE - 8];
+    u_int32     head;           /* next slot to take (consumer) */
+    u_int32     mask;           /* number of slots - 1 */
+    u_int32     units;          /* units of the device */
+    u_int32     chNumber;       /* valid channels */
+    int32       curCh;          /* current channel of the path or -1 */
+    u_int32     known;          /* lanes with valid shadow values */
+    u_int16     shadow[2*Z51_UNITS_MAX];    /* last values per lane */
+    Z51_MPSC_STATS  stats;      /* consumer counters (full unused) */
+    u_int8      pad1[MPSC_LINE];
+    MPSC_SLOT   slot[1];        /* mask + 1 slots */
+};
+
+/* mixer layer */
+typedef struct {
+    u_int32         state;      /* generation << 2 | MIX_xxx */
+    u_int32         gain;       /* current gain (int16) */
+    Z51_MIX_LAYER   par;
+    u_int32         pos;        /* BUFFER, RAMP: values done */
+    u_int32         acc;        /* DDS: phase, RAMP: value << 15,
+                                   NOISE: generator state */
+} MIX_SLOT;
+
+struct Z51_MIXER {
+    MIX_SLOT    slot[Z51_MIX_LAYERS_MAX];
+    int16       sine[MIX_SINE_LEN + 1];     /* one period + wrap value */
+};
+
+/* pacer */
+struct Z51_PACE {
+    u_int64         period;     /* [ns] */
+    u_int64         spin;       /* spin tail [ns] */
+    u_int64         next;       /* deadline of the next period [ns] */
+    Z51_PACE_STATS  stats;
+};
+
+/* device of a safe state trigger */
+typedef struct {
+    Z51_SAFE    *s;
+    MDIS_PATH   path;
+#ifndef _WIN32
+    pthread_t   tid;            /* helper thread (not for dev[0]) */
+#endif
+} SAFE_DEV;
+
+/* safe state trigger */
+struct Z51_SAFE {
+    u_int32         n;          /* devices */
+    SAFE_DEV        dev[Z51_SAFE_DEV_MAX];
+#ifndef _WIN32
+    u_int32         threads;    /* helper threads started */
+    pthread_mutex_t fire;       /* serializes Z51_SafeFire() */
+    pthread_mutex_t lock;       /* protects the fields below */
+    pthread_cond_t  go;         /* gen changed or quit set */
+    pthread_cond_t  done;       /* left reached 0 */
+    u_int32         gen;        /* Z51_SafeFire() calls */
+    u_int32         left;       /* devices of the current call not done */
+    u_int32         failed;     /* ... that returned an error */
+    int             quit;       /* helper threads terminate */
+#endif
+};
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+#ifdef _MSC_VER
+static int atomicCas( u_int32 *p, u_int32 *oldP, u_int32 val );
+#endif
+static int32 mpscSelect( Z51_MPSC *q, MDIS_PATH path, int32 ch );
+static int mixGenerate( Z51_MIXER *m, MIX_SLOT *s, int16 *dst, u_int32 n );
+static void mixAdd( int16 *acc, const int16 *src, u_int32 n, int16 gain );
+static int16 mixSat( int32 x );
+static void paceSleep( u_int64 until );
+#ifndef _WIN32
+static void *safeThread( void *arg );
+static void safeDone( Z51_SAFE *s, int32 err );
+#endif
+
+/******************************* Z51_RleEncode *****************************/
+/** Encode values into the Z51_FMT_RLE block format
+ *
+ *  The first value is always encoded as raw value, so every encoded block
+ *  is independent of the decoder state left by previous blocks. Runs of
+ *  equal values are encoded as holds, small steps as deltas.
+ *
+ *  \param src        \IN  values to encode
+ *  \param n          \IN  number of values
+ *  \param dst        \OUT encoded data
+ *  \param dstSize    \IN  size of dst [bytes], Z51_RLE_MAXSIZE(n) is
+ *                         always sufficient
+ *
+ *  \return           size of encoded data [bytes] or -1 if dst too small
+ */
+int32 Z51_RleEncode(
+    const u_int16 *src,
+    u_int32       n,
+    u_int8        *dst,
+    u_int32       dstSize )
+{
+    u_int32 i = 0, len = 0, run, cnt;
+    u_int16 prev = 0;
+    int32   delta;
+
+    while( i < n ) {
+        /* run of values equal to the previous one */
+        for( run=0; i > 0 && i + run < n && src[i+run] == prev; run++ )
+            ;
+
+        if( run ) {
+            i += run;
+            while( run ) {
+                if( run > RLE_SHORT_MAX ) {
+                    cnt = run < RLE_LONG_MAX ? run : RLE_LONG_MAX;
+                    if( len + 2 > dstSize )
+                        return( -1 );
+                    dst[len++] = (u_int8)(Z51_RLE_LHOLD | ((cnt - 65) >> 8));
+                    dst[len++] = (u_int8)(cnt - 65);
+                }
+                else {
+                    cnt = run;
+                    if( len + 1 > dstSize )
+                        return( -1 );
+                    dst[len++] = (u_int8)(Z51_RLE_HOLD | (cnt - 1));
+                }
+                run -= cnt;
+            }
+            continue;
+        }
+
+        delta = (int32)src[i] - (int32)prev;
+        if( i > 0 && delta >= -64 && delta <= 63 ) {
+            if( len + 1 > dstSize )
+                return( -1 );
+            dst[len++] = (u_int8)(delta & 0x7f);
+        }
+        else {
+            if( len + 3 > dstSize )
+                return( -1 );
+            dst[len++] = Z51_RLE_RAW;
+            dst[len++] = (u_int8)src[i];
+            dst[len++] = (u_int8)(src[i] >> 8);
+        }
+        prev = src[i++];
+    }
+
+    return( (int32)len );
+}
+
+/******************************* Z51_RleDecode *****************************/
+/** Decode a complete block in the Z51_FMT_RLE format
+ *
+ *  This is the user space counterpart of the driver's decoder, e.g. to
+ *  verify encoded data before it is written. The previous value starts
+ *  with 0.
+ *
+ *  \param src        \IN  encoded data
+ *  \param size       \IN  size of encoded data [bytes]
+ *  \param dst        \OUT decoded values
+ *  \param max        \IN  max. number of values in dst
+ *
+ *  \return           number of decoded values or -1 on invalid data or
+ *                    if dst is too small
+ */
+int32 Z51_RleDecode(
+    const u_int8  *src,
+    u_int32       size,
+    u_int16       *dst,
+    u_int32       max )
+{
+    const u_int8 *end = src + size;
+    u_int32      n = 0, cnt;
+    u_int16      prev = 0;
+    u_int8       tag;
+
+    while( src < end ) {
+        tag = *src++;
+
+        if( tag < Z51_RLE_HOLD ) {
+            if( n >= max )
+                return( -1 );
+            prev = (u_int16)(prev + ((int8)(tag << 1) >> 1));
+            dst[n++] = prev;
+            continue;
+        }
+
+        if( tag == Z51_RLE_RAW ) {
+            if( end - src < 2 || n >= max )
+                return( -1 );
+            prev = (u_int16)(src[0] | (src[1] << 8));
+            src += 2;
+            dst[n++] = prev;
+            continue;
+        }
+
+        if( tag < Z51_RLE_LHOLD )
+            cnt = (tag & 0x3f) + 1;
+        else if( tag < Z51_RLE_RSVD && src < end )
+            cnt = (((tag & 0x1f) << 8) | *src++) + 65;
+        else
+            return( -1 );
+
+        if( cnt > max - n )
+            return( -1 );
+        while( cnt-- )
+            dst[n++] = prev;
+    }
+
+    return( (int32)n );
+}
+
+/**********************************************************************/
+/** Convert one value in engineering units to an input value
+ *
+ *  \param x          \IN  value
+ *  \param lo         \IN  value for input value 0x0000
+ *  \param scale      \IN  0xffff / (hi - lo)
+ *
+ *  \return           input value
+ */
+static u_int16 unitsToCode( float x, float lo, float scale )
+{
+    float y = (x - lo) * scale;
+
+    /* same operand order as SSE max/min: NaN results in 0 */
+    y = (y > 0.0f) ? y : 0.0f;
+    y = (y < UNITS_CODE_MAX) ? y : UNITS_CODE_MAX;
+
+    y = (y + UNITS_ROUND) - UNITS_ROUND;
+    return( (u_int16)(int32)y );
+}
+
+/**************************** Z51_UnitsToCode ******************************/
+/** Convert values in engineering units to input values
+ *
+ *  The values are scaled linearly so that \\a lo maps to input value
+ *  0x0000 and \\a hi to 0xffff, e.g. lo=-10.0, hi=10.0 for a +/-10 V
+ *  output or lo=4.0, hi=20.0 for a 4..20 mA output. Results are rounded
+ *  to the nearest input value (ties to even) and saturated; NaN results in
+ *  0x0000. The input values are calibrated by the driver as usual, so the
+ *  output can be written with M_setblock() in format Z51_FMT_NATIVE.
+ *
+ *  With SSE2 eight values are converted per iteration. The result is
+ *  bit-exact with Z51_UnitsToCodeRef().
+ *
+ *  \param src        \IN  values in engineering units
+ *  \param n          \IN  number of values
+ *  \param lo         \IN  value for input value 0x0000
+ *  \param hi         \IN  value for input value 0xffff (hi != lo)
+ *  \param dst        \OUT input values (may not overlap src)
+ */
+void Z51_UnitsToCode(
+    const float   *src,
+    u_int32       n,
+    float         lo,
+    float         hi,
+    u_int16       *dst )
+{
+    float   scale = UNITS_CODE_MAX / (hi - lo);
+    u_int32 i = 0;
+
+#ifdef __SSE2__
+    const __m128  vLo    = _mm_set1_ps( lo );
+    const __m128  vScale = _mm_set1_ps( scale );
+    const __m128  vZero  = _mm_setzero_ps();
+    const __m128  vMax   = _mm_set1_ps( UNITS_CODE_MAX );
+    const __m128  vRound = _mm_set1_ps( UNITS_ROUND );
+    const __m128i vBias  = _mm_set1_epi32( 0x8000 );
+    const __m128i vFlip  = _mm_set1_epi16( (short)0x8000 );
+    __m128  a, b;
+    __m128i c;
+
+    for( ; i + 8 <= n; i += 8 ) {
+        a = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( src + i ), vLo ), vScale );
+        b = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( src + i + 4 ), vLo ), vScale );
+
+        a = _mm_min_ps( _mm_max_ps( a, vZero ), vMax );
+        b = _mm_min_ps( _mm_max_ps( b, vZero ), vMax );
+
+        a = _mm_sub_ps( _mm_add_ps( a, vRound ), vRound );
+        b = _mm_sub_ps( _mm_add_ps( b, vRound ), vRound );
+
+        /* SSE2 has only a signed 32->16 bit pack, so pack offset binary */
+        c = _mm_packs_epi32( _mm_sub_epi32( _mm_cvttps_epi32( a ), vBias ),
+                             _mm_sub_epi32( _mm_cvttps_epi32( b ), vBias ) );
+        _mm_storeu_si128( (__m128i*)(dst + i), _mm_xor_si128( c, vFlip ) );
+    }
+#endif
+
+    for( ; i < n; i++ )
+        dst[i] = unitsToCode( src[i], lo, scale );
+}
+
+/************************** Z51_UnitsToCodeRef *****************************/
+/** Scalar reference of Z51_UnitsToCode()
+ *
+ *  \param src        \IN  values in engineering units
+ *  \param n          \IN  number of values
+ *  \param lo         \IN  value for input value 0x0000
+ *  \param hi         \IN  value for input value 0xffff (hi != lo)
+ *  \param dst        \OUT input values
+ */
+void Z51_UnitsToCodeRef(
+    const float   *src,
+    u_int32       n,
+    float         lo,
+    float         hi,
+    u_int16       *dst )
+{
+    float   scale = UNITS_CODE_MAX / (hi - lo);
+    u_int32 i;
+
+    for( i=0; i<n; i++ )
+        dst[i] = unitsToCode( src[i], lo, scale );
+}
+
+/******************************* Z51_MpscCreate ****************************/
+/** Create a multi-producer submission queue
+ *
+ *  Any number of threads may submit channel updates with Z51_MpscPut() or
+ *  Z51_MpscPutAt() without locking; a single dispatcher thread takes them
+ *  with Z51_MpscDispatch() or Z51_MpscDrain(). The queue is a bounded
+ *  ring: producers claim slots with one compare-and-swap, each slot
+ *  carries a sequence number that tells producer and consumer whether it
+ *  is free or filled.
+ *
+ *  \param slots      \IN  queue size, rounded up to a power of two
+ *  \param units      \IN  number of units of the device (Z51_UNITS)
+ *
+ *  \return           queue or NULL on error
+ */
+Z51_MPSC* Z51_MpscCreate(
+    u_int32 slots,
+    u_int32 units )
+{
+    Z51_MPSC *q;
+    u_int32  n, i;
+
+    if( units < 1 || units > Z51_UNITS_MAX || slots < 1 || slots > 0x10000000 )
+        return( NULL );
+
+    for( n=1; n<slots; n<<=1 )
+        ;
+
+    q = (Z51_MPSC*)calloc( 1, sizeof(Z51_MPSC) + (n - 1) * sizeof(MPSC_SLOT) );
+    if( q == NULL )
+        return( NULL );
+
+    q->mask     = n - 1;
+    q->units    = units;
+    q->chNumber = units * 3 + (units > 1 ? 1 : 0);
+    q->curCh    = -1;
+
+    for( i=0; i<n; i++ )
+        q->slot[i].seq = i;
+
+    return( q );
+}
+
+/******************************* Z51_MpscDelete ****************************/
+/** Delete a submission queue, entries still queued are discarded
+ *
+ *  \param q          \IN  queue or NULL
+ */
+void Z51_MpscDelete( Z51_MPSC *q )
+{
+    free( q );
+}
+
+/******************************* Z51_MpscPut *******************************/
+/** Submit a channel update without deadline
+ *
+ *  \param q          \IN  queue
+ *  \param ch         \IN  channel
+ *  \param value      \IN  value as for M_write() on \a ch
+ *
+ *  \return           0 or -1 if the queue is full or \a ch is invalid
+ */
+int32 Z51_MpscPut(
+    Z51_MPSC *q,
+    int32    ch,
+    u_int32  value )
+{
+    return( Z51_MpscPutAt( q, ch, value, 0 ) );
+}
+
+/******************************* Z51_MpscPutAt *****************************/
+/** Submit a channel update with deadline
+ *
+ *  May be called by any number of threads at the same time. Updates not
+ *  taken by the dispatcher until \a deadline are dropped. A full queue is
+ *  counted (Z51_MPSC_STATS.full) and reported to the caller, which may
+ *  retry or drop the update.
+ *
+ *  \param q          \IN  queue
+ *  \param ch         \IN  channel
+ *  \param value      \IN  value as for M_write() on \a ch
+ *  \param deadline   \IN  UOS_MsecTimerGet() time the update is valid to,
+ *                         0 for no deadline
+ *
+ *  \return           0 or -1 if the queue is full or \a ch is invalid
+ */
+int32 Z51_MpscPutAt(
+    Z51_MPSC *q,
+    int32    ch,
+    u_int32  value,
+    u_int32  deadline )
+{
+    MPSC_SLOT *s;
+    u_int32   pos, seq;
+
+    if( ch < 0 || (u_int32)ch >= q->chNumber )
+        return( -1 );
+
+    pos = ATOMIC_LOAD( &q->tail );
+    for(;;) {
+        s   = &q->slot[pos & q->mask];
+        seq = ATOMIC_LOAD( &s->seq );
+
+        if( seq == pos ) {
+            /* slot free: claim it (pos is reloaded on failure) */
+            if( ATOMIC_CAS( &q->tail, &pos, pos + 1 ) )
+                break;
+        }
+        else if( (int32)(seq - pos) < 0 ) {
+            /* slot not yet taken by the consumer */
+            ATOMIC_INC( &q->full );
+            return( -1 );
+        }
+        else {
+            /* another producer claimed it */
+            pos = ATOMIC_LOAD( &q->tail );
+        }
+    }
+
+    s->ch       = ch;
+    s->value    = value;
+    s->deadline = deadline;
+    ATOMIC_STORE( &s->seq, pos + 1 );         /* publish */
+
+    return( 0 );
+}
+
+/******************************* Z51_MpscDrain *****************************/
+/** Take the queued updates, coalesced to the newest one per channel
+ *
+ *  Must only be called by one thread at a time (the dispatcher). Takes at
+ *  most one queue size of entries, so producers can't keep it busy.
+ *
+ *  \param q          \IN  queue
+ *  \param now        \IN  UOS_MsecTimerGet() time to check deadlines
+ *  \param out        \OUT updates in submission order, space for
+ *                         Z51_MPSC_CH_MAX entries
+ *
+ *  \return           number of updates
+ */
+int32 Z51_MpscDrain(
+    Z51_MPSC        *q,
+    u_int32         now,
+    Z51_MPSC_ENTRY  *out )
+{
+    int8           idx[Z51_MPSC_CH_MAX];    /* out[] index per channel */
+    MPSC_SLOT      *s;
+    Z51_MPSC_ENTRY e;
+    u_int32        i, j, n = 0;
+
+    for( i=0; i<Z51_MPSC_CH_MAX; i++ )
+        idx[i] = -1;
+
+    for( i=0; i<=q->mask; i++ ) {
+        s = &q->slot[q->head & q->mask];
+        if( ATOMIC_LOAD( &s->seq ) != q->head + 1 )
+            break;                          /* empty */
+
+        e.ch       = s->ch;
+        e.value    = s->value;
+        e.deadline = s->deadline;
+        e.seq      = q->head;
+
+        /* release the slot for the producers of the next round */
+        ATOMIC_STORE( &s->seq, q->head + q->mask + 1 );
+        q->head++;
+        q->stats.puts++;
+
+        if( e.deadline && (int32)(now - e.deadline) > 0 ) {
+            q->stats.expired++;
+        }
+        else if( idx[e.ch] >= 0 ) {
+            out[(int32)idx[e.ch]] = e;
+            q->stats.coalesced++;
+        }
+        else {
+            idx[e.ch] = (int8)n;
+            out[n++]  = e;
+        }
+    }
+
+    /* coalesced entries take the position of the newest update */
+    for( i=1; i<n; i++ ) {
+        e = out[i];
+        for( j=i; j>0 && (int32)(out[j-1].seq - e.seq) > 0; j-- )
+            out[j] = out[j-1];
+        out[j] = e;
+    }
+
+    return( (int32)n );
+}
+
+/******************************* Z51_MpscDispatch **************************/
+/** Write the queued updates to the device
+ *
+ *  Takes the updates with Z51_MpscDrain() and merges them per unit: when
+ *  both outputs of a unit changed, they are written at once over the
+ *  unit's channel driving both outputs, otherwise over the single output
+ *  channel. When two or more units changed and the values of all outputs
+ *  are known, all units are written by one block write of one frame on
+ *  the group channel, using the block settings of channel 0 (which must
+ *  be the defaults: format Z51_FMT_NATIVE, no interpolation, synchronous).
+ *
+ *  The dispatcher owns \a path: the current channel is only changed when
+ *  needed and is expected to stay unchanged between calls.
+ *
+ *  \param q          \IN  queue
+ *  \param path       \IN  path of the device
+ *
+ *  \return           number of M_write()/M_setblock() calls or -1 on
+ *                    error (see UOS_ErrnoGet())
+ */
+int32 Z51_MpscDispatch(
+    Z51_MPSC  *q,
+    MDIS_PATH path )
+{
+    Z51_MPSC_ENTRY e[Z51_MPSC_CH_MAX];
+    u_int32        frame[Z51_UNITS_MAX];
+    u_int32        dirty = 0;               /* changed lanes */
+    u_int32        all = (1 << (2 * q->units)) - 1;
+    u_int32        n, i, u, m, sub, units = 0;
+    int32          writes = 0;
+
+    n = (u_int32)Z51_MpscDrain( q, UOS_MsecTimerGet(), e );
+
+    for( i=0; i<n; i++ ) {
+        if( (u_int32)e[i].ch == q->units * 3 ) {    /* group channel */
+            for( u=0; u<q->units; u++ ) {
+                q->shadow[2*u]   = (u_int16)e[i].value;
+                q->shadow[2*u+1] = (u_int16)(e[i].value >> 16);
+            }
+            dirty = all;
+            continue;
+        }
+
+        u   = e[i].ch / 3;
+        sub = e[i].ch % 3;
+        if( sub != 1 ) {
+            q->shadow[2*u] = (u_int16)e[i].value;
+            dirty |= 1 << (2 * u);
+        }
+        if( sub == 1 ) {
+            q->shadow[2*u+1] = (u_int16)e[i].value;
+            dirty |= 2 << (2 * u);
+        }
+        else if( sub == 2 ) {
+            q->shadow[2*u+1] = (u_int16)(e[i].value >> 16);
+            dirty |= 2 << (2 * u);
+        }
+    }
+    q->known |= dirty;
+
+    for( u=0; u<q->units; u++ )
+        if( (dirty >> (2 * u)) & 3 )
+            units++;
+
+    if( units > 1 && q->known == all ) {
+        /* all units updated in the same output bank */
+        for( u=0; u<q->units; u++ )
+            frame[u] = ((u_int32)q->shadow[2*u+1] << 16) | q->shadow[2*u];
+
+        if( mpscSelect( q, path, (int32)q->units * 3 ) ||
+            M_setblock( path, (u_int8*)frame, (int32)(q->units * 4) ) < 0 )
+            return( -1 );
+        writes++;
+    }
+    else {
+        for( u=0; u<q->units; u++ ) {
+            m = (dirty >> (2 * u)) & 3;
+            if( m == 0 )
+                continue;
+
+            if( mpscSelect( q, path, (int32)(3 * u + (m == 3 ? 2 : m - 1)) ) ||
+                M_write( path, m == 3 ?
+                         (int32)(((u_int32)q->shadow[2*u+1] << 16) |
+                                 q->shadow[2*u]) :
+                         (int32)q->shadow[2*u + m - 1] ) < 0 )
+                return( -1 );
+            writes++;
+        }
+    }
+
+    q->stats.writes += writes;
+    return( writes );
+}
+
+/******************************* Z51_MpscStats *****************************/
+/** Get the counters of a submission queue
+ *
+ *  The counters are updated without locking, so they are approximate
+ *  while producers or the dispatcher are running.
+ *
+ *  \param q          \IN  queue
+ *  \param st         \OUT counters
+ */
+void Z51_MpscStats(
+    Z51_MPSC       *q,
+    Z51_MPSC_STATS *st )
+{
+    *st      = q->stats;
+    st->full = ATOMIC_LOAD( &q->full );
+}
+
+/****************************** Z51_MixerCreate ****************************/
+/** Create a waveform mixer
+ *
+ *  A mixer sums up to Z51_MIX_LAYERS_MAX layers, each with its own gain,
+ *  into one stream of signed values, e.g. a slow bias ramp, a stimulus
+ *  waveform and a small dither for one output. Z51_MixerRender() produces
+ *  the values for block writes in format Z51_FMT_S16; calibration is
+ *  applied by the driver as usual.
+ *
+ *  \return           mixer or NULL if out of memory
+ */
+Z51_MIXER* Z51_MixerCreate( void )
+{
+    Z51_MIXER *m;
+    double    s = 0.0, c = 1.0, t;
+    u_int32   i;
+
+    if( (m = (Z51_MIXER*)calloc( 1, sizeof(Z51_MIXER) )) == NULL )
+        return( NULL );
+
+    /* sine table by rotation, so no math library is needed */
+    for( i=0; i<=MIX_SINE_LEN; i++ ) {
+        m->sine[i] = (int16)(s * MIX_SINE_AMP + (s < 0 ? -0.5 : 0.5));
+        t = s * MIX_COS_STEP + c * MIX_SIN_STEP;
+        c = c * MIX_COS_STEP - s * MIX_SIN_STEP;
+        s = t;
+    }
+    m->sine[0] = m->sine[MIX_SINE_LEN / 2] = m->sine[MIX_SINE_LEN] = 0;
+
+    return( m );
+}
+
+/****************************** Z51_MixerDelete ****************************/
+/** Delete a mixer
+ *
+ *  \param m          \IN  mixer or NULL
+ */
+void Z51_MixerDelete( Z51_MIXER *m )
+{
+    free( m );
+}
+
+/****************************** Z51_MixerAdd *******************************/
+/** Add a layer to a mixer
+ *
+ *  May be called by any thread while another one renders; the layer
+ *  takes effect with the next MIX_CHUNK values rendered. The parameters
+ *  are copied, a BUFFER layer's values are referenced until the layer is
+ *  removed. A BUFFER layer without loop is removed automatically after
+ *  its last value, a RAMP layer keeps its end value.
+ *
+ *  \param m          \IN  mixer
+ *  \param layer      \IN  layer parameters
+ *
+ *  \return           layer ID (>= 0) or -1 on invalid parameters or if
+ *                    all layers are in use
+ */
+int32 Z51_MixerAdd(
+    Z51_MIXER           *m,
+    const Z51_MIX_LAYER *layer )
+{
+    MIX_SLOT *s;
+    u_int32  i, st, gen;
+
+    if( (layer->type == Z51_MIX_BUFFER && (!layer->buf || !layer->len)) ||
+        layer->type < Z51_MIX_BUFFER || layer->type > Z51_MIX_NOISE )
+        return( -1 );
+
+    for( i=0; i<Z51_MIX_LAYERS_MAX; i++ ) {
+        s  = &m->slot[i];
+        st = ATOMIC_LOAD( &s->state );
+        if( MIX_STATE( st ) != MIX_FREE )
+            continue;
+
+        gen = MIX_GEN( st + 4 );
+        if( !ATOMIC_CAS( &s->state, &st, (gen << 2) | MIX_NEW ) )
+            continue;                       /* taken by another thread */
+
+        s->par  = *layer;
+        s->gain = (u_int16)layer->gain;
+        s->pos  = 0;
+
+        switch( layer->type ) {
+            case Z51_MIX_DDS:
+                s->acc = layer->phase;
+                break;
+            case Z51_MIX_RAMP:
+                s->acc = (u_int32)((int32)layer->from * 0x8000);
+                break;
+            case Z51_MIX_NOISE:
+                s->acc = layer->phase ? layer->phase : 1;
+                break;
+            default:
+                s->acc = 0;
+        }
+
+        ATOMIC_STORE( &s->state, (gen << 2) | MIX_ACTIVE );
+        return( (int32)((gen << 4) | i) );
+    }
+
+    return( -1 );
+}
+
+/****************************** Z51_MixerRemove ****************************/
+/** Remove a layer from a mixer
+ *
+ *  May be called by any thread while another one renders. The layer is
+ *  no longer used by Z51_MixerRender() calls started after the return,
+ *  so its buffer may be released when such a call has completed.
+ *
+ *  \param m          \IN  mixer
+ *  \param id         \IN  layer ID from Z51_MixerAdd()
+ *
+ *  \return           0 or -1 if the layer does not exist (any more)
+ */
+int32 Z51_MixerRemove(
+    Z51_MIXER *m,
+    int32     id )
+{
+    MIX_SLOT *s = &m->slot[id & (Z51_MIX_LAYERS_MAX - 1)];
+    u_int32  st = (((u_int32)id >> 4) << 2) | MIX_ACTIVE;
+
+    if( id < 0 )
+        return( -1 );
+
+    return( ATOMIC_CAS( &s->state, &st, (st & ~3) | MIX_REMOVED ) ? 0 : -1 );
+}
+
+/****************************** Z51_MixerGain ******************************/
+/** Change the gain of a layer
+ *
+ *  May be called by any thread while another one renders; the new gain
+ *  applies from the next MIX_CHUNK values rendered.
+ *
+ *  \param m          \IN  mixer
+ *  \param id         \IN  layer ID from Z51_MixerAdd()
+ *  \param gain       \IN  gain, Z51_MIX_GAIN_ONE is 1.0
+ *
+ *  \return           0 or -1 if the layer does not exist (any more)
+ */
+int32 Z51_MixerGain(
+    Z51_MIXER *m,
+    int32     id,
+    int16     gain )
+{
+    MIX_SLOT *s = &m->slot[id & (Z51_MIX_LAYERS_MAX - 1)];
+    u_int32  st = (((u_int32)id >> 4) << 2) | MIX_ACTIVE;
+
+    if( id < 0 || ATOMIC_LOAD( &s->state ) != st )
+        return( -1 );
+
+    ATOMIC_STORE( &s->gain, (u_int16)gain );
+    return( 0 );
+}
+
+/****************************** Z51_MixerRender ****************************/
+/** Render the sum of all layers
+ *
+ *  Each layer is generated and added with saturation in passes of
+ *  MIX_CHUNK values, so the sum stays in the first level cache and each
+ *  layer adds about the same cost. With SSE2 eight values are scaled and
+ *  added per instruction. Must only be called by one thread at a time.
+ *
+ *  \param m          \IN  mixer
+ *  \param dst        \OUT signed values, for block write in format
+ *                         Z51_FMT_S16
+ *  \param n          \IN  number of values
+ *
+ *  \return           number of layers active at the end
+ */
+int32 Z51_MixerRender(
+    Z51_MIXER *m,
+    int16     *dst,
+    u_int32   n )
+{
+    int16    tmp[MIX_CHUNK];
+    MIX_SLOT *s;
+    u_int32  i, cnt, st, active = 0;
+    int16    gain;
+    int      more;
+
+    for( ; n; n -= cnt, dst += cnt ) {
+        cnt = n < MIX_CHUNK ? n : MIX_CHUNK;
+        memset( dst, 0, cnt * sizeof(int16) );
+
+        for( i=0, active=0; i<Z51_MIX_LAYERS_MAX; i++ ) {
+            s  = &m->slot[i];
+            st = ATOMIC_LOAD( &s->state );
+
+            if( MIX_STATE( st ) == MIX_REMOVED )
+                ATOMIC_STORE( &s->state, st & ~3 );     /* free */
+            if( MIX_STATE( st ) != MIX_ACTIVE )
+                continue;
+
+            active++;
+            gain = (int16)ATOMIC_LOAD( &s->gain );
+            more = mixGenerate( m, s, tmp, cnt );
+            mixAdd( dst, tmp, cnt, gain );
+
+            /* ended: free the slot, unless it was removed meanwhile */
+            if( !more && !ATOMIC_CAS( &s->state, &st, st & ~3 ) )
+                ATOMIC_STORE( &s->state, st & ~3 );
+        }
+    }
+
+    return( (int32)active );
+}
+
+/****************************** Z51_NsecTimerGet ***************************/
+/** Get the time of a monotonic clock
+ *
+ *  Unlike UOS_MsecTimerGet() the clock doesn't wrap around and isn't
+ *  changed by setting the system time.
+ *
+ *  \return           time [ns], the start is arbitrary
+ */
+u_int64 Z51_NsecTimerGet( void )
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER        cnt;
+
+    if( freq.QuadPart == 0 )
+        QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &cnt );
+
+    return( (u_int64)(cnt.QuadPart / freq.QuadPart) * PACE_NS +
+            (u_int64)(cnt.QuadPart % freq.QuadPart) * PACE_NS /
+            (u_int64)freq.QuadPart );
+#else
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (u_int64)ts.tv_sec * PACE_NS + (u_int64)ts.tv_nsec );
+#endif
+}
+
+/******************************* Z51_PaceCreate ****************************/
+/** Create a pacer
+ *
+ *  A pacer lets a loop run once per period on absolute deadlines, so the
+ *  time the loop body takes and the wake-up latency don't add up to drift
+ *  as with UOS_Delay() between outputs. Z51_PaceWait() sleeps until
+ *  \a spinNs before the deadline and spins for the rest, which bounds the
+ *  jitter by the clock instead of the scheduler. Periods shorter than the
+ *  spin tail are paced by spinning only, so at 10..100 kHz the loop
+ *  occupies a CPU.
+ *
+ *  The first deadline is one period after creation (see Z51_PaceReset()).
+ *
+ *  \param periodNs   \IN  period [ns]
+ *  \param spinNs     \IN  spin tail [ns], e.g. Z51_PACE_SPIN_DEFAULT;
+ *                         0 to only sleep
+ *
+ *  \return           pacer or NULL on error
+ */
+Z51_PACE* Z51_PaceCreate(
+    u_int64 periodNs,
+    u_int32 spinNs )
+{
+    Z51_PACE *p;
+
+    if( periodNs == 0 )
+        return( NULL );
+
+    if( (p = (Z51_PACE*)calloc( 1, sizeof(Z51_PACE) )) == NULL )
+        return( NULL );
+
+    p->period = periodNs;
+    p->spin   = spinNs;
+    Z51_PaceReset( p );
+
+    return( p );
+}
+
+/******************************* Z51_PaceDelete ****************************/
+/** Delete a pacer
+ *
+ *  \param p          \IN  pacer or NULL
+ */
+void Z51_PaceDelete( Z51_PACE *p )
+{
+    free( p );
+}
+
+/******************************* Z51_PaceReset *****************************/
+/** Restart the deadlines one period from now and clear the counters
+ *
+ *  E.g. after the loop was paused.
+ *
+ *  \param p          \IN  pacer
+ */
+void Z51_PaceReset( Z51_PACE *p )
+{
+    memset( &p->stats, 0, sizeof(p->stats) );
+    p->next = Z51_NsecTimerGet() + p->period;
+}
+
+/******************************* Z51_PaceWait ******************************/
+/** Wait for the end of the current period
+ *
+ *  If called after the deadline (overrun), returns at once. Periods that
+ *  ended completely meanwhile are skipped and their number is returned,
+ *  so the deadlines stay on their grid and the caller can advance its
+ *  waveform accordingly instead of catching up with a burst of outputs.
+ *
+ *  \param p          \IN  pacer
+ *
+ *  \return           number of skipped periods (0 if in time)
+ */
+int32 Z51_PaceWait( Z51_PACE *p )
+{
+    u_int64 now = Z51_NsecTimerGet();
+    u_int64 late;
+    u_int32 missed = 0;
+
+    p->stats.periods++;
+
+    if( now >= p->next ) {
+        missed = (u_int32)((now - p->next) / p->period);
+        p->next += (u_int64)missed * p->period;
+        p->stats.overruns++;
+        p->stats.missed += missed;
+    }
+    else {
+        if( p->next - now > p->spin ) {
+            paceSleep( p->next - p->spin );
+            p->stats.sleeps++;
+
+            now = Z51_NsecTimerGet();
+            if( now > p->next )
+                p->stats.oversleeps++;
+        }
+
+        while( now < p->next ) {
+            PACE_RELAX();
+            now = Z51_NsecTimerGet();
+        }
+
+        late = now - p->next;
+        p->stats.lateSum += late;
+        if( late > p->stats.lateMax )
+            p->stats.lateMax = (u_int32)(late < 0xffffffff ? late : 0xffffffff);
+    }
+
+    p->next += p->period;
+    return( (int32)missed );
+}
+
+/******************************* Z51_PaceStats *****************************/
+/** Get the counters of a pacer
+ *
+ *  The average delay after the deadline is
+ *  lateSum / (periods - overruns).
+ *
+ *  \param p          \IN  pacer
+ *  \param st         \OUT counters
+ */
+void Z51_PaceStats(
+    Z51_PACE       *p,
+    Z51_PACE_STATS *st )
+{
+    *st = p->stats;
+}
+
+/******************************* Z51_SafeCreate ****************************/
+/** Create a trigger for the safe state of several devices
+ *
+ *  Z51_SafeFire() sets Z51_SAFE_STATE on all devices at once: one helper
+ *  thread per device except the first waits for the trigger, the caller
+ *  of Z51_SafeFire() handles the first device itself. So the time to safe
+ *  is about the time of the slowest device instead of the sum over all
+ *  devices. The helper threads inherit the scheduling policy and priority
+ *  of the caller, create the trigger from a real-time thread to keep
+ *  them from being delayed by the application.
+ *
+ *  The paths must stay open until Z51_SafeDelete(). The safe values and
+ *  powerdown modes are set per device before (Z51_SAFE_VALUE,
+ *  Z51_SAFE_PD).
+ *
+ *  \param path       \IN  paths of the devices
+ *  \param n          \IN  number of paths (1..Z51_SAFE_DEV_MAX)
+ *
+ *  \return           trigger or NULL on error
+ */
+Z51_SAFE* Z51_SafeCreate(
+    const MDIS_PATH *path,
+    u_int32         n )
+{
+    Z51_SAFE *s;
+    u_int32  i;
+
+    if( n == 0 || n > Z51_SAFE_DEV_MAX )
+        return( NULL );
+
+    if( (s = (Z51_SAFE*)calloc( 1, sizeof(Z51_SAFE) )) == NULL )
+        return( NULL );
+
+    s->n = n;
+    for( i=0; i<n; i++ ) {
+        s->dev[i].s    = s;
+        s->dev[i].path = path[i];
+    }
+
+#ifndef _WIN32
+    pthread_mutex_init( &s->fire, NULL );
+    pthread_mutex_init( &s->lock, NULL );
+    pthread_cond_init( &s->go, NULL );
+    pthread_cond_init( &s->done, NULL );
+
+    /* helper threads start with gen 0 as seen, see safeThread() */
+    for( i=1; i<n; i++ ) {
+        if( pthread_create( &s->dev[i].tid, NULL, safeThread,
+                            &s->dev[i] ) ) {
+            Z51_SafeDelete( s );
+            return( NULL );
+        }
+        s->threads++;
+    }
+#endif
+
+    return( s );
+}
+
+/******************************* Z51_SafeDelete ****************************/
+/** Delete a safe state trigger
+ *
+ *  Stops the helper threads, the devices and paths are not changed.
+ *
+ *  \param s          \IN  trigger or NULL
+ */
+void Z51_SafeDelete( Z51_SAFE *s )
+{
+#ifndef _WIN32
+    u_int32 i;
+#endif
+
+    if( s == NULL )
+        return;
+
+#ifndef _WIN32
+    pthread_mutex_lock( &s->lock );
+    s->quit = 1;
+    pthread_cond_broadcast( &s->go );
+    pthread_mutex_unlock( &s->lock );
+
+    for( i=1; i<=s->threads; i++ )
+        pthread_join( s->dev[i].tid, NULL );
+
+    pthread_cond_destroy( &s->done );
+    pthread_cond_destroy( &s->go );
+    pthread_mutex_destroy( &s->lock );
+    pthread_mutex_destroy( &s->fire );
+#endif
+
+    free( s );
+}
+
+/******************************* Z51_SafeFire ******************************/
+/** Put all devices of a trigger into the safe state
+ *
+ *  Sets Z51_SAFE_STATE to 1 on all devices in parallel and returns when
+ *  all devices are done. A device that fails doesn't stop the others.
+ *  Calls from several threads are serialized. On _WIN32 the devices are
+ *  set one after the other.
+ *
+ *  \param s          \IN  trigger
+ *  \param nsP        \OUT time to safe of the slowest device [ns]
+ *                         (may be NULL)
+ *
+ *  \return           number of devices that failed (0 if all are safe)
+ */
+int32 Z51_SafeFire(
+    Z51_SAFE *s,
+    u_int64  *nsP )
+{
+    u_int64 start;
+    int32   failed;
+#ifdef _WIN32
+    u_int32 i;
+#else
+    int32   err;
+#endif
+
+    start = Z51_NsecTimerGet();
+
+#ifdef _WIN32
+    failed = 0;
+    for( i=0; i<s->n; i++ )
+        if( M_setstat( s->dev[i].path, Z51_SAFE_STATE, 1 ) )
+            failed++;
+#else
+    pthread_mutex_lock( &s->fire );
+
+    pthread_mutex_lock( &s->lock );
+    s->left   = s->n;
+    s->failed = 0;
+    s->gen++;
+    pthread_cond_broadcast( &s->go );
+    pthread_mutex_unlock( &s->lock );
+
+    err = M_setstat( s->dev[0].path, Z51_SAFE_STATE, 1 );
+
+    pthread_mutex_lock( &s->lock );
+    safeDone( s, err );
+    while( s->left )
+        pthread_cond_wait( &s->done, &s->lock );
+    failed = (int32)s->failed;
+    pthread_mutex_unlock( &s->lock );
+
+    pthread_mutex_unlock( &s->fire );
+#endif
+
+    if( nsP )
+        *nsP = Z51_NsecTimerGet() - start;
+
+    return( failed );
+}
+
+/******************************* mpscSelect ********************************/
+/** Make \a ch the current channel of the dispatcher's path
+ *
+ *  \param q          \IN  queue
+ *  \param path       \IN  path of the device
+ *  \param ch         \IN  channel
+ *
+ *  \return           0 or -1 on error
+ */
+static int32 mpscSelect(
+    Z51_MPSC  *q,
+    MDIS_PATH path,
+    int32     ch )
+{
+    if( q->curCh == ch )
+        return( 0 );
+
+    if( M_setstat( path, M_MK_CH_CURRENT, ch ) ) {
+        q->curCh = -1;
+        return( -1 );
+    }
+    q->curCh = ch;
+    return( 0 );
+}
+
+/******************************* mixGenerate *******************************/
+/** Generate the next values of a mixer layer
+ *
+ *  \param m          \IN  mixer
+ *  \param s          \IN  layer
+ *  \param dst        \OUT values
+ *  \param n          \IN  number of values
+ *
+ *  \return           0 if the layer has ended (BUFFER without loop)
+ */
+static int mixGenerate(
+    Z51_MIXER *m,
+    MIX_SLOT  *s,
+    int16     *dst,
+    u_int32   n )
+{
+    const Z51_MIX_LAYER *par = &s->par;
+    u_int32             i, k, cnt, x;
+    int32               a, b, step;
+
+    switch( par->type ) {
+        case Z51_MIX_BUFFER:
+            for( i=0; i<n; i+=cnt ) {
+                if( s->pos == par->len ) {
+                    if( !par->loop ) {
+                        memset( dst + i, 0, (n - i) * sizeof(int16) );
+                        return( 0 );
+                    }
+                    s->pos = 0;
+                }
+                cnt = par->len - s->pos;
+                if( cnt > n - i )
+                    cnt = n - i;
+                memcpy( dst + i, par->buf + s->pos, cnt * sizeof(int16) );
+                s->pos += cnt;
+            }
+            break;
+
+        case Z51_MIX_DDS:
+            /* table lookup with linear interpolation, 15 bit fraction */
+            for( i=0, x=s->acc; i<n; i++, x+=par->step ) {
+                k = x >> (32 - MIX_SINE_BITS);
+                a = m->sine[k];
+                b = m->sine[k+1];
+                dst[i] = (int16)(a + (((b - a) *
+                         (int32)((x >> (17 - MIX_SINE_BITS)) & 0x7fff)) >> 15));
+            }
+            s->acc = x;
+            break;
+
+        case Z51_MIX_RAMP:
+            /* value << 15, step rounded; the end value is exact */
+            step = par->len ?
+                   ((int32)par->to - par->from) * 0x8000 / (int32)par->len : 0;
+            for( i=0; i<n && s->pos < par->len; i++, s->pos++ ) {
+                dst[i] = (int16)((int32)(s->acc + 0x4000) >> 15);
+                s->acc += (u_int32)step;
+            }
+            for( ; i<n; i++ )
+                dst[i] = par->to;
+            break;
+
+        default:
+            /* xorshift32 */
+            for( i=0, x=s->acc; i<n; i++ ) {
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                dst[i] = (int16)(x >> 16);
+            }
+            s->acc = x;
+    }
+
+    return( 1 );
+}
+
+/******************************* mixAdd ************************************/
+/** Add scaled values with saturation: acc += src * gain
+ *
+ *  The product is rounded (Q14 gain) and saturated before the saturating
+ *  add. The SSE2 and the scalar code give identical results.
+ *
+ *  \param acc        \INOUT sum
+ *  \param src        \IN  values of one layer
+ *  \param n          \IN  number of values
+ *  \param gain       \IN  gain, Z51_MIX_GAIN_ONE is 1.0
+ */
+static void mixAdd(
+    int16       *acc,
+    const int16 *src,
+    u_int32     n,
+    int16       gain )
+{
+    u_int32 i = 0;
+
+#ifdef __SSE2__
+    const __m128i vGain  = _mm_set1_epi16( gain );
+    const __m128i vRound = _mm_set1_epi32( Z51_MIX_GAIN_ONE / 2 );
+    __m128i       x, lo, hi;
+
+    for( ; i + 8 <= n; i += 8 ) {
+        x = _mm_loadu_si128( (const __m128i*)(src + i) );
+
+        if( gain != Z51_MIX_GAIN_ONE ) {
+            /* 32-bit products from low and high halves, back with packs */
+            lo = _mm_mullo_epi16( x, vGain );
+            hi = _mm_mulhi_epi16( x, vGain );
+            x  = _mm_packs_epi32(
+                     _mm_srai_epi32( _mm_add_epi32(
+                         _mm_unpacklo_epi16( lo, hi ), vRound ), 14 ),
+                     _mm_srai_epi32( _mm_add_epi32(
+                         _mm_unpackhi_epi16( lo, hi ), vRound ), 14 ) );
+        }
+
+        _mm_storeu_si128( (__m128i*)(acc + i),
+            _mm_adds_epi16( _mm_loadu_si128( (const __m128i*)(acc + i) ),
+                            x ) );
+    }
+#endif
+
+    for( ; i < n; i++ )
+        acc[i] = mixSat( acc[i] +
+            mixSat( (src[i] * gain + Z51_MIX_GAIN_ONE / 2) >> 14 ) );
+}
+
+/******************************* mixSat ************************************/
+/** Saturate to the int16 range
+ */
+static int16 mixSat( int32 x )
+{
+    return( (int16)(x > 0x7fff ? 0x7fff : (x < -0x8000 ? -0x8000 : x)) );
+}
+
+/******************************** paceSleep ********************************/
+/** Sleep until a time of Z51_NsecTimerGet()
+ *
+ *  May return early, the caller spins for the rest. Windows sleeps whole
+ *  milliseconds of the system timer resolution, so the spin tail should
+ *  be about 2ms there.
+ *
+ *  \param until      \IN  wake-up time [ns]
+ */
+static void paceSleep( u_int64 until )
+{
+#ifdef _WIN32
+    u_int64 now = Z51_NsecTimerGet();
+
+    if( until > now + 1000000 )
+        Sleep( (DWORD)((until - now) / 1000000) );
+#else
+    struct timespec ts;
+
+    ts.tv_sec  = (time_t)(until / PACE_NS);
+    ts.tv_nsec = (long)(until % PACE_NS);
+
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) ==
+           EINTR )
+        ;
+#endif
+}
+
+#ifndef _WIN32
+/******************************* safeThread ********************************/
+/** Helper thread of a safe state trigger: one device
+ *
+ *  Waits for the next Z51_SafeFire() call. Starts with generation 0 as
+ *  seen, so a trigger fired before the thread ran isn't missed.
+ *
+ *  \param arg        \IN  device (SAFE_DEV)
+ *
+ *  \return           NULL
+ */
+static void *safeThread( void *arg )
+{
+    SAFE_DEV *d = (SAFE_DEV*)arg;
+    Z51_SAFE *s = d->s;
+    u_int32  gen = 0;
+    int32    err;
+
+    pthread_mutex_lock( &s->lock );
+    for(;;) {
+        while( s->gen == gen && !s->quit )
+            pthread_cond_wait( &s->go, &s->lock );
+        if( s->quit )
+            break;
+        gen = s->gen;
+        pthread_mutex_unlock( &s->lock );
+
+        err = M_setstat( d->path, Z51_SAFE_STATE, 1 );
+
+        pthread_mutex_lock( &s->lock );
+        safeDone( s, err );
+    }
+    pthread_mutex_unlock( &s->lock );
+
+    return( NULL );
+}
+
+/******************************* safeDone **********************************/
+/** Count a device of the current Z51_SafeFire() call as done
+ *
+ *  Called with s->lock held.
+ *
+ *  \param s          \IN  trigger
+ *  \param err        \IN  result of M_setstat()
+ */
+static void safeDone(
+    Z51_SAFE *s,
+    int32    err )
+{
+    if( err )
+        s->failed++;
+    if( --s->left == 0 )
+        pthread_cond_signal( &s->done );
+}
+#endif
+
+#ifdef _MSC_VER
+/******************************* atomicCas *********************************/
+/** Compare-and-swap for ATOMIC_CAS(), updates *oldP on failure
+ *
+ *  \return           1 if *p was replaced by \a val
+ */
+static int atomicCas(
+    u_int32 *p,
+    u_int32 *oldP,
+    u_int32 val )
+{
+    u_int32 prev = (u_int32)_InterlockedCompareExchange(
+                       (volatile long*)p, (long)val, (long)*oldP );
+
+    if( prev == *oldP )
+        return( 1 );
+    *oldP = prev;
+    return( 0 );
+}
+#endif